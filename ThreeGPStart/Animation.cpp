@@ -0,0 +1,133 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Index within range of the last key at or before time, range must not be empty
+		unsigned int SearchKey(const std::vector<float>& times, const KeyRange& range, float time)
+		{
+			const float* first{ times.data() + range.first };
+			const float* after{ std::upper_bound(first, first + range.count, time) };
+			return after == first ? 0 : (unsigned int)(after - first) - 1;
+		}
+
+		// As SearchKey but starting from the key found last time. Stays put or steps to the next key in O(1),
+		// only searching after a jump such as the clip wrapping around.
+		unsigned int SeekKey(const std::vector<float>& times, const KeyRange& range, float time, unsigned int& cursor)
+		{
+			const float* keyTimes{ times.data() + range.first };
+			const unsigned int key{ cursor };
+
+			if (key < range.count && keyTimes[key] <= time)
+			{
+				if (key + 1 >= range.count || time < keyTimes[key + 1])
+					return key;
+				if (key + 2 >= range.count || time < keyTimes[key + 2])
+					return cursor = key + 1;
+			}
+
+			return cursor = SearchKey(times, range, time);
+		}
+
+		glm::vec3 Blend(const glm::vec3& from, const glm::vec3& to, float blend) { return glm::mix(from, to, blend); }
+		glm::quat Blend(const glm::quat& from, const glm::quat& to, float blend) { return glm::slerp(from, to, blend); }
+
+		// Value at time given the key at or before it, blending towards the next key if there is one
+		template<typename T>
+		T Interpolate(const KeyArrays<T>& keys, const KeyRange& range, unsigned int key, float time)
+		{
+			const unsigned int k{ range.first + key };
+			if (key + 1 >= range.count)
+				return keys.values[k];
+
+			const float span{ keys.times[k + 1] - keys.times[k] };
+			const float blend{ span > 0 ? glm::clamp((time - keys.times[k]) / span, 0.0f, 1.0f) : 0.0f };
+			return blend > 0 ? Blend(keys.values[k], keys.values[k + 1], blend) : keys.values[k];
+		}
+
+		// Time within the clip, wrapped into [0, duration)
+		float WrapTime(const AnimationClip& clip, float time)
+		{
+			if (clip.duration > 0)
+			{
+				time = std::fmod(time, clip.duration);
+				if (time < 0)
+					time += clip.duration;
+			}
+			return time;
+		}
+
+		// Write a node's local transform straight from its sampled parts
+		void SetNodeTransform(NodeHierarchy& hierarchy, unsigned int nodeIndex, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scaling)
+		{
+			glm::mat4 transform{ glm::mat4_cast(rotation) };
+			transform[0] *= scaling.x;
+			transform[1] *= scaling.y;
+			transform[2] *= scaling.z;
+			transform[3] = glm::vec4(position, 1.0f);
+
+			hierarchy.SetLocalTransform(nodeIndex, transform);
+		}
+	}
+
+	// Pose the hierarchy from the clip at time seconds
+	void SampleAnimation(const AnimationClip& clip, float time, NodeHierarchy& hierarchy)
+	{
+		time = WrapTime(clip, time);
+
+		for (const AnimationChannel& channel : clip.channels)
+		{
+			// Assimp always gives at least one key of each kind, the defaults are for clips built by hand
+			const glm::vec3 position{ channel.positions.count == 0 ? glm::vec3(0) :
+				Interpolate(clip.positions, channel.positions, SearchKey(clip.positions.times, channel.positions, time), time) };
+			const glm::quat rotation{ channel.rotations.count == 0 ? glm::quat() :
+				Interpolate(clip.rotations, channel.rotations, SearchKey(clip.rotations.times, channel.rotations, time), time) };
+			const glm::vec3 scaling{ channel.scalings.count == 0 ? glm::vec3(1) :
+				Interpolate(clip.scalings, channel.scalings, SearchKey(clip.scalings.times, channel.scalings, time), time) };
+
+			SetNodeTransform(hierarchy, channel.nodeIndex, position, rotation, scaling);
+		}
+	}
+
+	// Start sampling clip from its first keys
+	void AnimationSampler::SetClip(const AnimationClip* clip)
+	{
+		m_clip = clip;
+		m_cursors.assign(clip ? clip->channels.size() * 3 : 0, 0);
+	}
+
+	// Pose the hierarchy from the clip at time seconds, continuing from the keys used last time
+	void AnimationSampler::Sample(float time, NodeHierarchy& hierarchy)
+	{
+		if (!m_clip)
+			return;
+
+		const AnimationClip& clip{ *m_clip };
+		time = WrapTime(clip, time);
+
+		unsigned int* cursor{ m_cursors.data() };
+		for (const AnimationChannel& channel : clip.channels)
+		{
+			const glm::vec3 position{ channel.positions.count == 0 ? glm::vec3(0) :
+				Interpolate(clip.positions, channel.positions, SeekKey(clip.positions.times, channel.positions, time, cursor[0]), time) };
+			const glm::quat rotation{ channel.rotations.count == 0 ? glm::quat() :
+				Interpolate(clip.rotations, channel.rotations, SeekKey(clip.rotations.times, channel.rotations, time, cursor[1]), time) };
+			const glm::vec3 scaling{ channel.scalings.count == 0 ? glm::vec3(1) :
+				Interpolate(clip.scalings, channel.scalings, SeekKey(clip.scalings.times, channel.scalings, time, cursor[2]), time) };
+
+			SetNodeTransform(hierarchy, channel.nodeIndex, position, rotation, scaling);
+			cursor += 3;
+		}
+	}
+
+	// Skinning matrices for a mesh's bones in the hierarchy's current pose
+	void ComputeSkinPalette(const Span<Bone>& bones, const NodeHierarchy& hierarchy, glm::mat4* palette)
+	{
+		for (size_t b = 0; b < bones.size(); b++)
+			palette[b] = hierarchy.GetWorldTransform(bones[b].nodeIndex) * bones[b].offsetTransform;
+	}
+}
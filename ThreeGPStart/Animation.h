@@ -0,0 +1,37 @@
+#pragma once
+// Keyframed node animation and the skinning matrices it produces
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+
+namespace Helpers
+{
+
+	// Pose the hierarchy: set the local transform of every node the clip animates to its value at time seconds,
+	// wrapping past the end. Call UpdateWorldTransforms afterwards.
+	// Searches every channel's keys, prefer an AnimationSampler for playback.
+	void SampleAnimation(const AnimationClip& clip, float time, NodeHierarchy& hierarchy);
+
+	// Plays one clip, remembering the key each channel last sampled
+	// Playback moving forward a frame at a time then finds its keys without searching
+	class AnimationSampler
+	{
+	private:
+		const AnimationClip* m_clip{ nullptr };
+
+		// Per channel position, rotation and scaling key last used, relative to the channel's ranges
+		std::vector<unsigned int> m_cursors;
+	public:
+		// Start sampling clip, nullptr for none. The clip must outlive the sampler.
+		void SetClip(const AnimationClip* clip);
+		const AnimationClip* GetClip() const { return m_clip; }
+
+		// As SampleAnimation, no allocation and usually no search
+		void Sample(float time, NodeHierarchy& hierarchy);
+	};
+
+	// Skinning matrices for a mesh's bones, taking mesh space vertices from the bind pose to the hierarchy's current pose.
+	// palette needs room for bones.size() matrices.
+	void ComputeSkinPalette(const Span<Bone>& bones, const NodeHierarchy& hierarchy, glm::mat4* palette);
+
+}
@@ -0,0 +1,1459 @@
+#include "Benchmark.h"
+#include "Helper.h"
+#include "Mesh.h"
+#include "Camera.h"
+#include "Model.h"
+#include "ModelTerrain.h"
+#include "ModelSkyBox.h"
+#include "Animation.h"
+#include "SkinnedMesh.h"
+#include "MaterialLibrary.h"
+#include "ObjLoader.h"
+#include "GltfLoader.h"
+#include "ImageLoader.h"
+#include "TextureCache.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace Benchmarks
+{
+	namespace
+	{
+		// Runs work a number of times and outputs the best and average time
+		void Measure(const std::string& label, int repeats, const std::function<void()>& work)
+		{
+			double best{ 1e30 };
+			double total{ 0 };
+			for (int i = 0; i < repeats; i++)
+			{
+				Helpers::Timer timer;
+				work();
+				double ms{ timer.ElapsedMs() };
+				best = std::min(best, ms);
+				total += ms;
+			}
+
+			std::cout << "  " << label << ": best " << best << " ms, average " << total / repeats << " ms" << std::endl;
+		}
+
+		// Writes a flat grid of cellsXZ * cellsXZ quads with normals and UVs as an OBJ file
+		bool WriteGridObj(const std::string& filename, int cellsXZ)
+		{
+			std::ofstream out(filename);
+			if (!out)
+				return false;
+
+			const int numVerts{ cellsXZ + 1 };
+			for (int z = 0; z < numVerts; z++)
+			{
+				for (int x = 0; x < numVerts; x++)
+					out << "v " << x << " " << ((x * 7 + z * 13) % 5) << " " << z << "\n";
+			}
+			for (int z = 0; z < numVerts; z++)
+			{
+				for (int x = 0; x < numVerts; x++)
+					out << "vt " << (float)x / cellsXZ << " " << (float)z / cellsXZ << "\n";
+			}
+			out << "vn 0 1 0\n";
+
+			for (int z = 0; z < cellsXZ; z++)
+			{
+				for (int x = 0; x < cellsXZ; x++)
+				{
+					int i0{ z * numVerts + x + 1 };
+					int i1{ i0 + 1 };
+					int i2{ i0 + numVerts + 1 };
+					int i3{ i0 + numVerts };
+					out << "f " << i0 << "/" << i0 << "/1 " << i1 << "/" << i1 << "/1 " << i2 << "/" << i2 << "/1 " << i3 << "/" << i3 << "/1\n";
+				}
+			}
+
+			return (bool)out;
+		}
+
+		// Writes the same grid as WriteGridObj as a binary glTF file with float streams and 32 bit indices
+		bool WriteGridGlb(const std::string& filename, int cellsXZ)
+		{
+			const size_t numVerts{ (size_t)(cellsXZ + 1) * (cellsXZ + 1) };
+			const size_t numElements{ (size_t)cellsXZ * cellsXZ * 6 };
+
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec3> normals(numVerts, glm::vec3(0, 1, 0));
+			std::vector<glm::vec2> uvCoords;
+			std::vector<unsigned int> elements;
+			positions.reserve(numVerts);
+			uvCoords.reserve(numVerts);
+			elements.reserve(numElements);
+
+			for (int z = 0; z <= cellsXZ; z++)
+			{
+				for (int x = 0; x <= cellsXZ; x++)
+				{
+					positions.push_back(glm::vec3(x, (x * 7 + z * 13) % 5, z));
+					uvCoords.push_back(glm::vec2((float)x / cellsXZ, 1.0f - (float)z / cellsXZ));
+				}
+			}
+			for (int z = 0; z < cellsXZ; z++)
+			{
+				for (int x = 0; x < cellsXZ; x++)
+				{
+					const unsigned int i0{ (unsigned int)(z * (cellsXZ + 1) + x) };
+					const unsigned int i1{ i0 + 1 };
+					const unsigned int i2{ i0 + cellsXZ + 2 };
+					const unsigned int i3{ i0 + cellsXZ + 1 };
+					elements.insert(elements.end(), { i0, i1, i2, i0, i2, i3 });
+				}
+			}
+
+			// Streams packed back to back in one buffer, every size is a multiple of 4 so no padding is needed
+			const size_t positionBytes{ sizeof(glm::vec3) * numVerts };
+			const size_t normalBytes{ sizeof(glm::vec3) * numVerts };
+			const size_t uvBytes{ sizeof(glm::vec2) * numVerts };
+			const size_t elementBytes{ sizeof(unsigned int) * numElements };
+			const size_t binBytes{ positionBytes + normalBytes + uvBytes + elementBytes };
+
+			const Helpers::BoundingBox bounds{ Helpers::ComputeBoundingBox(positions.data(), positions.size()) };
+			auto vec3 = [](const glm::vec3& v) { return "[" + std::to_string(v.x) + "," + std::to_string(v.y) + "," + std::to_string(v.z) + "]"; };
+
+			std::string json{ "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+				"\"nodes\":[{\"name\":\"grid\",\"mesh\":0}],"
+				"\"meshes\":[{\"name\":\"grid\",\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+				"\"buffers\":[{\"byteLength\":" + std::to_string(binBytes) + "}],\"bufferViews\":["
+				"{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + std::to_string(positionBytes) + "},"
+				"{\"buffer\":0,\"byteOffset\":" + std::to_string(positionBytes) + ",\"byteLength\":" + std::to_string(normalBytes) + "},"
+				"{\"buffer\":0,\"byteOffset\":" + std::to_string(positionBytes + normalBytes) + ",\"byteLength\":" + std::to_string(uvBytes) + "},"
+				"{\"buffer\":0,\"byteOffset\":" + std::to_string(positionBytes + normalBytes + uvBytes) + ",\"byteLength\":" + std::to_string(elementBytes) + "}],"
+				"\"accessors\":["
+				"{\"bufferView\":0,\"componentType\":5126,\"count\":" + std::to_string(numVerts) + ",\"type\":\"VEC3\","
+				"\"min\":" + vec3(bounds.minExtents) + ",\"max\":" + vec3(bounds.maxExtents) + "},"
+				"{\"bufferView\":1,\"componentType\":5126,\"count\":" + std::to_string(numVerts) + ",\"type\":\"VEC3\"},"
+				"{\"bufferView\":2,\"componentType\":5126,\"count\":" + std::to_string(numVerts) + ",\"type\":\"VEC2\"},"
+				"{\"bufferView\":3,\"componentType\":5125,\"count\":" + std::to_string(numElements) + ",\"type\":\"SCALAR\"}]}" };
+			json.resize((json.size() + 3) & ~(size_t)3, ' '); // Chunks are 4 byte aligned, JSON pads with spaces
+
+			std::ofstream out(filename, std::ios::binary);
+			if (!out)
+				return false;
+
+			auto write32 = [&](uint32_t value) { out.write((const char*)&value, sizeof(value)); };
+			write32(0x46546C67); // "glTF"
+			write32(2);
+			write32((uint32_t)(12 + 8 + json.size() + 8 + binBytes));
+			write32((uint32_t)json.size());
+			write32(0x4E4F534A); // "JSON"
+			out.write(json.data(), json.size());
+			write32((uint32_t)binBytes);
+			write32(0x004E4942); // "BIN"
+			out.write((const char*)positions.data(), positionBytes);
+			out.write((const char*)normals.data(), normalBytes);
+			out.write((const char*)uvCoords.data(), uvBytes);
+			out.write((const char*)elements.data(), elementBytes);
+
+			return (bool)out;
+		}
+
+		// The per element push_back copy PopulateFromAssimpScene used before the single arena import
+		struct LegacyMesh
+		{
+			std::vector<glm::vec3> vertices;
+			std::vector<glm::vec3> normals;
+			std::vector<glm::vec2> uvCoords;
+			std::vector<unsigned int> elements;
+		};
+
+		void LegacyCopy(const aiScene* scene, std::vector<LegacyMesh>& meshes)
+		{
+			for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+			{
+				aiMesh* aimesh = scene->mMeshes[i];
+
+				meshes.push_back(LegacyMesh());
+				LegacyMesh& newMesh = meshes.back();
+
+				for (size_t v = 0; v < aimesh->mNumVertices; v++)
+					newMesh.vertices.push_back(*(glm::vec3*)&aimesh->mVertices[v]);
+
+				if (aimesh->HasNormals())
+				{
+					for (size_t v = 0; v < aimesh->mNumVertices; v++)
+						newMesh.normals.push_back(*(glm::vec3*)&aimesh->mNormals[v]);
+				}
+
+				if (aimesh->HasTextureCoords(0))
+				{
+					for (size_t v = 0; v < aimesh->mNumVertices; v++)
+						newMesh.uvCoords.push_back(*(glm::vec2*)&aimesh->mTextureCoords[0][v]);
+				}
+
+				for (unsigned int face = 0; face < aimesh->mNumFaces; face++)
+				{
+					for (int triInd = 0; triInd < 3; triInd++)
+						newMesh.elements.push_back(aimesh->mFaces[face].mIndices[triInd]);
+				}
+			}
+		}
+
+		// Cost of turning an Assimp scene into our mesh data, old per element copy against the arena import
+		bool MeshImport()
+		{
+			const std::string filename{ "benchmark_grid.obj" };
+			const int cellsXZ{ 1024 };
+
+			std::cout << "Mesh import: " << cellsXZ << "x" << cellsXZ << " cell synthetic OBJ" << std::endl;
+
+			if (!WriteGridObj(filename, cellsXZ))
+				return false;
+
+			Assimp::Importer importer;
+			const aiScene* scene = importer.ReadFile(filename.c_str(), aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+			std::remove(filename.c_str());
+
+			if (!scene)
+			{
+				std::cout << importer.GetErrorString() << std::endl;
+				return false;
+			}
+
+			Measure("per element push_back", 5, [scene]()
+			{
+				std::vector<LegacyMesh> meshes;
+				LegacyCopy(scene, meshes);
+			});
+
+			Measure("single arena bulk copy", 5, [scene]()
+			{
+				Helpers::ModelLoader loader;
+				loader.LoadFromScene(scene, Helpers::ImportProfile::FastLoad); //Copy only, no meshlets
+			});
+
+			return true;
+		}
+
+		// Vertices, triangles and bounds of every mesh in an Assimp scene or a native OBJ read, for comparing the two
+		struct ObjSummary
+		{
+			size_t numVertices{ 0 };
+			size_t numTriangles{ 0 };
+			Helpers::BoundingBox boundingBox;
+		};
+
+		ObjSummary Summarise(const aiScene* scene)
+		{
+			ObjSummary summary;
+			std::vector<glm::vec3> vertices;
+			for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+			{
+				const aiMesh* aimesh{ scene->mMeshes[i] };
+				summary.numVertices += aimesh->mNumVertices;
+				summary.numTriangles += aimesh->mNumFaces;
+				vertices.insert(vertices.end(), (const glm::vec3*)aimesh->mVertices, (const glm::vec3*)aimesh->mVertices + aimesh->mNumVertices);
+			}
+			summary.boundingBox = Helpers::ComputeBoundingBox(vertices.data(), vertices.size());
+			return summary;
+		}
+
+		ObjSummary Summarise(const Helpers::ObjModel& model)
+		{
+			ObjSummary summary;
+			std::vector<glm::vec3> vertices;
+			for (const Helpers::ObjMesh& mesh : model.meshes)
+			{
+				summary.numVertices += mesh.vertices.size();
+				summary.numTriangles += mesh.elements.size() / 3;
+				vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+			}
+			summary.boundingBox = Helpers::ComputeBoundingBox(vertices.data(), vertices.size());
+			return summary;
+		}
+
+		// Native OBJ reader against Assimp on the same file, they must agree on the geometry
+		bool CompareObj(const std::string& filename, Helpers::ThreadPool* threadPool)
+		{
+			Assimp::Importer importer;
+			const aiScene* scene = importer.ReadFile(filename.c_str(), aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+			Helpers::ObjModel model;
+			if (!scene || !Helpers::ReadObj(filename, threadPool, model))
+				return false;
+
+			const ObjSummary assimp{ Summarise(scene) };
+			const ObjSummary native{ Summarise(model) };
+
+			std::cout << "  " << filename << ": assimp " << assimp.numVertices << " vertices " << assimp.numTriangles << " triangles, native "
+				<< native.numVertices << " vertices " << native.numTriangles << " triangles" << std::endl;
+
+			// The two float parsers may round the last bit differently
+			auto close = [](const glm::vec3& a, const glm::vec3& b)
+			{
+				return glm::all(glm::lessThanEqual(glm::abs(a - b), glm::vec3(1e-5f) * (glm::vec3(1) + glm::abs(a))));
+			};
+
+			return assimp.numVertices == native.numVertices && assimp.numTriangles == native.numTriangles &&
+				close(assimp.boundingBox.minExtents, native.boundingBox.minExtents) && close(assimp.boundingBox.maxExtents, native.boundingBox.maxExtents);
+		}
+
+		// Wall time to read a large OBJ with Assimp and with the native reader on a growing number of threads
+		bool ObjImport()
+		{
+			const std::string filename{ "benchmark_large.obj" };
+			const int cellsXZ{ 1500 };
+
+			std::cout << "OBJ import: " << cellsXZ << "x" << cellsXZ << " cell synthetic OBJ" << std::endl;
+
+			if (!WriteGridObj(filename, cellsXZ))
+				return false;
+
+			Measure("assimp", 1, [&]()
+			{
+				Assimp::Importer importer;
+				importer.ReadFile(filename.c_str(), aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+			});
+
+			const unsigned int maxThreads{ std::max(1u, std::thread::hardware_concurrency()) };
+			for (unsigned int numThreads = 1; ; numThreads = std::min(numThreads * 2, maxThreads))
+			{
+				Helpers::ThreadPool threadPool(numThreads);
+				Measure("native, " + std::to_string(numThreads) + " threads", 3, [&]()
+				{
+					Helpers::ObjModel model;
+					Helpers::ReadObj(filename, &threadPool, model);
+				});
+
+				if (numThreads == maxThreads)
+					break;
+			}
+
+			Helpers::ThreadPool threadPool;
+			const bool matches{ CompareObj("Data\\Models\\Jeep\\jeep.obj", &threadPool) && CompareObj(filename, &threadPool) };
+			std::remove(filename.c_str());
+
+			if (!matches)
+				std::cout << "  native and assimp geometry differ" << std::endl;
+
+			return matches;
+		}
+
+		ObjSummary Summarise(const Helpers::GltfModel& model)
+		{
+			ObjSummary summary;
+			std::vector<glm::vec3> vertices;
+			for (const Helpers::GltfPrimitive& primitive : model.primitives)
+			{
+				summary.numVertices += primitive.vertices.size();
+				summary.numTriangles += primitive.elements.size() / 3;
+				vertices.insert(vertices.end(), primitive.vertices.data(), primitive.vertices.data() + primitive.vertices.size());
+			}
+			summary.boundingBox = Helpers::ComputeBoundingBox(vertices.data(), vertices.size());
+			return summary;
+		}
+
+		// Read time of a large binary glTF with the native reader against Assimp and against reading the bytes off disk
+		bool GlbImport()
+		{
+			const std::string filename{ "benchmark_large.glb" };
+			const int cellsXZ{ 1500 };
+
+			std::cout << "glTF import: " << cellsXZ << "x" << cellsXZ << " cell synthetic GLB" << std::endl;
+
+			if (!WriteGridGlb(filename, cellsXZ))
+				return false;
+
+			// The floor: every byte of the file copied into memory
+			Measure("read whole file", 3, [&]()
+			{
+				std::ifstream in(filename, std::ios::binary);
+				std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			});
+
+			Measure("assimp", 1, [&]()
+			{
+				Assimp::Importer importer;
+				importer.ReadFile(filename.c_str(), aiProcess_Triangulate);
+			});
+
+			// Touches every vertex so the mapped pages are really read
+			Measure("native, in place", 3, [&]()
+			{
+				Helpers::GltfModel model;
+				if (Helpers::ReadGlb(filename, model))
+					Summarise(model);
+			});
+
+			Measure("native, FastLoad into a ModelLoader", 3, [&]()
+			{
+				Helpers::ModelLoader loader;
+				loader.LoadFromFile(filename, Helpers::ImportProfile::FastLoad);
+			});
+
+			Assimp::Importer importer;
+			const aiScene* scene = importer.ReadFile(filename.c_str(), aiProcess_Triangulate);
+			Helpers::GltfModel model;
+			bool matches{ scene && Helpers::ReadGlb(filename, model) };
+			if (matches)
+			{
+				const ObjSummary assimp{ Summarise(scene) };
+				const ObjSummary native{ Summarise(model) };
+
+				std::cout << "  assimp " << assimp.numVertices << " vertices " << assimp.numTriangles << " triangles, native "
+					<< native.numVertices << " vertices " << native.numTriangles << " triangles" << std::endl;
+
+				matches = assimp.numVertices == native.numVertices && assimp.numTriangles == native.numTriangles &&
+					assimp.boundingBox.minExtents == native.boundingBox.minExtents && assimp.boundingBox.maxExtents == native.boundingBox.maxExtents;
+			}
+
+			model = Helpers::GltfModel(); // Unmap before deleting
+			std::remove(filename.c_str());
+
+			if (!matches)
+				std::cout << "  native and assimp geometry differ" << std::endl;
+
+			return matches;
+		}
+
+		// Red and blue swap of decoded images, the byte loop against the widest shuffle the CPU has and a plain copy,
+		// which is all uploading as GL_BGRA would leave. Swapping twice must give back the original pixels.
+		bool SwizzleImages()
+		{
+			std::cout << "BGRA to RGBA swizzle: " << Helpers::SwizzleKernelName() << " kernel" << std::endl;
+
+			auto compare = [](const std::string& label, const unsigned char* pixels, size_t numPixels)
+			{
+				std::vector<unsigned char> scalar(numPixels * 4);
+				std::vector<unsigned char> vectorised(numPixels * 4);
+				const double megabytes{ numPixels * 4 / (1024.0 * 1024.0) };
+
+				std::cout << " " << label << ", " << megabytes << " MB" << std::endl;
+				Measure("scalar", 5, [&]() { Helpers::SwizzleRedBlueScalar(pixels, scalar.data(), numPixels); });
+				Measure("vectorised", 5, [&]() { Helpers::SwizzleRedBlue(pixels, vectorised.data(), numPixels); });
+				Measure("copy only", 5, [&]() { std::memcpy(vectorised.data(), pixels, numPixels * 4); });
+
+				Helpers::SwizzleRedBlue(pixels, vectorised.data(), numPixels);
+				bool matches{ scalar == vectorised };
+
+				Helpers::SwizzleRedBlue(vectorised.data(), vectorised.data(), numPixels);
+				matches = matches && std::memcmp(vectorised.data(), pixels, numPixels * 4) == 0;
+
+				if (!matches)
+					std::cout << "  vectorised swizzle differs from scalar" << std::endl;
+				return matches;
+			};
+
+			bool allMatch{ true };
+
+			// The cloud sky box faces, decoded once then swizzled in memory so FreeImage is not timed
+			const char* faces[]{ "Back", "Bottom", "Front", "Left", "Right", "Top" };
+			std::vector<unsigned char> skyBox;
+			Helpers::ImageLoader image;
+			for (const char* face : faces)
+			{
+				if (!image.Load(std::string("Data\\Sky\\Clouds\\SkyBox_") + face + ".tga"))
+					return false;
+
+				const unsigned char* pixels{ (const unsigned char*)image.GetData() };
+				skyBox.insert(skyBox.end(), pixels, pixels + (size_t)image.Width() * image.Height() * 4);
+			}
+			allMatch = compare("six sky box faces", skyBox.data(), skyBox.size() / 4) && allMatch;
+
+			// Decoding through a reused loader, which only allocates for the first face
+			Measure("load six faces through one loader", 3, [&]()
+			{
+				for (const char* face : faces)
+					image.Load(std::string("Data\\Sky\\Clouds\\SkyBox_") + face + ".tga");
+			});
+
+			// 8K texture, one odd pixel past a whole vector to exercise the tail
+			const size_t side{ 8192 };
+			std::vector<unsigned char> large(side * side * 4 + 4);
+			for (size_t i = 0; i < large.size(); i++)
+				large[i] = (unsigned char)(i * 2654435761u >> 24);
+			allMatch = compare("8K texture", large.data(), large.size() / 4) && allMatch;
+
+			return allMatch;
+		}
+
+		// Load time and texture memory of the Mars sky box's DXT1 faces kept compressed, against decoding them to RGBA
+		// and against just reading the files
+		bool CompressedTextures()
+		{
+			const char* faces[]{ "B", "D", "F", "L", "R", "U" };
+			auto filename = [](const char* face) { return std::string("Data\\Sky\\Mars\\Mar_") + face + ".dds"; };
+
+			std::cout << "Compressed textures: six Mars sky box faces" << std::endl;
+
+			Measure("read files", 5, [&]()
+			{
+				for (const char* face : faces)
+				{
+					std::ifstream in(filename(face), std::ios::binary);
+					std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+				}
+			});
+
+			Helpers::ImageLoader image;
+			Measure("load compressed", 5, [&]()
+			{
+				for (const char* face : faces)
+					image.Load(filename(face));
+			});
+
+			Measure("decode to RGBA", 5, [&]()
+			{
+				for (const char* face : faces)
+					image.LoadDecoded(filename(face));
+			});
+
+			size_t compressedBytes{ 0 };
+			size_t decodedBytes{ 0 };
+			for (const char* face : faces)
+			{
+				if (!image.Load(filename(face)) || !image.IsCompressed())
+					return false;
+				for (const Helpers::ImageLevel& level : image.CompressedLevels())
+					compressedBytes += level.size;
+
+				// Uploaded RGBA gets a full mip chain built, a third more again
+				if (!image.LoadDecoded(filename(face)))
+					return false;
+				decodedBytes += (size_t)image.Width() * image.Height() * 4 * 4 / 3;
+			}
+
+			std::cout << "  texture memory: compressed " << compressedBytes / 1024 << " KB, decoded " << decodedBytes / 1024 << " KB" << std::endl;
+
+			return true;
+		}
+
+		// Block compressing the cloud sky box faces on the CPU, each format on one thread and across the pool,
+		// then the first load of a face that compresses and caches it against later loads that read the cache.
+		// Every thread count must give the same blocks.
+		bool TextureCompression()
+		{
+			const char* faces[]{ "Back", "Bottom", "Front", "Left", "Right", "Top" };
+			auto filename = [](const char* face) { return std::string("Data\\Sky\\Clouds\\SkyBox_") + face + ".tga"; };
+
+			// Decoded once so FreeImage is not timed
+			std::vector<std::vector<unsigned char>> pixels;
+			int width{ 0 };
+			int height{ 0 };
+			Helpers::ImageLoader image;
+			for (const char* face : faces)
+			{
+				if (!image.LoadDecoded(filename(face)))
+					return false;
+
+				const unsigned char* data{ (const unsigned char*)image.GetData() };
+				width = image.Width();
+				height = image.Height();
+				pixels.emplace_back(data, data + (size_t)width * height * 4);
+			}
+
+			const size_t numBlocks{ (size_t)((width + 3) / 4) * ((height + 3) / 4) };
+			const size_t decodedBytes{ pixels.size() * (size_t)width * height * 4 };
+			std::cout << "Texture compression: six " << width << "x" << height << " sky box faces, " << decodedBytes / 1024 << " KB as RGBA" << std::endl;
+
+			Helpers::ThreadPool threadPool;
+			bool allMatch{ true };
+			for (Helpers::BlockFormat format : { Helpers::BlockFormat::BC1, Helpers::BlockFormat::BC3, Helpers::BlockFormat::BC7 })
+			{
+				const size_t blockBytes{ Helpers::CompressedBlockBytes(Helpers::BlockFormatGl(format)) };
+				std::vector<unsigned char> serial(numBlocks * blockBytes * pixels.size());
+				std::vector<unsigned char> parallel(serial.size());
+
+				std::cout << " " << Helpers::BlockFormatName(format) << ", " << serial.size() / 1024 << " KB" << std::endl;
+				Measure("one thread", 2, [&]()
+				{
+					for (size_t i = 0; i < pixels.size(); i++)
+						Helpers::CompressImage(pixels[i].data(), width, height, format, nullptr, serial.data() + i * numBlocks * blockBytes);
+				});
+				Measure(std::to_string(threadPool.NumThreads()) + " threads", 2, [&]()
+				{
+					for (size_t i = 0; i < pixels.size(); i++)
+						Helpers::CompressImage(pixels[i].data(), width, height, format, &threadPool, parallel.data() + i * numBlocks * blockBytes);
+				});
+
+				if (serial != parallel)
+				{
+					std::cout << "  blocks differ between thread counts" << std::endl;
+					allMatch = false;
+				}
+			}
+
+			// Loading through the cache, removed first so the first load has to build it
+			const std::string face{ filename(faces[0]) };
+			const std::string cacheFilename{ Helpers::TextureCache::CacheFilename(face, Helpers::BlockFormat::Auto) };
+			std::remove(cacheFilename.c_str());
+
+			Helpers::Timer timer;
+			Helpers::ImageLoadSettings settings;
+			settings.compression = Helpers::BlockFormat::Auto;
+			if (!image.Load(face, settings, &threadPool) || !image.IsCompressed())
+				return false;
+			std::cout << "  first load, compressing " << image.CompressedLevels().size() << " levels: " << timer.ElapsedMs() << " ms" << std::endl;
+
+			Measure("cached load", 5, [&]() { image.Load(face, settings, &threadPool); });
+			Measure("decode to RGBA", 5, [&]() { image.LoadDecoded(face); });
+
+			return allMatch;
+		}
+
+		// Bounding box of a large point cloud, per component scalar loop against the SSE kernel
+		bool BoundsKernel()
+		{
+			const size_t numPoints{ 4 * 1024 * 1024 };
+
+			std::cout << "Bounding box: " << numPoints << " points" << std::endl;
+
+			std::vector<glm::vec3> points(numPoints);
+			for (size_t i = 0; i < numPoints; i++)
+				points[i] = glm::vec3((float)(i * 7 % 1001), (float)(i * 13 % 977), (float)(i * 17 % 1013)) - glm::vec3(500.0f);
+
+			Helpers::BoundingBox scalarBox;
+			Measure("scalar", 10, [&]() { scalarBox = Helpers::ComputeBoundingBoxScalar(points.data(), points.size()); });
+
+			Helpers::BoundingBox kernelBox;
+			Measure("vectorised", 10, [&]() { kernelBox = Helpers::ComputeBoundingBox(points.data(), points.size()); });
+
+			return scalarBox.minExtents == kernelBox.minExtents && scalarBox.maxExtents == kernelBox.maxExtents;
+		}
+
+		// Compact positions of a flat grid and a single point decoded back as the vertex shader does, flat axes must come back exactly
+		bool CompactPositions()
+		{
+			const int cellsXZ{ 256 };
+
+			std::cout << "Compact positions: " << cellsXZ << "x" << cellsXZ << " cell plane at height 12.5 and a single point" << std::endl;
+
+			std::vector<glm::vec3> planeVertices;
+			for (int z = 0; z <= cellsXZ; z++)
+				for (int x = 0; x <= cellsXZ; x++)
+					planeVertices.push_back(glm::vec3(x * 3.7f - 400.0f, 12.5f, z * 2.1f + 50.0f));
+			const glm::vec3 pointVertex{ -3.0f, 0.0f, 1e6f };
+
+			Helpers::Mesh plane;
+			plane.vertices = Helpers::Span<glm::vec3>(planeVertices.data(), planeVertices.size());
+			Helpers::Mesh point;
+			point.vertices = Helpers::Span<glm::vec3>(&pointVertex, 1);
+
+			bool allMatch{ true };
+			for (const Helpers::Mesh* mesh : { &plane, &point })
+			{
+				Helpers::CompactVertexData compact;
+				Measure("encode", 5, [&]() { Helpers::EncodeCompact(*mesh, compact); });
+
+				float worstError{ 0 };
+				for (size_t i = 0; i < mesh->vertices.size(); i++)
+				{
+					for (int axis = 0; axis < 3; axis++)
+					{
+						const float decoded{ compact.positionOffset[axis] + compact.positions[i * 4 + axis] / 65535.0f * compact.positionScale[axis] };
+						const float original{ mesh->vertices[i][axis] };
+						const float error{ std::abs(decoded - original) };
+
+						// Half a quantisation step on a spread axis, nothing on a flat one
+						const bool flat{ compact.positions[i * 4 + axis] == 0 && compact.positionScale[axis] == 1.0f };
+						if (!std::isfinite(decoded) || error > (flat ? 0.0f : compact.positionScale[axis] / 65535.0f * 0.5f + 1e-3f))
+							allMatch = false;
+						worstError = std::max(worstError, error);
+					}
+				}
+				std::cout << "  " << mesh->vertices.size() << " vertices, worst error " << worstError << std::endl;
+			}
+
+			return allMatch;
+		}
+
+		// Share of the jeep's triangles that meshlet culling rejects from views circling it, and the cost of the test
+		bool MeshletCulling()
+		{
+			Helpers::ModelLoader loader;
+			if (!loader.LoadFromFile("Data\\Models\\Jeep\\jeep.obj", Helpers::ImportProfile::RuntimeOptimal))
+				return false;
+
+			size_t numMeshlets{ 0 };
+			size_t numTriangles{ 0 };
+			for (const Helpers::Mesh& mesh : loader.GetMeshVector())
+			{
+				numMeshlets += mesh.meshlets.size();
+				numTriangles += mesh.elements.size() / 3;
+			}
+
+			std::cout << "Meshlet culling: jeep, " << numTriangles << " triangles in " << numMeshlets << " meshlets" << std::endl;
+
+			const Helpers::BoundingSphere& bounds{ loader.GetBoundingSphere() };
+			const glm::mat4 projection{ glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.5f, 20000.0f) };
+			const int numViews{ 64 };
+
+			size_t trianglesDrawn{ 0 };
+			Measure("cull 64 views", 10, [&]()
+			{
+				trianglesDrawn = 0;
+				for (int view = 0; view < numViews; view++)
+				{
+					// Close enough that the jeep fills the view so the frustum rejects some of it too
+					const float angle{ glm::two_pi<float>() * view / numViews };
+					const glm::vec3 eye{ bounds.centre + glm::vec3(std::cos(angle), 0.4f, std::sin(angle)) * bounds.radius * 1.2f };
+					const glm::mat4 viewTransform{ glm::lookAt(eye, bounds.centre + glm::vec3(std::sin(angle), 0, -std::cos(angle)) * bounds.radius * 0.3f, glm::vec3(0, 1, 0)) };
+					const Helpers::Frustum frustum{ Helpers::Frustum::FromMatrix(projection * viewTransform) };
+
+					for (const Helpers::Mesh& mesh : loader.GetMeshVector())
+					{
+						for (const Helpers::Meshlet& meshlet : mesh.meshlets)
+						{
+							if (frustum.Intersects(meshlet.boundingSphere) && !Helpers::IsMeshletBackFacing(meshlet, eye))
+								trianglesDrawn += meshlet.numElements / 3;
+						}
+					}
+				}
+			});
+
+			std::cout << "  " << 100.0 * trianglesDrawn / ((double)numTriangles * numViews) << "% of triangles submitted" << std::endl;
+			return numMeshlets > 0;
+		}
+
+		// Benchmarks that draw open a window and use the scene shaders
+		class DrawContext
+		{
+		private:
+			GLFWwindow* m_window{ nullptr };
+			GLuint m_program{ 0 };
+		public:
+			~DrawContext()
+			{
+				MaterialLibrary::Shared().Clear();
+				if (m_program)
+					glDeleteProgram(m_program);
+				if (m_window)
+				{
+					glfwDestroyWindow(m_window);
+					glfwTerminate();
+				}
+			}
+
+			// Create the window and program, returns false on error
+			bool Initialise()
+			{
+				m_window = Helpers::CreateGLFWWindow(1024, 768, "Benchmark");
+				if (!m_window)
+					return false;
+
+				// Frame times should not be limited by the display refresh
+				glfwSwapInterval(0);
+
+				GLuint vertexShader{ Helpers::LoadAndCompileShader(GL_VERTEX_SHADER, "Data/Shaders/vertex_shader.glsl") };
+				GLuint fragmentShader{ Helpers::LoadAndCompileShader(GL_FRAGMENT_SHADER, "Data/Shaders/fragment_shader.glsl") };
+				if (vertexShader == 0 || fragmentShader == 0)
+					return false;
+
+				m_program = glCreateProgram();
+				glAttachShader(m_program, vertexShader);
+				glAttachShader(m_program, fragmentShader);
+				glDeleteShader(vertexShader);
+				glDeleteShader(fragmentShader);
+
+				if (!Helpers::LinkProgramShaders(m_program))
+					return false;
+
+				MaterialLibrary::BindProgram(m_program);
+				return MaterialLibrary::Shared().Upload();
+			}
+
+			// Calls draw for a number of frames from the simulation's start view, outputs and returns the average frame time in ms
+			double MeasureFrames(const std::string& label, int numFrames,
+				const std::function<void(const Helpers::Camera&, glm::mat4&, glm::mat4&)>& draw)
+			{
+				Helpers::Camera camera;
+				camera.Initialise(glm::vec3(0, 2000, 3000), glm::vec3(0.5, 0, 0));
+
+				int width{ 0 };
+				int height{ 0 };
+				glfwGetFramebufferSize(m_window, &width, &height);
+				glViewport(0, 0, width, height);
+
+				glm::mat4 projection{ glm::perspective(glm::radians(45.0f), width / (float)std::max(height, 1), 0.5f, 20000.0f) };
+				glm::mat4 view{ glm::lookAt(camera.GetPosition(), camera.GetPosition() + camera.GetLookVector(), camera.GetUpVector()) };
+
+				glEnable(GL_DEPTH_TEST);
+				glEnable(GL_CULL_FACE);
+				glUseProgram(m_program);
+
+				// glFinish so each frame is timed to completion on the GPU, the first frames warm up the driver
+				const int warmUpFrames{ 10 };
+				Helpers::Timer timer;
+				for (int frame = 0; frame < warmUpFrames + numFrames; frame++)
+				{
+					if (frame == warmUpFrames)
+						timer.Reset();
+
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					draw(camera, projection, view);
+					glFinish();
+
+					glfwSwapBuffers(m_window);
+					glfwPollEvents();
+				}
+
+				const double frameMs{ timer.ElapsedMs() / numFrames };
+				std::cout << "  " << label << ": " << frameMs << " ms per frame" << std::endl;
+				return frameMs;
+			}
+
+			// Draws models for a number of frames and outputs the average frame time
+			void MeasureFrames(const std::string& label, int numFrames, const std::vector<Model*>& models)
+			{
+				MeasureFrames(label, numFrames, [&](const Helpers::Camera& camera, glm::mat4& projection, glm::mat4& view)
+				{
+					for (Model* model : models)
+						model->Render(camera, m_program, projection, view);
+				});
+			}
+
+			GLuint GetProgram() const { return m_program; }
+		};
+
+		// Mip chains of the terrain's tiled grass and a cloud sky box face built on the CPU with each filter, on one thread
+		// and across the pool, against glGenerateMipmap on the GL thread and uploading the built levels.
+		// A flat colour must stay flat through every filter.
+		bool MipGeneration()
+		{
+			DrawContext context;
+			if (!context.Initialise())
+				return false;
+
+			const Helpers::MipFilter filters[]{ Helpers::MipFilter::Box, Helpers::MipFilter::Kaiser, Helpers::MipFilter::GammaCorrect };
+			Helpers::ThreadPool threadPool;
+			bool allFlat{ true };
+
+			for (const char* filename : { "Data\\Textures\\grass.jpg", "Data\\Sky\\Clouds\\SkyBox_Front.tga" })
+			{
+				Helpers::ImageLoader image;
+				if (!image.LoadDecoded(filename))
+					return false;
+
+				const int width{ image.Width() };
+				const int height{ image.Height() };
+				const std::vector<Helpers::ImageLevel> levels{ Helpers::MipChainLayout(width, height) };
+				std::vector<unsigned char> chain(levels.back().offset + levels.back().size);
+				std::memcpy(chain.data(), image.GetData(), levels[0].size);
+
+				std::cout << "Mip generation: " << filename << ", " << width << "x" << height << ", " << levels.size() << " levels" << std::endl;
+
+				for (Helpers::MipFilter filter : filters)
+				{
+					std::cout << " " << Helpers::MipFilterName(filter) << std::endl;
+					Measure("one thread", 3, [&]() { Helpers::GenerateMipChain(chain.data(), levels, filter, nullptr); });
+					Measure(std::to_string(threadPool.NumThreads()) + " threads", 3, [&]() { Helpers::GenerateMipChain(chain.data(), levels, filter, &threadPool); });
+				}
+
+				// What the GL thread spends, finishing so the driver's work is counted
+				GLuint texture{ 0 };
+				glGenTextures(1, &texture);
+				glBindTexture(GL_TEXTURE_2D, texture);
+				Measure("glGenerateMipmap", 3, [&]()
+				{
+					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, chain.data());
+					glGenerateMipmap(GL_TEXTURE_2D);
+					glFinish();
+				});
+				Measure("upload built levels", 3, [&]()
+				{
+					for (size_t level = 0; level < levels.size(); level++)
+						glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA, levels[level].width, levels[level].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, chain.data() + levels[level].offset);
+					glFinish();
+				});
+				glDeleteTextures(1, &texture);
+			}
+
+			// Weights of every filter sum to one and edges wrap, so a flat image cannot change, odd sizes included
+			const int flatWidth{ 37 };
+			const int flatHeight{ 20 };
+			const std::vector<Helpers::ImageLevel> flatLevels{ Helpers::MipChainLayout(flatWidth, flatHeight) };
+			for (Helpers::MipFilter filter : filters)
+			{
+				std::vector<unsigned char> flat(flatLevels.back().offset + flatLevels.back().size);
+				for (size_t i = 0; i < flatLevels[0].size; i += 4)
+				{
+					flat[i] = 200;
+					flat[i + 1] = 120;
+					flat[i + 2] = 30;
+					flat[i + 3] = 255;
+				}
+
+				Helpers::GenerateMipChain(flat.data(), flatLevels, filter, &threadPool);
+				for (size_t i = 0; i < flat.size(); i += 4)
+				{
+					if (flat[i] != 200 || flat[i + 1] != 120 || flat[i + 2] != 30 || flat[i + 3] != 255)
+					{
+						std::cout << "  " << Helpers::MipFilterName(filter) << " changed a flat colour" << std::endl;
+						allFlat = false;
+						break;
+					}
+				}
+			}
+
+			return allFlat;
+		}
+
+		// Time from starting to load the scene to being able to draw it, with every texture decoded and uploaded in full
+		// against streaming them in, then texture memory once each has drawn from the start view for a while
+		bool TextureStreaming()
+		{
+			DrawContext context;
+			if (!context.Initialise())
+				return false;
+
+			TextureManager& textureManager{ TextureManager::Shared() };
+			Helpers::ThreadPool threadPool;
+			const size_t bytesPerFrame{ 4 * 1024 * 1024 };
+
+			std::cout << "Texture streaming: sky box, terrain and two jeeps" << std::endl;
+
+			// The first pass builds the mesh and texture caches so the other two are timed reading them
+			for (int pass = 0; pass < 3; pass++)
+			{
+				const bool streaming{ pass == 2 };
+				textureManager.SetStreaming(streaming);
+
+				ModelSkyBox skyBox("Data\\Sky\\Clouds\\skybox.x");
+				ModelTerrain terrain(10000, 64);
+				terrain.Texture("Data\\Textures\\grass.jpg");
+				Model jeep("Data\\Models\\Jeep\\jeep.obj", 0, 0, 0, 1.0f);
+				jeep.Texture("Data\\Models\\Jeep\\jeep_army.jpg");
+				Model jeepTwo("Data\\Models\\Jeep\\jeep.obj", 1000, 0, 1000, 1.0f);
+				jeepTwo.Texture("Data\\Models\\Jeep\\jeep_rood.jpg");
+				const std::vector<Model*> models{ &skyBox, &terrain, &jeep, &jeepTwo };
+
+				Helpers::Timer timer;
+				for (Model* model : models)
+				{
+					if (!model->Load(&threadPool))
+						return false;
+				}
+				for (Model* model : models)
+				{
+					if (!model->Upload())
+						return false;
+				}
+				const double startMs{ timer.ElapsedMs() };
+
+				const std::string label{ pass == 0 ? "building caches" : streaming ? "streamed" : "in full" };
+				std::cout << "  " << label << ": ready to draw in " << startMs << " ms, " << textureManager.StatsString() << std::endl;
+
+				context.MeasureFrames(label, 120, [&](const Helpers::Camera& camera, glm::mat4& projection, glm::mat4& view)
+				{
+					if (textureManager.Stream(bytesPerFrame))
+					{
+						for (Model* model : models)
+							model->OnAssetsReloaded();
+					}
+					for (Model* model : models)
+						model->Render(camera, context.GetProgram(), projection, view);
+				});
+				std::cout << "  " << label << " after drawing: " << textureManager.StatsString() << std::endl;
+
+				// Nothing may still be decoding into these textures when the models go
+				textureManager.WaitForReloads();
+			}
+
+			textureManager.SetStreaming(true);
+			return true;
+		}
+
+		// Memory and frame time of the scene geometry with full float and compact vertex encodings
+		bool VertexEncodings()
+		{
+			DrawContext context;
+			if (!context.Initialise())
+				return false;
+
+			const int cellsXZ{ 1024 };
+			std::cout << "Vertex encodings: " << cellsXZ << "x" << cellsXZ << " cell terrain and two jeeps" << std::endl;
+
+			const std::pair<std::string, Helpers::VertexEncoding> encodings[]{
+				{ "full", Helpers::VertexEncoding::Full },
+				{ "compact", Helpers::VertexEncoding::Compact }
+			};
+
+			for (const auto& encoding : encodings)
+			{
+				ModelTerrain terrain(10000, cellsXZ);
+				terrain.Texture("Data\\Textures\\grass.jpg");
+
+				Model jeep("Data\\Models\\Jeep\\jeep.obj", 0, 0, 0, 1.0f);
+				jeep.Texture("Data\\Models\\Jeep\\jeep_army.jpg");
+
+				Model jeepTwo("Data\\Models\\Jeep\\jeep.obj", 1000, 0, 1000, 1.0f);
+				jeepTwo.Texture("Data\\Models\\Jeep\\jeep_rood.jpg");
+
+				std::vector<Model*> models{ &terrain, &jeep, &jeepTwo };
+				for (Model* model : models)
+				{
+					model->SetVertexEncoding(encoding.second);
+					if (!model->Initialise())
+						return false;
+				}
+
+				// The jeeps share one set of buffers so only count them once
+				std::cout << "  " << encoding.first << ": " << (terrain.GetGpuBytes() + jeep.GetGpuBytes()) / 1024 << " KB vertex and element memory" << std::endl;
+				context.MeasureFrames(encoding.first, 300, models);
+			}
+
+			return true;
+		}
+
+		// Frame time of a dense terrain grid with separate attribute buffers against one interleaved buffer
+		bool VertexLayouts()
+		{
+			DrawContext context;
+			if (!context.Initialise())
+				return false;
+
+			const int cellsXZ{ 1024 };
+			const float size{ 10000.0f };
+			std::cout << "Vertex layouts: " << cellsXZ << "x" << cellsXZ << " cell terrain" << std::endl;
+
+			// Rolling hills laid out like ModelTerrain, without needing the heightmap
+			const int numVertsXZ{ cellsXZ + 1 };
+			std::vector<glm::vec3> vertices;
+			std::vector<glm::vec3> normals;
+			std::vector<glm::vec2> uvCoords;
+			std::vector<unsigned int> elements;
+			for (int z = 0; z < numVertsXZ; z++)
+			{
+				for (int x = 0; x < numVertsXZ; x++)
+				{
+					const float u{ (float)x / cellsXZ };
+					const float v{ (float)z / cellsXZ };
+					const float height{ 200.0f * std::sin(u * 20.0f) * std::cos(v * 15.0f) };
+					vertices.push_back(glm::vec3((u - 0.5f) * size, height, (v - 0.5f) * size));
+					normals.push_back(glm::normalize(glm::vec3(-std::cos(u * 20.0f) * std::cos(v * 15.0f) * 0.4f, 1.0f, std::sin(u * 20.0f) * std::sin(v * 15.0f) * 0.3f)));
+					uvCoords.push_back(glm::vec2(u, v) * 10.0f);
+				}
+			}
+			for (int z = 0; z < cellsXZ; z++)
+			{
+				for (int x = 0; x < cellsXZ; x++)
+				{
+					const unsigned int corner{ (unsigned int)(z * numVertsXZ + x) };
+					elements.insert(elements.end(), { corner, corner + numVertsXZ, corner + 1, corner + 1, corner + numVertsXZ, corner + numVertsXZ + 1 });
+				}
+			}
+
+			Helpers::Mesh mesh;
+			mesh.vertices = Helpers::Span<glm::vec3>(vertices.data(), vertices.size());
+			mesh.normals = Helpers::Span<glm::vec3>(normals.data(), normals.size());
+			mesh.uvCoords = Helpers::Span<glm::vec2>(uvCoords.data(), uvCoords.size());
+			mesh.elements = Helpers::Span<unsigned int>(elements.data(), elements.size());
+			mesh.CalculateBounds();
+
+			const std::pair<std::string, Helpers::VertexEncoding> encodings[]{
+				{ "full", Helpers::VertexEncoding::Full },
+				{ "compact", Helpers::VertexEncoding::Compact }
+			};
+			const std::pair<std::string, Helpers::VertexLayout> layouts[]{
+				{ "separate", Helpers::VertexLayout::Separate },
+				{ "interleaved", Helpers::VertexLayout::Interleaved }
+			};
+
+			for (const auto& encoding : encodings)
+			{
+				for (const auto& layout : layouts)
+				{
+					std::vector<GLuint> buffers;
+					const MyMesh terrainMesh{ UploadMesh(mesh, encoding.second, buffers, layout.second) };
+
+					const GLuint program{ context.GetProgram() };
+					context.MeasureFrames(encoding.first + " " + layout.first, 300, [&](const Helpers::Camera&, glm::mat4& projection, glm::mat4& view)
+					{
+						const glm::mat4 combined{ projection * view };
+						const glm::mat4 model{ 1 };
+						glUniformMatrix4fv(glGetUniformLocation(program, "combined_xform"), 1, GL_FALSE, glm::value_ptr(combined));
+						glUniformMatrix4fv(glGetUniformLocation(program, "model_xform"), 1, GL_FALSE, glm::value_ptr(model));
+						terrainMesh.Draw(program);
+					});
+
+					glDeleteVertexArrays(1, &terrainMesh.VAO);
+					glDeleteBuffers((GLsizei)buffers.size(), buffers.data());
+				}
+			}
+
+			return true;
+		}
+
+		// Triangles submitted and frame time for a field of jeeps, drawing full meshes against selected levels of detail
+		bool LevelsOfDetail()
+		{
+			DrawContext context;
+			if (!context.Initialise())
+				return false;
+
+			const int jeepsXZ{ 16 };
+			const float spacing{ 600.0f };
+			std::cout << "Levels of detail: " << jeepsXZ * jeepsXZ << " jeeps" << std::endl;
+
+			std::vector<std::unique_ptr<Model>> jeeps;
+			for (int z = 0; z < jeepsXZ; z++)
+			{
+				for (int x = 0; x < jeepsXZ; x++)
+				{
+					jeeps.emplace_back(new Model("Data\\Models\\Jeep\\jeep.obj", (x - jeepsXZ / 2) * spacing, 0, (z - jeepsXZ / 2) * spacing, 1.0f));
+					jeeps.back()->Texture("Data\\Models\\Jeep\\jeep_army.jpg");
+					if (!jeeps.back()->Initialise())
+						return false;
+				}
+			}
+
+			const Helpers::ImportReport* report{ jeeps.front()->GetImportReport() };
+			if (report)
+				std::cout << "  imported in " << report->totalMilliseconds << " ms" << (report->fromCache ? " from the cache" : "") << std::endl;
+
+			std::vector<Model*> models;
+			for (const auto& jeep : jeeps)
+				models.push_back(jeep.get());
+
+			for (bool lodEnabled : { false, true })
+			{
+				for (Model* model : models)
+					model->SetLodEnabled(lodEnabled);
+
+				const std::string label{ lodEnabled ? "levels of detail" : "full meshes" };
+				context.MeasureFrames(label, 300, [&](const Helpers::Camera& camera, glm::mat4& projection, glm::mat4& view)
+				{
+					DrawStats::Current().Reset();
+					for (Model* model : models)
+						model->Render(camera, context.GetProgram(), projection, view);
+				});
+				std::cout << "  " << label << ": " << DrawStats::Current().triangles << " triangles per frame" << std::endl;
+			}
+
+			return true;
+		}
+
+		// A tube bent by a chain of bones, the repo has no skinned model so the mesh, skeleton and clip are built here
+		struct SkinnedTube
+		{
+			std::vector<glm::vec3> vertices;
+			std::vector<glm::vec3> normals;
+			std::vector<glm::vec2> uvCoords;
+			std::vector<unsigned int> elements;
+			std::vector<glm::u8vec4> boneIndices;
+			std::vector<glm::vec4> boneWeights;
+			std::vector<Helpers::Bone> bones;
+
+			Helpers::Mesh mesh;
+			Helpers::NodeHierarchy hierarchy;
+			Helpers::AnimationClip clip;
+
+			SkinnedTube(unsigned int numBones, unsigned int ringsPerBone, unsigned int segments)
+			{
+				const float boneLength{ 20.0f };
+				const float radius{ 8.0f };
+				const float pi{ glm::pi<float>() };
+
+				// Node 0 is the root, bone b is node b + 1 a bone length above its parent
+				hierarchy.AddNode("root", glm::mat4(1), -1, nullptr, 0);
+				for (unsigned int b = 0; b < numBones; b++)
+				{
+					const glm::mat4 local{ glm::translate(glm::mat4(1), glm::vec3(0, b == 0 ? 0 : boneLength, 0)) };
+					hierarchy.AddNode("bone" + std::to_string(b), local, (int)b, nullptr, 0);
+
+					Helpers::Bone bone;
+					bone.nodeIndex = b + 1;
+					bone.offsetTransform = glm::translate(glm::mat4(1), glm::vec3(0, -(float)b * boneLength, 0));
+					bones.push_back(bone);
+				}
+				hierarchy.UpdateWorldTransforms(false);
+
+				// Each ring is weighted between the two bones it lies between
+				const unsigned int numRings{ numBones * ringsPerBone + 1 };
+				for (unsigned int ring = 0; ring < numRings; ring++)
+				{
+					const float along{ (float)ring / ringsPerBone };
+					const unsigned int bone{ std::min((unsigned int)along, numBones - 1) };
+					const unsigned int nextBone{ std::min(bone + 1, numBones - 1) };
+					const float blend{ glm::clamp(along - bone, 0.0f, 1.0f) };
+
+					for (unsigned int segment = 0; segment <= segments; segment++)
+					{
+						const float angle{ 2.0f * pi * segment / segments };
+						const glm::vec3 normal{ std::cos(angle), 0, std::sin(angle) };
+						vertices.push_back(normal * radius + glm::vec3(0, along * boneLength, 0));
+						normals.push_back(normal);
+						uvCoords.push_back(glm::vec2((float)segment / segments, along));
+						boneIndices.push_back(glm::u8vec4(bone, nextBone, 0, 0));
+						boneWeights.push_back(glm::vec4(1.0f - blend, blend, 0, 0));
+					}
+				}
+
+				for (unsigned int ring = 0; ring + 1 < numRings; ring++)
+				{
+					for (unsigned int segment = 0; segment < segments; segment++)
+					{
+						const unsigned int corner{ ring * (segments + 1) + segment };
+						const unsigned int above{ corner + segments + 1 };
+						elements.insert(elements.end(), { corner, above, corner + 1, corner + 1, above, above + 1 });
+					}
+				}
+
+				mesh.vertices = Helpers::Span<glm::vec3>(vertices.data(), vertices.size());
+				mesh.normals = Helpers::Span<glm::vec3>(normals.data(), normals.size());
+				mesh.uvCoords = Helpers::Span<glm::vec2>(uvCoords.data(), uvCoords.size());
+				mesh.elements = Helpers::Span<unsigned int>(elements.data(), elements.size());
+				mesh.boneIndices = Helpers::Span<glm::u8vec4>(boneIndices.data(), boneIndices.size());
+				mesh.boneWeights = Helpers::Span<glm::vec4>(boneWeights.data(), boneWeights.size());
+				mesh.bones = Helpers::Span<Helpers::Bone>(bones.data(), bones.size());
+				mesh.CalculateBounds();
+
+				// Every bone sways about z, out of phase with its parent so the tube snakes
+				clip.name = "sway";
+				clip.duration = 2.0f;
+				const int numKeys{ 9 };
+				for (unsigned int b = 0; b < numBones; b++)
+				{
+					Helpers::AnimationChannel channel;
+					channel.nodeIndex = b + 1;
+					for (int key = 0; key < numKeys; key++)
+					{
+						const float time{ clip.duration * key / (numKeys - 1) };
+						const float angle{ 0.15f * std::sin(2.0f * pi * time / clip.duration + b * 0.4f) };
+						clip.rotations.Add(channel.rotations, time, glm::angleAxis(angle, glm::vec3(0, 0, 1)));
+					}
+					clip.positions.Add(channel.positions, 0, glm::vec3(hierarchy.GetNode(b + 1).transform[3]));
+					clip.channels.push_back(channel);
+				}
+			}
+		};
+
+		// Rigid node animation of many instances, searching every channel's keys against the cached key sampler
+		bool NodeAnimation()
+		{
+			// A turret on a base with two wheels, long baked clips give each channel many keys
+			const unsigned int numInstances{ 500 };
+			const int keysPerSecond{ 60 };
+			const float pi{ glm::pi<float>() };
+
+			Helpers::NodeHierarchy hierarchy;
+			hierarchy.AddNode("base", glm::mat4(1), -1, nullptr, 0);
+			hierarchy.AddNode("turret", glm::translate(glm::mat4(1), glm::vec3(0, 2, 0)), 0, nullptr, 0);
+			hierarchy.AddNode("barrel", glm::translate(glm::mat4(1), glm::vec3(0, 0.5f, 1)), 1, nullptr, 0);
+			hierarchy.AddNode("wheelLeft", glm::translate(glm::mat4(1), glm::vec3(-1, 0, 0)), 0, nullptr, 0);
+			hierarchy.AddNode("wheelRight", glm::translate(glm::mat4(1), glm::vec3(1, 0, 0)), 0, nullptr, 0);
+			hierarchy.UpdateWorldTransforms(false);
+
+			Helpers::AnimationClip clip;
+			clip.name = "patrol";
+			clip.duration = 30.0f;
+			const int numKeys{ (int)clip.duration * keysPerSecond + 1 };
+			for (unsigned int node = 1; node < hierarchy.NumNodes(); node++)
+			{
+				Helpers::AnimationChannel channel;
+				channel.nodeIndex = node;
+				const glm::vec3 axis{ node == 1 ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0) };
+				for (int key = 0; key < numKeys; key++)
+				{
+					const float time{ (float)key / keysPerSecond };
+					clip.rotations.Add(channel.rotations, time, glm::angleAxis(std::sin(time * node) * pi, axis));
+				}
+				clip.positions.Add(channel.positions, 0, glm::vec3(hierarchy.GetNode(node).transform[3]));
+				clip.channels.push_back(channel);
+			}
+
+			std::cout << "Node animation: " << numInstances << " instances of " << clip.channels.size() << " channels with " << numKeys << " keys each" << std::endl;
+
+			std::vector<Helpers::NodeHierarchy> poses(numInstances, hierarchy);
+			std::vector<Helpers::AnimationSampler> samplers(numInstances);
+			for (Helpers::AnimationSampler& sampler : samplers)
+				sampler.SetClip(&clip);
+
+			// Ten seconds of 60 Hz frames, instances offset in time so they are not in step
+			const int numFrames{ 600 };
+			auto play = [&](bool cached)
+			{
+				for (int frame = 0; frame < numFrames; frame++)
+				{
+					const float time{ frame / 60.0f };
+					for (unsigned int i = 0; i < numInstances; i++)
+					{
+						if (cached)
+							samplers[i].Sample(time + i * 0.37f, poses[i]);
+						else
+							Helpers::SampleAnimation(clip, time + i * 0.37f, poses[i]);
+						poses[i].UpdateWorldTransforms();
+					}
+				}
+			};
+
+			Measure("searched keys, " + std::to_string(numFrames) + " frames", 5, [&]() { play(false); });
+			Measure("cached keys, " + std::to_string(numFrames) + " frames", 5, [&]() { play(true); });
+
+			// Both ways must pose the nodes the same
+			std::vector<Helpers::NodeHierarchy> searched(poses);
+			for (unsigned int i = 0; i < numInstances; i++)
+			{
+				const float time{ 12.34f + i * 0.37f };
+				samplers[i].Sample(time, poses[i]);
+				Helpers::SampleAnimation(clip, time, searched[i]);
+				for (unsigned int node = 0; node < hierarchy.NumNodes(); node++)
+				{
+					const glm::mat4& a{ poses[i].GetNode(node).transform };
+					const glm::mat4& b{ searched[i].GetNode(node).transform };
+					for (int column = 0; column < 4; column++)
+					{
+						if (glm::any(glm::greaterThan(glm::abs(a[column] - b[column]), glm::vec4(1e-5f))))
+						{
+							std::cout << "  cached and searched poses differ" << std::endl;
+							return false;
+						}
+					}
+				}
+			}
+
+			return true;
+		}
+
+		// Most skinned tubes each skinning path can animate and draw within a 60 Hz frame
+		bool Skinning()
+		{
+			DrawContext context;
+			if (!context.Initialise())
+				return false;
+
+			const SkinnedTube tube(32, 10, 32);
+			std::cout << "Skinning: tubes of " << tube.vertices.size() << " vertices and " << tube.bones.size() << " bones" << std::endl;
+
+			std::vector<GLuint> buffers;
+			const MyMesh uploaded{ UploadMesh(tube.mesh, Helpers::VertexEncoding::Full, buffers) };
+
+			Helpers::ThreadPool threadPool;
+			const GLuint program{ context.GetProgram() };
+			const double frameBudgetMs{ 1000.0 / 60.0 };
+			const int spacingXZ{ 60 };
+
+			for (bool cpu : { false, true })
+			{
+				const std::string path{ cpu ? "cpu" : "gpu" };
+
+				// Average frame time animating, skinning and drawing this many tubes in a grid
+				auto measure = [&](int numInstances)
+				{
+					const int instancesX{ (int)std::ceil(std::sqrt((double)numInstances)) };
+					std::vector<Helpers::NodeHierarchy> poses(numInstances, tube.hierarchy);
+					std::vector<glm::mat4> palettes(numInstances * tube.bones.size());
+					std::vector<std::unique_ptr<SkinnedMesh>> skinnedMeshes;
+					if (cpu)
+					{
+						for (int i = 0; i < numInstances; i++)
+							skinnedMeshes.emplace_back(new SkinnedMesh(tube.mesh, uploaded));
+					}
+
+					float time{ 0 };
+					const double frameMs{ context.MeasureFrames(path + " " + std::to_string(numInstances), 60,
+						[&](const Helpers::Camera&, glm::mat4& projection, glm::mat4& view)
+					{
+						time += 1.0f / 60.0f;
+
+						const glm::mat4 combined{ projection * view };
+						glUniformMatrix4fv(glGetUniformLocation(program, "combined_xform"), 1, GL_FALSE, glm::value_ptr(combined));
+
+						for (int i = 0; i < numInstances; i++)
+						{
+							glm::mat4* palette{ palettes.data() + i * tube.bones.size() };
+							Helpers::SampleAnimation(tube.clip, time + i * 0.1f, poses[i]);
+							poses[i].UpdateWorldTransforms();
+							Helpers::ComputeSkinPalette(tube.mesh.bones, poses[i], palette);
+
+							const glm::mat4 model{ glm::translate(glm::mat4(1), glm::vec3((i % instancesX - instancesX / 2) * spacingXZ, 0, (i / instancesX - instancesX / 2) * spacingXZ)) };
+							glUniformMatrix4fv(glGetUniformLocation(program, "model_xform"), 1, GL_FALSE, glm::value_ptr(model));
+
+							if (cpu)
+							{
+								skinnedMeshes[i]->Skin(&threadPool, tube.mesh, palette);
+								skinnedMeshes[i]->Upload();
+								skinnedMeshes[i]->Draw(program);
+							}
+							else
+							{
+								uploaded.DrawSkinned(program, palette);
+							}
+						}
+					}) };
+					return frameMs;
+				};
+
+				// Double until over budget, then narrow down between the last two counts
+				int within{ 0 };
+				int over{ 1 };
+				const int maxInstances{ 1 << 16 };
+				while (over <= maxInstances && measure(over) <= frameBudgetMs)
+				{
+					within = over;
+					over *= 2;
+				}
+				while (over - within > std::max(1, within / 16))
+				{
+					const int middle{ (within + over) / 2 };
+					if (measure(middle) <= frameBudgetMs)
+						within = middle;
+					else
+						over = middle;
+				}
+
+				std::cout << "  " << path << " skinning sustains " << within << " tubes at 60 Hz" << std::endl;
+			}
+
+			glDeleteVertexArrays(1, &uploaded.VAO);
+			glDeleteBuffers((GLsizei)buffers.size(), buffers.data());
+
+			return true;
+		}
+	}
+
+	// Runs the named benchmark, or all of them if name is empty. Returns the process exit code.
+	int Run(const std::string& name)
+	{
+		const std::vector<std::pair<std::string, std::function<bool()>>> benchmarks{
+			{ "import", MeshImport },
+			{ "objimport", ObjImport },
+			{ "glbimport", GlbImport },
+			{ "bounds", BoundsKernel },
+			{ "compactpositions", CompactPositions },
+			{ "swizzle", SwizzleImages },
+			{ "compressedtextures", CompressedTextures },
+			{ "texturecompression", TextureCompression },
+			{ "mipgeneration", MipGeneration },
+			{ "texturestreaming", TextureStreaming },
+			{ "vertexencoding", VertexEncodings },
+			{ "vertexlayout", VertexLayouts },
+			{ "meshlets", MeshletCulling },
+			{ "lod", LevelsOfDetail },
+			{ "skinning", Skinning },
+			{ "nodeanimation", NodeAnimation },
+		};
+
+		bool foundAny{ false };
+		bool allPassed{ true };
+		for (const auto& benchmark : benchmarks)
+		{
+			if (!name.empty() && name != benchmark.first)
+				continue;
+
+			foundAny = true;
+			if (!benchmark.second())
+			{
+				std::cout << "Benchmark " << benchmark.first << " failed" << std::endl;
+				allPassed = false;
+			}
+		}
+
+		if (!foundAny)
+		{
+			std::cout << "Unknown benchmark: " << name << std::endl;
+			return -1;
+		}
+
+		return allPassed ? 0 : -1;
+	}
+}
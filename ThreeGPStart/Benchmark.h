@@ -0,0 +1,10 @@
+#pragma once
+// Microbenchmarks for the loading and rendering paths, run with: ThreeGPStart --benchmark [name]
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Benchmarks
+{
+	// Runs the named benchmark, or all of them if name is empty. Returns the process exit code.
+	int Run(const std::string& name);
+}
@@ -0,0 +1,192 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOUNDS_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace Helpers
+{
+
+	// Grow to also enclose other
+	void BoundingBox::Expand(const BoundingBox& other)
+	{
+		minExtents = glm::min(minExtents, other.minExtents);
+		maxExtents = glm::max(maxExtents, other.maxExtents);
+	}
+
+	// Box enclosing this one after transform, using Arvo's method so no corners need transforming
+	BoundingBox BoundingBox::Transformed(const glm::mat4& transform) const
+	{
+		if (!IsValid())
+			return *this;
+
+		// Start at the translation then add the smallest and largest contribution of each axis
+		BoundingBox result;
+		result.minExtents = result.maxExtents = glm::vec3(transform[3]);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const glm::vec3 column{ transform[axis] };
+			const glm::vec3 a{ column * minExtents[axis] };
+			const glm::vec3 b{ column * maxExtents[axis] };
+			result.minExtents += glm::min(a, b);
+			result.maxExtents += glm::max(a, b);
+		}
+
+		return result;
+	}
+
+	// Sphere enclosing this one after transform, non uniform scale uses the largest axis
+	BoundingSphere BoundingSphere::Transformed(const glm::mat4& transform) const
+	{
+		if (!IsValid())
+			return *this;
+
+		const float scaleSq{ std::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+			std::max(glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+				glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])))) };
+
+		BoundingSphere result;
+		result.centre = glm::vec3(transform * glm::vec4(centre, 1.0f));
+		result.radius = radius * std::sqrt(scaleSq);
+		return result;
+	}
+
+	// Extract the planes from a projection * view (* model) matrix (Gribb and Hartmann)
+	Frustum Frustum::FromMatrix(const glm::mat4& transform)
+	{
+		// Rows of the matrix, glm is column major
+		const glm::mat4 rows{ glm::transpose(transform) };
+
+		Frustum frustum;
+		frustum.planes[0] = rows[3] + rows[0];	// left
+		frustum.planes[1] = rows[3] - rows[0];	// right
+		frustum.planes[2] = rows[3] + rows[1];	// bottom
+		frustum.planes[3] = rows[3] - rows[1];	// top
+		frustum.planes[4] = rows[3] + rows[2];	// near
+		frustum.planes[5] = rows[3] - rows[2];	// far
+
+		// Normalise so distances to the planes are true distances
+		for (glm::vec4& plane : frustum.planes)
+			plane /= glm::length(glm::vec3(plane));
+
+		return frustum;
+	}
+
+	// False only if the sphere is certainly outside
+	bool Frustum::Intersects(const BoundingSphere& sphere) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane), sphere.centre) + plane.w < -sphere.radius)
+				return false;
+		}
+		return true;
+	}
+
+	// False only if the box is certainly outside
+	bool Frustum::Intersects(const BoundingBox& box) const
+	{
+		const glm::vec3 centre{ box.Centre() };
+		const glm::vec3 halfSize{ box.HalfSize() };
+		for (const glm::vec4& plane : planes)
+		{
+			// Distance of the centre against the box's extent along the plane normal
+			const glm::vec3 normal{ plane };
+			const float extent{ glm::dot(halfSize, glm::abs(normal)) };
+			if (glm::dot(normal, centre) + plane.w < -extent)
+				return false;
+		}
+		return true;
+	}
+
+	// Plain per component version of ComputeBoundingBox, kept for platforms without SSE and for comparison
+	BoundingBox ComputeBoundingBoxScalar(const glm::vec3* points, size_t count)
+	{
+		BoundingBox box;
+		for (size_t i = 0; i < count; i++)
+		{
+			box.minExtents = glm::min(box.minExtents, points[i]);
+			box.maxExtents = glm::max(box.maxExtents, points[i]);
+		}
+		return box;
+	}
+
+	// Box enclosing count points, uses SSE where available
+	BoundingBox ComputeBoundingBox(const glm::vec3* points, size_t count)
+	{
+#ifdef BOUNDS_USE_SSE
+		// Four packed vec3 are exactly three SSE registers:
+		//   x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+		// so min / max each register as it comes and sort out which lane is which axis at the end
+		const size_t numBlocks{ count / 4 };
+		if (numBlocks == 0)
+			return ComputeBoundingBoxScalar(points, count);
+
+		const float* data{ (const float*)points };
+
+		__m128 min0{ _mm_loadu_ps(data) }, min1{ _mm_loadu_ps(data + 4) }, min2{ _mm_loadu_ps(data + 8) };
+		__m128 max0{ min0 }, max1{ min1 }, max2{ min2 };
+
+		for (size_t block = 1; block < numBlocks; block++)
+		{
+			const float* blockData{ data + block * 12 };
+			const __m128 v0{ _mm_loadu_ps(blockData) };
+			const __m128 v1{ _mm_loadu_ps(blockData + 4) };
+			const __m128 v2{ _mm_loadu_ps(blockData + 8) };
+
+			min0 = _mm_min_ps(min0, v0);
+			min1 = _mm_min_ps(min1, v1);
+			min2 = _mm_min_ps(min2, v2);
+			max0 = _mm_max_ps(max0, v0);
+			max1 = _mm_max_ps(max1, v1);
+			max2 = _mm_max_ps(max2, v2);
+		}
+
+		float mins[12];
+		float maxs[12];
+		_mm_storeu_ps(mins, min0);
+		_mm_storeu_ps(mins + 4, min1);
+		_mm_storeu_ps(mins + 8, min2);
+		_mm_storeu_ps(maxs, max0);
+		_mm_storeu_ps(maxs + 4, max1);
+		_mm_storeu_ps(maxs + 8, max2);
+
+		// Lane i holds axis i % 3, the leftover points go through the scalar path
+		BoundingBox box{ ComputeBoundingBoxScalar(points + numBlocks * 4, count - numBlocks * 4) };
+		for (int lane = 0; lane < 12; lane++)
+		{
+			box.minExtents[lane % 3] = std::min(box.minExtents[lane % 3], mins[lane]);
+			box.maxExtents[lane % 3] = std::max(box.maxExtents[lane % 3], maxs[lane]);
+		}
+		return box;
+#else
+		return ComputeBoundingBoxScalar(points, count);
+#endif
+	}
+
+	// Sphere around the centre of box enclosing count points
+	BoundingSphere ComputeBoundingSphere(const glm::vec3* points, size_t count, const BoundingBox& box)
+	{
+		BoundingSphere sphere;
+		if (!box.IsValid())
+			return sphere;
+
+		sphere.centre = box.Centre();
+
+		float radiusSq{ 0 };
+		for (size_t i = 0; i < count; i++)
+		{
+			const glm::vec3 offset{ points[i] - sphere.centre };
+			radiusSq = std::max(radiusSq, glm::dot(offset, offset));
+		}
+
+		sphere.radius = std::sqrt(radiusSq);
+		return sphere;
+	}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+// Bounding volumes used for culling and spatial queries
+
+#include "ExternalLibraryHeaders.h"
+
+#include <limits>
+
+namespace Helpers
+{
+
+	// Axis aligned bounding box, empty until something is added to it
+	struct BoundingBox
+	{
+		glm::vec3 minExtents{ std::numeric_limits<float>::max() };
+		glm::vec3 maxExtents{ -std::numeric_limits<float>::max() };
+
+		// False for a box that has had nothing added
+		bool IsValid() const { return minExtents.x <= maxExtents.x; }
+
+		glm::vec3 Centre() const { return (minExtents + maxExtents) * 0.5f; }
+		glm::vec3 HalfSize() const { return (maxExtents - minExtents) * 0.5f; }
+
+		// Grow to also enclose other
+		void Expand(const BoundingBox& other);
+
+		// Box enclosing this one after transform, using Arvo's method so no corners need transforming
+		BoundingBox Transformed(const glm::mat4& transform) const;
+	};
+
+	// Bounding sphere, negative radius when empty
+	struct BoundingSphere
+	{
+		glm::vec3 centre{ 0 };
+		float radius{ -1.0f };
+
+		// False for a sphere that has had nothing added
+		bool IsValid() const { return radius >= 0; }
+
+		// Sphere enclosing this one after transform, non uniform scale uses the largest axis
+		BoundingSphere Transformed(const glm::mat4& transform) const;
+	};
+
+	// View frustum as six inward facing planes, a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+
+		// Extract the planes from a projection * view (* model) matrix, the planes are in the space the matrix transforms from
+		static Frustum FromMatrix(const glm::mat4& transform);
+
+		// False only if the volume is certainly outside
+		bool Intersects(const BoundingSphere& sphere) const;
+		bool Intersects(const BoundingBox& box) const;
+	};
+
+	// Box enclosing count points, uses SSE where available
+	BoundingBox ComputeBoundingBox(const glm::vec3* points, size_t count);
+
+	// Plain per component version of ComputeBoundingBox, kept for platforms without SSE and for comparison
+	BoundingBox ComputeBoundingBoxScalar(const glm::vec3* points, size_t count);
+
+	// Sphere around the centre of box enclosing count points
+	BoundingSphere ComputeBoundingSphere(const glm::vec3* points, size_t count, const BoundingBox& box);
+
+}
@@ -8,26 +8,58 @@ in vec2 varying_coord;
 
 uniform sampler2D sampler_tex;
 
+//Every material in the MaterialLibrary, laid out as GpuMaterial. Each draw picks one with material_index.
+const int MAX_MATERIALS = 128;
+
+struct Material
+{
+	vec4 ambient_colour;
+	vec4 diffuse_colour;
+	vec4 specular_colour;
+	vec4 emissive_colour;
+	float specular_factor;
+};
+
+layout(std140) uniform Materials
+{
+	Material materials[MAX_MATERIALS];
+};
+
+uniform int material_index = 0;
+
+//Scene lighting, set once per frame by the Renderer
+uniform vec3 light_position = vec3(0, 5000, 0);
+uniform vec3 light_colour = vec3(0.8);
+uniform vec3 ambient_light = vec3(0.7);
+uniform vec3 camera_position = vec3(0);
+
 void main(void)
 {
 
-	vec3 light_position = vec3(0, 5000, 0);
+	Material material = materials[material_index];
+
 	vec3 tex_colour = texture(sampler_tex, varying_coord).rgb;
 
 	vec3 P = varying_position;
 
-	vec3 light_direction = P - light_position;
-
-	vec3 L = normalize(-light_direction);
+	vec3 L = normalize(light_position - P);
 	vec3 N = normalize(varying_normal);
-	
-	float diffuse_intensity = max(0, dot( L, N )) * 0.8;
+	vec3 V = normalize(camera_position - P);
+
+	float diffuse_intensity = max(0, dot( L, N ));
 
-	vec3 final_colour = tex_colour * diffuse_intensity;
+	//Emissive, ambient and diffuse all scale the texel
+	vec3 final_colour = tex_colour * (material.emissive_colour.rgb +
+		material.ambient_colour.rgb * ambient_light +
+		material.diffuse_colour.rgb * light_colour * diffuse_intensity);
 
-	vec4 fragment_colour_one = vec4(final_colour, 1.0); //Point Light
-	vec4 fragment_colour_two = vec4(tex_colour, 1.0) * 0.7; //Ambient Lighting
+	//Blinn-Phong highlight, the specular factor is the power
+	if (diffuse_intensity > 0 && material.specular_factor > 0)
+	{
+		vec3 H = normalize(L + V);
+		final_colour += material.specular_colour.rgb * light_colour * pow(max(0, dot(N, H)), material.specular_factor);
+	}
 
-	fragment_colour = fragment_colour_one + fragment_colour_two;
+	fragment_colour = vec4(final_colour, material.diffuse_colour.a);
 
 }
\ No newline at end of file
@@ -3,21 +3,63 @@
 uniform mat4 combined_xform;
 uniform mat4 model_xform;
 
+//Compact meshes store positions as 0..1 across their bounds, full float meshes use an offset of 0 and scale of 1
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+
+//Compact meshes store normals octahedral encoded in .xy as 0..1
+uniform bool oct_normals;
+
+//Skinned meshes blend up to four of these bone matrices per vertex, kept small enough to fit the minimum uniform space GL guarantees
+const int MAX_BONES = 60;
+uniform bool skinned;
+uniform mat4 bone_palette[MAX_BONES];
+
+//Meshes drawn by several nodes are drawn instanced, each instance placed by its node's transform within the model
+uniform bool instanced;
+
 layout(location = 0) in vec3 vertex_position;
 layout(location = 1) in vec3 vertex_normal;
 layout(location = 2) in vec2 texture_coord;
+layout(location = 3) in uvec4 bone_indices;
+layout(location = 4) in vec4 bone_weights;
+layout(location = 5) in mat4 instance_xform; //Takes locations 5 to 8
 
 out vec3 varying_normal;
 out vec2 varying_coord;
 out vec3 varying_position;
 
+vec3 oct_decode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
 void main(void)
 {
+	vec3 position = position_offset + vertex_position * position_scale;
+	vec3 normal = oct_normals ? oct_decode(vertex_normal.xy * 2.0 - 1.0) : vertex_normal;
+
+	if (skinned)
+	{
+		mat4 skin = bone_palette[bone_indices.x] * bone_weights.x +
+			bone_palette[bone_indices.y] * bone_weights.y +
+			bone_palette[bone_indices.z] * bone_weights.z +
+			bone_palette[bone_indices.w] * bone_weights.w;
+
+		position = vec3(skin * vec4(position, 1.0));
+		normal = mat3(skin) * normal;
+	}
+
+	mat4 world_xform = instanced ? model_xform * instance_xform : model_xform;
+
 	varying_coord = texture_coord;
-	varying_normal = mat3(model_xform) * vertex_normal;
+	varying_normal = mat3(world_xform) * normal;
 
-	varying_position = mat4x3 (model_xform) * vec4(vertex_position, 1.0);
+	varying_position = mat4x3 (world_xform) * vec4(position, 1.0);
 
-	gl_Position = combined_xform * model_xform * vec4(vertex_position, 1.0);
+	gl_Position = combined_xform * world_xform * vec4(position, 1.0);
 
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "FileWatcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace Helpers
+{
+
+	namespace
+	{
+		// How often file stamps are compared when inotify is not available
+		const double kStampIntervalMs{ 500 };
+	}
+
+	FileWatcher::FileWatcher()
+	{
+#ifdef __linux__
+		m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_inotify < 0)
+			std::cout << "inotify unavailable, watching file stamps instead" << std::endl;
+#endif
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+#ifdef __linux__
+		if (m_inotify >= 0)
+			close(m_inotify);
+#endif
+	}
+
+	// Start watching a file, returns false if it cannot be watched. Watching a file twice is harmless.
+	bool FileWatcher::Watch(const std::string& filename)
+	{
+		const std::string path{ CanonicalPath(filename) };
+		if (m_files.count(path))
+			return true;
+
+		// The canonical path also opens on Linux when the name was given with '\\' separators
+		FileStamp stamp;
+		if (!GetFileStamp(path, stamp))
+			return false;
+
+#ifdef __linux__
+		if (m_inotify >= 0)
+		{
+			// Watch the directory rather than the file as a rename over the file would end a file watch
+			const size_t slash{ path.find_last_of('/') };
+			const std::string directory{ slash == std::string::npos ? "." : path.substr(0, slash) };
+
+			const int watch{ inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) };
+			if (watch < 0)
+			{
+				std::cout << "Could not watch directory: " << directory << std::endl;
+				return false;
+			}
+			m_directories[watch] = directory;
+		}
+#endif
+
+		m_files[path] = stamp;
+		return true;
+	}
+
+	// Changed files found by inotify, reported by the next Poll
+	void FileWatcher::ReadEvents(std::set<std::string>& changed)
+	{
+#ifdef __linux__
+		alignas(inotify_event) char buffer[4096];
+		for (;;)
+		{
+			const ssize_t numBytes{ read(m_inotify, buffer, sizeof(buffer)) };
+			if (numBytes <= 0)
+				break; // EAGAIN once the queue is empty
+
+			for (ssize_t offset = 0; offset < numBytes; )
+			{
+				const inotify_event* event{ (const inotify_event*)(buffer + offset) };
+				offset += sizeof(inotify_event) + event->len;
+
+				auto directory = m_directories.find(event->wd);
+				if (directory == m_directories.end() || event->len == 0)
+					continue;
+
+				// Other files in the same directory are ignored
+				const std::string path{ CanonicalPath(directory->second + "/" + event->name) };
+				if (m_files.count(path))
+					changed.insert(path);
+			}
+		}
+#else
+		(void)changed;
+#endif
+	}
+
+	// Canonical paths of the watched files written since the last call, never waits
+	std::vector<std::string> FileWatcher::Poll()
+	{
+		// A save often writes more than once, each file is only reported once per poll
+		std::set<std::string> changed;
+
+		if (m_inotify >= 0)
+		{
+			ReadEvents(changed);
+		}
+		else if (m_stampTimer.ElapsedMs() >= kStampIntervalMs)
+		{
+			m_stampTimer.Reset();
+			for (auto& entry : m_files)
+			{
+				FileStamp stamp;
+				if (!GetFileStamp(entry.first, stamp))
+					continue; // Mid save, or deleted, check again next time
+
+				if (stamp.modifiedTime != entry.second.modifiedTime || stamp.size != entry.second.size)
+				{
+					entry.second = stamp;
+					changed.insert(entry.first);
+				}
+			}
+		}
+
+		return std::vector<std::string>(changed.begin(), changed.end());
+	}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+// Detects asset files rewritten on disk so they can be reloaded while the program runs
+
+#include "ExternalLibraryHeaders.h"
+#include "Helper.h"
+
+#include <set>
+
+namespace Helpers
+{
+
+	// Watches a set of files for changes without blocking the caller
+	// On Linux inotify watches the directories holding the files, so editors that save by writing a new file
+	// and renaming it over the old one are caught too. Elsewhere the file stamps are compared a few times a second.
+	class FileWatcher
+	{
+	private:
+		// Watched files by canonical path, with their stamp when last checked
+		std::map<std::string, FileStamp> m_files;
+
+		// inotify instance and the canonical directory of each watch descriptor, -1 if inotify is not in use
+		int m_inotify{ -1 };
+		std::map<int, std::string> m_directories;
+
+		// Time since the stamps were last compared, when inotify is not in use
+		Timer m_stampTimer;
+
+		// Changed files found by inotify, reported by the next Poll
+		void ReadEvents(std::set<std::string>& changed);
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		// Owns an OS handle so cannot be copied
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		// Start watching a file, returns false if it cannot be watched. Watching a file twice is harmless.
+		bool Watch(const std::string& filename);
+
+		// Canonical paths of the watched files written since the last call, never waits
+		std::vector<std::string> Poll();
+	};
+
+}
@@ -0,0 +1,874 @@
+#include "GltfLoader.h"
+#include "ObjLoader.h"
+#include "Helper.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Binary glTF header and chunk types
+		const uint32_t kGlbMagic{ 0x46546C67 }; // "glTF"
+		const uint32_t kGlbChunkJson{ 0x4E4F534A }; // "JSON"
+		const uint32_t kGlbChunkBin{ 0x004E4942 }; // "BIN\0"
+
+		// Accessor component types
+		const int kByte{ 5120 };
+		const int kUnsignedByte{ 5121 };
+		const int kShort{ 5122 };
+		const int kUnsignedShort{ 5123 };
+		const int kUnsignedInt{ 5125 };
+		const int kFloat{ 5126 };
+
+		const int kModeTriangles{ 4 };
+
+		// Deepest nesting the JSON parser and the node walk follow, glTF needs only a handful
+		const int kMaxDepth{ 256 };
+
+		struct JsonValue;
+		const JsonValue& NullValue();
+
+		// Parsed JSON, objects keep their members in file order
+		struct JsonValue
+		{
+			enum class Type { Null, Boolean, Number, String, Array, Object };
+
+			Type type{ Type::Null };
+			bool boolean{ false };
+			double number{ 0 };
+			std::string string;
+			std::vector<JsonValue> elements;
+			std::vector<std::pair<std::string, JsonValue>> members;
+
+			// Member or element, a null value if there is none so lookups can be chained
+			const JsonValue& operator[](const char* key) const;
+			const JsonValue& operator[](size_t index) const;
+			const JsonValue& operator[](int index) const { return index < 0 ? NullValue() : (*this)[(size_t)index]; }
+
+			bool Has(const char* key) const { return (*this)[key].type != Type::Null; }
+			size_t Size() const { return type == Type::Array ? elements.size() : 0; }
+			double Number(double fallback) const { return type == Type::Number ? number : fallback; }
+			int Int(int fallback) const { return type == Type::Number && number >= -2147483648.0 && number <= 2147483647.0 ? (int)number : fallback; }
+
+			// Counts, offsets and strides, fallback unless a whole number a size_t can hold exactly
+			size_t Unsigned(size_t fallback) const { return type == Type::Number && number >= 0 && number <= 9007199254740992.0 ? (size_t)number : fallback; }
+			const std::string& String() const;
+		};
+
+		const JsonValue& NullValue()
+		{
+			static const JsonValue null;
+			return null;
+		}
+
+		const JsonValue& JsonValue::operator[](const char* key) const
+		{
+			for (const auto& member : members)
+			{
+				if (member.first == key)
+					return member.second;
+			}
+			return NullValue();
+		}
+
+		const JsonValue& JsonValue::operator[](size_t index) const
+		{
+			return index < Size() ? elements[index] : NullValue();
+		}
+
+		const std::string& JsonValue::String() const
+		{
+			return type == Type::String ? string : NullValue().string;
+		}
+
+		// Recursive descent JSON parser over a block of text
+		class JsonParser
+		{
+		private:
+			const char* m_cursor;
+			const char* m_end;
+			int m_depth{ 0 };
+
+			void SkipSpace()
+			{
+				while (m_cursor < m_end && (*m_cursor == ' ' || *m_cursor == '\t' || *m_cursor == '\n' || *m_cursor == '\r'))
+					m_cursor++;
+			}
+
+			bool Expect(char c)
+			{
+				SkipSpace();
+				if (m_cursor == m_end || *m_cursor != c)
+					return false;
+				m_cursor++;
+				return true;
+			}
+
+			bool ParseLiteral(const char* word)
+			{
+				const size_t length{ std::strlen(word) };
+				if ((size_t)(m_end - m_cursor) < length || std::memcmp(m_cursor, word, length) != 0)
+					return false;
+				m_cursor += length;
+				return true;
+			}
+
+			static void AppendUtf8(std::string& out, unsigned int code)
+			{
+				if (code < 0x80)
+				{
+					out += (char)code;
+				}
+				else if (code < 0x800)
+				{
+					out += (char)(0xC0 | (code >> 6));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+				else if (code < 0x10000)
+				{
+					out += (char)(0xE0 | (code >> 12));
+					out += (char)(0x80 | ((code >> 6) & 0x3F));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+				else
+				{
+					out += (char)(0xF0 | (code >> 18));
+					out += (char)(0x80 | ((code >> 12) & 0x3F));
+					out += (char)(0x80 | ((code >> 6) & 0x3F));
+					out += (char)(0x80 | (code & 0x3F));
+				}
+			}
+
+			bool ParseHex4(unsigned int& code)
+			{
+				if (m_end - m_cursor < 4)
+					return false;
+				code = 0;
+				for (int i = 0; i < 4; i++)
+				{
+					const char c{ *m_cursor++ };
+					code <<= 4;
+					if (c >= '0' && c <= '9')
+						code |= c - '0';
+					else if (c >= 'a' && c <= 'f')
+						code |= c - 'a' + 10;
+					else if (c >= 'A' && c <= 'F')
+						code |= c - 'A' + 10;
+					else
+						return false;
+				}
+				return true;
+			}
+
+			bool ParseString(std::string& out)
+			{
+				if (!Expect('"'))
+					return false;
+
+				while (m_cursor < m_end && *m_cursor != '"')
+				{
+					const char c{ *m_cursor++ };
+					if (c != '\\')
+					{
+						out += c;
+						continue;
+					}
+
+					if (m_cursor == m_end)
+						return false;
+
+					const char escaped{ *m_cursor++ };
+					switch (escaped)
+					{
+					case '"': out += '"'; break;
+					case '\\': out += '\\'; break;
+					case '/': out += '/'; break;
+					case 'b': out += '\b'; break;
+					case 'f': out += '\f'; break;
+					case 'n': out += '\n'; break;
+					case 'r': out += '\r'; break;
+					case 't': out += '\t'; break;
+					case 'u':
+					{
+						unsigned int code;
+						if (!ParseHex4(code))
+							return false;
+
+						// Characters outside the basic plane arrive as a surrogate pair
+						if (code >= 0xD800 && code < 0xDC00 && m_end - m_cursor >= 6 && m_cursor[0] == '\\' && m_cursor[1] == 'u')
+						{
+							m_cursor += 2;
+							unsigned int low;
+							if (!ParseHex4(low) || low < 0xDC00 || low >= 0xE000)
+								return false;
+							code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+						}
+						AppendUtf8(out, code);
+						break;
+					}
+					default:
+						return false;
+					}
+				}
+
+				if (m_cursor == m_end)
+					return false;
+				m_cursor++;
+				return true;
+			}
+
+			// Integers are exact up to 2^53, anything with a fraction or exponent goes through the float parser
+			bool ParseNumber(double& out)
+			{
+				const char* start{ m_cursor };
+				bool integer{ true };
+				while (m_cursor < m_end)
+				{
+					const char c{ *m_cursor };
+					if (c == '.' || c == 'e' || c == 'E')
+						integer = false;
+					else if ((c < '0' || c > '9') && c != '+' && c != '-')
+						break;
+					m_cursor++;
+				}
+
+				if (m_cursor == start)
+					return false;
+
+				if (integer)
+				{
+					const bool negative{ *start == '-' };
+					double value{ 0 };
+					for (const char* p = start + (negative || *start == '+' ? 1 : 0); p < m_cursor; p++)
+					{
+						if (*p < '0' || *p > '9')
+							return false;
+						value = value * 10 + (*p - '0');
+					}
+					out = negative ? -value : value;
+					return true;
+				}
+
+				const char* cursor{ start };
+				float value;
+				if (!ParseFloat(cursor, m_cursor, value) || cursor != m_cursor)
+					return false;
+				out = value;
+				return true;
+			}
+		public:
+			JsonParser(const char* begin, const char* end) : m_cursor(begin), m_end(end) {}
+
+			bool Parse(JsonValue& value)
+			{
+				SkipSpace();
+				if (m_cursor == m_end || ++m_depth > kMaxDepth)
+					return false;
+
+				bool parsed{ false };
+				switch (*m_cursor)
+				{
+				case '{':
+				{
+					m_cursor++;
+					value.type = JsonValue::Type::Object;
+					parsed = Expect('}');
+					while (!parsed)
+					{
+						std::pair<std::string, JsonValue> member;
+						if (!ParseString(member.first) || !Expect(':') || !Parse(member.second))
+							break;
+						value.members.push_back(std::move(member));
+						if (Expect('}'))
+							parsed = true;
+						else if (!Expect(','))
+							break;
+					}
+					break;
+				}
+				case '[':
+				{
+					m_cursor++;
+					value.type = JsonValue::Type::Array;
+					parsed = Expect(']');
+					while (!parsed)
+					{
+						value.elements.emplace_back();
+						if (!Parse(value.elements.back()))
+							break;
+						if (Expect(']'))
+							parsed = true;
+						else if (!Expect(','))
+							break;
+					}
+					break;
+				}
+				case '"':
+					value.type = JsonValue::Type::String;
+					parsed = ParseString(value.string);
+					break;
+				case 't':
+					value.type = JsonValue::Type::Boolean;
+					value.boolean = true;
+					parsed = ParseLiteral("true");
+					break;
+				case 'f':
+					value.type = JsonValue::Type::Boolean;
+					parsed = ParseLiteral("false");
+					break;
+				case 'n':
+					parsed = ParseLiteral("null");
+					break;
+				default:
+					value.type = JsonValue::Type::Number;
+					parsed = ParseNumber(value.number);
+					break;
+				}
+
+				m_depth--;
+				return parsed;
+			}
+
+			// True once only white space is left
+			bool AtEnd()
+			{
+				SkipSpace();
+				return m_cursor == m_end;
+			}
+		};
+
+		// Where an accessor's values lie in the binary chunk
+		struct AccessorView
+		{
+			const unsigned char* data{ nullptr };
+			size_t count{ 0 };
+			size_t stride{ 0 };
+			int componentType{ 0 };
+			int numComponents{ 0 };
+			bool normalized{ false };
+		};
+
+		size_t ComponentSize(int componentType)
+		{
+			switch (componentType)
+			{
+			case kByte:
+			case kUnsignedByte:
+				return 1;
+			case kShort:
+			case kUnsignedShort:
+				return 2;
+			case kUnsignedInt:
+			case kFloat:
+				return 4;
+			}
+			return 0;
+		}
+
+		int NumComponents(const std::string& type)
+		{
+			if (type == "SCALAR")
+				return 1;
+			if (type == "VEC2")
+				return 2;
+			if (type == "VEC3")
+				return 3;
+			if (type == "VEC4")
+				return 4;
+			return 0;
+		}
+
+		// Find an accessor's values, checking they lie inside the binary chunk
+		bool LocateAccessor(const JsonValue& json, const unsigned char* bin, size_t binSize, const JsonValue& accessorIndex, AccessorView& view)
+		{
+			const JsonValue& accessor{ json["accessors"][(size_t)accessorIndex.Int(-1)] };
+			if (accessor.type != JsonValue::Type::Object)
+			{
+				std::cout << "glTF accessor " << accessorIndex.Int(-1) << " does not exist" << std::endl;
+				return false;
+			}
+
+			if (accessor.Has("sparse") || !accessor.Has("bufferView"))
+			{
+				std::cout << "glTF sparse and zero filled accessors are not supported" << std::endl;
+				return false;
+			}
+
+			const JsonValue& bufferView{ json["bufferViews"][(size_t)accessor["bufferView"].Int(-1)] };
+			if (bufferView["buffer"].Int(-1) != 0 || json["buffers"][0].Has("uri"))
+			{
+				std::cout << "glTF buffers outside the .glb file are not supported" << std::endl;
+				return false;
+			}
+
+			view.componentType = accessor["componentType"].Int(0);
+			view.numComponents = NumComponents(accessor["type"].String());
+			view.count = accessor["count"].Unsigned(0);
+			view.normalized = accessor["normalized"].boolean;
+
+			const size_t elementSize{ ComponentSize(view.componentType) * view.numComponents };
+			view.stride = bufferView["byteStride"].Unsigned(0);
+			if (view.stride == 0)
+				view.stride = elementSize;
+
+			const size_t viewOffset{ bufferView["byteOffset"].Unsigned(0) };
+			const size_t viewLength{ bufferView["byteLength"].Unsigned(SIZE_MAX) };
+			const size_t accessorOffset{ accessor["byteOffset"].Unsigned(0) };
+
+			// Every value must lie inside the buffer view, which must lie inside the binary chunk
+			bool inside{ elementSize != 0 && view.stride >= elementSize && viewOffset <= binSize && viewLength <= binSize - viewOffset && accessorOffset <= viewLength };
+			if (inside && view.count > 0)
+			{
+				const size_t available{ viewLength - accessorOffset };
+				inside = available >= elementSize && view.count - 1 <= (available - elementSize) / view.stride;
+			}
+
+			if (!inside)
+			{
+				std::cout << "glTF accessor " << accessorIndex.Int(-1) << " is malformed or outside the binary chunk" << std::endl;
+				return false;
+			}
+
+			view.data = bin + viewOffset + accessorOffset;
+			return true;
+		}
+
+		// Component c of value i as a float, normalising integer types when the accessor asks to
+		float ReadComponent(const AccessorView& view, size_t i, int c)
+		{
+			const unsigned char* p{ view.data + i * view.stride + c * ComponentSize(view.componentType) };
+			switch (view.componentType)
+			{
+			case kFloat:
+			{
+				float value;
+				std::memcpy(&value, p, sizeof(value));
+				return value;
+			}
+			case kUnsignedByte:
+				return view.normalized ? *p / 255.0f : *p;
+			case kByte:
+			{
+				const signed char value{ (signed char)*p };
+				return view.normalized ? std::max(value / 127.0f, -1.0f) : value;
+			}
+			case kUnsignedShort:
+			{
+				uint16_t value;
+				std::memcpy(&value, p, sizeof(value));
+				return view.normalized ? value / 65535.0f : value;
+			}
+			case kShort:
+			{
+				int16_t value;
+				std::memcpy(&value, p, sizeof(value));
+				return view.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+			}
+			case kUnsignedInt:
+			{
+				uint32_t value;
+				std::memcpy(&value, p, sizeof(value));
+				return (float)value;
+			}
+			}
+			return 0;
+		}
+
+		// View a float vector accessor in place when it is tightly packed and aligned, otherwise convert it
+		template<typename T>
+		bool ReadVectorStream(const AccessorView& view, GltfStream<T>& stream)
+		{
+			if (view.numComponents != T::length())
+				return false;
+
+			if (view.componentType == kFloat && view.stride == sizeof(T) && (uintptr_t)view.data % alignof(T) == 0)
+			{
+				stream.inPlace = Span<T>((const T*)view.data, view.count);
+				return true;
+			}
+
+			stream.converted.resize(view.count);
+			for (size_t i = 0; i < view.count; i++)
+			{
+				for (int c = 0; c < T::length(); c++)
+					stream.converted[i][c] = ReadComponent(view, i, c);
+			}
+			return true;
+		}
+
+		// View 32 bit indices in place, widen smaller ones
+		bool ReadElements(const AccessorView& view, GltfStream<unsigned int>& stream)
+		{
+			if (view.numComponents != 1)
+				return false;
+
+			if (view.componentType == kUnsignedInt && view.stride == sizeof(unsigned int) && (uintptr_t)view.data % alignof(unsigned int) == 0)
+			{
+				stream.inPlace = Span<unsigned int>((const unsigned int*)view.data, view.count);
+				return true;
+			}
+
+			if (view.componentType != kUnsignedInt && view.componentType != kUnsignedShort && view.componentType != kUnsignedByte)
+				return false;
+
+			stream.converted.resize(view.count);
+			for (size_t i = 0; i < view.count; i++)
+			{
+				const unsigned char* p{ view.data + i * view.stride };
+				if (view.componentType == kUnsignedByte)
+				{
+					stream.converted[i] = *p;
+				}
+				else if (view.componentType == kUnsignedShort)
+				{
+					uint16_t value;
+					std::memcpy(&value, p, sizeof(value));
+					stream.converted[i] = value;
+				}
+				else
+				{
+					std::memcpy(&stream.converted[i], p, sizeof(unsigned int));
+				}
+			}
+			return true;
+		}
+
+		// Area weighted vertex normals, for primitives the file gives none
+		void GenerateSmoothNormals(GltfPrimitive& primitive)
+		{
+			const glm::vec3* vertices{ primitive.vertices.data() };
+			const unsigned int* elements{ primitive.elements.data() };
+
+			std::vector<glm::vec3>& normals{ primitive.normals.converted };
+			normals.assign(primitive.vertices.size(), glm::vec3(0));
+			for (size_t e = 0; e + 2 < primitive.elements.size(); e += 3)
+			{
+				const glm::vec3 normal{ glm::cross(vertices[elements[e + 1]] - vertices[elements[e]], vertices[elements[e + 2]] - vertices[elements[e]]) };
+				for (int corner = 0; corner < 3; corner++)
+					normals[elements[e + corner]] += normal;
+			}
+
+			for (glm::vec3& normal : normals)
+			{
+				const float length{ glm::length(normal) };
+				normal = length > 0 ? normal / length : glm::vec3(0, 1, 0);
+			}
+		}
+
+		// Our materials are Phong, so the metallic roughness model is approximated: the base colour lights diffuse
+		// and ambient, metals reflect their base colour, and rougher surfaces have a broader, weaker highlight
+		Material ConvertMaterial(const JsonValue& json, const JsonValue& gltfMaterial)
+		{
+			Material material;
+
+			const JsonValue& pbr{ gltfMaterial["pbrMetallicRoughness"] };
+			glm::vec4 baseColour{ 1 };
+			if (pbr["baseColorFactor"].Size() == 4)
+			{
+				for (int c = 0; c < 4; c++)
+					baseColour[c] = (float)pbr["baseColorFactor"][c].Number(1);
+			}
+			const float metallic{ (float)pbr["metallicFactor"].Number(1) };
+			const float roughness{ glm::clamp((float)pbr["roughnessFactor"].Number(1), 0.0f, 1.0f) };
+
+			material.diffuseColour = baseColour;
+			material.ambientColour = baseColour;
+			material.specularColour = glm::vec4(glm::mix(glm::vec3(0.04f), glm::vec3(baseColour), metallic) * (1 - roughness), 1);
+
+			const float roughness4{ std::max(roughness * roughness * roughness * roughness, 1e-4f) };
+			material.specularFactor = glm::clamp(2 / roughness4 - 2, 1.0f, 256.0f);
+
+			if (gltfMaterial["emissiveFactor"].Size() == 3)
+			{
+				for (int c = 0; c < 3; c++)
+					material.emissiveColour[c] = (float)gltfMaterial["emissiveFactor"][c].Number(0);
+				material.emissiveColour.a = 1;
+			}
+
+			// Only images held in their own files can be named, like Assimp the name is left relative to the model
+			if (pbr.Has("baseColorTexture"))
+			{
+				const JsonValue& texture{ json["textures"][(size_t)pbr["baseColorTexture"]["index"].Int(-1)] };
+				const JsonValue& image{ json["images"][(size_t)texture["source"].Int(-1)] };
+				const std::string& uri{ image["uri"].String() };
+				if (!uri.empty() && uri.compare(0, 5, "data:") != 0)
+					material.diffuseTextureFilename = uri;
+				else
+					std::cout << "Ignoring: glTF image embedded in the file" << std::endl;
+			}
+
+			return material;
+		}
+
+		// Local transform from a matrix or from translation, rotation and scale
+		glm::mat4 NodeTransform(const JsonValue& node)
+		{
+			if (node["matrix"].Size() == 16)
+			{
+				float values[16];
+				for (size_t i = 0; i < 16; i++)
+					values[i] = (float)node["matrix"][i].Number(0);
+				return glm::make_mat4(values); // glTF is column major like glm
+			}
+
+			glm::vec3 translation{ 0 };
+			glm::quat rotation{ 1, 0, 0, 0 };
+			glm::vec3 scale{ 1 };
+			if (node["translation"].Size() == 3)
+				translation = glm::vec3(node["translation"][0].Number(0), node["translation"][1].Number(0), node["translation"][2].Number(0));
+			if (node["rotation"].Size() == 4) // x, y, z, w
+				rotation = glm::quat((float)node["rotation"][3].Number(1), (float)node["rotation"][0].Number(0), (float)node["rotation"][1].Number(0), (float)node["rotation"][2].Number(0));
+			if (node["scale"].Size() == 3)
+				scale = glm::vec3(node["scale"][0].Number(1), node["scale"][1].Number(1), node["scale"][2].Number(1));
+
+			return glm::translate(glm::mat4(1), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1), scale);
+		}
+	}
+
+	// Read a binary glTF file, returns false if it cannot be read or has no triangles
+	bool ReadGlb(const std::string& filename, GltfModel& model)
+	{
+		model = GltfModel();
+		Timer stepTimer;
+		auto endStep = [&](const std::string& step)
+		{
+			model.steps.push_back(ImportStepTiming{ step, stepTimer.ElapsedMs() });
+			stepTimer.Reset();
+		};
+
+		if (!model.file.Open(filename))
+		{
+			std::cout << "Could not open " << filename << std::endl;
+			return false;
+		}
+
+		// 12 byte header then the JSON chunk, the binary chunk is optional
+		const unsigned char* bytes{ model.file.Data() };
+		const size_t fileSize{ model.file.Size() };
+		auto readWord = [bytes](size_t offset)
+		{
+			uint32_t word;
+			std::memcpy(&word, bytes + offset, sizeof(word));
+			return word;
+		};
+
+		if (fileSize < 20 || readWord(0) != kGlbMagic || readWord(4) != 2 || readWord(16) != kGlbChunkJson)
+		{
+			std::cout << filename << " is not a glTF 2.0 binary file" << std::endl;
+			return false;
+		}
+
+		const size_t jsonLength{ readWord(12) };
+		if (jsonLength > fileSize - 20)
+		{
+			std::cout << filename << " is truncated" << std::endl;
+			return false;
+		}
+
+		JsonValue json;
+		JsonParser parser((const char*)bytes + 20, (const char*)bytes + 20 + jsonLength);
+		if (!parser.Parse(json) || !parser.AtEnd() || json.type != JsonValue::Type::Object)
+		{
+			std::cout << filename << " has malformed JSON" << std::endl;
+			return false;
+		}
+
+		// Chunks start on 4 byte boundaries
+		const unsigned char* bin{ nullptr };
+		size_t binSize{ 0 };
+		const size_t binHeader{ 20 + ((jsonLength + 3) & ~(size_t)3) };
+		if (binHeader + 8 <= fileSize && readWord(binHeader + 4) == kGlbChunkBin)
+		{
+			binSize = std::min<size_t>(readWord(binHeader), fileSize - binHeader - 8);
+			bin = bytes + binHeader + 8;
+		}
+		endStep("glTF parse");
+
+		// Compression and quantisation extensions change what the accessors hold
+		for (const JsonValue& extension : json["extensionsRequired"].elements)
+		{
+			std::cout << filename << " requires unsupported glTF extension " << extension.String() << std::endl;
+			return false;
+		}
+
+		if (json.Has("skins"))
+			std::cout << "Ignoring: glTF skins" << std::endl;
+		if (json.Has("animations"))
+			std::cout << "Ignoring: glTF animations" << std::endl;
+
+		for (const JsonValue& material : json["materials"].elements)
+			model.materials.push_back(ConvertMaterial(json, material));
+
+		// Primitives without a material use the glTF default, which is added only when needed
+		size_t defaultMaterial{ SIZE_MAX };
+
+		// Our meshes made from each glTF mesh, for the nodes to refer to
+		const JsonValue& meshes{ json["meshes"] };
+		std::vector<std::vector<unsigned int>> meshPrimitives(meshes.Size());
+
+		for (size_t m = 0; m < meshes.Size(); m++)
+		{
+			for (const JsonValue& gltfPrimitive : meshes[m]["primitives"].elements)
+			{
+				if (gltfPrimitive["mode"].Int(kModeTriangles) != kModeTriangles)
+				{
+					std::cout << "Ignoring: glTF primitive that is not triangles" << std::endl;
+					continue;
+				}
+
+				const JsonValue& attributes{ gltfPrimitive["attributes"] };
+				if (!attributes.Has("POSITION"))
+				{
+					std::cout << "Ignoring: glTF primitive without positions" << std::endl;
+					continue;
+				}
+
+				GltfPrimitive primitive;
+				primitive.name = meshes[m]["name"].String();
+
+				AccessorView view;
+				if (!LocateAccessor(json, bin, binSize, attributes["POSITION"], view) || !ReadVectorStream(view, primitive.vertices))
+					return false;
+				const size_t numVertices{ primitive.vertices.size() };
+
+				if (attributes.Has("NORMAL") && (!LocateAccessor(json, bin, binSize, attributes["NORMAL"], view) || !ReadVectorStream(view, primitive.normals) || primitive.normals.size() != numVertices))
+					return false;
+
+				// Always converted, glTF has v = 0 at the top of the image where GL has the first row uploaded
+				if (attributes.Has("TEXCOORD_0"))
+				{
+					if (!LocateAccessor(json, bin, binSize, attributes["TEXCOORD_0"], view) || view.numComponents != 2 || view.count != numVertices)
+						return false;
+					primitive.uvCoords.converted.resize(numVertices);
+					for (size_t v = 0; v < numVertices; v++)
+						primitive.uvCoords.converted[v] = glm::vec2(ReadComponent(view, v, 0), 1 - ReadComponent(view, v, 1));
+				}
+
+				// Primitives without indices draw their vertices in order
+				if (gltfPrimitive.Has("indices"))
+				{
+					if (!LocateAccessor(json, bin, binSize, gltfPrimitive["indices"], view) || !ReadElements(view, primitive.elements))
+						return false;
+				}
+				else
+				{
+					primitive.elements.converted.resize(numVertices);
+					for (size_t v = 0; v < numVertices; v++)
+						primitive.elements.converted[v] = (unsigned int)v;
+				}
+
+				// Trailing indices that do not make a whole triangle are dropped, any out of range index fails the read
+				const unsigned int* elements{ primitive.elements.data() };
+				const size_t numElements{ primitive.elements.size() - primitive.elements.size() % 3 };
+				for (size_t e = 0; e < numElements; e++)
+				{
+					if (elements[e] >= numVertices)
+					{
+						std::cout << filename << " has an index past the end of its vertices" << std::endl;
+						return false;
+					}
+				}
+				if (primitive.elements.IsInPlace())
+					primitive.elements.inPlace = Span<unsigned int>(elements, numElements);
+				else
+					primitive.elements.converted.resize(numElements);
+
+				if (numElements == 0)
+					continue;
+
+				if (primitive.normals.size() == 0)
+					GenerateSmoothNormals(primitive);
+
+				const int materialIndex{ gltfPrimitive["material"].Int(-1) };
+				if (materialIndex >= 0 && (size_t)materialIndex < model.materials.size())
+				{
+					primitive.materialIndex = (size_t)materialIndex;
+				}
+				else
+				{
+					if (defaultMaterial == SIZE_MAX)
+					{
+						defaultMaterial = model.materials.size();
+						model.materials.push_back(ConvertMaterial(json, NullValue()));
+					}
+					primitive.materialIndex = defaultMaterial;
+				}
+
+				meshPrimitives[m].push_back((unsigned int)model.primitives.size());
+				model.primitives.push_back(std::move(primitive));
+			}
+		}
+		endStep("glTF streams");
+
+		if (model.primitives.empty())
+		{
+			std::cout << filename << " has no triangles" << std::endl;
+			return false;
+		}
+
+		// The default scene, or every node no other node claims when there are no scenes
+		const JsonValue& nodes{ json["nodes"] };
+		std::vector<size_t> roots;
+		if (json.Has("scenes"))
+		{
+			for (const JsonValue& root : json["scenes"][(size_t)json["scene"].Int(0)]["nodes"].elements)
+				roots.push_back((size_t)root.Int(-1));
+		}
+		else
+		{
+			std::vector<char> isChild(nodes.Size(), 0);
+			for (const JsonValue& node : nodes.elements)
+			{
+				for (const JsonValue& child : node["children"].elements)
+				{
+					if ((size_t)child.Int(-1) < isChild.size())
+						isChild[(size_t)child.Int(-1)] = 1;
+				}
+			}
+			for (size_t n = 0; n < nodes.Size(); n++)
+			{
+				if (!isChild[n])
+					roots.push_back(n);
+			}
+		}
+
+		model.nodes.push_back(GltfNode());
+		model.nodes[0].name = "glTF root";
+
+		// Depth first so the nodes can be added to a NodeHierarchy in order, each node is visited once
+		std::vector<char> visited(nodes.Size(), 0);
+		std::function<void(size_t, int, int)> addNode = [&](size_t n, int parentIndex, int depth)
+		{
+			if (n >= nodes.Size() || visited[n] || depth > kMaxDepth)
+				return;
+			visited[n] = 1;
+
+			const JsonValue& node{ nodes[n] };
+			GltfNode newNode;
+			newNode.name = node["name"].String();
+			newNode.transform = NodeTransform(node);
+			newNode.parentIndex = parentIndex;
+
+			const size_t meshIndex{ (size_t)node["mesh"].Int(-1) };
+			if (meshIndex < meshPrimitives.size())
+				newNode.meshIndices = meshPrimitives[meshIndex];
+
+			const int nodeIndex{ (int)model.nodes.size() };
+			model.nodes.push_back(std::move(newNode));
+
+			for (const JsonValue& child : node["children"].elements)
+				addNode((size_t)child.Int(-1), nodeIndex, depth + 1);
+		};
+		for (size_t root : roots)
+			addNode(root, 0, 0);
+
+		return true;
+	}
+
+}
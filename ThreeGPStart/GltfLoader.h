@@ -0,0 +1,71 @@
+#pragma once
+// Native reader for binary glTF 2.0 (.glb) files, using the vertex data where it lies in the mapped file
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+#include "MappedFile.h"
+
+namespace Helpers
+{
+
+	// One accessor's values. When the accessor is already laid out as T they are viewed in place in the
+	// mapped file, otherwise they are converted into their own storage.
+	template<typename T>
+	struct GltfStream
+	{
+		Span<T> inPlace;
+		std::vector<T> converted;
+
+		bool IsInPlace() const { return !inPlace.empty(); }
+		size_t size() const { return IsInPlace() ? inPlace.size() : converted.size(); }
+		const T* data() const { return IsInPlace() ? inPlace.data() : converted.data(); }
+	};
+
+	// A glTF mesh primitive, which becomes one of our meshes as it has a single material
+	struct GltfPrimitive
+	{
+		// Name of the glTF mesh it belongs to
+		std::string name;
+
+		// Index into the GltfModel materials
+		size_t materialIndex{ 0 };
+
+		// Normals are always present, generated smooth if the file has none. uvCoords is empty if the file has none.
+		GltfStream<glm::vec3> vertices;
+		GltfStream<glm::vec3> normals;
+		GltfStream<glm::vec2> uvCoords;
+		GltfStream<unsigned int> elements;
+	};
+
+	// A node of the default scene, in depth first order
+	struct GltfNode
+	{
+		std::string name;
+		glm::mat4 transform{ 1 };
+		int parentIndex{ -1 };
+
+		// Indices into the GltfModel primitives drawn by this node
+		std::vector<unsigned int> meshIndices;
+	};
+
+	// Everything read from a .glb file. The in place streams point into file, so it must stay open while they are used.
+	struct GltfModel
+	{
+		MappedFile file;
+
+		std::vector<GltfPrimitive> primitives;
+		std::vector<Material> materials;
+
+		// Node 0 is a root holding the scene's root nodes
+		std::vector<GltfNode> nodes;
+
+		// Time taken by each stage of the read
+		std::vector<ImportStepTiming> steps;
+	};
+
+	// Read a binary glTF file, returns false if it cannot be read or has no triangles.
+	// Float positions and normals and 32 bit indices are viewed in place. Texture coordinates are always converted
+	// as glTF puts v = 0 at the top of the image. Skins, animations and embedded images are ignored.
+	bool ReadGlb(const std::string& filename, GltfModel& model);
+
+}
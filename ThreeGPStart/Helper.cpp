@@ -2,6 +2,9 @@
 
 #include <fstream>
 #include <sstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <cctype>
 
 namespace Helpers
 {
@@ -79,6 +82,63 @@ namespace Helpers
 		return ss.str();
 	}
 
+	// Retrieve the modification time and size of a file. Returns false if the file does not exist.
+	bool GetFileStamp(const std::string& filepath, FileStamp& stamp)
+	{
+#ifdef _WIN32
+		struct _stat64 info;
+		if (_stat64(filepath.c_str(), &info) != 0)
+			return false;
+#else
+		struct stat info;
+		if (stat(filepath.c_str(), &info) != 0)
+			return false;
+#endif
+		stamp.modifiedTime = (long long)info.st_mtime;
+		stamp.size = (unsigned long long)info.st_size;
+		return true;
+	}
+
+	// Normalise a file path so different spellings of the same file compare equal
+	std::string CanonicalPath(const std::string& filepath)
+	{
+		std::vector<std::string> parts;
+		std::string part;
+
+		auto addPart = [&parts](const std::string& entry)
+		{
+			if (entry.empty() || entry == ".")
+				return;
+			if (entry == ".." && !parts.empty() && parts.back() != "..")
+				parts.pop_back();
+			else
+				parts.push_back(entry);
+		};
+
+		for (char c : filepath)
+		{
+			if (c == '/' || c == '\\')
+			{
+				addPart(part);
+				part.clear();
+			}
+			else
+			{
+#ifdef _WIN32
+				c = (char)tolower((unsigned char)c);
+#endif
+				part += c;
+			}
+		}
+		addPart(part);
+
+		std::string canonical{ !filepath.empty() && (filepath[0] == '/' || filepath[0] == '\\') ? "/" : "" };
+		for (size_t i = 0; i < parts.size(); i++)
+			canonical += (i ? "/" : "") + parts[i];
+
+		return canonical;
+	}
+
 	// Check shader with id compiled without error
 	bool DidShaderCompileOK(GLuint id)
 	{
@@ -2,6 +2,8 @@
 
 #include "ExternalLibraryHeaders.h"
 
+#include <chrono>
+
 namespace Helpers
 {
 	// Uses GLFW to set up a window via GLFW. Also initialises GLEW and OpenGL.
@@ -10,6 +12,35 @@ namespace Helpers
 	// Loads a whole file into a string e.g. for shader use
 	std::string stringFromFile(std::string filepath);	
 
+	// Modification time and size of a file on disk, used to detect stale cached data
+	struct FileStamp
+	{
+		long long modifiedTime{ 0 };
+		unsigned long long size{ 0 };
+	};
+
+	// Retrieve the modification time and size of a file. Returns false if the file does not exist.
+	bool GetFileStamp(const std::string& filepath, FileStamp& stamp);
+
+	// Normalise a file path so different spellings of the same file compare equal, e.g. for use as a cache key
+	// Separators become '/', "." and ".." entries are resolved and on Windows case is ignored
+	std::string CanonicalPath(const std::string& filepath);
+
+	// Simple wall clock timer, used to report load times
+	class Timer
+	{
+	private:
+		std::chrono::high_resolution_clock::time_point m_start{ std::chrono::high_resolution_clock::now() };
+	public:
+		// Restart timing from now
+		void Reset() { m_start = std::chrono::high_resolution_clock::now(); }
+
+		// Milliseconds passed since construction or the last Reset
+		double ElapsedMs() const {
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_start).count();
+		}
+	};
+
 	// Check program linked without error (i.e. no errors in the shaders)
 	bool LinkProgramShaders(GLuint shaderProgram);
 
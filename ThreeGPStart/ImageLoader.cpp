@@ -1,11 +1,363 @@
 #include "ImageLoader.h"
+#include "Helper.h"
+#include "TextureCache.h"
+
+#include <cctype>
+#include <fstream>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_USE_SSE 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows any intrinsic anywhere, GCC and Clang need the functions using them marked
+#if defined(IMAGE_USE_SSE) && (defined(__GNUC__) || defined(__clang__))
+#define IMAGE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define IMAGE_TARGET(isa)
+#endif
 
 namespace Helpers
 {
 
+	namespace
+	{
+		using SwizzleKernel = void(*)(const unsigned char*, unsigned char*, size_t);
+
+#ifdef IMAGE_USE_SSE
+		// Byte order of each 4 pixels after swapping red and blue
+		const char kSwapRedBlue[16]{ 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 };
+
+		// x64 baseline, masks and shifts 4 pixels at a time
+		void SwizzleSse2(const unsigned char* source, unsigned char* destination, size_t numPixels)
+		{
+			const __m128i greenAlpha{ _mm_set1_epi32((int)0xFF00FF00) };
+			const __m128i low{ _mm_set1_epi32(0x000000FF) };
+
+			size_t i{ 0 };
+			for (; i + 4 <= numPixels; i += 4)
+			{
+				const __m128i pixels{ _mm_loadu_si128((const __m128i*)(source + i * 4)) };
+				const __m128i red{ _mm_and_si128(_mm_srli_epi32(pixels, 16), low) };
+				const __m128i blue{ _mm_slli_epi32(_mm_and_si128(pixels, low), 16) };
+				_mm_storeu_si128((__m128i*)(destination + i * 4), _mm_or_si128(_mm_and_si128(pixels, greenAlpha), _mm_or_si128(red, blue)));
+			}
+			SwizzleRedBlueScalar(source + i * 4, destination + i * 4, numPixels - i);
+		}
+
+		// One byte shuffle per 4 pixels
+		IMAGE_TARGET("ssse3")
+		void SwizzleSsse3(const unsigned char* source, unsigned char* destination, size_t numPixels)
+		{
+			const __m128i shuffle{ _mm_loadu_si128((const __m128i*)kSwapRedBlue) };
+
+			size_t i{ 0 };
+			for (; i + 4 <= numPixels; i += 4)
+			{
+				const __m128i pixels{ _mm_loadu_si128((const __m128i*)(source + i * 4)) };
+				_mm_storeu_si128((__m128i*)(destination + i * 4), _mm_shuffle_epi8(pixels, shuffle));
+			}
+			SwizzleRedBlueScalar(source + i * 4, destination + i * 4, numPixels - i);
+		}
+
+		// One byte shuffle per 8 pixels, the same pattern in both 128 bit lanes
+		IMAGE_TARGET("avx2")
+		void SwizzleAvx2(const unsigned char* source, unsigned char* destination, size_t numPixels)
+		{
+			const __m128i lane{ _mm_loadu_si128((const __m128i*)kSwapRedBlue) };
+			const __m256i shuffle{ _mm256_broadcastsi128_si256(lane) };
+
+			size_t i{ 0 };
+			for (; i + 8 <= numPixels; i += 8)
+			{
+				const __m256i pixels{ _mm256_loadu_si256((const __m256i*)(source + i * 4)) };
+				_mm256_storeu_si256((__m256i*)(destination + i * 4), _mm256_shuffle_epi8(pixels, shuffle));
+			}
+			SwizzleSsse3(source + i * 4, destination + i * 4, numPixels - i);
+		}
+
+		// The CPU and OS support, AVX2 also needs the OS to save the upper halves of the registers
+		bool CpuHasSsse3()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			return (info[2] & (1 << 9)) != 0;
+#else
+			return __builtin_cpu_supports("ssse3");
+#endif
+		}
+
+		bool CpuHasAvx2()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			__cpuid(info, 1);
+			const bool osSavesAvx{ (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6 };
+
+			__cpuidex(info, 7, 0);
+			return osSavesAvx && (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+
+		struct SwizzleChoice
+		{
+			SwizzleKernel kernel;
+			const char* name;
+		};
+
+		// Widest kernel the CPU supports, worked out once
+		const SwizzleChoice& ChooseSwizzle()
+		{
+			static const SwizzleChoice choice = []() -> SwizzleChoice
+			{
+#ifdef IMAGE_USE_SSE
+				if (CpuHasAvx2())
+					return { SwizzleAvx2, "AVX2" };
+				if (CpuHasSsse3())
+					return { SwizzleSsse3, "SSSE3" };
+				return { SwizzleSse2, "SSE2" };
+#else
+				return { SwizzleRedBlueScalar, "scalar" };
+#endif
+			}();
+			return choice;
+		}
+	}
+
+	// Swap the red and blue bytes of numPixels 4 byte pixels, turning BGRA into RGBA or back. source and destination may be the same.
+	void SwizzleRedBlue(const unsigned char* source, unsigned char* destination, size_t numPixels)
+	{
+		ChooseSwizzle().kernel(source, destination, numPixels);
+	}
+
+	// One byte at a time, kept to compare against
+	void SwizzleRedBlueScalar(const unsigned char* source, unsigned char* destination, size_t numPixels)
+	{
+		for (size_t pix = 0; pix < numPixels; pix++)
+		{
+			const unsigned char blue{ source[pix * 4 + 0] };
+			destination[pix * 4 + 0] = source[pix * 4 + 2];
+			destination[pix * 4 + 1] = source[pix * 4 + 1];
+			destination[pix * 4 + 2] = blue;
+			destination[pix * 4 + 3] = source[pix * 4 + 3];
+		}
+	}
+
+	// Name of the kernel SwizzleRedBlue uses on this CPU
+	const char* SwizzleKernelName()
+	{
+		return ChooseSwizzle().name;
+	}
+
+	// Grow the buffer to hold numBytes, its contents are lost if it has to grow
+	void ImageLoader::Reserve(size_t numBytes)
+	{
+		if (numBytes > m_capacity)
+		{
+			m_data.reset(new GLbyte[numBytes]);
+			m_capacity = numBytes;
+		}
+	}
+
 	// Attempt to load an image form the file and path provided. Returns false on error.
-	bool ImageLoader::Load(const std::string& filepath)
+	// DDS and KTX files that are block compressed stay compressed, other DDS files are decoded.
+	// Other images are block compressed and given mips as settings asks, spreading the work over threadPool.
+	// Compressed results are cached beside the image so later loads read them instead.
+	bool ImageLoader::Load(const std::string& filepath, const ImageLoadSettings& settings, ThreadPool* threadPool)
+	{
+		std::string extension{ filepath.substr(std::min(filepath.find_last_of('.'), filepath.size())) };
+		for (char& c : extension)
+			c = (char)std::tolower((unsigned char)c);
+
+		// FreeImage cannot read KTX, so there is nothing to fall back on
+		if (extension == ".ktx")
+			return LoadCompressed(filepath, true);
+
+		// Otherwise decode the DDS as any other image, e.g. when its blocks cannot be flipped
+		if (extension == ".dds" && LoadCompressed(filepath, false))
+			return true;
+
+		if (settings.compression == BlockFormat::None)
+		{
+			if (!LoadDecoded(filepath))
+				return false;
+
+			if (settings.generateMips)
+				GenerateMips(settings.mipFilter, threadPool);
+			return true;
+		}
+
+		// A cache built from these exact source bytes with this encoder can be used as it is
+		std::ifstream source(filepath, std::ios::binary | std::ios::ate);
+		if (!source)
+			return LoadDecoded(filepath);
+
+		std::vector<unsigned char> sourceBytes((size_t)source.tellg());
+		source.seekg(0);
+		if (!source.read((char*)sourceBytes.data(), sourceBytes.size()))
+			return LoadDecoded(filepath);
+
+		const std::string cacheFilename{ TextureCache::CacheFilename(filepath, settings.compression) };
+		const std::string key{ TextureCache::MakeKey(sourceBytes.data(), sourceBytes.size(), settings.mipFilter) };
+
+		FileStamp cacheStamp;
+		if (GetFileStamp(cacheFilename, cacheStamp) && LoadCompressed(cacheFilename, true))
+		{
+			const auto found{ m_compressed.metadata.find(TextureCache::kKeyName) };
+			if (found != m_compressed.metadata.end() && found->second == key)
+				return true;
+		}
+
+		if (!LoadDecoded(filepath))
+			return false;
+
+		std::vector<unsigned char> ktx{ CompressDecoded(settings.compression, settings.mipFilter, key, threadPool) };
+
+		// Carry on with the compressed image in memory if the cache cannot be written, e.g. a read only folder
+		if (!TextureCache::Write(cacheFilename, ktx))
+			std::cout << "Could not write texture cache: " << cacheFilename << std::endl;
+
+		return true;
+	}
+
+	// Compress the decoded image in the buffer with a full mip chain made with mipFilter, replacing it with the levels as a KTX file.
+	// The file is also returned, holding cacheKey, so it can be cached.
+	std::vector<unsigned char> ImageLoader::CompressDecoded(BlockFormat format, MipFilter mipFilter, const std::string& cacheKey, ThreadPool* threadPool)
 	{
+		GenerateMips(mipFilter, threadPool);
+
+		const unsigned char* rgba{ (const unsigned char*)m_data.get() };
+		format = ResolveBlockFormat(format, rgba, (size_t)m_width * (size_t)m_height);
+
+		CompressedImageInfo info;
+		info.format = BlockFormatGl(format);
+		info.metadata["KTXorientation"] = "S=r,T=u";
+		info.metadata[TextureCache::kKeyName] = cacheKey;
+
+		// Lay out every level first so the blocks can be written straight into one buffer
+		const size_t blockBytes{ CompressedBlockBytes(info.format) };
+		size_t totalBytes{ 0 };
+		for (const ImageLevel& mip : m_mipLevels)
+		{
+			ImageLevel level{ mip };
+			level.offset = totalBytes;
+			level.size = (size_t)((mip.width + 3) / 4) * (size_t)((mip.height + 3) / 4) * blockBytes;
+			info.levels.push_back(level);
+			totalBytes += level.size;
+		}
+
+		std::vector<unsigned char> blocks(totalBytes);
+		for (size_t i = 0; i < info.levels.size(); i++)
+		{
+			const ImageLevel& level{ info.levels[i] };
+			CompressImage(rgba + m_mipLevels[i].offset, level.width, level.height, format, threadPool, blocks.data() + level.offset);
+		}
+
+		std::vector<unsigned char> ktx{ BuildKtx(info, blocks.data()) };
+
+		// Keep the loader holding the compressed image, as if the cache had been read
+		Reserve(ktx.size());
+		std::copy(ktx.begin(), ktx.end(), (unsigned char*)m_data.get());
+		ParseKtx((const unsigned char*)m_data.get(), ktx.size(), m_compressed);
+		m_dataSize = ktx.size();
+		m_mipLevels.clear();
+
+		return ktx;
+	}
+
+	// Build the mip levels of a decoded image after level 0 in the buffer, nothing for a compressed image which has its own
+	void ImageLoader::GenerateMips(MipFilter filter, ThreadPool* threadPool)
+	{
+		if (IsCompressed())
+			return;
+
+		std::vector<ImageLevel> levels{ MipChainLayout(m_width, m_height) };
+		const size_t totalBytes{ levels.back().offset + levels.back().size };
+
+		// Unlike Reserve, level 0 has to survive the buffer growing
+		if (totalBytes > m_capacity)
+		{
+			std::unique_ptr<GLbyte[]> grown(new GLbyte[totalBytes]);
+			std::copy(m_data.get(), m_data.get() + levels[0].size, grown.get());
+			m_data = std::move(grown);
+			m_capacity = totalBytes;
+		}
+
+		GenerateMipChain((unsigned char*)m_data.get(), levels, filter, threadPool);
+
+		m_mipLevels = std::move(levels);
+		m_dataSize = totalBytes;
+	}
+
+	// Read a container file into the buffer as it is, false if it is not block compressed or its rows cannot be flipped
+	bool ImageLoader::LoadCompressed(const std::string& filepath, bool ktx)
+	{
+		m_compressed = CompressedImageInfo();
+		m_mipLevels.clear();
+
+		std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			std::cout << "Could not find: " << filepath << std::endl;
+			return false;
+		}
+
+		const size_t fileSize{ (size_t)file.tellg() };
+		file.seekg(0);
+		Reserve(fileSize);
+		if (!file.read((char*)m_data.get(), fileSize))
+		{
+			std::cout << "Could not read: " << filepath << std::endl;
+			return false;
+		}
+
+		unsigned char* bytes{ (unsigned char*)m_data.get() };
+		CompressedImageInfo info;
+		if (!(ktx ? ParseKtx(bytes, fileSize, info) : ParseDds(bytes, fileSize, info)))
+		{
+			std::cout << "Not uploading compressed: " << filepath << std::endl;
+			return false;
+		}
+
+		// Match the row order of decoded images so texture coordinates work the same either way.
+		// An image that cannot be flipped would appear upside down, so it is not used compressed at all.
+		if (info.topDown)
+		{
+			for (const ImageLevel& level : info.levels)
+			{
+				if (!FlipCompressedLevel(bytes, info.format, level))
+				{
+					std::cout << "Could not flip the rows of " << filepath << ", not uploading compressed" << std::endl;
+					return false;
+				}
+			}
+		}
+
+		m_compressed = info;
+		m_width = info.levels[0].width;
+		m_height = info.levels[0].height;
+		m_dataSize = fileSize;
+
+		return true;
+	}
+
+	// Load the image decoded to RGBA whatever the file holds
+	bool ImageLoader::LoadDecoded(const std::string& filepath)
+	{
+		m_compressed = CompressedImageInfo();
+		m_mipLevels.clear();
+
 		// Determine the format of the image.
 		FREE_IMAGE_FORMAT format{ FreeImage_GetFileType(filepath.c_str(), 0) };
 
@@ -33,6 +385,11 @@ namespace Helpers
 
 		// If we're here we have a known image format, so load the image into a bitmap
 		FIBITMAP* bitmap{ FreeImage_Load(format, filepath.c_str()) };
+		if (!bitmap)
+		{
+			std::cout << "Could not decode: " << filepath << std::endl;
+			return false;
+		}
 
 		// How many bits-per-pixel is the source image?
 		unsigned int bitsPerPixel{ FreeImage_GetBPP(bitmap) };
@@ -44,31 +401,29 @@ namespace Helpers
 		else
 			bitmap32 = FreeImage_ConvertTo32Bits(bitmap);
 
+		if (!bitmap32)
+		{
+			std::cout << "Could not convert to 32 bits: " << filepath << std::endl;
+			FreeImage_Unload(bitmap);
+			return false;
+		}
+
 		// Grab size
 		m_width = FreeImage_GetWidth(bitmap32);
 		m_height = FreeImage_GetHeight(bitmap32);
 
 		// Get a pointer to the texture data as an array of unsigned bytes.
 		// Note: At this point bitmap32 ALWAYS holds a 32-bit colour version of our image - so we get our data from that.
-		// Also, we don't need to delete or delete[] this textureData because it's not on the heap (so attempting to do
-		// so will cause a crash) - just let it go out of scope and the memory will be returned to the stack.
-		BYTE* textureData{ FreeImage_GetBits(bitmap32) };
+		// It belongs to the bitmap so is freed when it is unloaded below.
+		const BYTE* textureData{ FreeImage_GetBits(bitmap32) };
 
-		m_data = new GLbyte[(size_t)m_width * (size_t)m_height * 1 * 4];
+		// Only reallocate when the image is larger than any loaded before, the old contents are not needed
+		const size_t numPixels{ (size_t)m_width * (size_t)m_height };
+		Reserve(numPixels * 4);
+		m_dataSize = numPixels * 4;
 
 		// Copy to mine, Note: Freeimage data format is GL_BGRA while I need GL_RGBA
-		// Iterate through the pixels, copying the data
-		// from 'pixels' to 'bits' except in RGBA format.
-
-		for (int pix = 0; pix < m_width * m_height; pix++)
-		{
-			m_data[pix * 4 + 0] = textureData[pix * 4 + 2];	//r = 3
-			m_data[pix * 4 + 1] = textureData[pix * 4 + 1];	//g = 0
-			m_data[pix * 4 + 2] = textureData[pix * 4 + 0];	//b = 1
-			m_data[pix * 4 + 3] = textureData[pix * 4 + 3];	//a = 2
-		}
-
-		// Note that to avoid the above conversion I could just use GL_BGRA when I create the GL textures but  better to be consistant
+		SwizzleRedBlue(textureData, (unsigned char*)m_data.get(), numPixels);
 
 		// Unload the 32-bit colour bitmap
 		FreeImage_Unload(bitmap32);
@@ -82,4 +437,4 @@ namespace Helpers
 
 		return true;
 	}
-}
\ No newline at end of file
+}
@@ -1,18 +1,51 @@
 #pragma once
 
 #include "ExternalLibraryHeaders.h"
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+#include "TextureContainer.h"
+
+#include <memory>
 
 namespace Helpers
 {
 
+	// How Load prepares an image that is not already block compressed
+	struct ImageLoadSettings
+	{
+		BlockFormat compression{ BlockFormat::None };	// Block compress to, None keeps RGBA
+		bool generateMips{ false };						// Build the mip chain on the CPU, always done when compressing
+		MipFilter mipFilter{ MipFilter::Box };
+	};
+
 	// Helper utilising FreeImage to load images / textures
-	// Loaded format is guaranteed to be 32 bit RGBA layout
+	// Loaded format is guaranteed to be 32 bit RGBA layout, unless a DDS or KTX file holds a block compressed image,
+	// which is kept compressed with its mip levels so it can be uploaded as it is
+	// The pixel buffer is kept between loads and only grows, so reusing a loader does not allocate for images no larger than before
 	class ImageLoader
 	{
 	private:
 		int m_width{ 0 };
 		int m_height{ 0 };
-		GLbyte* m_data{ nullptr };
+		std::unique_ptr<GLbyte[]> m_data;
+		size_t m_capacity{ 0 };
+		size_t m_dataSize{ 0 };
+
+		// Compressed format and levels, format 0 when the image is decoded RGBA
+		CompressedImageInfo m_compressed;
+
+		// Levels of a decoded image once GenerateMips has built them, empty before
+		std::vector<ImageLevel> m_mipLevels;
+
+		// Grow the buffer to hold numBytes, its contents are lost if it has to grow
+		void Reserve(size_t numBytes);
+
+		// Read a container file into the buffer as it is, false if it is not block compressed or its rows cannot be flipped
+		bool LoadCompressed(const std::string& filepath, bool ktx);
+
+		// Compress the decoded image in the buffer with a full mip chain made with mipFilter, replacing it with the levels as a KTX file.
+		// The file is also returned, holding cacheKey, so it can be cached.
+		std::vector<unsigned char> CompressDecoded(BlockFormat format, MipFilter mipFilter, const std::string& cacheKey, ThreadPool* threadPool);
 	public:
 		// Width in texels of the image
 		int Width() const { return m_width; }
@@ -21,10 +54,42 @@ namespace Helpers
 		int Height() const { return m_height; }
 
 		// Attempt to load an image form the file and path provided. Returns false on error.
-		bool Load(const std::string& filepath);
+		// DDS and KTX files that are block compressed stay compressed, other DDS files are decoded.
+		// Other images are block compressed and given mips as settings asks, spreading the work over threadPool.
+		// Compressed results are cached beside the image so later loads read them instead.
+		bool Load(const std::string& filepath, const ImageLoadSettings& settings = ImageLoadSettings(), ThreadPool* threadPool = nullptr);
+
+		// Load the image decoded to RGBA whatever the file holds
+		bool LoadDecoded(const std::string& filepath);
+
+		// Build the mip levels of a decoded image after level 0 in the buffer, nothing for a compressed image which has its own
+		void GenerateMips(MipFilter filter, ThreadPool* threadPool);
+
+		// RGBA levels of a decoded image with offsets into GetData, empty unless GenerateMips was called
+		const std::vector<ImageLevel>& MipLevels() const { return m_mipLevels; }
 
 		// Allows access to the raw bytes that make up the image
-		GLbyte* GetData() const { return m_data; }
+		const GLbyte* GetData() const { return m_data.get(); }
+
+		// Bytes of image in GetData, every level when compressed
+		size_t DataSize() const { return m_dataSize; }
+
+		// True if the image holds block compressed levels rather than RGBA
+		bool IsCompressed() const { return m_compressed.format != 0; }
+
+		// GL internal format and levels of a compressed image, level offsets are into GetData
+		GLenum CompressedFormat() const { return m_compressed.format; }
+		const std::vector<ImageLevel>& CompressedLevels() const { return m_compressed.levels; }
 	};
 
-}
\ No newline at end of file
+	// Swap the red and blue bytes of numPixels 4 byte pixels, turning BGRA into RGBA or back. source and destination may be the same.
+	// Uses the widest shuffle the CPU supports, chosen the first time it is called.
+	void SwizzleRedBlue(const unsigned char* source, unsigned char* destination, size_t numPixels);
+
+	// One byte at a time, kept to compare against
+	void SwizzleRedBlueScalar(const unsigned char* source, unsigned char* destination, size_t numPixels);
+
+	// Name of the kernel SwizzleRedBlue uses on this CPU
+	const char* SwizzleKernelName();
+
+}
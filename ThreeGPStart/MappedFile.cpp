@@ -0,0 +1,174 @@
+#include "MappedFile.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Helpers
+{
+
+	// Map the file at filepath into memory, returns false on error
+	bool MappedFile::Open(const std::string& filepath)
+	{
+		Close();
+
+#ifdef _WIN32
+		// Let others replace or delete the file while it is mapped, as the caches rewrite their files in place
+		HANDLE file{ CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL) };
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping{ CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) };
+		if (!mapping)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		void* view{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+		if (!view)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_fileHandle = file;
+		m_mappingHandle = mapping;
+		m_data = (const unsigned char*)view;
+		m_size = (size_t)fileSize.QuadPart;
+#else
+		int file{ open(filepath.c_str(), O_RDONLY) };
+		if (file < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size == 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void* view{ mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0) };
+
+		// The mapping keeps its own reference to the file
+		close(file);
+
+		if (view == MAP_FAILED)
+			return false;
+
+		m_data = (const unsigned char*)view;
+		m_size = (size_t)info.st_size;
+#endif
+
+		return true;
+	}
+
+	// Take over the mapping held by other, leaving it empty
+	MappedFile& MappedFile::operator=(MappedFile&& other)
+	{
+		if (this == &other)
+			return *this;
+
+		Close();
+
+		m_data = other.m_data;
+		m_size = other.m_size;
+		other.m_data = nullptr;
+		other.m_size = 0;
+#ifdef _WIN32
+		m_fileHandle = other.m_fileHandle;
+		m_mappingHandle = other.m_mappingHandle;
+		other.m_fileHandle = nullptr;
+		other.m_mappingHandle = nullptr;
+#endif
+
+		return *this;
+	}
+
+	// Unmap the file, safe to call when nothing is mapped
+	void MappedFile::Close()
+	{
+#ifdef _WIN32
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mappingHandle)
+			CloseHandle((HANDLE)m_mappingHandle);
+		if (m_fileHandle)
+			CloseHandle((HANDLE)m_fileHandle);
+
+		m_mappingHandle = nullptr;
+		m_fileHandle = nullptr;
+#else
+		if (m_data)
+			munmap((void*)m_data, m_size);
+#endif
+
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	// Write a whole file via a temporary that is renamed into place. Returns false on error.
+	bool WriteFileAtomically(const std::string& filepath, const std::function<void(std::ostream&)>& write)
+	{
+		// Unique per process and call so writers racing on the same file never share a temporary
+		static std::atomic<unsigned int> s_tempCounter{ 0 };
+#ifdef _WIN32
+		const unsigned long processId{ GetCurrentProcessId() };
+#else
+		const unsigned long processId{ (unsigned long)getpid() };
+#endif
+		const std::string tempFilepath{ filepath + "." + std::to_string(processId) + "-" + std::to_string(s_tempCounter++) + ".tmp" };
+		{
+			std::ofstream out(tempFilepath, std::ios::binary | std::ios::trunc);
+			if (out)
+			{
+				write(out);
+				out.close();
+			}
+
+			if (!out)
+			{
+				std::remove(tempFilepath.c_str());
+				return false;
+			}
+		}
+
+		// Replace in one step so readers always see either the old file or the new one, never neither
+#ifdef _WIN32
+		const bool replaced{ MoveFileExA(tempFilepath.c_str(), filepath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0 };
+#else
+		const bool replaced{ rename(tempFilepath.c_str(), filepath.c_str()) == 0 };
+#endif
+		if (!replaced)
+		{
+			std::remove(tempFilepath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool WriteFileAtomically(const std::string& filepath, const std::vector<unsigned char>& bytes)
+	{
+		return WriteFileAtomically(filepath, [&](std::ostream& out) { out.write((const char*)bytes.data(), bytes.size()); });
+	}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+#include <functional>
+
+namespace Helpers
+{
+
+	// Read only memory mapping of a whole file
+	// The mapped bytes stay valid until Close is called or the object is destroyed
+	class MappedFile
+	{
+	private:
+		const unsigned char* m_data{ nullptr };
+		size_t m_size{ 0 };
+#ifdef _WIN32
+		void* m_fileHandle{ nullptr };
+		void* m_mappingHandle{ nullptr };
+#endif
+	public:
+		MappedFile() = default;
+		~MappedFile() { Close(); }
+
+		// Owns OS handles so cannot be copied, but ownership can be handed on
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) { *this = std::move(other); }
+		MappedFile& operator=(MappedFile&& other);
+
+		// Map the file at filepath into memory, returns false on error
+		bool Open(const std::string& filepath);
+
+		// Unmap the file, safe to call when nothing is mapped
+		void Close();
+
+		// True if a file is currently mapped
+		bool IsOpen() const { return m_data != nullptr; }
+
+		// Start of the mapped bytes
+		const unsigned char* Data() const { return m_data; }
+
+		// Size of the mapped file in bytes
+		size_t Size() const { return m_size; }
+	};
+
+	// Write a whole file via a uniquely named temporary beside it that then replaces filepath in one step,
+	// so a crash part way through never leaves a partial or missing file at filepath.
+	// The temporary is removed whatever happens. Returns false on error.
+	bool WriteFileAtomically(const std::string& filepath, const std::function<void(std::ostream&)>& write);
+	bool WriteFileAtomically(const std::string& filepath, const std::vector<unsigned char>& bytes);
+
+}
@@ -0,0 +1,121 @@
+#include "MaterialLibrary.h"
+#include "Helper.h"
+
+#include <cstring>
+
+namespace
+{
+
+	GpuMaterial ToGpuMaterial(const glm::vec4& ambient, const glm::vec4& diffuse, const glm::vec4& specular, const glm::vec4& emissive, float specularFactor)
+	{
+
+		GpuMaterial material;
+		std::memset(&material, 0, sizeof(material)); //Padding included so identical materials compare equal
+
+		material.ambientColour = ambient;
+		material.diffuseColour = diffuse;
+		material.specularColour = specular;
+		material.emissiveColour = emissive;
+		material.specularFactor = specularFactor;
+
+		return material;
+
+	}
+
+}
+
+MaterialLibrary::MaterialLibrary()
+{
+
+	Clear();
+
+}
+
+MaterialLibrary& MaterialLibrary::Shared()
+{
+
+	static MaterialLibrary library;
+	return library;
+
+}
+
+unsigned int MaterialLibrary::Add(const Helpers::Material& material)
+{
+
+	const GpuMaterial gpuMaterial = ToGpuMaterial(material.ambientColour, material.diffuseColour, material.specularColour,
+		material.emissiveColour, material.specularFactor);
+
+	for (size_t i = 0; i < m_materials.size(); i++) //Only runs at upload and the library is small
+	{
+		if (std::memcmp(&m_materials[i], &gpuMaterial, sizeof(GpuMaterial)) == 0)
+		{
+			return (unsigned int)i;
+		}
+	}
+
+	if (m_materials.size() >= kMaxMaterials)
+	{
+		std::cout << "Material library full, using the default material" << std::endl;
+		return kDefaultMaterial;
+	}
+
+	m_materials.push_back(gpuMaterial);
+	return (unsigned int)m_materials.size() - 1;
+
+}
+
+bool MaterialLibrary::Upload()
+{
+
+	if (!m_buffer)
+	{
+		//Sized for every slot up front so adding materials never reallocates
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(GpuMaterial) * kMaxMaterials, nullptr, GL_STATIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, kBindingPoint, m_buffer);
+		m_numUploaded = 0;
+	}
+
+	if (m_numUploaded < m_materials.size())
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(GpuMaterial) * m_numUploaded, sizeof(GpuMaterial) * (m_materials.size() - m_numUploaded),
+			m_materials.data() + m_numUploaded);
+		m_numUploaded = m_materials.size();
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	return !Helpers::CheckForGLError();
+
+}
+
+void MaterialLibrary::Clear()
+{
+
+	if (m_buffer)
+	{
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+
+	m_numUploaded = 0;
+	m_materials.clear();
+
+	//The default lights like the shader did before materials, ambient and diffuse only
+	m_materials.push_back(ToGpuMaterial(glm::vec4(1), glm::vec4(1), glm::vec4(0), glm::vec4(0), 1.0f)); //kDefaultMaterial
+	m_materials.push_back(ToGpuMaterial(glm::vec4(0), glm::vec4(0, 0, 0, 1), glm::vec4(0), glm::vec4(1), 1.0f)); //kUnlitMaterial
+
+}
+
+void MaterialLibrary::BindProgram(GLuint program)
+{
+
+	const GLuint blockIndex = glGetUniformBlockIndex(program, "Materials");
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(program, blockIndex, kBindingPoint);
+	}
+
+}
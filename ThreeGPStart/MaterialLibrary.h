@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+
+const unsigned int kMaxMaterials{ 128 }; //Materials the fragment shader can index, must match MAX_MATERIALS in fragment_shader.glsl
+
+struct GpuMaterial //One material laid out as an element of the std140 Materials uniform block
+{
+
+	glm::vec4 ambientColour;
+	glm::vec4 diffuseColour;
+	glm::vec4 specularColour;
+	glm::vec4 emissiveColour;
+	float specularFactor;
+	float padding[3]; //std140 rounds struct array elements up to 16 bytes
+
+};
+
+//Every material in use, uploaded once into a uniform buffer the fragment shader indexes per draw
+//Identical materials share a slot, so Models of the same file add nothing after the first
+class MaterialLibrary
+{
+
+private:
+
+	std::vector<GpuMaterial> m_materials;
+	size_t m_numUploaded{ 0 }; //Materials already in the buffer
+
+	GLuint m_buffer{ 0 };
+
+public:
+
+	static const unsigned int kDefaultMaterial{ 0 }; //Lit white, for geometry without an imported material
+	static const unsigned int kUnlitMaterial{ 1 }; //Texture colour only, for the sky
+	static const GLuint kBindingPoint{ 0 }; //Uniform buffer binding the Materials block reads from
+
+	MaterialLibrary();
+
+	static MaterialLibrary& Shared(); //Library used by all Models
+
+	unsigned int Add(const Helpers::Material& material); //Slot holding the material, kDefaultMaterial once the library is full. GL thread only
+	bool Upload(); //Create the buffer and send the materials added since the last call, GL thread only
+	void Clear(); //Delete the buffer and forget all but the built in materials, call before the GL context goes
+
+	size_t NumMaterials() const { return m_materials.size(); }
+
+	static void BindProgram(GLuint program); //Point a linked program's Materials block at kBindingPoint
+
+};
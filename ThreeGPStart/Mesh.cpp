@@ -1,4 +1,19 @@
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "Meshlets.h"
+#include "Simplify.h"
+#include "MeshOptimiser.h"
+#include "ObjLoader.h"
+#include "GltfLoader.h"
+
+#include <assimp/DefaultLogger.hpp>
+#include <assimp/Logger.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <mutex>
 
 namespace Helpers
 {
@@ -6,80 +21,276 @@ namespace Helpers
 	inline void EsOutput(const std::string& what) { std::cout << what << std::endl; }
 	inline void EsError(const std::string& what) { std::cerr << "Error: " << what << std::endl; }
 	inline glm::vec4 aiColor4DToGlmVec4(aiColor4D col) { return glm::vec4(col.r, col.g, col.b, col.a); }
+	inline glm::mat4 aiMatrix4x4ToGlmMat4(const aiMatrix4x4& m) { return glm::transpose(glm::make_mat4(&m.a1)); } // Assimp is row major
 #define EsAssert assert
 
-	// Retrieve the dimensions of this mesh in local coordinates
-	void Mesh::GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const
+	// Calculate boundingBox and boundingSphere from the vertices
+	void Mesh::CalculateBounds()
 	{
-		if (vertices.empty())
-			return;
+		boundingBox = ComputeBoundingBox(vertices.data(), vertices.size());
+		boundingSphere = ComputeBoundingSphere(vertices.data(), vertices.size(), boundingBox);
+	}
+
+	namespace
+	{
+		// Report of the import currently running on this thread, if any
+		thread_local ImportReport* t_activeReport{ nullptr };
+
+		// Name of the post-process step that most recently announced itself on this thread
+		thread_local std::string t_currentStep;
+
+		// With AI_CONFIG_GLOB_MEASURE_TIME set Assimp writes its timings to the logger as debug messages.
+		// This logger parses them into the report of the import on the calling thread rather than printing them.
+		// It keeps no shared state so imports on several threads at once do not interfere.
+		class ImportReportLogger : public Assimp::Logger
+		{
+		public:
+			ImportReportLogger() : Assimp::Logger(Assimp::Logger::VERBOSE) {}
+
+			bool attachStream(Assimp::LogStream* /*pStream*/, unsigned int /*severity*/) override { return false; }
+			bool detatchStream(Assimp::LogStream* /*pStream*/, unsigned int /*severity*/) override { return false; }
+
+		private:
+			void OnDebug(const char* message) override
+			{
+				if (!t_activeReport)
+					return;
+
+				const std::string text{ message };
+
+				// Post-process steps log "<Name>Process begin" as they start
+				const std::string beginSuffix{ "Process begin" };
+				if (text.size() > beginSuffix.size() && text.compare(text.size() - beginSuffix.size(), beginSuffix.size(), beginSuffix) == 0)
+				{
+					t_currentStep = text.substr(0, text.size() - beginSuffix.size());
+					return;
+				}
+
+				// The profiler logs "END   `<region>`, dt= <seconds> s" as each region finishes
+				if (text.compare(0, 3, "END") != 0)
+					return;
+
+				size_t regionStart{ text.find('`') };
+				size_t regionEnd{ text.find('`', regionStart + 1) };
+				size_t timeStart{ text.find("dt=") };
+				if (regionStart == std::string::npos || regionEnd == std::string::npos || timeStart == std::string::npos)
+					return;
 
-		minExtents.x = maxExtents.x = vertices[0].x;
-		minExtents.y = maxExtents.y = vertices[0].y;
-		minExtents.z = maxExtents.z = vertices[0].z;
+				ImportStepTiming timing;
+				timing.step = text.substr(regionStart + 1, regionEnd - regionStart - 1);
+				timing.milliseconds = std::atof(text.c_str() + timeStart + 3) * 1000.0;
 
-		for (size_t i = 1; i < vertices.size(); i++)
+				// Every step is profiled under the same "postprocess" region so name it after the step itself
+				if (timing.step == "postprocess" && !t_currentStep.empty())
+					timing.step = t_currentStep;
+
+				t_currentStep.clear();
+				t_activeReport->steps.push_back(timing);
+			}
+
+			void OnInfo(const char* /*message*/) override {}
+
+			void OnWarn(const char* message) override
+			{
+				if (t_activeReport)
+					t_activeReport->warnings.push_back(message);
+			}
+
+			void OnError(const char* message) override
+			{
+				if (t_activeReport)
+					t_activeReport->warnings.push_back(std::string("Error: ") + message);
+			}
+		};
+
+		std::once_flag s_loggerInstalled;
+
+		// Points t_activeReport at a report for the duration of an import
+		struct ActiveReportScope
 		{
-			minExtents.x = std::min(minExtents.x, vertices[i].x);
-			minExtents.y = std::min(minExtents.y, vertices[i].y);
-			minExtents.z = std::min(minExtents.z, vertices[i].z);
+			ActiveReportScope(ImportReport& report) { t_activeReport = &report; t_currentStep.clear(); }
+			~ActiveReportScope() { t_activeReport = nullptr; }
+		};
 
-			maxExtents.x = std::max(maxExtents.x, vertices[i].x);
-			maxExtents.y = std::max(maxExtents.y, vertices[i].y);
-			maxExtents.z = std::max(maxExtents.z, vertices[i].z);
+		const char* ProfileName(ImportProfile profile)
+		{
+			switch (profile)
+			{
+			case ImportProfile::FastLoad:
+				return "fast-load";
+			case ImportProfile::RuntimeOptimal:
+				return "runtime-optimal";
+			case ImportProfile::ValidateEverything:
+				return "validate-everything";
+			}
+			return "unknown";
 		}
 	}
 
-	// Load a 3D model form a provided file and path, return false on error
-	bool ModelLoader::LoadFromFile(const std::string& objFilename)
+	// Helper to output the report
+	std::string ImportReport::ToString() const
 	{
-		m_filename = objFilename;
+		std::string report = std::string("Profile: ") + ProfileName(profile) +
+			(fromCache ? " (mesh cache)" : " (assimp)") +
+			" Total: " + std::to_string(totalMilliseconds) + " ms";
 
-		EsOutput("\nUsing assimp to load: " + objFilename);
+		for (const ImportStepTiming& timing : steps)
+			report += "\n  " + timing.step + ": " + std::to_string(timing.milliseconds) + " ms";
+
+		for (const std::string& warning : warnings)
+			report += "\n  Warning: " + warning;
+
+		return report;
+	}
+
+	// Assimp post-processing steps used by an import profile
+	unsigned int ModelLoader::PostProcessSteps(ImportProfile profile)
+	{
+		// Always needed, the renderer only deals with indexed triangles that have normals.
+		// Tangents are never requested as nothing uses them, and bone weights are limited to four by the mesh import itself.
+		const unsigned int essential = aiProcess_Triangulate |	// triangulate polygons with more than 3 edges
+			aiProcess_SortByPType |								// make 'clean' meshes which consist of a single typ of primitives
+			aiProcess_GenSmoothNormals;							// if no normals then create them
 
 		// Commom post processing steps - may slow load but make mesh better optimised
-		unsigned int ppsteps = aiProcess_CalcTangentSpace | // calculate tangents and bitangents if possible
+		// Cache locality is left to the loader's own optimiser, which also handles overdraw and vertex fetch
+		const unsigned int optimised = essential |
 			aiProcess_JoinIdenticalVertices |				// join identical vertices/ optimize indexing
-			aiProcess_ValidateDataStructure |				// perform a full validation of the loader's output
-			aiProcess_ImproveCacheLocality |				// improve the cache locality of the output vertices
 			aiProcess_RemoveRedundantMaterials |			// remove redundant materials
 			aiProcess_FindDegenerates |						// remove degenerated polygons from the import
 			aiProcess_FindInvalidData |						// detect invalid model data, such as invalid normal vectors
 			aiProcess_GenUVCoords |							// convert spherical, cylindrical, box and planar mapping to proper UVs
 			aiProcess_TransformUVCoords |					// preprocess UV transformations (scaling, translation ...)
 			aiProcess_FindInstances |						// search for instanced meshes and remove them by references to one master
-			aiProcess_LimitBoneWeights |					// limit bone weights to 4 per vertex
 			aiProcess_OptimizeMeshes |						// join small meshes, if possible;
-			aiProcess_SplitByBoneCount |					// split meshes with too many bones.
-			aiProcess_GenSmoothNormals |					// generate smooth normal vectors if not existing
-			aiProcess_SplitLargeMeshes |					// split large, unrenderable meshes into submeshes
-			aiProcess_Triangulate |							// triangulate polygons with more than 3 edges
-			aiProcess_SortByPType |							// make 'clean' meshes which consist of a single typ of primitives
-			aiProcess_GenSmoothNormals |					// if no normals then create them
-			0;
+			aiProcess_SplitLargeMeshes;						// split large, unrenderable meshes into submeshes
+
+		switch (profile)
+		{
+		case ImportProfile::FastLoad:
+			return essential;
+		case ImportProfile::RuntimeOptimal:
+			return optimised;
+		case ImportProfile::ValidateEverything:
+			return optimised | aiProcess_ValidateDataStructure; // perform a full validation of the loader's output
+		}
+
+		return optimised;
+	}
+
+	// Load a 3D model form a provided file and path, return false on error
+	bool ModelLoader::LoadFromFile(const std::string& objFilename, ImportProfile profile, ThreadPool* threadPool)
+	{
+		m_filename = objFilename;
+
+		m_importReport = ImportReport();
+		m_importReport.profile = profile;
+
+		Timer loadTimer;
+
+		const unsigned int ppsteps{ PostProcessSteps(profile) };
+
+		// Primitive types removed by aiProcess_SortByPType, also part of the cache key
+		const int removedPrimitives{ aiPrimitiveType_LINE | aiPrimitiveType_POINT };
+
+		// A warm start maps the binary cache written by a previous run and skips Assimp entirely
+		MeshCacheKey cacheKey;
+		cacheKey.settingsHash = MeshCache::HashSettings(&ppsteps, sizeof(ppsteps));
+		cacheKey.settingsHash = MeshCache::HashSettings(&removedPrimitives, sizeof(removedPrimitives), cacheKey.settingsHash);
+		cacheKey.settingsHash = MeshCache::HashSettings(&profile, sizeof(profile), cacheKey.settingsHash);
+
+		// The native reader and Assimp do not number vertices alike so each keeps its own cache
+		std::string extension{ objFilename.substr(std::min(objFilename.find_last_of('.'), objFilename.size())) };
+		for (char& c : extension)
+			c = (char)std::tolower((unsigned char)c);
+		const bool nativeObj{ m_nativeObj && extension == ".obj" };
+		cacheKey.settingsHash = MeshCache::HashSettings(&nativeObj, sizeof(nativeObj), cacheKey.settingsHash);
+
+		// A glTF binary loaded with FastLoad maps in place just like the cache would, so is not cached
+		const bool glb{ extension == ".glb" };
+		const bool glbInPlace{ glb && profile == ImportProfile::FastLoad };
+
+		const std::string cacheFilename{ MeshCache::CacheFilename(objFilename, cacheKey) };
+		const bool haveSourceStamp{ GetFileStamp(objFilename, cacheKey.sourceStamp) && !glbInPlace };
+
+		if (haveSourceStamp && MeshCache::Read(*this, cacheFilename, cacheKey))
+		{
+			m_importReport.fromCache = true;
+			m_importReport.totalMilliseconds = loadTimer.ElapsedMs();
+			EsOutput("\nWarm load from mesh cache: " + cacheFilename + " took " + std::to_string(loadTimer.ElapsedMs()) + " ms");
+			return true;
+		}
+
+		if (glb)
+		{
+			EsOutput("\nUsing native glTF reader to load: " + objFilename);
+
+			GltfModel model;
+			if (!ReadGlb(objFilename, model) || !PopulateFromGlb(model, profile))
+				return false;
+
+			m_importReport.totalMilliseconds = loadTimer.ElapsedMs();
+			EsOutput("Cold load with native glTF reader: " + objFilename + " took " + std::to_string(loadTimer.ElapsedMs()) + " ms");
+
+			if (haveSourceStamp && !MeshCache::Write(*this, cacheFilename, cacheKey))
+				EsOutput("Could not write mesh cache: " + cacheFilename);
+
+			return true;
+		}
+
+		if (nativeObj)
+		{
+			EsOutput("\nUsing native OBJ reader to load: " + objFilename);
+
+			ObjModel model;
+			if (!ReadObj(objFilename, threadPool, model) || !PopulateFromObj(model, profile))
+				return false;
+
+			m_importReport.totalMilliseconds = loadTimer.ElapsedMs();
+			EsOutput("Cold load with native OBJ reader: " + objFilename + " took " + std::to_string(loadTimer.ElapsedMs()) + " ms");
+
+			if (haveSourceStamp && !MeshCache::Write(*this, cacheFilename, cacheKey))
+				EsOutput("Could not write mesh cache: " + cacheFilename);
+
+			return true;
+		}
+
+		EsOutput("\nUsing assimp to load: " + objFilename);
+
+		// Assimp's timings arrive through its global logger, install ours the first time through
+		std::call_once(s_loggerInstalled, []() { Assimp::DefaultLogger::set(new ImportReportLogger); });
+		ActiveReportScope reportScope(m_importReport);
 
 		// Create an instance of the Importer class
 		Assimp::Importer importer;
 
 		// By removing all points and lines we guarantee a face will describe a 3 vertex triangle
-		importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_LINE | aiPrimitiveType_POINT);
+		importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, removedPrimitives);
 		importer.SetPropertyInteger(AI_CONFIG_GLOB_MEASURE_TIME, 1);
 
 		const aiScene* scene = importer.ReadFile(objFilename.c_str(), ppsteps);
 
-		
-
 		if (!scene)
 		{
 			EsOutput(importer.GetErrorString());
 			return false;
 		}
 
-		return PopulateFromAssimpScene(scene);
+		if (!PopulateFromAssimpScene(scene, profile))
+			return false;
+
+		m_importReport.totalMilliseconds = loadTimer.ElapsedMs();
+		EsOutput("Cold load with assimp: " + objFilename + " took " + std::to_string(loadTimer.ElapsedMs()) + " ms");
+
+		// Save the result so the next run can take the warm path
+		if (haveSourceStamp && !MeshCache::Write(*this, cacheFilename, cacheKey))
+			EsOutput("Could not write mesh cache: " + cacheFilename);
+
+		return true;
 	}
 
 	// Parse the ASSIMP data into our format
-	bool ModelLoader::PopulateFromAssimpScene(const aiScene* scene)
+	bool ModelLoader::PopulateFromAssimpScene(const aiScene* scene, ImportProfile profile)
 	{
 		// An assimp scene can contain many things I do not need like cameras and lights
 		// Some I may want to support in the future so output that these exist but are being ignored:
@@ -112,15 +323,14 @@ namespace Helpers
 			if (AI_SUCCESS == scene->mMaterials[m]->Get(AI_MATKEY_COLOR_EMISSIVE, col))
 				m_materials[m].emissiveColour = aiColor4DToGlmVec4(col);
 
-			unsigned int shininess = 0;
-			unsigned int ret1 = scene->mMaterials[m]->Get(AI_MATKEY_SHININESS, shininess);
-			unsigned int shininessStrength = 0;
-			unsigned int ret2 = scene->mMaterials[m]->Get(AI_MATKEY_SHININESS_STRENGTH, shininessStrength);
-			float specularFactor = 0;
-			if (ret1 == AI_SUCCESS && ret2 == AI_SUCCESS)
-				m_materials[m].specularFactor = (float)(shininess * shininessStrength);
-			else if (ret1 == AI_SUCCESS)
-				m_materials[m].specularFactor = (float)shininess; // TODO: not sure about this		
+			// Shininess is the specular power, the strength scales the specular colour rather than the power
+			float shininess = 0;
+			if (AI_SUCCESS == scene->mMaterials[m]->Get(AI_MATKEY_SHININESS, shininess))
+				m_materials[m].specularFactor = shininess;
+
+			float shininessStrength = 0;
+			if (AI_SUCCESS == scene->mMaterials[m]->Get(AI_MATKEY_SHININESS_STRENGTH, shininessStrength))
+				m_materials[m].specularColour *= shininessStrength;
 
 			// There are many types for each colour and also normals
 			aiString texPath;
@@ -144,21 +354,61 @@ namespace Helpers
 			}
 		}
 
-		int hasBones{ 0 };
 		int hasTangents{ 0 };
 		int hasColourChannels{ 0 };
 		int hasMMoreThanOneUVChannel{ 0 };
 
 		//EsOutput("Scene contains " + std::to_string(scene->mNumMeshes) + " mesh");
 
+		// All mesh data goes in one arena, so first size every stream of every mesh
+		// Each stream starts on a 16 byte boundary
+		auto alignedSize = [](size_t numBytes) { return (numBytes + 15) & ~(size_t)15; };
+
+		size_t arenaSize{ 0 };
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+		{
+			const aiMesh* aimesh = scene->mMeshes[i];
+
+			arenaSize += alignedSize(sizeof(glm::vec3) * aimesh->mNumVertices);
+			if (aimesh->HasNormals())
+				arenaSize += alignedSize(sizeof(glm::vec3) * aimesh->mNumVertices);
+			if (aimesh->HasTextureCoords(0))
+				arenaSize += alignedSize(sizeof(glm::vec2) * aimesh->mNumVertices);
+			arenaSize += alignedSize(sizeof(unsigned int) * 3 * aimesh->mNumFaces);
+			if (aimesh->HasBones())
+				arenaSize += alignedSize(sizeof(glm::u8vec4) * aimesh->mNumVertices) + alignedSize(sizeof(glm::vec4) * aimesh->mNumVertices);
+		}
+
+		m_mappedFile.Close();
+		m_streamsInPlace = false;
+		m_arena.assign(arenaSize, 0);
+		m_meshVector.clear();
+		m_meshVector.resize(scene->mNumMeshes);
+		m_bones.clear();
+
+		// Where each mesh's bones start, the spans are set once the vector has stopped growing
+		std::vector<size_t> firstBone(scene->mNumMeshes + 1, 0);
+
+		// Bones name their node, which can only be found once the hierarchy is built after the meshes
+		std::vector<std::string> boneNodeNames;
+
+		unsigned char* arenaCursor{ m_arena.data() };
+
+		// Reserves the next count values of type T in the arena
+		auto allocate = [&](size_t count, auto* typeTag)
+		{
+			using T = std::remove_pointer_t<decltype(typeTag)>;
+			T* data{ (T*)arenaCursor };
+			arenaCursor += alignedSize(sizeof(T) * count);
+			return data;
+		};
+
 		// ASSIMP mesh
 		// http://assimp.sourceforge.net/lib_html/structai_mesh.html
 		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
 		{
 			aiMesh* aimesh = scene->mMeshes[i];
 
-			if (aimesh->HasBones())
-				hasBones++;
 			if (aimesh->GetNumColorChannels())
 				hasColourChannels++;
 			if (aimesh->GetNumUVChannels() > 1)
@@ -167,55 +417,116 @@ namespace Helpers
 				hasTangents++;
 
 			// Create my mesh part
-			m_meshVector.push_back(Mesh());
-			Mesh& newMesh = m_meshVector.back();
+			Mesh& newMesh = m_meshVector[i];
 
 			newMesh.name = aimesh->mName.C_Str();
 
-			//		EsOutput("Processing mesh with name: " + newMesh->name);
+			const size_t numVertices{ aimesh->mNumVertices };
 
-					// Copy over all the vertices, ai format of a vertex is same as mine
-					// Probably be able to speed this all up at some point
-			for (size_t v = 0; v < aimesh->mNumVertices; v++)
-			{
-				glm::vec3 newV = *(glm::vec3*) & aimesh->mVertices[v];
-				newMesh.vertices.push_back(newV);
-			}
+			// Copy over all the vertices, ai format of a vertex is same as mine so this is a straight block copy
+			static_assert(sizeof(aiVector3D) == sizeof(glm::vec3), "aiVector3D and glm::vec3 layouts must match");
+			glm::vec3* vertices{ allocate(numVertices, (glm::vec3*)nullptr) };
+			std::memcpy(vertices, aimesh->mVertices, sizeof(glm::vec3) * numVertices);
+			newMesh.vertices = Span<glm::vec3>(vertices, numVertices);
 
 			// And the normals if there are any
+			glm::vec3* normals{ nullptr };
 			if (aimesh->HasNormals())
 			{
-				for (size_t v = 0; v < aimesh->mNumVertices; v++)
-				{
-					glm::vec3 newN = *(glm::vec3*) & aimesh->mNormals[v];
-					newMesh.normals.push_back(newN);
-				}
+				normals = allocate(numVertices, (glm::vec3*)nullptr);
+				std::memcpy(normals, aimesh->mNormals, sizeof(glm::vec3) * numVertices);
+				newMesh.normals = Span<glm::vec3>(normals, numVertices);
 			}
 
-			// And texture coordinates
+			// And texture coordinates, assimp stores these as 3D so drop the third component
+			glm::vec2* uvCoords{ nullptr };
 			if (aimesh->HasTextureCoords(0))
 			{
-				for (size_t v = 0; v < aimesh->mNumVertices; v++)
-				{
-					glm::vec2 newN = *(glm::vec2*) & aimesh->mTextureCoords[0][v];
-					newMesh.uvCoords.push_back(newN);
-				}
+				uvCoords = allocate(numVertices, (glm::vec2*)nullptr);
+				const aiVector3D* source{ aimesh->mTextureCoords[0] };
+				for (size_t v = 0; v < numVertices; v++)
+					uvCoords[v] = glm::vec2(source[v].x, source[v].y);
+				newMesh.uvCoords = Span<glm::vec2>(uvCoords, numVertices);
 			}
 
 			// Faces contain the vertex indices and due to the flags I set before are always triangles
+			unsigned int* elements{ allocate((size_t)aimesh->mNumFaces * 3, (unsigned int*)nullptr) };
 			for (unsigned int face = 0; face < aimesh->mNumFaces; face++)
 			{
 				EsAssert(aimesh->mFaces[face].mNumIndices == 3);
-				for (int triInd = 0; triInd < 3; triInd++)
-					newMesh.elements.push_back(aimesh->mFaces[face].mIndices[triInd]);
+				const unsigned int* indices{ aimesh->mFaces[face].mIndices };
+				elements[face * 3 + 0] = indices[0];
+				elements[face * 3 + 1] = indices[1];
+				elements[face * 3 + 2] = indices[2];
+			}
+			const size_t numElements{ (size_t)aimesh->mNumFaces * 3 };
+			newMesh.elements = Span<unsigned int>(elements, numElements);
+
+			// Bone weights arrive per bone, gather them per vertex keeping the four strongest
+			glm::u8vec4* boneIndices{ nullptr };
+			glm::vec4* boneWeights{ nullptr };
+			if (aimesh->HasBones() && aimesh->mNumBones > kMaxBonesPerMesh)
+			{
+				EsOutput("Ignoring: mesh " + newMesh.name + " has more than " + std::to_string(kMaxBonesPerMesh) + " bones");
+			}
+			else if (aimesh->HasBones())
+			{
+				boneIndices = allocate(numVertices, (glm::u8vec4*)nullptr);
+				boneWeights = allocate(numVertices, (glm::vec4*)nullptr);
+
+				for (unsigned int b = 0; b < aimesh->mNumBones; b++)
+				{
+					const aiBone* bone{ aimesh->mBones[b] };
+
+					Bone newBone;
+					newBone.offsetTransform = aiMatrix4x4ToGlmMat4(bone->mOffsetMatrix);
+					m_bones.push_back(newBone);
+					boneNodeNames.push_back(bone->mName.C_Str());
+
+					for (unsigned int w = 0; w < bone->mNumWeights; w++)
+					{
+						const unsigned int v{ bone->mWeights[w].mVertexId };
+						glm::vec4& weights{ boneWeights[v] };
+
+						int weakest{ 0 };
+						for (int slot = 1; slot < 4; slot++)
+						{
+							if (weights[slot] < weights[weakest])
+								weakest = slot;
+						}
+
+						if (bone->mWeights[w].mWeight > weights[weakest])
+						{
+							weights[weakest] = bone->mWeights[w].mWeight;
+							boneIndices[v][weakest] = (unsigned char)b;
+						}
+					}
+				}
+
+				// Weights must sum to one, a vertex no bone claimed follows the first bone
+				for (size_t v = 0; v < numVertices; v++)
+				{
+					const float sum{ boneWeights[v].x + boneWeights[v].y + boneWeights[v].z + boneWeights[v].w };
+					if (sum > 0)
+						boneWeights[v] /= sum;
+					else
+						boneWeights[v] = glm::vec4(1, 0, 0, 0);
+				}
+
+				newMesh.boneIndices = Span<glm::u8vec4>(boneIndices, numVertices);
+				newMesh.boneWeights = Span<glm::vec4>(boneWeights, numVertices);
 			}
+			firstBone[i + 1] = m_bones.size();
 
 			// Material index
 			newMesh.materialIndex = aimesh->mMaterialIndex;
 		}
 
-		if (hasBones)
-			EsOutput("Ignoring: One or more mesh have bones");
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+			m_meshVector[i].bones = Span<Bone>(m_bones.data() + firstBone[i], firstBone[i + 1] - firstBone[i]);
+
+		ProcessMeshes(profile);
+
 		if (hasColourChannels)
 			EsOutput("Ignoring: One or more mesh has colour channels");
 		if (hasMMoreThanOneUVChannel)
@@ -224,78 +535,500 @@ namespace Helpers
 			EsOutput("Ignoring: One or more mesh has tangents");
 
 		// Hierarchy, ASSIMP calls these nodes
-		m_rootNode = RecurseCreateNode(scene->mRootNode, nullptr);
+		m_nodeHierarchy.Clear();
+		AddAssimpNode(scene->mRootNode, -1);
+		m_nodeHierarchy.UpdateWorldTransforms(false);
+
+		CalculateModelBounds();
+
+		for (size_t b = 0; b < m_bones.size(); b++)
+		{
+			const int nodeIndex{ m_nodeHierarchy.FindNode(boneNodeNames[b]) };
+			if (nodeIndex < 0)
+				EsOutput("Bone has no node: " + boneNodeNames[b]);
+			m_bones[b].nodeIndex = nodeIndex < 0 ? 0 : (unsigned int)nodeIndex;
+		}
 
+		// Keys are converted from ticks to seconds
+		m_animations.clear();
 		for (size_t i = 0; i < scene->mNumAnimations; i++)
 		{
-			// Only supporting node animation			
-			if (scene->mAnimations[i]->mNumMeshChannels)
+			const aiAnimation* animation{ scene->mAnimations[i] };
+
+			// Only supporting node animation
+			if (animation->mNumMeshChannels || animation->mNumMorphMeshChannels)
 				EsOutput("Ignoring: mesh animations");
 
-			if (scene->mAnimations[i]->mNumChannels)
-				EsOutput("Animation has " + std::to_string(scene->mAnimations[i]->mNumChannels) + " Channels");
+			const double ticksPerSecond{ animation->mTicksPerSecond > 0 ? animation->mTicksPerSecond : 25.0 };
+
+			AnimationClip clip;
+			clip.name = animation->mName.C_Str();
+			clip.duration = (float)(animation->mDuration / ticksPerSecond);
+
+			for (unsigned int c = 0; c < animation->mNumChannels; c++)
+			{
+				const aiNodeAnim* nodeAnim{ animation->mChannels[c] };
+				const int nodeIndex{ m_nodeHierarchy.FindNode(nodeAnim->mNodeName.C_Str()) };
+				if (nodeIndex < 0)
+				{
+					EsOutput("Ignoring: animation channel for missing node " + std::string(nodeAnim->mNodeName.C_Str()));
+					continue;
+				}
+
+				AnimationChannel channel;
+				channel.nodeIndex = (unsigned int)nodeIndex;
+
+				for (unsigned int k = 0; k < nodeAnim->mNumPositionKeys; k++)
+				{
+					const aiVectorKey& key{ nodeAnim->mPositionKeys[k] };
+					clip.positions.Add(channel.positions, (float)(key.mTime / ticksPerSecond), glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+				}
+				for (unsigned int k = 0; k < nodeAnim->mNumRotationKeys; k++)
+				{
+					const aiQuatKey& key{ nodeAnim->mRotationKeys[k] };
+					clip.rotations.Add(channel.rotations, (float)(key.mTime / ticksPerSecond), glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
+				}
+				for (unsigned int k = 0; k < nodeAnim->mNumScalingKeys; k++)
+				{
+					const aiVectorKey& key{ nodeAnim->mScalingKeys[k] };
+					clip.scalings.Add(channel.scalings, (float)(key.mTime / ticksPerSecond), glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+				}
+
+				clip.channels.push_back(channel);
+			}
+
+			EsOutput("Animation " + clip.name + ": " + std::to_string(clip.channels.size()) + " channels, " + std::to_string(clip.duration) + " s");
+			m_animations.push_back(std::move(clip));
+		}
+
+		EsOutput("Loaded OK");
+
+		return true;
+	}
+
+	// Copy a model read by the native OBJ reader, every mesh hangs off a single root node
+	bool ModelLoader::PopulateFromObj(const ObjModel& model, ImportProfile profile)
+	{
+		if (model.meshes.empty())
+		{
+			EsOutput("OBJ has no mesh");
+			return false;
+		}
+
+		m_materials = model.materials;
+
+		// Same arena layout as an Assimp import, each stream on a 16 byte boundary
+		auto alignedSize = [](size_t numBytes) { return (numBytes + 15) & ~(size_t)15; };
+
+		size_t arenaSize{ 0 };
+		for (const ObjMesh& objMesh : model.meshes)
+		{
+			arenaSize += alignedSize(sizeof(glm::vec3) * objMesh.vertices.size());
+			arenaSize += alignedSize(sizeof(glm::vec3) * objMesh.normals.size());
+			arenaSize += alignedSize(sizeof(glm::vec2) * objMesh.uvCoords.size());
+			arenaSize += alignedSize(sizeof(unsigned int) * objMesh.elements.size());
+		}
+
+		m_mappedFile.Close();
+		m_streamsInPlace = false;
+		m_arena.assign(arenaSize, 0);
+		m_meshVector.clear();
+		m_meshVector.resize(model.meshes.size());
+		m_bones.clear();
+		m_animations.clear();
+
+		unsigned char* arenaCursor{ m_arena.data() };
+
+		// Copies a stream into the next free part of the arena
+		auto copy = [&](const auto& source)
+		{
+			using T = typename std::decay_t<decltype(source)>::value_type;
+			if (source.empty())
+				return Span<T>();
+			T* data{ (T*)arenaCursor };
+			std::memcpy(data, source.data(), sizeof(T) * source.size());
+			arenaCursor += alignedSize(sizeof(T) * source.size());
+			return Span<T>(data, source.size());
+		};
+
+		std::vector<unsigned int> meshIndices(model.meshes.size());
+		for (size_t i = 0; i < model.meshes.size(); i++)
+		{
+			const ObjMesh& objMesh{ model.meshes[i] };
+			Mesh& newMesh{ m_meshVector[i] };
+
+			newMesh.name = objMesh.name;
+			newMesh.vertices = copy(objMesh.vertices);
+			newMesh.normals = copy(objMesh.normals);
+			newMesh.uvCoords = copy(objMesh.uvCoords);
+			newMesh.elements = copy(objMesh.elements);
+			newMesh.materialIndex = objMesh.materialIndex;
+
+			meshIndices[i] = (unsigned int)i;
+		}
+
+		ProcessMeshes(profile);
+
+		// OBJ has no hierarchy
+		m_nodeHierarchy.Clear();
+		m_nodeHierarchy.AddNode("OBJ root", glm::mat4(1), -1, meshIndices.data(), (unsigned int)meshIndices.size());
+		m_nodeHierarchy.UpdateWorldTransforms(false);
+
+		CalculateModelBounds();
+
+		m_importReport.steps.insert(m_importReport.steps.end(), model.steps.begin(), model.steps.end());
+
+		EsOutput("Loaded OK");
+
+		return true;
+	}
+
+	// Take a model read by the native glTF reader, viewing its streams in the mapped file when nothing will rewrite them
+	bool ModelLoader::PopulateFromGlb(GltfModel& model, ImportProfile profile)
+	{
+		// Every profile but FastLoad reorders vertices and elements, which needs them in the arena
+		const bool keepInPlace{ profile == ImportProfile::FastLoad };
+
+		m_materials = model.materials;
+
+		auto alignedSize = [](size_t numBytes) { return (numBytes + 15) & ~(size_t)15; };
+		auto arenaBytes = [&](const auto& stream)
+		{
+			using T = std::remove_const_t<std::remove_pointer_t<decltype(stream.data())>>;
+			return keepInPlace && stream.IsInPlace() ? 0 : alignedSize(sizeof(T) * stream.size());
+		};
+
+		size_t arenaSize{ 0 };
+		for (const GltfPrimitive& primitive : model.primitives)
+		{
+			arenaSize += arenaBytes(primitive.vertices);
+			arenaSize += arenaBytes(primitive.normals);
+			arenaSize += arenaBytes(primitive.uvCoords);
+			arenaSize += arenaBytes(primitive.elements);
+		}
+
+		m_mappedFile.Close();
+		m_arena.assign(arenaSize, 0);
+		m_meshVector.clear();
+		m_meshVector.resize(model.primitives.size());
+		m_bones.clear();
+		m_animations.clear();
+
+		unsigned char* arenaCursor{ m_arena.data() };
+		bool anyInPlace{ false };
+
+		// Views a stream where it is or copies it into the next free part of the arena
+		auto place = [&](const auto& stream)
+		{
+			using T = std::remove_const_t<std::remove_pointer_t<decltype(stream.data())>>;
+			if (stream.size() == 0)
+				return Span<T>();
+			if (keepInPlace && stream.IsInPlace())
+			{
+				anyInPlace = true;
+				return stream.inPlace;
+			}
+			T* data{ (T*)arenaCursor };
+			std::memcpy(data, stream.data(), sizeof(T) * stream.size());
+			arenaCursor += alignedSize(sizeof(T) * stream.size());
+			return Span<T>(data, stream.size());
+		};
+
+		for (size_t i = 0; i < model.primitives.size(); i++)
+		{
+			const GltfPrimitive& primitive{ model.primitives[i] };
+			Mesh& newMesh{ m_meshVector[i] };
+
+			newMesh.name = primitive.name;
+			newMesh.vertices = place(primitive.vertices);
+			newMesh.normals = place(primitive.normals);
+			newMesh.uvCoords = place(primitive.uvCoords);
+			newMesh.elements = place(primitive.elements);
+			newMesh.materialIndex = primitive.materialIndex;
 		}
 
+		// The spans point into the mapping so the loader takes it over, otherwise it is closed with the model
+		if (anyInPlace)
+			m_mappedFile = std::move(model.file);
+		m_streamsInPlace = anyInPlace;
+
+		ProcessMeshes(profile);
+
+		m_nodeHierarchy.Clear();
+		for (const GltfNode& node : model.nodes)
+			m_nodeHierarchy.AddNode(node.name, node.transform, node.parentIndex, node.meshIndices.data(), (unsigned int)node.meshIndices.size());
+		m_nodeHierarchy.UpdateWorldTransforms(false);
+
+		CalculateModelBounds();
+
+		m_importReport.steps.insert(m_importReport.steps.end(), model.steps.begin(), model.steps.end());
+
 		EsOutput("Loaded OK");
 
 		return true;
 	}
 
-	// Recursive node creation
-	Node* ModelLoader::RecurseCreateNode(aiNode* node, Node* parent)
+	// Optimise, cluster and simplify every mesh in place then bound it
+	void ModelLoader::ProcessMeshes(ImportProfile profile)
 	{
-		Node* newNode = new Node;
+		m_meshlets.clear();
+		m_lodElements.clear();
+		m_lods.clear();
+
+		// Where each mesh's meshlets and levels of detail start, the spans are set once the vectors have stopped growing
+		const bool buildMeshlets{ profile != ImportProfile::FastLoad };
+		const bool buildLods{ profile != ImportProfile::FastLoad };
+		const bool optimiseOrder{ profile != ImportProfile::FastLoad };
+		std::vector<size_t> firstMeshlet(m_meshVector.size() + 1, 0);
+		std::vector<size_t> firstLodElement(m_meshVector.size() + 1, 0);
+		std::vector<size_t> firstLod(m_meshVector.size() + 1, 0);
+
+		std::vector<unsigned int> lodElements;
+		std::vector<unsigned int> reordered;
+		std::vector<unsigned int> vertexRemap;
+		VertexCacheStats cacheBefore;
+		VertexCacheStats cacheAfter;
+
+		// The spans are read only views, but the arena they point into belongs to this loader
+		// Streams a mesh does not have come back null
+		auto writable = [](const auto& span)
+		{
+			using T = std::remove_const_t<std::remove_pointer_t<decltype(span.data())>>;
+			return span.empty() ? nullptr : const_cast<T*>(span.data());
+		};
+
+		for (size_t i = 0; i < m_meshVector.size(); i++)
+		{
+			Mesh& newMesh = m_meshVector[i];
+
+			const size_t numVertices{ newMesh.vertices.size() };
+			const size_t numElements{ newMesh.elements.size() };
+			glm::vec3* vertices{ writable(newMesh.vertices) };
+			glm::vec3* normals{ writable(newMesh.normals) };
+			glm::vec2* uvCoords{ writable(newMesh.uvCoords) };
+			unsigned int* elements{ writable(newMesh.elements) };
+			glm::u8vec4* boneIndices{ writable(newMesh.boneIndices) };
+			glm::vec4* boneWeights{ writable(newMesh.boneWeights) };
+
+			// Triangles ordered for the vertex cache, then runs of them ordered to cut overdraw
+			if (optimiseOrder)
+			{
+				cacheBefore.Add(AnalyseVertexCache(elements, numElements, numVertices));
+				OptimiseVertexCache(elements, elements, numElements, numVertices);
+				reordered.resize(numElements);
+				OptimiseOverdraw(reordered.data(), elements, numElements, vertices, numVertices);
+				std::copy(reordered.begin(), reordered.end(), elements);
+			}
+
+			// Clusters for finer grained culling, this reorders the elements so each meshlet's triangles are together
+			// The cache order is then restored within each meshlet, the meshlets stay in the overdraw order they were grown in
+			if (buildMeshlets)
+			{
+				std::vector<Meshlet> meshlets{ BuildMeshlets(vertices, numVertices, elements, numElements) };
+				if (optimiseOrder)
+				{
+					for (const Meshlet& meshlet : meshlets)
+						OptimiseVertexCache(elements + meshlet.firstElement, elements + meshlet.firstElement, meshlet.numElements, numVertices);
+				}
+				m_meshlets.insert(m_meshlets.end(), meshlets.begin(), meshlets.end());
+			}
+			firstMeshlet[i + 1] = m_meshlets.size();
+
+			// Simplified versions for drawing at a distance, they share the vertices so only add elements
+			std::vector<MeshLod> lods;
+			lodElements.clear();
+			if (buildLods)
+			{
+				lods = BuildLods(vertices, numVertices, elements, numElements, lodElements);
+				if (optimiseOrder)
+				{
+					for (const MeshLod& lod : lods)
+						OptimiseVertexCache(&lodElements[lod.firstElement], &lodElements[lod.firstElement], lod.numElements, numVertices);
+				}
+			}
 
-		newNode->name = node->mName.C_Str();
-		newNode->parentNode = parent;
+			// Vertices renumbered in the order the full mesh first uses them, so fetching walks forward through memory
+			if (optimiseOrder)
+			{
+				vertexRemap.resize(numVertices);
+				BuildVertexFetchRemap(vertexRemap.data(), elements, numElements, numVertices);
+				RemapVertices(vertices, numVertices, vertexRemap.data());
+				if (normals)
+					RemapVertices(normals, numVertices, vertexRemap.data());
+				if (uvCoords)
+					RemapVertices(uvCoords, numVertices, vertexRemap.data());
+				if (boneIndices)
+				{
+					RemapVertices(boneIndices, numVertices, vertexRemap.data());
+					RemapVertices(boneWeights, numVertices, vertexRemap.data());
+				}
+				RemapElements(elements, numElements, vertexRemap.data());
+				RemapElements(lodElements.data(), lodElements.size(), vertexRemap.data());
+
+				cacheAfter.Add(AnalyseVertexCache(elements, numElements, numVertices));
+			}
 
-		for (size_t i = 0; i < node->mNumMeshes; i++)
-			newNode->meshIndices.push_back(node->mMeshes[i]);
+			m_lodElements.insert(m_lodElements.end(), lodElements.begin(), lodElements.end());
+			m_lods.insert(m_lods.end(), lods.begin(), lods.end());
+			firstLodElement[i + 1] = m_lodElements.size();
+			firstLod[i + 1] = m_lods.size();
 
-		newNode->transform = *((glm::mat4*) & node->mTransformation);
+			newMesh.CalculateBounds();
+		}
+
+		if (optimiseOrder)
+		{
+			EsOutput("Vertex cache ACMR " + std::to_string(cacheBefore.Acmr()) + " -> " + std::to_string(cacheAfter.Acmr()) +
+				", ATVR " + std::to_string(cacheBefore.Atvr()) + " -> " + std::to_string(cacheAfter.Atvr()));
+		}
 
+		for (size_t i = 0; i < m_meshVector.size(); i++)
+		{
+			m_meshVector[i].meshlets = Span<Meshlet>(m_meshlets.data() + firstMeshlet[i], firstMeshlet[i + 1] - firstMeshlet[i]);
+			m_meshVector[i].lodElements = Span<unsigned int>(m_lodElements.data() + firstLodElement[i], firstLodElement[i + 1] - firstLodElement[i]);
+			m_meshVector[i].lods = Span<MeshLod>(m_lods.data() + firstLod[i], firstLod[i + 1] - firstLod[i]);
+		}
+	}
+
+	// Recursive, appends node and its children to the hierarchy in depth first order
+	void ModelLoader::AddAssimpNode(const aiNode* node, int parentIndex)
+	{
 		if (node->mMetaData)
 			EsOutput("Ignoring: node has metadata");
 
+		unsigned int index = m_nodeHierarchy.AddNode(node->mName.C_Str(), aiMatrix4x4ToGlmMat4(node->mTransformation),
+			parentIndex, node->mMeshes, node->mNumMeshes);
+
 		for (size_t i = 0; i < node->mNumChildren; i++)
-			newNode->childNodes.emplace_back(RecurseCreateNode(node->mChildren[i], newNode));
+			AddAssimpNode(node->mChildren[i], (int)index);
+	}
+
+	// Remove all nodes
+	void NodeHierarchy::Clear()
+	{
+		m_nodes.clear();
+		m_meshIndices.clear();
+		m_worldTransforms.clear();
+		m_dirty.clear();
+		m_anyDirty = false;
+	}
+
+	// Add a node, nodes must be added in depth first order. Returns the new node's index.
+	unsigned int NodeHierarchy::AddNode(const std::string& name, const glm::mat4& transform, int parentIndex,
+		const unsigned int* meshIndices, unsigned int numMeshIndices)
+	{
+		EsAssert(parentIndex < (int)m_nodes.size());
+
+		Node newNode;
+		newNode.name = name;
+		newNode.transform = transform;
+		newNode.parentIndex = parentIndex;
+		newNode.firstMeshIndex = (unsigned int)m_meshIndices.size();
+		newNode.numMeshIndices = numMeshIndices;
 
-		return newNode;
+		m_meshIndices.insert(m_meshIndices.end(), meshIndices, meshIndices + numMeshIndices);
+
+		// Every ancestor's subtree now also covers this node
+		for (int ancestor = parentIndex; ancestor >= 0; ancestor = m_nodes[ancestor].parentIndex)
+			m_nodes[ancestor].subtreeSize++;
+
+		m_nodes.push_back(newNode);
+		m_worldTransforms.push_back(transform);
+		m_dirty.push_back(1);
+		m_anyDirty = true;
+
+		return (unsigned int)m_nodes.size() - 1;
 	}
 
-	// Recursive deletion of nodes
-	void ModelLoader::RecurseDeleteNode(Node* node)
+	// Index of the first node called name, -1 if there is none
+	int NodeHierarchy::FindNode(const std::string& name) const
 	{
-		if (!node)
+		for (size_t i = 0; i < m_nodes.size(); i++)
+		{
+			if (m_nodes[i].name == name)
+				return (int)i;
+		}
+		return -1;
+	}
+
+	// Change a node's local transform, its subtree's world transforms update on the next UpdateWorldTransforms
+	void NodeHierarchy::SetLocalTransform(size_t index, const glm::mat4& transform)
+	{
+		m_nodes[index].transform = transform;
+		m_dirty[index] = 1;
+		m_anyDirty = true;
+	}
+
+	// Recalculate world transforms in one forward pass, with onlyDirty just the subtrees under changed nodes
+	void NodeHierarchy::UpdateWorldTransforms(bool onlyDirty)
+	{
+		if (onlyDirty && !m_anyDirty)
 			return;
 
-		for (Node* n : node->childNodes)
-			RecurseDeleteNode(n);
+		const size_t numNodes{ m_nodes.size() };
+		size_t i{ 0 };
+		while (i < numNodes)
+		{
+			if (onlyDirty && !m_dirty[i])
+			{
+				i++;
+				continue;
+			}
+
+			// A parent always precedes its children, so its world transform is already up to date here
+			const size_t subtreeEnd{ onlyDirty ? i + m_nodes[i].subtreeSize : numNodes };
+			for (; i < subtreeEnd; i++)
+			{
+				const Node& node{ m_nodes[i] };
+				m_worldTransforms[i] = node.parentIndex < 0 ? node.transform : m_worldTransforms[node.parentIndex] * node.transform;
+				m_dirty[i] = 0;
+			}
+		}
 
-		delete node;
+		m_anyDirty = false;
 	}
 
-	// Retrieve the dimensions of this model in local coordinates
-	void ModelLoader::GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const
+	// Combine the mesh bounds into the model bounds
+	void ModelLoader::CalculateModelBounds()
 	{
-		if (m_meshVector.empty())
-			return;
+		m_boundingBox = BoundingBox();
+		m_boundingSphere = BoundingSphere();
 
-		m_meshVector[0].GetLocalExtents(minExtents, maxExtents);
+		// Each mesh is placed by the world transform of every node that draws it
+		std::vector<BoundingSphere> placedSpheres;
+		for (size_t node = 0; node < m_nodeHierarchy.NumNodes(); node++)
+		{
+			const glm::mat4& transform{ m_nodeHierarchy.GetWorldTransform(node) };
+			for (unsigned int meshIndex : m_nodeHierarchy.GetMeshIndices(node))
+			{
+				if (meshIndex >= m_meshVector.size())
+					continue;
 
-		for (size_t i = 1; i < m_meshVector.size(); i++)
+				m_boundingBox.Expand(m_meshVector[meshIndex].boundingBox.Transformed(transform));
+				placedSpheres.push_back(m_meshVector[meshIndex].boundingSphere.Transformed(transform));
+			}
+		}
+
+		// No hierarchy to go by so take the meshes as they are
+		if (placedSpheres.empty())
 		{
-			glm::vec3 newMin;
-			glm::vec3 newMax;
-			m_meshVector[0].GetLocalExtents(newMin, newMax);
+			for (const Mesh& mesh : m_meshVector)
+			{
+				m_boundingBox.Expand(mesh.boundingBox);
+				placedSpheres.push_back(mesh.boundingSphere);
+			}
+		}
 
-			minExtents.x = std::min(minExtents.x, newMin.x);
-			minExtents.y = std::min(minExtents.y, newMin.y);
-			minExtents.z = std::min(minExtents.z, newMin.z);
+		if (!m_boundingBox.IsValid())
+			return;
 
-			maxExtents.x = std::max(maxExtents.x, newMax.x);
-			maxExtents.y = std::max(maxExtents.y, newMax.y);
-			maxExtents.z = std::max(maxExtents.z, newMax.z);
+		// Centre on the box and grow to reach the far side of every mesh sphere
+		m_boundingSphere.centre = m_boundingBox.Centre();
+		m_boundingSphere.radius = 0;
+		for (const BoundingSphere& sphere : placedSpheres)
+		{
+			if (sphere.IsValid())
+				m_boundingSphere.radius = std::max(m_boundingSphere.radius, glm::length(sphere.centre - m_boundingSphere.centre) + sphere.radius);
 		}
 	}
 }
\ No newline at end of file
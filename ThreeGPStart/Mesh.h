@@ -3,9 +3,17 @@
 
 #include "ExternalLibraryHeaders.h"
 #include "Helper.h"
+#include "MappedFile.h"
+#include "Bounds.h"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 namespace Helpers
 {
+	class ThreadPool;
+	struct ObjModel;
+	struct GltfModel;
 
 	// Materials work with lights and shaders to produce the final render
 	struct Material
@@ -43,26 +51,115 @@ namespace Helpers
 		}
 	};
 
+	// Read only view of a contiguous run of values held elsewhere
+	// Mesh data is a set of these pointing into storage owned by the ModelLoader
+	template<typename T>
+	class Span
+	{
+	private:
+		const T* m_data{ nullptr };
+		size_t m_size{ 0 };
+	public:
+		Span() = default;
+		Span(const T* data, size_t size) : m_data(data), m_size(size) {}
+
+		const T* data() const { return m_data; }
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		const T& operator[](size_t i) const { return m_data[i]; }
+
+		const T* begin() const { return m_data; }
+		const T* end() const { return m_data + m_size; }
+	};
+
+	// Small cluster of a mesh's triangles for culling at finer than whole mesh granularity
+	struct Meshlet
+	{
+		// Range of the mesh elements holding this meshlet's triangles
+		unsigned int firstElement{ 0 };
+		unsigned int numElements{ 0 };
+
+		// Distinct vertices referenced
+		unsigned int numVertices{ 0 };
+
+		// Bounds of the meshlet's vertices
+		BoundingSphere boundingSphere;
+
+		// Normal cone, every triangle faces within the cone around coneAxis. A coneCutoff of 1 means the cone is too wide to cull with.
+		glm::vec3 coneAxis{ 0, 0, 1 };
+		float coneCutoff{ 1.0f };
+	};
+
+	// A simplified version of a mesh, drawn in place of the full elements once far enough away to look the same
+	struct MeshLod
+	{
+		// Range of the mesh lodElements holding this level's triangles
+		unsigned int firstElement{ 0 };
+		unsigned int numElements{ 0 };
+
+		// Furthest the simplified surface strays from the full mesh, in local coordinates
+		float error{ 0 };
+	};
+
+	// Joint of a skinned mesh, vertices are weighted to up to four of these
+	struct Bone
+	{
+		// Node in the ModelLoader hierarchy that moves the bone
+		unsigned int nodeIndex{ 0 };
+
+		// Takes mesh space to the bone's space in the bind pose
+		glm::mat4 offsetTransform{ 1 };
+	};
+
+	// Most bones one mesh can have, bone indices are stored in a byte
+	const unsigned int kMaxBonesPerMesh{ 256 };
+
 	// Data container for a mesh
 	// A model can be made up of a number of mesh
+	// The data is only valid for as long as the ModelLoader that produced it
 	struct Mesh
 	{
 		// Name may well be blank, depends on the mesh creator
 		std::string name;
 
 		// Data in the mesh, vertices are guaranteed but normals and uvCoords depend on the model creator
-		std::vector<glm::vec3> vertices;
-		std::vector<glm::vec3> normals;
-		std::vector<glm::vec2> uvCoords;
+		Span<glm::vec3> vertices;
+		Span<glm::vec3> normals;
+		Span<glm::vec2> uvCoords;
 
 		// Elements
-		std::vector<unsigned int> elements;
+		Span<unsigned int> elements;
+
+		// Meshlets covering the elements in order, empty if the import profile does not build them
+		Span<Meshlet> meshlets;
+
+		// Triangles of every level of detail one after the other, indexing the same vertices as elements
+		Span<unsigned int> lodElements;
+
+		// Levels of detail coarser than elements, each coarser than the last. Empty if the import profile does not build them.
+		Span<MeshLod> lods;
+
+		// Skinning, empty unless the mesh has bones. Each vertex blends up to four bones, its weights sum to 1.
+		Span<glm::u8vec4> boneIndices;
+		Span<glm::vec4> boneWeights;
+		Span<Bone> bones;
 
 		// Index into the material vector held by the ModelLoader
 		size_t materialIndex;
 
+		// Bounds of the vertices in local coordinates, calculated once at import
+		BoundingBox boundingBox;
+		BoundingSphere boundingSphere;
+
+		// Calculate boundingBox and boundingSphere from the vertices
+		void CalculateBounds();
+
 		// Retrieve the dimensions of this mesh in local coordinates
-		void GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const;
+		void GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const {
+			minExtents = boundingBox.minExtents;
+			maxExtents = boundingBox.maxExtents;
+		}
 
 		// Helper
 		std::string ToString() const {
@@ -72,55 +169,277 @@ namespace Helpers
 				" Num verts: " + std::to_string(vertices.size()) + "\n" +
 				" Num normals: " + std::to_string(normals.size()) + "\n" +
 				" Num uv coords: " + std::to_string(uvCoords.size()) + "\n" +
-				" Num indices: " + std::to_string(elements.size());
+				" Num indices: " + std::to_string(elements.size()) + "\n" +
+				" Num meshlets: " + std::to_string(meshlets.size()) + "\n" +
+				" Num levels of detail: " + std::to_string(lods.size()) + "\n" +
+				" Num bones: " + std::to_string(bones.size());
 		}
 	};
 
 	// A mesh can contain a hierarchy in a tree structure
-	// Each entry is a Node
+	// Each entry is a Node, held in a flat array in depth first order
 	struct Node
 	{
 		std::string name;
-		glm::mat4 transform;
-		std::vector<unsigned int> meshIndices;
 
-		Node* parentNode{ nullptr };
-		std::vector<Node*> childNodes;
+		// Transform relative to the parent node
+		glm::mat4 transform{ 1 };
+
+		// Index of the parent in the hierarchy, -1 for the root
+		int parentIndex{ -1 };
+
+		// Number of nodes in the subtree rooted here including this one, they directly follow this node
+		unsigned int subtreeSize{ 1 };
+
+		// Range of this node's entries in the hierarchy's mesh index array
+		unsigned int firstMeshIndex{ 0 };
+		unsigned int numMeshIndices{ 0 };
+	};
+
+	// Flat, index based node tree
+	// Parents always come before their children so world transforms can be found in a single forward pass
+	class NodeHierarchy
+	{
+	private:
+		std::vector<Node> m_nodes;
+		std::vector<unsigned int> m_meshIndices;
+		std::vector<glm::mat4> m_worldTransforms;
+
+		// Nodes whose local transform changed since the last update
+		std::vector<unsigned char> m_dirty;
+		bool m_anyDirty{ false };
+	public:
+		// Remove all nodes
+		void Clear();
+
+		// Add a node, nodes must be added in depth first order. Returns the new node's index.
+		unsigned int AddNode(const std::string& name, const glm::mat4& transform, int parentIndex,
+			const unsigned int* meshIndices, unsigned int numMeshIndices);
+
+		// Number of nodes in the hierarchy
+		size_t NumNodes() const { return m_nodes.size(); }
+
+		// Access to the nodes in depth first order
+		const std::vector<Node>& GetNodes() const { return m_nodes; }
+		const Node& GetNode(size_t index) const { return m_nodes[index]; }
+
+		// Indices into the ModelLoader mesh vector of the meshes drawn by a node
+		Span<unsigned int> GetMeshIndices(size_t index) const {
+			return Span<unsigned int>(m_meshIndices.data() + m_nodes[index].firstMeshIndex, m_nodes[index].numMeshIndices);
+		}
+
+		// Index of the first node called name, -1 if there is none
+		int FindNode(const std::string& name) const;
+
+		// Change a node's local transform, its subtree's world transforms update on the next UpdateWorldTransforms
+		void SetLocalTransform(size_t index, const glm::mat4& transform);
+
+		// Recalculate world transforms in one forward pass, with onlyDirty just the subtrees under changed nodes
+		void UpdateWorldTransforms(bool onlyDirty = true);
+
+		// Transform from a node to the model's local space, valid after UpdateWorldTransforms
+		const glm::mat4& GetWorldTransform(size_t index) const { return m_worldTransforms[index]; }
+		const std::vector<glm::mat4>& GetWorldTransforms() const { return m_worldTransforms; }
+	};
+
+	// Run of one channel's keys within its clip's key arrays
+	struct KeyRange
+	{
+		unsigned int first{ 0 };
+		unsigned int count{ 0 };
+	};
+
+	// Keys of every channel in a clip packed one channel after another
+	// Times are held apart from values so finding a key only touches the times
+	template<typename T>
+	struct KeyArrays
+	{
+		std::vector<float> times;
+		std::vector<T> values;
+
+		// Append a key to range, a channel's keys must all be added before the next channel's
+		void Add(KeyRange& range, float time, const T& value)
+		{
+			if (range.count == 0)
+				range.first = (unsigned int)times.size();
+			times.push_back(time);
+			values.push_back(value);
+			range.count++;
+		}
+	};
+
+	// Keys driving one node's local transform, each range is sorted by time
+	struct AnimationChannel
+	{
+		unsigned int nodeIndex{ 0 };
+		KeyRange positions;
+		KeyRange rotations;
+		KeyRange scalings;
+	};
+
+	// One named animation, such as a walk cycle
+	struct AnimationClip
+	{
+		std::string name;
+
+		// Length in seconds, playback wraps around after this
+		float duration{ 0 };
+
+		std::vector<AnimationChannel> channels;
+
+		// The channel key ranges index these
+		KeyArrays<glm::vec3> positions;
+		KeyArrays<glm::quat> rotations;
+		KeyArrays<glm::vec3> scalings;
+	};
+
+	// Named sets of Assimp post-processing steps, trading import time against mesh quality
+	enum class ImportProfile
+	{
+		FastLoad,			// Just enough to give renderable triangles with normals, no optimisation
+		RuntimeOptimal,		// Joined, cache optimised and merged mesh split into meshlets with levels of detail for the best runtime performance
+		ValidateEverything	// Runtime optimal plus full validation of the loader output
+	};
+
+	// Time taken by one stage of an import, either an Assimp post-process step or a loading stage
+	struct ImportStepTiming
+	{
+		std::string step;
+		double milliseconds{ 0 };
+	};
+
+	// Structured report of how a model was imported
+	struct ImportReport
+	{
+		ImportProfile profile{ ImportProfile::RuntimeOptimal };
+
+		// True if the data came from the mesh cache rather than Assimp
+		bool fromCache{ false };
+
+		// Wall time of the whole LoadFromFile call
+		double totalMilliseconds{ 0 };
+
+		// Per step timings measured by Assimp (AI_CONFIG_GLOB_MEASURE_TIME), in the order they ran
+		std::vector<ImportStepTiming> steps;
+
+		// Warnings raised by Assimp during the import
+		std::vector<std::string> warnings;
+
+		// Helper to output the report
+		std::string ToString() const;
 	};
 
 	// Helper to load model data into mesh and material structures
 	class ModelLoader
 	{
+		// The mesh cache reads and writes the loaded data directly
+		friend class MeshCache;
 	private:
 		std::string m_filename;
 		std::vector<Mesh> m_meshVector;
 		std::vector<Material> m_materials;
 
-		Node* m_rootNode{ nullptr };
+		// Single allocation holding every mesh's vertex and element data, the mesh spans point into this
+		std::vector<unsigned char> m_arena;
+
+		// When loaded from the mesh cache, or a glTF binary whose streams are used in place,
+		// the spans point straight into the mapped file instead
+		MappedFile m_mappedFile;
+
+		// True when the vertex and element spans view a glTF binary's buffers where they lie
+		bool m_streamsInPlace{ false };
+
+		// Meshlets of every mesh, the mesh meshlet spans point into this
+		std::vector<Meshlet> m_meshlets;
+
+		// Level of detail triangles and ranges of every mesh, the mesh lodElements and lods spans point into these
+		std::vector<unsigned int> m_lodElements;
+		std::vector<MeshLod> m_lods;
+
+		// Bones of every mesh, the mesh bone spans point into this
+		std::vector<Bone> m_bones;
+
+		NodeHierarchy m_nodeHierarchy;
+
+		// Node animations, the channels refer to nodes in m_nodeHierarchy
+		std::vector<AnimationClip> m_animations;
+
+		ImportReport m_importReport;
+
+		// Read .obj files with the native reader rather than Assimp
+		bool m_nativeObj{ true };
+
+		// Bounds of every mesh placed by the node hierarchy, in model local coordinates
+		BoundingBox m_boundingBox;
+		BoundingSphere m_boundingSphere;
 
-		bool PopulateFromAssimpScene(const aiScene* scene);
+		// Combine the mesh bounds into the model bounds
+		void CalculateModelBounds();
 
-		// Recursive
-		Node* RecurseCreateNode(aiNode* node, Node* parent);
-		void RecurseDeleteNode(Node* node);
+		bool PopulateFromAssimpScene(const aiScene* scene, ImportProfile profile);
+
+		// Copy a model read by the native OBJ reader, every mesh hangs off a single root node
+		bool PopulateFromObj(const ObjModel& model, ImportProfile profile);
+
+		// Take a model read by the native glTF reader. With FastLoad the streams it read in place stay in the
+		// mapped file, which the loader takes over, as nothing is rewritten. Other profiles copy them to the arena.
+		bool PopulateFromGlb(GltfModel& model, ImportProfile profile);
+
+		// Optimise, cluster and simplify the meshes once their streams are in the arena, as the import profile asks
+		void ProcessMeshes(ImportProfile profile);
+
+		// Recursive, appends node and its children to the hierarchy in depth first order
+		void AddAssimpNode(const aiNode* node, int parentIndex);
 	public:
 		ModelLoader() = default;
-		~ModelLoader() { RecurseDeleteNode(m_rootNode); }
+
+		// Owns the storage the mesh spans refer to so cannot be copied
+		ModelLoader(const ModelLoader&) = delete;
+		ModelLoader& operator=(const ModelLoader&) = delete;
 
 		// Load a 3D model form a provided file and path, return false on error
-		bool LoadFromFile(const std::string& objFilename);
+		// OBJ files are parsed across threadPool when given, serially otherwise. Binary glTF files are read natively.
+		bool LoadFromFile(const std::string& objFilename, ImportProfile profile = ImportProfile::RuntimeOptimal, ThreadPool* threadPool = nullptr);
+
+		// Choose between the native OBJ reader, the default, and Assimp for .obj files
+		void SetUseNativeObj(bool nativeObj) { m_nativeObj = nativeObj; }
+
+		// True when the mesh streams are a glTF binary's buffers viewed in place, so can be sent to GL as they are
+		bool StreamsInPlace() const { return m_streamsInPlace; }
+
+		// Populate from a scene already imported with Assimp, return false on error
+		bool LoadFromScene(const aiScene* scene, ImportProfile profile = ImportProfile::RuntimeOptimal) { return PopulateFromAssimpScene(scene, profile); }
+
+		// Assimp post-processing steps used by an import profile
+		static unsigned int PostProcessSteps(ImportProfile profile);
+
+		// How the last LoadFromFile went, including per step timings
+		const ImportReport& GetImportReport() const { return m_importReport; }
 
 		// Retrieves the collection of mesh loaded from the 3D model
 		std::vector<Mesh>& GetMeshVector() { return m_meshVector; }
+		const std::vector<Mesh>& GetMeshVector() const { return m_meshVector; }
 
 		// Retrieves the collection of materials loaded from the 3D model
 		std::vector<Material>& GetMaterialVector() { return m_materials; }
+		const std::vector<Material>& GetMaterialVector() const { return m_materials; }
 
-		// For a mesh heirarchy this is the root.
-		Node* GetRootNode() { return m_rootNode; }
+		// The mesh heirarchy, node 0 is the root
+		NodeHierarchy& GetNodeHierarchy() { return m_nodeHierarchy; }
+		const NodeHierarchy& GetNodeHierarchy() const { return m_nodeHierarchy; }
+
+		// Animations that can be played on the node hierarchy
+		const std::vector<AnimationClip>& GetAnimations() const { return m_animations; }
+
+		// Bounds of the whole model in local coordinates, calculated once at import
+		const BoundingBox& GetBoundingBox() const { return m_boundingBox; }
+		const BoundingSphere& GetBoundingSphere() const { return m_boundingSphere; }
 
 		// Retrieve the dimensions of this model in local coordinates
-		void GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const;
+		void GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const {
+			minExtents = m_boundingBox.minExtents;
+			maxExtents = m_boundingBox.maxExtents;
+		}
 
 		// Helper to output the main info. of this loaded model
 		std::string ToString(bool describeEachMesh = true) const {
@@ -0,0 +1,505 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace Helpers
+{
+	namespace
+	{
+		const char kMagic[4]{ '3', 'G', 'P', 'M' };
+
+		// Fixed size header at the start of every cache file
+		struct CacheHeader
+		{
+			char magic[4];
+			unsigned int version;
+			long long sourceModifiedTime;
+			unsigned long long sourceSize;
+			unsigned long long settingsHash;
+			unsigned int numMaterials;
+			unsigned int numMeshes;
+		};
+
+		// Writes values padded to 4 bytes so everything read back is aligned
+		class CacheWriter
+		{
+		private:
+			std::ostream& m_out;
+		public:
+			CacheWriter(std::ostream& out) : m_out(out) {}
+
+			void Bytes(const void* data, size_t numBytes)
+			{
+				static const char padding[4]{ 0 };
+				m_out.write((const char*)data, numBytes);
+				if (numBytes % 4)
+					m_out.write(padding, 4 - numBytes % 4);
+			}
+
+			void U32(unsigned int value) { Bytes(&value, sizeof(value)); }
+
+			void String(const std::string& str)
+			{
+				U32((unsigned int)str.size());
+				Bytes(str.data(), str.size());
+			}
+
+			template<typename T>
+			void Array(const std::vector<T>& values)
+			{
+				U32((unsigned int)values.size());
+				Bytes(values.data(), sizeof(T) * values.size());
+			}
+
+			template<typename T>
+			void Array(const Span<T>& values)
+			{
+				U32((unsigned int)values.size());
+				Bytes(values.data(), sizeof(T) * values.size());
+			}
+		};
+
+		// Walks the mapped cache, every read is bounds checked so a truncated file fails cleanly
+		class CacheReader
+		{
+		private:
+			const unsigned char* m_cursor;
+			const unsigned char* m_end;
+		public:
+			CacheReader(const unsigned char* data, size_t numBytes) : m_cursor(data), m_end(data + numBytes) {}
+
+			// Returns a pointer to numBytes of data and advances past it (and its padding), nullptr if overrun
+			const unsigned char* Bytes(size_t numBytes)
+			{
+				size_t padded{ (numBytes + 3) & ~(size_t)3 };
+				if ((size_t)(m_end - m_cursor) < padded)
+					return nullptr;
+
+				const unsigned char* data{ m_cursor };
+				m_cursor += padded;
+				return data;
+			}
+
+			bool U32(unsigned int& value)
+			{
+				const unsigned char* data{ Bytes(sizeof(value)) };
+				if (!data)
+					return false;
+				std::memcpy(&value, data, sizeof(value));
+				return true;
+			}
+
+			bool String(std::string& str)
+			{
+				unsigned int length{ 0 };
+				if (!U32(length))
+					return false;
+				const unsigned char* data{ Bytes(length) };
+				if (!data)
+					return false;
+				str.assign((const char*)data, length);
+				return true;
+			}
+
+			template<typename T>
+			bool Array(std::vector<T>& values)
+			{
+				unsigned int count{ 0 };
+				if (!U32(count))
+					return false;
+				const unsigned char* data{ Bytes(sizeof(T) * count) };
+				if (!data)
+					return false;
+				const T* first{ (const T*)data };
+				values.assign(first, first + count);
+				return true;
+			}
+
+			// Points values straight at the data in the mapping, no copy is made
+			template<typename T>
+			bool Array(Span<T>& values)
+			{
+				unsigned int count{ 0 };
+				if (!U32(count))
+					return false;
+				const unsigned char* data{ Bytes(sizeof(T) * count) };
+				if (!data)
+					return false;
+				values = Span<T>((const T*)data, count);
+				return true;
+			}
+		};
+
+		// Smallest a record can be, two empty names then the colours and specular factor
+		const size_t kMinMaterialBytes{ 4 * 2 + ((sizeof(glm::vec4) * 4 + sizeof(float) + 3) & ~(size_t)3) };
+
+		// Empty name, material index, bounds, then ten empty arrays
+		const size_t kMinMeshBytes{ 4 * 2 + ((sizeof(BoundingBox) + sizeof(BoundingSphere) + 3) & ~(size_t)3) + 4 * 10 };
+
+		void WriteMaterial(CacheWriter& writer, const Material& material)
+		{
+			writer.String(material.diffuseTextureFilename);
+			writer.String(material.specularTextureFilename);
+			writer.Bytes(&material.diffuseColour, sizeof(glm::vec4));
+			writer.Bytes(&material.ambientColour, sizeof(glm::vec4));
+			writer.Bytes(&material.emissiveColour, sizeof(glm::vec4));
+			writer.Bytes(&material.specularColour, sizeof(glm::vec4));
+			writer.Bytes(&material.specularFactor, sizeof(float));
+		}
+
+		bool ReadMaterial(CacheReader& reader, Material& material)
+		{
+			if (!reader.String(material.diffuseTextureFilename) || !reader.String(material.specularTextureFilename))
+				return false;
+
+			const unsigned char* colours{ reader.Bytes(sizeof(glm::vec4) * 4 + sizeof(float)) };
+			if (!colours)
+				return false;
+
+			std::memcpy(&material.diffuseColour, colours, sizeof(glm::vec4));
+			std::memcpy(&material.ambientColour, colours + sizeof(glm::vec4), sizeof(glm::vec4));
+			std::memcpy(&material.emissiveColour, colours + sizeof(glm::vec4) * 2, sizeof(glm::vec4));
+			std::memcpy(&material.specularColour, colours + sizeof(glm::vec4) * 3, sizeof(glm::vec4));
+			std::memcpy(&material.specularFactor, colours + sizeof(glm::vec4) * 4, sizeof(float));
+			return true;
+		}
+
+		void WriteMesh(CacheWriter& writer, const Mesh& mesh)
+		{
+			writer.String(mesh.name);
+			writer.U32((unsigned int)mesh.materialIndex);
+			writer.Bytes(&mesh.boundingBox, sizeof(BoundingBox));
+			writer.Bytes(&mesh.boundingSphere, sizeof(BoundingSphere));
+			writer.Array(mesh.vertices);
+			writer.Array(mesh.normals);
+			writer.Array(mesh.uvCoords);
+			writer.Array(mesh.elements);
+			writer.Array(mesh.meshlets);
+			writer.Array(mesh.lodElements);
+			writer.Array(mesh.lods);
+			writer.Array(mesh.boneIndices);
+			writer.Array(mesh.boneWeights);
+			writer.Array(mesh.bones);
+		}
+
+		// Per vertex streams must match the vertex count, or be absent
+		template<typename T>
+		bool PerVertex(const Span<T>& values, size_t numVertices)
+		{
+			return values.empty() || values.size() == numVertices;
+		}
+
+		bool ElementsInside(const Span<unsigned int>& elements, size_t numVertices)
+		{
+			for (unsigned int element : elements)
+			{
+				if (element >= numVertices)
+					return false;
+			}
+			return true;
+		}
+
+		template<typename T>
+		bool RangesInside(const Span<T>& ranges, size_t numElements)
+		{
+			for (const T& range : ranges)
+			{
+				if (range.firstElement > numElements || range.numElements > numElements - range.firstElement)
+					return false;
+			}
+			return true;
+		}
+
+		// Everything the renderer indexes with must stay inside the mesh, anything else is a corrupt file
+		bool ValidMesh(const Mesh& mesh, size_t numMaterials)
+		{
+			const size_t numVertices{ mesh.vertices.size() };
+			if (!PerVertex(mesh.normals, numVertices) ||
+				!PerVertex(mesh.uvCoords, numVertices) ||
+				!PerVertex(mesh.boneIndices, numVertices) ||
+				!PerVertex(mesh.boneWeights, numVertices) ||
+				mesh.materialIndex >= numMaterials ||
+				!ElementsInside(mesh.elements, numVertices) ||
+				!ElementsInside(mesh.lodElements, numVertices) ||
+				!RangesInside(mesh.meshlets, mesh.elements.size()) ||
+				!RangesInside(mesh.lods, mesh.lodElements.size()))
+				return false;
+
+			for (const glm::u8vec4& indices : mesh.boneIndices)
+			{
+				for (int i = 0; i < 4; i++)
+				{
+					if (indices[i] >= mesh.bones.size())
+						return false;
+				}
+			}
+			return true;
+		}
+
+		bool ReadMesh(CacheReader& reader, Mesh& mesh, size_t numMaterials)
+		{
+			unsigned int materialIndex{ 0 };
+			const unsigned char* bounds{ nullptr };
+			if (!reader.String(mesh.name) || !reader.U32(materialIndex) ||
+				!(bounds = reader.Bytes(sizeof(BoundingBox) + sizeof(BoundingSphere))))
+				return false;
+
+			mesh.materialIndex = materialIndex;
+
+			// Stored at import so a warm load never has to scan the vertices
+			std::memcpy(&mesh.boundingBox, bounds, sizeof(BoundingBox));
+			std::memcpy(&mesh.boundingSphere, bounds + sizeof(BoundingBox), sizeof(BoundingSphere));
+
+			return reader.Array(mesh.vertices) &&
+				reader.Array(mesh.normals) &&
+				reader.Array(mesh.uvCoords) &&
+				reader.Array(mesh.elements) &&
+				reader.Array(mesh.meshlets) &&
+				reader.Array(mesh.lodElements) &&
+				reader.Array(mesh.lods) &&
+				reader.Array(mesh.boneIndices) &&
+				reader.Array(mesh.boneWeights) &&
+				reader.Array(mesh.bones) &&
+				ValidMesh(mesh, numMaterials);
+		}
+
+		// Nodes are stored flat in the same depth first order as the hierarchy
+		void WriteNodes(CacheWriter& writer, const NodeHierarchy& hierarchy)
+		{
+			writer.U32((unsigned int)hierarchy.NumNodes());
+
+			for (size_t i = 0; i < hierarchy.NumNodes(); i++)
+			{
+				const Node& node{ hierarchy.GetNode(i) };
+				writer.String(node.name);
+				writer.Bytes(&node.transform, sizeof(glm::mat4));
+				writer.Bytes(&node.parentIndex, sizeof(int));
+				writer.Array(hierarchy.GetMeshIndices(i));
+			}
+		}
+
+		bool ReadNodes(CacheReader& reader, NodeHierarchy& hierarchy)
+		{
+			unsigned int numNodes{ 0 };
+			if (!reader.U32(numNodes))
+				return false;
+
+			for (unsigned int i = 0; i < numNodes; i++)
+			{
+				std::string name;
+				const unsigned char* transform{ nullptr };
+				const unsigned char* parent{ nullptr };
+				Span<unsigned int> meshIndices;
+				if (!reader.String(name) ||
+					!(transform = reader.Bytes(sizeof(glm::mat4))) ||
+					!(parent = reader.Bytes(sizeof(int))) ||
+					!reader.Array(meshIndices))
+					return false;
+
+				glm::mat4 localTransform;
+				int parentIndex{ 0 };
+				std::memcpy(&localTransform, transform, sizeof(glm::mat4));
+				std::memcpy(&parentIndex, parent, sizeof(int));
+
+				// Parents must come first, anything else is a corrupt file
+				if (parentIndex >= (int)i || (parentIndex < 0) != (i == 0))
+					return false;
+
+				hierarchy.AddNode(name, localTransform, parentIndex, meshIndices.data(), (unsigned int)meshIndices.size());
+			}
+
+			hierarchy.UpdateWorldTransforms(false);
+			return numNodes > 0;
+		}
+
+		template<typename T>
+		void WriteKeys(CacheWriter& writer, const KeyArrays<T>& keys)
+		{
+			writer.Array(keys.times);
+			writer.Array(keys.values);
+		}
+
+		template<typename T>
+		bool ReadKeys(CacheReader& reader, KeyArrays<T>& keys)
+		{
+			return reader.Array(keys.times) && reader.Array(keys.values) && keys.times.size() == keys.values.size();
+		}
+
+		bool RangeInside(const KeyRange& range, size_t numKeys)
+		{
+			return range.first <= numKeys && range.count <= numKeys - range.first;
+		}
+
+		void WriteAnimations(CacheWriter& writer, const std::vector<AnimationClip>& animations)
+		{
+			writer.U32((unsigned int)animations.size());
+
+			for (const AnimationClip& clip : animations)
+			{
+				writer.String(clip.name);
+				writer.Bytes(&clip.duration, sizeof(float));
+				writer.Array(clip.channels);
+				WriteKeys(writer, clip.positions);
+				WriteKeys(writer, clip.rotations);
+				WriteKeys(writer, clip.scalings);
+			}
+		}
+
+		// Key arrays are copied out of the mapping as the clips own their keys
+		bool ReadAnimations(CacheReader& reader, const NodeHierarchy& hierarchy, std::vector<AnimationClip>& animations)
+		{
+			unsigned int numAnimations{ 0 };
+			if (!reader.U32(numAnimations))
+				return false;
+
+			animations.resize(numAnimations);
+			for (AnimationClip& clip : animations)
+			{
+				const unsigned char* duration{ nullptr };
+				if (!reader.String(clip.name) || !(duration = reader.Bytes(sizeof(float))) ||
+					!reader.Array(clip.channels) ||
+					!ReadKeys(reader, clip.positions) ||
+					!ReadKeys(reader, clip.rotations) ||
+					!ReadKeys(reader, clip.scalings))
+					return false;
+
+				std::memcpy(&clip.duration, duration, sizeof(float));
+
+				for (const AnimationChannel& channel : clip.channels)
+				{
+					if (channel.nodeIndex >= hierarchy.NumNodes() ||
+						!RangeInside(channel.positions, clip.positions.times.size()) ||
+						!RangeInside(channel.rotations, clip.rotations.times.size()) ||
+						!RangeInside(channel.scalings, clip.scalings.times.size()))
+						return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	// Hash the import settings that affect the output so a change invalidates the cache (FNV-1a)
+	unsigned long long MeshCache::HashSettings(const void* data, size_t numBytes, unsigned long long hash)
+	{
+		const unsigned char* bytes{ (const unsigned char*)data };
+		for (size_t i = 0; i < numBytes; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Cache filename used for a given source asset, named after the settings too so each import profile keeps its own cache
+	std::string MeshCache::CacheFilename(const std::string& sourceFilename, const MeshCacheKey& key)
+	{
+		char settings[17];
+		std::snprintf(settings, sizeof(settings), "%016llx", key.settingsHash);
+		return sourceFilename + "." + settings + ".meshcache";
+	}
+
+	// Populate loader from the cache file if it exists and matches key. Returns false if missing, stale or corrupt.
+	bool MeshCache::Read(ModelLoader& loader, const std::string& cacheFilename, const MeshCacheKey& key)
+	{
+		MappedFile file;
+		if (!file.Open(cacheFilename) || file.Size() < sizeof(CacheHeader))
+			return false;
+
+		CacheHeader header;
+		std::memcpy(&header, file.Data(), sizeof(header));
+
+		if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+			header.version != kVersion ||
+			header.sourceModifiedTime != key.sourceStamp.modifiedTime ||
+			header.sourceSize != key.sourceStamp.size ||
+			header.settingsHash != key.settingsHash)
+			return false;
+
+		// The counts come from the file, so check they could fit in what is left before allocating for them
+		const size_t remainingBytes{ file.Size() - sizeof(header) };
+		if ((unsigned long long)header.numMaterials * kMinMaterialBytes + (unsigned long long)header.numMeshes * kMinMeshBytes > remainingBytes)
+			return false;
+
+		CacheReader reader(file.Data() + sizeof(header), remainingBytes);
+
+		std::vector<Material> materials(header.numMaterials);
+		for (Material& material : materials)
+		{
+			if (!ReadMaterial(reader, material))
+				return false;
+		}
+
+		std::vector<Mesh> meshes(header.numMeshes);
+		for (Mesh& mesh : meshes)
+		{
+			if (!ReadMesh(reader, mesh, materials.size()))
+				return false;
+		}
+
+		NodeHierarchy nodeHierarchy;
+		if (!ReadNodes(reader, nodeHierarchy))
+			return false;
+
+		std::vector<AnimationClip> animations;
+		if (!ReadAnimations(reader, nodeHierarchy, animations))
+			return false;
+
+		// A bone pointing outside the hierarchy means a corrupt file
+		for (const Mesh& mesh : meshes)
+		{
+			for (const Bone& bone : mesh.bones)
+			{
+				if (bone.nodeIndex >= nodeHierarchy.NumNodes())
+					return false;
+			}
+		}
+
+		// The mesh spans point into the mapping so the loader takes ownership of it
+		loader.m_materials = std::move(materials);
+		loader.m_meshVector = std::move(meshes);
+		loader.m_arena.clear();
+		loader.m_meshlets.clear();
+		loader.m_lodElements.clear();
+		loader.m_lods.clear();
+		loader.m_bones.clear();
+		loader.m_mappedFile = std::move(file);
+		loader.m_streamsInPlace = false;
+		loader.m_nodeHierarchy = std::move(nodeHierarchy);
+		loader.m_animations = std::move(animations);
+		loader.CalculateModelBounds();
+
+		return true;
+	}
+
+	// Write the contents of loader to the cache file. Returns false on error.
+	bool MeshCache::Write(const ModelLoader& loader, const std::string& cacheFilename, const MeshCacheKey& key)
+	{
+		return WriteFileAtomically(cacheFilename, [&](std::ostream& out)
+		{
+			CacheHeader header{};
+			std::memcpy(header.magic, kMagic, sizeof(kMagic));
+			header.version = kVersion;
+			header.sourceModifiedTime = key.sourceStamp.modifiedTime;
+			header.sourceSize = key.sourceStamp.size;
+			header.settingsHash = key.settingsHash;
+			header.numMaterials = (unsigned int)loader.m_materials.size();
+			header.numMeshes = (unsigned int)loader.m_meshVector.size();
+			out.write((const char*)&header, sizeof(header));
+
+			CacheWriter writer(out);
+
+			for (const Material& material : loader.m_materials)
+				WriteMaterial(writer, material);
+
+			for (const Mesh& mesh : loader.m_meshVector)
+				WriteMesh(writer, mesh);
+
+			WriteNodes(writer, loader.m_nodeHierarchy);
+			WriteAnimations(writer, loader.m_animations);
+		});
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+// Binary cache of imported model data, written beside the source asset so later runs can skip Assimp
+
+#include "ExternalLibraryHeaders.h"
+#include "Helper.h"
+
+namespace Helpers
+{
+	class ModelLoader;
+
+	// Identifies the exact source file and import settings a cache was built from
+	struct MeshCacheKey
+	{
+		FileStamp sourceStamp;
+		unsigned long long settingsHash{ 0 };
+	};
+
+	// Reads and writes the versioned binary mesh cache
+	// All data is 4 byte aligned so a warm load points the mesh spans straight into the memory mapping
+	class MeshCache
+	{
+	public:
+		// Bump whenever the layout written by Write changes, older caches are then ignored
+		static const unsigned int kVersion{ 7 };
+
+		// Cache filename used for a given source asset, named after the settings too so each import profile keeps its own cache
+		static std::string CacheFilename(const std::string& sourceFilename, const MeshCacheKey& key);
+
+		// Hash the import settings that affect the output so a change invalidates the cache
+		static unsigned long long HashSettings(const void* data, size_t numBytes, unsigned long long hash = 14695981039346656037ull);
+
+		// Populate loader from the cache file if it exists and matches key. Returns false if missing, stale or corrupt.
+		static bool Read(ModelLoader& loader, const std::string& cacheFilename, const MeshCacheKey& key);
+
+		// Write the contents of loader to the cache file. Returns false on error.
+		static bool Write(const ModelLoader& loader, const std::string& cacheFilename, const MeshCacheKey& key);
+	};
+}
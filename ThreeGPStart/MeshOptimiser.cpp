@@ -0,0 +1,319 @@
+#include "MeshOptimiser.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Forsyth's scoring parameters, the scoring cache is an LRU a little larger than real hardware
+		const int kScoringCacheSize{ 32 };
+		const float kCacheDecayPower{ 1.5f };
+		const float kLastTriangleScore{ 0.75f };
+		const float kValenceBoostScale{ 2.0f };
+		const float kValenceBoostPower{ 0.5f };
+
+		// Higher for vertices recently used and for vertices with few triangles left, so they are finished off
+		float VertexScore(int cachePosition, unsigned int remainingTriangles)
+		{
+			if (remainingTriangles == 0)
+				return -1.0f;
+
+			float score{ 0 };
+			if (cachePosition >= 0)
+			{
+				// The last triangle's vertices score a little lower so the strip does not just turn back on itself
+				if (cachePosition < 3)
+					score = kLastTriangleScore;
+				else
+					score = std::pow(1.0f - (float)(cachePosition - 3) / (kScoringCacheSize - 3), kCacheDecayPower);
+			}
+
+			return score + kValenceBoostScale * std::pow((float)remainingTriangles, -kValenceBoostPower);
+		}
+
+		// FIFO cache simulated with timestamps, a vertex is still cached if fewer than cacheSize misses happened since it was loaded
+		class FifoCache
+		{
+		private:
+			std::vector<unsigned int> m_timestamps;
+			unsigned int m_time;
+			unsigned int m_cacheSize;
+		public:
+			FifoCache(size_t numVertices, unsigned int cacheSize) :
+				m_timestamps(numVertices, 0), m_time(cacheSize + 1), m_cacheSize(cacheSize) {}
+
+			// Returns 1 if the vertex had to be transformed
+			unsigned int Access(unsigned int vertex)
+			{
+				if (m_time - m_timestamps[vertex] <= m_cacheSize)
+					return 0;
+				m_timestamps[vertex] = m_time++;
+				return 1;
+			}
+
+			// Forget everything, as if the cache had been flushed
+			void Reset() { m_time += m_cacheSize + 1; }
+		};
+	}
+
+	// Simulate a FIFO vertex cache over the elements
+	VertexCacheStats AnalyseVertexCache(const unsigned int* elements, size_t numElements, size_t numVertices, unsigned int cacheSize)
+	{
+		VertexCacheStats stats;
+		stats.numTriangles = numElements / 3;
+
+		FifoCache cache(numVertices, cacheSize);
+		std::vector<unsigned char> used(numVertices, 0);
+		for (size_t i = 0; i < numElements; i++)
+		{
+			stats.numTransformed += cache.Access(elements[i]);
+			if (!used[elements[i]])
+			{
+				used[elements[i]] = 1;
+				stats.numVertices++;
+			}
+		}
+
+		return stats;
+	}
+
+	// Reorder triangles so recently used vertices are reused while still in the cache (Forsyth's linear speed method)
+	void OptimiseVertexCache(unsigned int* destination, const unsigned int* elements, size_t numElements, size_t numVertices)
+	{
+		const size_t numTriangles{ numElements / 3 };
+		if (numTriangles == 0)
+			return;
+
+		// Triangles using each vertex, the first remaining[v] entries of a vertex's range are the ones not yet emitted
+		std::vector<unsigned int> adjacencyOffsets(numVertices + 1, 0);
+		for (size_t i = 0; i < numTriangles * 3; i++)
+			adjacencyOffsets[elements[i] + 1]++;
+		for (size_t v = 0; v < numVertices; v++)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+		std::vector<unsigned int> adjacentTriangles(numTriangles * 3);
+		std::vector<unsigned int> remaining(numVertices, 0);
+		for (size_t i = 0; i < numTriangles * 3; i++)
+		{
+			const unsigned int v{ elements[i] };
+			adjacentTriangles[adjacencyOffsets[v] + remaining[v]++] = (unsigned int)(i / 3);
+		}
+
+		std::vector<int> cachePosition(numVertices, -1);
+		std::vector<float> vertexScore(numVertices);
+		for (size_t v = 0; v < numVertices; v++)
+			vertexScore[v] = VertexScore(-1, remaining[v]);
+
+		std::vector<float> triangleScore(numTriangles);
+		for (size_t t = 0; t < numTriangles; t++)
+			triangleScore[t] = vertexScore[elements[t * 3]] + vertexScore[elements[t * 3 + 1]] + vertexScore[elements[t * 3 + 2]];
+
+		std::vector<unsigned char> emitted(numTriangles, 0);
+		std::vector<unsigned int> result;
+		result.reserve(numTriangles * 3);
+
+		std::vector<unsigned int> cache;
+		std::vector<unsigned int> newCache;
+		cache.reserve(kScoringCacheSize + 3);
+		newCache.reserve(kScoringCacheSize + 3);
+
+		size_t best{ (size_t)(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin()) };
+		size_t nextUnemitted{ 0 };
+
+		for (size_t numEmitted = 0; numEmitted < numTriangles; numEmitted++)
+		{
+			// Nothing in the cache has triangles left, carry on from the next triangle in input order
+			if (best == numTriangles)
+			{
+				while (emitted[nextUnemitted])
+					nextUnemitted++;
+				best = nextUnemitted;
+			}
+
+			const unsigned int* triangle{ &elements[best * 3] };
+			result.insert(result.end(), triangle, triangle + 3);
+			emitted[best] = 1;
+
+			// Take the triangle off its vertices' remaining lists
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const unsigned int v{ triangle[corner] };
+				unsigned int* list{ &adjacentTriangles[adjacencyOffsets[v]] };
+				const unsigned int* found{ std::find(list, list + remaining[v], (unsigned int)best) };
+				std::swap(list[found - list], list[remaining[v] - 1]);
+				remaining[v]--;
+			}
+
+			// The triangle's vertices move to the front of the LRU cache
+			newCache.assign(triangle, triangle + 3);
+			for (unsigned int v : cache)
+			{
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+					newCache.push_back(v);
+			}
+
+			// Rescore everything that moved, including vertices pushed out the end, and pass the change on to their triangles
+			for (size_t i = 0; i < newCache.size(); i++)
+			{
+				const unsigned int v{ newCache[i] };
+				cachePosition[v] = i < (size_t)kScoringCacheSize ? (int)i : -1;
+
+				const float score{ VertexScore(cachePosition[v], remaining[v]) };
+				const float change{ score - vertexScore[v] };
+				vertexScore[v] = score;
+
+				for (unsigned int a = 0; a < remaining[v]; a++)
+					triangleScore[adjacentTriangles[adjacencyOffsets[v] + a]] += change;
+			}
+
+			if (newCache.size() > (size_t)kScoringCacheSize)
+				newCache.resize(kScoringCacheSize);
+			cache.swap(newCache);
+
+			// Best next triangle is one touching the cache
+			best = numTriangles;
+			float bestScore{ -1.0f };
+			for (unsigned int v : cache)
+			{
+				for (unsigned int a = 0; a < remaining[v]; a++)
+				{
+					const unsigned int t{ adjacentTriangles[adjacencyOffsets[v] + a] };
+					if (triangleScore[t] > bestScore)
+					{
+						bestScore = triangleScore[t];
+						best = t;
+					}
+				}
+			}
+		}
+
+		std::copy(result.begin(), result.end(), destination);
+	}
+
+	// Reorder runs of cache optimised triangles so those facing out from the mesh centre draw first
+	void OptimiseOverdraw(unsigned int* destination, const unsigned int* elements, size_t numElements,
+		const glm::vec3* vertices, size_t numVertices, float threshold)
+	{
+		const size_t numTriangles{ numElements / 3 };
+		if (numTriangles == 0)
+			return;
+
+		FifoCache cache(numVertices, kVertexCacheSize);
+		auto triangleMisses = [&](size_t t)
+		{
+			return cache.Access(elements[t * 3]) + cache.Access(elements[t * 3 + 1]) + cache.Access(elements[t * 3 + 2]);
+		};
+
+		// A triangle missing on all three vertices starts a new run, reordering there costs nothing
+		std::vector<size_t> hardStarts;
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			if (triangleMisses(t) == 3)
+				hardStarts.push_back(t);
+		}
+		hardStarts.push_back(numTriangles);
+
+		// Split runs further wherever the part so far already matches the run's cache efficiency
+		std::vector<size_t> clusterStarts;
+		for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+		{
+			const size_t start{ hardStarts[h] };
+			const size_t end{ hardStarts[h + 1] };
+
+			cache.Reset();
+			size_t runMisses{ 0 };
+			for (size_t t = start; t < end; t++)
+				runMisses += triangleMisses(t);
+			const float clusterThreshold{ threshold * runMisses / (end - start) };
+
+			cache.Reset();
+			clusterStarts.push_back(start);
+			size_t clusterMisses{ 0 };
+			size_t clusterSize{ 0 };
+			for (size_t t = start; t < end; t++)
+			{
+				clusterMisses += triangleMisses(t);
+				clusterSize++;
+
+				if (t + 1 < end && clusterMisses <= clusterThreshold * clusterSize)
+				{
+					clusterStarts.push_back(t + 1);
+					cache.Reset();
+					clusterMisses = 0;
+					clusterSize = 0;
+				}
+			}
+		}
+		clusterStarts.push_back(numTriangles);
+
+		const size_t numClusters{ clusterStarts.size() - 1 };
+
+		// Area weighted centres of each cluster and of the whole mesh
+		std::vector<glm::vec3> clusterCentres(numClusters, glm::vec3(0));
+		std::vector<glm::vec3> clusterNormals(numClusters, glm::vec3(0));
+		glm::vec3 meshCentre{ 0 };
+		float meshArea{ 0 };
+
+		for (size_t c = 0; c < numClusters; c++)
+		{
+			float clusterArea{ 0 };
+			for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+			{
+				const glm::vec3& p0{ vertices[elements[t * 3]] };
+				const glm::vec3& p1{ vertices[elements[t * 3 + 1]] };
+				const glm::vec3& p2{ vertices[elements[t * 3 + 2]] };
+				const glm::vec3 normal{ glm::cross(p1 - p0, p2 - p0) };
+				const float area{ glm::length(normal) };
+
+				clusterCentres[c] += (p0 + p1 + p2) * (area / 3.0f);
+				clusterNormals[c] += normal;
+				clusterArea += area;
+			}
+
+			meshCentre += clusterCentres[c];
+			meshArea += clusterArea;
+			if (clusterArea > 0)
+				clusterCentres[c] /= clusterArea;
+		}
+		if (meshArea > 0)
+			meshCentre /= meshArea;
+
+		// Clusters far out and facing away from the centre are the likeliest to cover the others
+		std::vector<float> sortKeys(numClusters, 0.0f);
+		for (size_t c = 0; c < numClusters; c++)
+		{
+			const float normalLength{ glm::length(clusterNormals[c]) };
+			if (normalLength > 0)
+				sortKeys[c] = glm::dot(clusterCentres[c] - meshCentre, clusterNormals[c] / normalLength);
+		}
+
+		std::vector<size_t> order(numClusters);
+		for (size_t c = 0; c < numClusters; c++)
+			order[c] = c;
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		for (size_t c : order)
+		{
+			const unsigned int* first{ elements + clusterStarts[c] * 3 };
+			const unsigned int* last{ elements + clusterStarts[c + 1] * 3 };
+			destination = std::copy(first, last, destination);
+		}
+	}
+
+	// Build a remap that numbers vertices in the order the elements first use them
+	size_t BuildVertexFetchRemap(unsigned int* remap, const unsigned int* elements, size_t numElements, size_t numVertices)
+	{
+		std::fill(remap, remap + numVertices, ~0u);
+
+		unsigned int nextVertex{ 0 };
+		for (size_t i = 0; i < numElements; i++)
+		{
+			if (remap[elements[i]] == ~0u)
+				remap[elements[i]] = nextVertex++;
+		}
+
+		return nextVertex;
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+// Triangle and vertex reordering for faster drawing: post-transform vertex cache, overdraw and vertex fetch
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+
+	// Size of the FIFO cache used when measuring, a conservative match for current hardware
+	const unsigned int kVertexCacheSize{ 16 };
+
+	// How well an element order uses the post-transform vertex cache
+	struct VertexCacheStats
+	{
+		size_t numTriangles{ 0 };
+		size_t numVertices{ 0 };
+
+		// Vertices the cache had to transform
+		size_t numTransformed{ 0 };
+
+		// Average cache miss ratio, transformed vertices per triangle. 0.5 is ideal for a large grid, 3 the worst.
+		float Acmr() const { return numTriangles ? (float)numTransformed / numTriangles : 0; }
+
+		// Average transform to vertex ratio, 1 is ideal
+		float Atvr() const { return numVertices ? (float)numTransformed / numVertices : 0; }
+
+		// Combine with the stats of another mesh
+		void Add(const VertexCacheStats& other) {
+			numTriangles += other.numTriangles;
+			numVertices += other.numVertices;
+			numTransformed += other.numTransformed;
+		}
+	};
+
+	// Simulate a FIFO vertex cache over the elements
+	VertexCacheStats AnalyseVertexCache(const unsigned int* elements, size_t numElements, size_t numVertices,
+		unsigned int cacheSize = kVertexCacheSize);
+
+	// Reorder triangles so recently used vertices are reused while still in the cache (Forsyth's linear speed method)
+	// destination may be the same as elements
+	void OptimiseVertexCache(unsigned int* destination, const unsigned int* elements, size_t numElements, size_t numVertices);
+
+	// Reorder runs of cache optimised triangles so those facing out from the mesh centre, which tend to hide the rest,
+	// draw first from most viewpoints. Runs are only split where the cache miss ratio stays within threshold times the
+	// input's. destination may not be the same as elements.
+	void OptimiseOverdraw(unsigned int* destination, const unsigned int* elements, size_t numElements,
+		const glm::vec3* vertices, size_t numVertices, float threshold = 1.05f);
+
+	// Build a remap that numbers vertices in the order the elements first use them, so vertex fetches walk forward
+	// through memory. Unused vertices get ~0u. Returns the number of vertices used.
+	size_t BuildVertexFetchRemap(unsigned int* remap, const unsigned int* elements, size_t numElements, size_t numVertices);
+
+	// Apply a remap from BuildVertexFetchRemap to a vertex stream, in place
+	template<typename T>
+	void RemapVertices(T* vertices, size_t numVertices, const unsigned int* remap)
+	{
+		std::vector<T> original(vertices, vertices + numVertices);
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			if (remap[v] != ~0u)
+				vertices[remap[v]] = original[v];
+		}
+	}
+
+	// Apply a remap from BuildVertexFetchRemap to elements, in place
+	inline void RemapElements(unsigned int* elements, size_t numElements, const unsigned int* remap)
+	{
+		for (size_t i = 0; i < numElements; i++)
+			elements[i] = remap[elements[i]];
+	}
+
+}
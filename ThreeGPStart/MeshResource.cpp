@@ -0,0 +1,669 @@
+#include "MeshResource.h"
+#include "Helper.h"
+#include "MaterialLibrary.h"
+
+#include <cstddef>
+
+MeshResource::~MeshResource()
+{
+
+	if (m_reload.valid()) //The import in flight writes into m_reloadedLoader
+	{
+		m_reload.wait();
+	}
+
+	ReleaseBuffers();
+
+}
+
+void MeshResource::ReleaseBuffers()
+{
+
+	for (const MyMesh& mesh : m_meshes)
+	{
+		glDeleteVertexArrays(1, &mesh.VAO);
+	}
+	m_meshes.clear();
+
+	if (!m_buffers.empty())
+	{
+		glDeleteBuffers((GLsizei)m_buffers.size(), m_buffers.data());
+	}
+	m_buffers.clear();
+
+}
+
+bool MeshResource::Load(Helpers::ThreadPool* threadPool)
+{
+
+	//Later callers wait here for the first import to finish then share its result
+	std::lock_guard<std::mutex> lock(m_loadMutex);
+
+	if (!m_loadAttempted)
+	{
+		m_loadAttempted = true;
+		m_loaded = m_loader->LoadFromFile(m_filename, m_profile, threadPool);
+	}
+
+	return m_loaded;
+
+}
+
+namespace
+{
+
+	//Create a buffer holding numBytes of data, record it for deletion and count its memory against mesh
+	GLuint CreateBuffer(GLenum target, size_t numBytes, const void* data, std::vector<GLuint>& buffers, MyMesh& mesh)
+	{
+
+		GLuint buffer;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(target, buffer);
+		glBufferData(target, numBytes, data, GL_STATIC_DRAW);
+		glBindBuffer(target, 0);
+
+		buffers.push_back(buffer);
+		mesh.gpuBytes += numBytes;
+
+		return buffer;
+
+	}
+
+	//Create the element buffer with the full elements followed by every level of detail's
+	GLuint CreateElementBuffer(const Helpers::Mesh& mesh, std::vector<GLuint>& buffers, MyMesh& newMesh)
+	{
+
+		const size_t fullBytes = sizeof(GLuint) * mesh.elements.size();
+		const size_t lodBytes = sizeof(GLuint) * mesh.lodElements.size();
+
+		const GLuint buffer = CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, fullBytes + lodBytes, nullptr, buffers, newMesh);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, fullBytes, mesh.elements.data());
+		if (lodBytes)
+		{
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, fullBytes, lodBytes, mesh.lodElements.data());
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		return buffer;
+
+	}
+
+	//Tell the vertex shader how to decode a mesh's vertices and the fragment shader which material to light it with
+	void SetDecodeUniforms(const MyMesh& mesh, GLuint program)
+	{
+
+		glUniform1i(glGetUniformLocation(program, "material_index"), (GLint)mesh.materialIndex);
+
+		glUniform3fv(glGetUniformLocation(program, "position_offset"), 1, glm::value_ptr(mesh.positionOffset));
+		glUniform3fv(glGetUniformLocation(program, "position_scale"), 1, glm::value_ptr(mesh.positionScale));
+		glUniform1i(glGetUniformLocation(program, "oct_normals"), mesh.octNormals ? 1 : 0);
+		glUniform1i(glGetUniformLocation(program, "skinned"), 0);
+		glUniform1i(glGetUniformLocation(program, "instanced"), 0);
+
+	}
+
+	//Bone indices and weights for one vertex, the weights quantised to 0..255
+	struct BoneVertex
+	{
+
+		glm::u8vec4 indices;
+		glm::u8vec4 weights;
+
+	};
+
+	//Pack the bone streams into one buffer, weights are rounded then the largest takes up any rounding error so they still sum to 1
+	GLuint CreateBoneBuffer(const Helpers::Mesh& mesh, std::vector<GLuint>& buffers, MyMesh& newMesh)
+	{
+
+		std::vector<BoneVertex> vertices(mesh.boneIndices.size());
+
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+
+			const glm::vec4& weights = mesh.boneWeights[i];
+			glm::ivec4 quantised = glm::ivec4(glm::round(glm::clamp(weights, 0.0f, 1.0f) * 255.0f));
+
+			int largest = 0;
+			for (int j = 1; j < 4; j++)
+			{
+				if (weights[j] > weights[largest])
+				{
+					largest = j;
+				}
+			}
+			quantised[largest] += 255 - (quantised.x + quantised.y + quantised.z + quantised.w);
+
+			vertices[i].indices = mesh.boneIndices[i];
+			vertices[i].weights = glm::u8vec4(glm::clamp(quantised, 0, 255));
+
+		}
+
+		return CreateBuffer(GL_ARRAY_BUFFER, sizeof(BoneVertex) * vertices.size(), vertices.data(), buffers, newMesh);
+
+	}
+
+	//Stream a vertex attribute from buffer, stride 0 for tightly packed
+	void BindAttribute(GLuint index, GLuint buffer, GLint size, GLenum type, GLboolean normalised, GLsizei stride, size_t offset)
+	{
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glEnableVertexAttribArray(index);
+		glVertexAttribPointer(
+			index,              // attribute index
+			size,               // number of components in each item in the stream
+			type,               // type of the item
+			normalised,         // normalized or not (advanced)
+			stride,             // stride (advanced)
+			(void*)offset       // array buffer offset (advanced)
+		);
+
+	}
+
+}
+
+MyMesh UploadMesh(const Helpers::Mesh& mesh, Helpers::VertexEncoding encoding, std::vector<GLuint>& buffers, Helpers::VertexLayout layout)
+{
+
+	MyMesh newMesh;
+	newMesh.numElements = (GLuint)mesh.elements.size();
+	newMesh.numVertices = (GLuint)mesh.vertices.size();
+	newMesh.numBones = mesh.bones.size();
+	newMesh.meshlets = mesh.meshlets;
+	newMesh.lods = mesh.lods;
+	newMesh.boundingSphere = mesh.boundingSphere;
+
+	const size_t numVertices = mesh.vertices.size();
+	const bool interleaved = layout == Helpers::VertexLayout::Interleaved;
+
+	GLuint elementsEBO;
+
+	//Create VAO, the vertex buffers are bound to it as they are described
+	glGenVertexArrays(1, &newMesh.VAO);
+	glBindVertexArray(newMesh.VAO);
+
+	if (encoding == Helpers::VertexEncoding::Compact)
+	{
+
+		Helpers::CompactVertexData compact;
+		Helpers::EncodeCompact(mesh, compact);
+
+		if (compact.elements16.empty())
+		{
+			elementsEBO = CreateElementBuffer(mesh, buffers, newMesh);
+		}
+		else
+		{
+			elementsEBO = CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * compact.elements16.size(), compact.elements16.data(), buffers, newMesh);
+			newMesh.elementType = GL_UNSIGNED_SHORT;
+		}
+
+		newMesh.positionOffset = compact.positionOffset;
+		newMesh.positionScale = compact.positionScale;
+		newMesh.octNormals = true;
+
+		//The shader decodes positions and normals
+		if (interleaved)
+		{
+
+			std::vector<Helpers::CompactVertex> vertices;
+			Helpers::InterleaveCompact(compact, numVertices, vertices);
+
+			const GLuint vertexVBO = CreateBuffer(GL_ARRAY_BUFFER, sizeof(Helpers::CompactVertex) * vertices.size(), vertices.data(), buffers, newMesh);
+			const GLsizei stride = sizeof(Helpers::CompactVertex);
+
+			BindAttribute(0, vertexVBO, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, offsetof(Helpers::CompactVertex, position));
+			BindAttribute(1, vertexVBO, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, offsetof(Helpers::CompactVertex, normal));
+			BindAttribute(2, vertexVBO, 2, GL_HALF_FLOAT, GL_FALSE, stride, offsetof(Helpers::CompactVertex, uvCoord));
+
+		}
+		else
+		{
+
+			const GLuint positionsVBO = CreateBuffer(GL_ARRAY_BUFFER, sizeof(GLushort) * compact.positions.size(), compact.positions.data(), buffers, newMesh);
+			const GLuint normalsVBO = CreateBuffer(GL_ARRAY_BUFFER, compact.normals.size(), compact.normals.data(), buffers, newMesh);
+			const GLuint texcoordsVBO = CreateBuffer(GL_ARRAY_BUFFER, sizeof(GLushort) * compact.uvCoords.size(), compact.uvCoords.data(), buffers, newMesh);
+
+			BindAttribute(0, positionsVBO, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GLushort) * 4, 0); //Padded to 8 bytes
+			BindAttribute(1, normalsVBO, 2, compact.octNormalBits == 8 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT, GL_TRUE, 0, 0);
+			BindAttribute(2, texcoordsVBO, 2, GL_HALF_FLOAT, GL_FALSE, 0, 0);
+
+		}
+
+	}
+	else
+	{
+
+		elementsEBO = CreateElementBuffer(mesh, buffers, newMesh);
+
+		if (interleaved)
+		{
+
+			std::vector<Helpers::FullVertex> vertices;
+			Helpers::InterleaveFull(mesh, vertices);
+
+			const GLuint vertexVBO = CreateBuffer(GL_ARRAY_BUFFER, sizeof(Helpers::FullVertex) * vertices.size(), vertices.data(), buffers, newMesh);
+			const GLsizei stride = sizeof(Helpers::FullVertex);
+
+			BindAttribute(0, vertexVBO, 3, GL_FLOAT, GL_FALSE, stride, offsetof(Helpers::FullVertex, position));
+			BindAttribute(1, vertexVBO, 3, GL_FLOAT, GL_FALSE, stride, offsetof(Helpers::FullVertex, normal));
+			BindAttribute(2, vertexVBO, 2, GL_FLOAT, GL_FALSE, stride, offsetof(Helpers::FullVertex, uvCoord));
+
+		}
+		else
+		{
+
+			const GLuint positionsVBO = CreateBuffer(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.vertices.size(), mesh.vertices.data(), buffers, newMesh);
+			const GLuint normalsVBO = CreateBuffer(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.normals.size(), mesh.normals.data(), buffers, newMesh);
+			const GLuint texcoordsVBO = CreateBuffer(GL_ARRAY_BUFFER, sizeof(glm::vec2) * mesh.uvCoords.size(), mesh.uvCoords.data(), buffers, newMesh);
+
+			BindAttribute(0, positionsVBO, 3, GL_FLOAT, GL_FALSE, 0, 0);
+			BindAttribute(1, normalsVBO, 3, GL_FLOAT, GL_FALSE, 0, 0);
+			BindAttribute(2, texcoordsVBO, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+		}
+
+	}
+
+	//Only skinned meshes carry the bone streams, the shader ignores them otherwise
+	if (!mesh.bones.empty())
+	{
+
+		const GLuint bonesVBO = CreateBoneBuffer(mesh, buffers, newMesh);
+
+		glBindBuffer(GL_ARRAY_BUFFER, bonesVBO);
+		glEnableVertexAttribArray(3);
+		glVertexAttribIPointer(3, 4, GL_UNSIGNED_BYTE, sizeof(BoneVertex), (void*)offsetof(BoneVertex, indices));
+		BindAttribute(4, bonesVBO, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BoneVertex), offsetof(BoneVertex, weights));
+
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementsEBO);
+	newMesh.elementBuffer = elementsEBO;
+
+	// Clear VAO binding
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	Helpers::CheckForGLError();
+
+	return newMesh;
+
+}
+
+void MyMesh::Draw(GLuint program) const
+{
+
+	SetDecodeUniforms(*this, program);
+
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, numElements, elementType, (void*)0);
+
+	DrawStats::Current().drawCalls++;
+	DrawStats::Current().triangles += numElements / 3;
+
+}
+
+void MyMesh::DrawSkinned(GLuint program, const glm::mat4* palette) const
+{
+
+	SetDecodeUniforms(*this, program);
+	glUniform1i(glGetUniformLocation(program, "skinned"), 1);
+	glUniformMatrix4fv(glGetUniformLocation(program, "bone_palette"), (GLsizei)numBones, GL_FALSE, glm::value_ptr(palette[0]));
+
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, numElements, elementType, (void*)0);
+
+	DrawStats::Current().drawCalls++;
+	DrawStats::Current().triangles += numElements / 3;
+
+}
+
+void MyMesh::DrawLod(GLuint program, size_t lod) const
+{
+
+	if (lod == 0 || lod > lods.size())
+	{
+		Draw(program);
+		return;
+	}
+
+	const Helpers::MeshLod& level = lods[lod - 1];
+	const size_t elementSize = elementType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+	SetDecodeUniforms(*this, program);
+
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, level.numElements, elementType, (void*)((numElements + level.firstElement) * elementSize));
+
+	DrawStats::Current().drawCalls++;
+	DrawStats::Current().triangles += level.numElements / 3;
+
+}
+
+void MyMesh::DrawInstanced(GLuint program, size_t lod, GLuint instanceBuffer, GLsizei numInstances) const
+{
+
+	if (lod > lods.size())
+	{
+		lod = 0;
+	}
+
+	const GLuint count = lod == 0 ? numElements : lods[lod - 1].numElements;
+	const GLuint first = lod == 0 ? 0 : numElements + lods[lod - 1].firstElement;
+	const size_t elementSize = elementType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+	SetDecodeUniforms(*this, program);
+	glUniform1i(glGetUniformLocation(program, "instanced"), 1);
+
+	glBindVertexArray(VAO);
+
+	//The VAO is shared with every Model of the file, so each draw points it at its own instances and stops streaming them afterwards
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(kInstanceAttribute + column);
+		glVertexAttribPointer(kInstanceAttribute + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * column));
+		glVertexAttribDivisor(kInstanceAttribute + column, 1);
+	}
+
+	glDrawElementsInstanced(GL_TRIANGLES, count, elementType, (void*)(first * elementSize), numInstances);
+
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glDisableVertexAttribArray(kInstanceAttribute + column);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	DrawStats::Current().drawCalls++;
+	DrawStats::Current().triangles += (size_t)count / 3 * numInstances;
+
+}
+
+void MyMesh::DrawVisible(GLuint program, const Helpers::Frustum& frustum, const glm::vec3& cameraPosition) const
+{
+
+	if (meshlets.empty())
+	{
+		Draw(program);
+		return;
+	}
+
+	//Ranges of elements to draw, neighbouring visible meshlets are merged into one range
+	//Kept between calls to save allocating every frame, drawing only ever happens on the GL thread
+	static std::vector<GLsizei> counts;
+	static std::vector<const void*> offsets;
+	counts.clear();
+	offsets.clear();
+
+	const size_t elementSize = elementType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	unsigned int rangeEnd = ~0u;
+
+	for (const Helpers::Meshlet& meshlet : meshlets)
+	{
+
+		if (!frustum.Intersects(meshlet.boundingSphere) || Helpers::IsMeshletBackFacing(meshlet, cameraPosition))
+		{
+			continue;
+		}
+
+		if (meshlet.firstElement == rangeEnd)
+		{
+			counts.back() += meshlet.numElements;
+		}
+		else
+		{
+			counts.push_back(meshlet.numElements);
+			offsets.push_back((const void*)(meshlet.firstElement * elementSize));
+		}
+
+		rangeEnd = meshlet.firstElement + meshlet.numElements;
+
+	}
+
+	if (counts.empty())
+	{
+		return;
+	}
+
+	SetDecodeUniforms(*this, program);
+
+	glBindVertexArray(VAO);
+	glMultiDrawElements(GL_TRIANGLES, counts.data(), elementType, offsets.data(), (GLsizei)counts.size());
+
+	DrawStats::Current().drawCalls++;
+	for (GLsizei count : counts)
+	{
+		DrawStats::Current().triangles += count / 3;
+	}
+
+}
+
+bool MeshResource::Upload()
+{
+
+	if (m_uploaded)
+	{
+		return true;
+	}
+
+	if (!m_loaded)
+	{
+		return false;
+	}
+
+	size_t gpuBytes = 0;
+	size_t fullBytes = 0;
+
+	MaterialLibrary& materials = MaterialLibrary::Shared();
+	const std::vector<Helpers::Material>& loaderMaterials = m_loader->GetMaterialVector();
+
+	//Streams viewed in a mapped glTF file are uploaded straight from the mapping, one buffer per attribute,
+	//rather than gathered into a temporary interleaved copy first
+	const Helpers::VertexLayout layout = m_loader->StreamsInPlace() && m_encoding == Helpers::VertexEncoding::Full ?
+		Helpers::VertexLayout::Separate : Helpers::VertexLayout::Interleaved;
+
+	for (const Helpers::Mesh& mesh : m_loader->GetMeshVector()) //For every mesh in the Model
+	{
+
+		m_meshes.push_back(UploadMesh(mesh, m_encoding, m_buffers, layout));
+
+		if (mesh.materialIndex < loaderMaterials.size())
+		{
+			m_meshes.back().materialIndex = materials.Add(loaderMaterials[mesh.materialIndex]); //Shared with any identical material already in use
+		}
+
+		gpuBytes += m_meshes.back().gpuBytes;
+		fullBytes += Helpers::FullEncodingBytes(mesh);
+
+	}
+
+	if (!materials.Upload()) //Only sends materials not already in the buffer
+	{
+		return false;
+	}
+
+	m_uploaded = true;
+
+	//Memory report, compact against what full floats would have needed
+	std::cout << m_filename << " vertex memory: " << gpuBytes / 1024 << " KB" <<
+		(m_encoding == Helpers::VertexEncoding::Compact ? " compact, " : " full, ") <<
+		fullBytes / 1024 << " KB with full floats" << std::endl;
+
+	return true;
+
+}
+
+bool MeshResource::BeginReload(Helpers::ThreadPool& threadPool)
+{
+
+	if (!m_uploaded) //Not uploaded yet, the first load will read the new file anyway
+	{
+		return false;
+	}
+
+	if (m_reload.valid()) //Start again once the import in flight is done
+	{
+		m_reloadAgain = true;
+		return true;
+	}
+
+	//Models keep drawing the old meshes until the new import is ready
+	m_reloadedLoader.reset(new Helpers::ModelLoader);
+	Helpers::ModelLoader* loader = m_reloadedLoader.get();
+	Helpers::ThreadPool* pool = &threadPool;
+	m_reload = threadPool.Submit([this, loader, pool]() { return loader->LoadFromFile(m_filename, m_profile, pool); });
+
+	return true;
+
+}
+
+bool MeshResource::FinishReload(Helpers::ThreadPool& threadPool)
+{
+
+	if (!m_reload.valid() || m_reload.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return false;
+	}
+
+	const bool imported = m_reload.get();
+	std::unique_ptr<Helpers::ModelLoader> loader = std::move(m_reloadedLoader);
+
+	bool changed = false;
+
+	if (!imported)
+	{
+		std::cout << "Could not reload " << m_filename << ", keeping the previous meshes" << std::endl;
+	}
+	else
+	{
+		ReleaseBuffers();
+		m_loader = std::move(loader);
+		m_uploaded = false;
+
+		changed = Upload();
+		if (changed)
+		{
+			m_generation++;
+			std::cout << "Reloaded " << m_filename << std::endl;
+		}
+	}
+
+	if (m_reloadAgain)
+	{
+		m_reloadAgain = false;
+		BeginReload(threadPool);
+	}
+
+	return changed;
+
+}
+
+DrawStats& DrawStats::Current()
+{
+
+	static DrawStats stats;
+	return stats;
+
+}
+
+MeshResourceCache& MeshResourceCache::Shared()
+{
+
+	static MeshResourceCache cache;
+	return cache;
+
+}
+
+std::shared_ptr<MeshResource> MeshResourceCache::Acquire(const std::string& filename, Helpers::ImportProfile profile, Helpers::VertexEncoding encoding)
+{
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::weak_ptr<MeshResource>& entry = m_resources[std::make_tuple(Helpers::CanonicalPath(filename), profile, encoding)];
+
+	std::shared_ptr<MeshResource> resource = entry.lock(); //Still in use by another Model?
+	if (!resource)
+	{
+		resource = std::make_shared<MeshResource>(filename, profile, encoding);
+		entry = resource;
+	}
+
+	return resource;
+
+}
+
+std::vector<std::string> MeshResourceCache::GetFilenames()
+{
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<std::string> filenames;
+	for (auto& entry : m_resources)
+	{
+		if (!entry.second.expired())
+		{
+			filenames.push_back(std::get<0>(entry.first));
+		}
+	}
+
+	return filenames;
+
+}
+
+bool MeshResourceCache::BeginReload(const std::string& filename, Helpers::ThreadPool& threadPool)
+{
+
+	const std::string path = Helpers::CanonicalPath(filename);
+
+	//Each import profile and encoding of the file is its own resource
+	std::vector<std::shared_ptr<MeshResource>> resources;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& entry : m_resources)
+		{
+			std::shared_ptr<MeshResource> resource = entry.second.lock();
+			if (resource && std::get<0>(entry.first) == path)
+			{
+				resources.push_back(resource);
+			}
+		}
+	}
+
+	bool anyStarted = false;
+	for (const std::shared_ptr<MeshResource>& resource : resources)
+	{
+		anyStarted = resource->BeginReload(threadPool) || anyStarted;
+	}
+
+	return anyStarted;
+
+}
+
+bool MeshResourceCache::FinishReloads(Helpers::ThreadPool& threadPool)
+{
+
+	std::vector<std::shared_ptr<MeshResource>> resources;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& entry : m_resources)
+		{
+			std::shared_ptr<MeshResource> resource = entry.second.lock();
+			if (resource)
+			{
+				resources.push_back(resource);
+			}
+		}
+	}
+
+	bool anyChanged = false;
+	for (const std::shared_ptr<MeshResource>& resource : resources)
+	{
+		anyChanged = resource->FinishReload(threadPool) || anyChanged;
+	}
+
+	return anyChanged;
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+#include "VertexFormat.h"
+#include "Meshlets.h"
+#include "ThreadPool.h"
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+struct DrawStats //Draw calls and triangles sent by MyMesh, for measuring what culling and levels of detail save
+{
+
+	size_t drawCalls{ 0 };
+	size_t triangles{ 0 };
+
+	static DrawStats& Current(); //Counts since the last Reset, drawing only happens on the GL thread
+	void Reset() { drawCalls = 0; triangles = 0; }
+
+};
+
+const size_t kMaxPaletteBones{ 60 }; //Bones the vertex shader can skin with, must match MAX_BONES in vertex_shader.glsl
+const GLuint kInstanceAttribute{ 5 }; //First of the four vertex attributes holding an instance's transform, must match instance_xform in vertex_shader.glsl
+
+struct MyMesh //Mesh Structure
+{
+
+	GLuint VAO;
+	GLuint elementBuffer{ 0 }; //Bound to the VAO, shared by any other VAO drawing the same elements
+	GLuint numElements;
+	GLuint numVertices{ 0 };
+	GLuint textureID{ 0 };
+	GLuint materialIndex{ 0 }; //Slot in the MaterialLibrary uniform buffer, the default material unless set
+
+	GLenum elementType{ GL_UNSIGNED_INT }; //GL_UNSIGNED_SHORT when compact elements fit
+	glm::vec3 positionOffset{ 0 }; //Decode of quantised positions, identity for float positions
+	glm::vec3 positionScale{ 1 };
+	bool octNormals{ false }; //Normals are octahedral encoded
+	size_t numBones{ 0 }; //Bone indices and weights are streamed when non zero
+
+	size_t gpuBytes{ 0 }; //Vertex and element memory used
+	Helpers::BoundingSphere boundingSphere; //Bounds of the vertices in mesh space
+
+	Helpers::Span<Helpers::Meshlet> meshlets; //Clusters of the elements, held by the ModelLoader
+	Helpers::Span<Helpers::MeshLod> lods; //Coarser levels of detail, their elements follow the full ones in the element buffer
+
+	void Draw(GLuint program) const; //Set the vertex decode and material uniforms and draw
+	void DrawVisible(GLuint program, const Helpers::Frustum& frustum, const glm::vec3& cameraPosition) const; //Draw only the meshlets that are in the frustum and facing the camera, both in mesh space
+	void DrawLod(GLuint program, size_t lod) const; //Draw a level of detail, 0 is the full mesh and lod n is lods[n - 1]
+	void DrawSkinned(GLuint program, const glm::mat4* palette) const; //Draw the full mesh skinned in the vertex shader, needs numBones <= kMaxPaletteBones
+	void DrawInstanced(GLuint program, size_t lod, GLuint instanceBuffer, GLsizei numInstances) const; //Draw a level of detail once per glm::mat4 in instanceBuffer
+
+
+};
+
+//Create the VAO and buffers for a mesh in the given encoding, the buffers are added to buffers for the caller to delete
+//Interleaved gives one vertex buffer and one element buffer per mesh, separate is only kept for comparison
+MyMesh UploadMesh(const Helpers::Mesh& mesh, Helpers::VertexEncoding encoding, std::vector<GLuint>& buffers,
+	Helpers::VertexLayout layout = Helpers::VertexLayout::Interleaved);
+
+//Geometry imported from one model file, shared by every Model created from the same file and import profile
+//Holds the CPU side import and the GPU buffers, per instance state such as transforms and textures stays on the Model
+class MeshResource
+{
+
+private:
+
+	std::string m_filename;
+	Helpers::ImportProfile m_profile;
+	Helpers::VertexEncoding m_encoding;
+
+	std::unique_ptr<Helpers::ModelLoader> m_loader{ new Helpers::ModelLoader }; //CPU side data
+	std::vector<MyMesh> m_meshes; //One per loader mesh, textureID is left 0
+	std::vector<GLuint> m_buffers; //Every VBO and EBO, deleted with the resource
+
+	std::mutex m_loadMutex;
+	bool m_loadAttempted{ false };
+	bool m_loaded{ false };
+	bool m_uploaded{ false };
+
+	std::future<bool> m_reload; //Import of the file after it changed on disk, valid while in flight
+	std::unique_ptr<Helpers::ModelLoader> m_reloadedLoader; //Loader the reload imports into, swapped in once done
+	bool m_reloadAgain{ false }; //The file changed again while it was being imported
+	unsigned int m_generation{ 0 }; //Counts finished reloads so Models know to pick up the new meshes
+
+	void ReleaseBuffers(); //Delete the VAOs and buffers
+
+public:
+
+	MeshResource(const std::string& filename, Helpers::ImportProfile profile, Helpers::VertexEncoding encoding) :
+		m_filename(filename), m_profile(profile), m_encoding(encoding) {}
+	~MeshResource();
+
+	MeshResource(const MeshResource&) = delete;
+	MeshResource& operator=(const MeshResource&) = delete;
+
+	bool Load(Helpers::ThreadPool* threadPool = nullptr); //Import the model the first time it is called, safe to call from several threads at once. OBJ files are parsed across threadPool.
+	bool Upload(); //Create the GL buffers the first time it is called, GL thread only
+
+	const Helpers::ModelLoader& GetLoader() const { return *m_loader; } //Imported data
+	const std::vector<MyMesh>& GetMeshes() const { return m_meshes; } //GPU buffers, valid after Upload
+
+	bool BeginReload(Helpers::ThreadPool& threadPool); //Import the changed file again on the pool, false if not uploaded yet
+	bool FinishReload(Helpers::ThreadPool& threadPool); //Swap in a finished import and upload it, GL thread only. True if the meshes changed.
+	unsigned int GetGeneration() const { return m_generation; } //Changes whenever a reload replaces the loader and meshes
+
+};
+
+//Hands out shared MeshResources keyed by file name, import profile and vertex encoding
+//Entries are reference counted through shared_ptr and freed once no Model uses them
+class MeshResourceCache
+{
+
+private:
+
+	std::map<std::tuple<std::string, Helpers::ImportProfile, Helpers::VertexEncoding>, std::weak_ptr<MeshResource>> m_resources;
+	std::mutex m_mutex;
+
+public:
+
+	static MeshResourceCache& Shared(); //Cache used by all Models
+
+	std::shared_ptr<MeshResource> Acquire(const std::string& filename, Helpers::ImportProfile profile, Helpers::VertexEncoding encoding); //Existing resource or a new unloaded one
+
+	std::vector<std::string> GetFilenames(); //Files of the resources in use, for watching
+	bool BeginReload(const std::string& filename, Helpers::ThreadPool& threadPool); //Re-import every resource of a changed file, false if none are uploaded
+	bool FinishReloads(Helpers::ThreadPool& threadPool); //Swap in finished imports, GL thread only. True if any resource changed.
+
+};
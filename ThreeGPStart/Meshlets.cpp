@@ -0,0 +1,204 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Fill in the bounds and normal cone of a meshlet from its elements
+		void CalculateMeshletBounds(Meshlet& meshlet, const glm::vec3* vertices, const unsigned int* elements, std::vector<glm::vec3>& scratch)
+		{
+			scratch.clear();
+			for (unsigned int i = 0; i < meshlet.numElements; i++)
+				scratch.push_back(vertices[elements[meshlet.firstElement + i]]);
+
+			const BoundingBox box{ ComputeBoundingBox(scratch.data(), scratch.size()) };
+			meshlet.boundingSphere = ComputeBoundingSphere(scratch.data(), scratch.size(), box);
+
+			// The cone axis is the average facing, its width is set by the triangle facing furthest from it
+			glm::vec3 normalSum{ 0 };
+			for (size_t i = 0; i < scratch.size(); i += 3)
+			{
+				const glm::vec3 normal{ glm::cross(scratch[i + 1] - scratch[i], scratch[i + 2] - scratch[i]) };
+				const float length{ glm::length(normal) };
+				if (length > 0)
+					normalSum += normal / length;
+			}
+
+			meshlet.coneAxis = glm::vec3(0, 0, 1);
+			meshlet.coneCutoff = 1.0f;
+
+			const float sumLength{ glm::length(normalSum) };
+			if (sumLength == 0)
+				return;
+
+			const glm::vec3 axis{ normalSum / sumLength };
+			float minDot{ 1.0f };
+			for (size_t i = 0; i < scratch.size(); i += 3)
+			{
+				const glm::vec3 normal{ glm::cross(scratch[i + 1] - scratch[i], scratch[i + 2] - scratch[i]) };
+				const float length{ glm::length(normal) };
+				if (length > 0)
+					minDot = std::min(minDot, glm::dot(normal / length, axis));
+			}
+
+			// Past about 84 degrees from the axis the cone would almost never reject anything
+			if (minDot <= 0.1f)
+				return;
+
+			meshlet.coneAxis = axis;
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	// Split the triangles into meshlets of spatially close triangles, growing each from its neighbours
+	std::vector<Meshlet> BuildMeshlets(const glm::vec3* vertices, size_t numVertices, unsigned int* elements, size_t numElements,
+		unsigned int maxVertices, unsigned int maxTriangles)
+	{
+		const size_t numTriangles{ numElements / 3 };
+
+		// Triangles using each vertex, packed with offsets
+		std::vector<unsigned int> adjacencyOffsets(numVertices + 1, 0);
+		for (size_t i = 0; i < numTriangles * 3; i++)
+			adjacencyOffsets[elements[i] + 1]++;
+		for (size_t v = 0; v < numVertices; v++)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+		std::vector<unsigned int> adjacentTriangles(numTriangles * 3);
+		{
+			std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < numTriangles * 3; i++)
+				adjacentTriangles[fill[elements[i]]++] = (unsigned int)(i / 3);
+		}
+
+		// Stamps record which meshlet last used a vertex or listed a triangle as a candidate
+		const unsigned int noMeshlet{ ~0u };
+		std::vector<unsigned int> vertexStamp(numVertices, noMeshlet);
+		std::vector<unsigned int> candidateStamp(numTriangles, noMeshlet);
+		std::vector<unsigned char> emitted(numTriangles, 0);
+
+		std::vector<unsigned int> reordered;
+		reordered.reserve(numTriangles * 3);
+
+		std::vector<unsigned int> candidates;
+		std::vector<Meshlet> meshlets;
+		Meshlet current;
+		unsigned int meshletIndex{ 0 };
+		size_t nextSeed{ 0 };
+
+		auto newVertexCount = [&](size_t triangle)
+		{
+			unsigned int count{ 0 };
+			for (int corner = 0; corner < 3; corner++)
+				count += vertexStamp[elements[triangle * 3 + corner]] != meshletIndex;
+			return count;
+		};
+
+		// Centre of the triangles in the meshlet so far, ties are broken by closeness to it to keep meshlets compact
+		glm::vec3 centroidSum{ 0 };
+		auto triangleCentre = [&](size_t triangle)
+		{
+			return (vertices[elements[triangle * 3]] + vertices[elements[triangle * 3 + 1]] + vertices[elements[triangle * 3 + 2]]) / 3.0f;
+		};
+
+		auto finishMeshlet = [&]()
+		{
+			meshlets.push_back(current);
+			meshletIndex++;
+			current = Meshlet();
+			current.firstElement = (unsigned int)reordered.size();
+			candidates.clear();
+			centroidSum = glm::vec3(0);
+		};
+
+		size_t numEmitted{ 0 };
+		while (numEmitted < numTriangles)
+		{
+			// Best candidate is the neighbour adding the fewest new vertices, emitted ones are dropped as they are found
+			const glm::vec3 centroid{ current.numElements ? centroidSum / (float)(current.numElements / 3) : glm::vec3(0) };
+			size_t best{ numTriangles };
+			unsigned int bestNewVertices{ 4 };
+			float bestDistance{ 0 };
+			for (size_t c = 0; c < candidates.size();)
+			{
+				const unsigned int triangle{ candidates[c] };
+				if (emitted[triangle])
+				{
+					candidates[c] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+
+				const unsigned int newVertices{ newVertexCount(triangle) };
+				if (newVertices <= bestNewVertices)
+				{
+					const glm::vec3 offset{ triangleCentre(triangle) - centroid };
+					const float distance{ glm::dot(offset, offset) };
+					if (newVertices < bestNewVertices || distance < bestDistance)
+					{
+						best = triangle;
+						bestNewVertices = newVertices;
+						bestDistance = distance;
+					}
+				}
+				c++;
+			}
+
+			// Nothing connected left so start again from the first unused triangle
+			if (best == numTriangles)
+			{
+				while (emitted[nextSeed])
+					nextSeed++;
+				best = nextSeed;
+				bestNewVertices = newVertexCount(best);
+			}
+
+			// Full, the triangle seeds the next meshlet instead
+			if (current.numVertices + bestNewVertices > maxVertices || current.numElements / 3 + 1 > maxTriangles)
+			{
+				finishMeshlet();
+				bestNewVertices = 3;
+			}
+
+			emitted[best] = 1;
+			numEmitted++;
+			centroidSum += triangleCentre(best);
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const unsigned int vertex{ elements[best * 3 + corner] };
+				reordered.push_back(vertex);
+
+				if (vertexStamp[vertex] != meshletIndex)
+				{
+					vertexStamp[vertex] = meshletIndex;
+					current.numVertices++;
+				}
+
+				for (unsigned int a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++)
+				{
+					const unsigned int neighbour{ adjacentTriangles[a] };
+					if (!emitted[neighbour] && candidateStamp[neighbour] != meshletIndex)
+					{
+						candidateStamp[neighbour] = meshletIndex;
+						candidates.push_back(neighbour);
+					}
+				}
+			}
+			current.numElements += 3;
+		}
+
+		if (current.numElements)
+			meshlets.push_back(current);
+
+		std::copy(reordered.begin(), reordered.end(), elements);
+
+		std::vector<glm::vec3> scratch;
+		for (Meshlet& meshlet : meshlets)
+			CalculateMeshletBounds(meshlet, vertices, elements, scratch);
+
+		return meshlets;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+// Partitioning of meshes into small clusters of triangles that can be culled individually
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+
+namespace Helpers
+{
+
+	// Limits that suit mesh shading hardware, also a good size for culling
+	const unsigned int kMaxMeshletVertices{ 64 };
+	const unsigned int kMaxMeshletTriangles{ 124 };
+
+	// Split the triangles into meshlets of spatially close triangles, growing each from its neighbours
+	// elements is reordered in place so every meshlet's triangles are contiguous, the meshlets are returned in element order
+	std::vector<Meshlet> BuildMeshlets(const glm::vec3* vertices, size_t numVertices, unsigned int* elements, size_t numElements,
+		unsigned int maxVertices = kMaxMeshletVertices, unsigned int maxTriangles = kMaxMeshletTriangles);
+
+	// True if every triangle in the meshlet faces away from a camera at cameraPosition, both in the mesh's space
+	inline bool IsMeshletBackFacing(const Meshlet& meshlet, const glm::vec3& cameraPosition)
+	{
+		const glm::vec3 toCentre{ meshlet.boundingSphere.centre - cameraPosition };
+		return glm::dot(toCentre, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCentre) + meshlet.boundingSphere.radius;
+	}
+
+}
@@ -0,0 +1,215 @@
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Helpers
+{
+
+	namespace
+	{
+		// Half width of the Kaiser filter in destination texels and the window's shape, the usual choice for mip generation
+		const double kKaiserRadius{ 3.0 };
+		const double kKaiserAlpha{ 4.0 };
+
+		// Source texels and weights contributing to each destination texel along one axis
+		struct AxisWeights
+		{
+			std::vector<size_t> begin;		// Taps of destination texel i run from begin[i] to begin[i + 1]
+			std::vector<int> sources;
+			std::vector<float> weights;
+		};
+
+		// Modified Bessel function of the first kind, order 0, by its power series
+		double BesselI0(double x)
+		{
+			double sum{ 1.0 };
+			double term{ 1.0 };
+			for (int k = 1; k < 32; k++)
+			{
+				term *= (x / (2.0 * k)) * (x / (2.0 * k));
+				sum += term;
+				if (term < sum * 1e-12)
+					break;
+			}
+			return sum;
+		}
+
+		// Kaiser windowed sinc at x destination texels from the centre
+		double Kaiser(double x)
+		{
+			if (std::abs(x) >= kKaiserRadius)
+				return 0.0;
+
+			const double sinc{ x == 0.0 ? 1.0 : std::sin(glm::pi<double>() * x) / (glm::pi<double>() * x) };
+			const double t{ x / kKaiserRadius };
+			return sinc * BesselI0(kKaiserAlpha * std::sqrt(1.0 - t * t)) / BesselI0(kKaiserAlpha);
+		}
+
+		AxisWeights MakeAxisWeights(int sourceSize, int destinationSize, MipFilter filter)
+		{
+			const double scale{ (double)sourceSize / destinationSize };
+			const double radius{ filter == MipFilter::Box ? 0.5 : kKaiserRadius };
+
+			AxisWeights axis;
+			axis.begin.push_back(0);
+			for (int i = 0; i < destinationSize; i++)
+			{
+				// Centre of the destination texel in source texels
+				const double centre{ (i + 0.5) * scale };
+				const int first{ (int)std::floor(centre - radius * scale) };
+				const int last{ (int)std::ceil(centre + radius * scale) };
+
+				const size_t start{ axis.weights.size() };
+				double total{ 0 };
+				for (int s = first; s < last; s++)
+				{
+					double weight;
+					if (filter == MipFilter::Box)
+						weight = std::max(0.0, std::min(s + 1.0, centre + scale / 2) - std::max((double)s, centre - scale / 2));
+					else
+						weight = Kaiser((s + 0.5 - centre) / scale);
+
+					if (weight == 0.0)
+						continue;
+
+					axis.sources.push_back(((s % sourceSize) + sourceSize) % sourceSize);
+					axis.weights.push_back((float)weight);
+					total += weight;
+				}
+
+				for (size_t w = start; w < axis.weights.size(); w++)
+					axis.weights[w] = (float)(axis.weights[w] / total);
+
+				axis.begin.push_back(axis.weights.size());
+			}
+
+			return axis;
+		}
+
+		// sRGB byte to linear, and the linear values halfway between neighbouring bytes to convert back by search
+		struct SrgbTables
+		{
+			float toLinear[256];
+			float thresholds[255];
+
+			SrgbTables()
+			{
+				auto decode = [](double s) { return s <= 0.04045 ? s / 12.92 : std::pow((s + 0.055) / 1.055, 2.4); };
+				for (int i = 0; i < 256; i++)
+					toLinear[i] = (float)decode(i / 255.0);
+				for (int i = 0; i < 255; i++)
+					thresholds[i] = (float)decode((i + 0.5) / 255.0);
+			}
+		};
+
+		const SrgbTables& Srgb()
+		{
+			static const SrgbTables tables;
+			return tables;
+		}
+	}
+
+	// Lower case name of the filter, as used in cache keys
+	const char* MipFilterName(MipFilter filter)
+	{
+		switch (filter)
+		{
+		case MipFilter::Box: return "box";
+		case MipFilter::Kaiser: return "kaiser";
+		case MipFilter::GammaCorrect: return "gamma";
+		default: return "unknown";
+		}
+	}
+
+	// RGBA levels of a width x height image down to 1x1, packed one after another from offset 0
+	std::vector<ImageLevel> MipChainLayout(int width, int height)
+	{
+		std::vector<ImageLevel> levels;
+		size_t offset{ 0 };
+		for (;; width = std::max(1, width / 2), height = std::max(1, height / 2))
+		{
+			ImageLevel level;
+			level.width = width;
+			level.height = height;
+			level.offset = offset;
+			level.size = (size_t)width * height * 4;
+			levels.push_back(level);
+			offset += level.size;
+
+			if (width == 1 && height == 1)
+				break;
+		}
+		return levels;
+	}
+
+	// Halve a width x height RGBA image with filter. Edges wrap, as textures are sampled with GL_REPEAT.
+	void DownsampleImage(const unsigned char* source, int width, int height, unsigned char* destination, MipFilter filter, ThreadPool* threadPool)
+	{
+		const int halfWidth{ std::max(1, width / 2) };
+		const int halfHeight{ std::max(1, height / 2) };
+
+		const AxisWeights columns{ MakeAxisWeights(width, halfWidth, filter) };
+		const AxisWeights rows{ MakeAxisWeights(height, halfHeight, filter) };
+
+		const SrgbTables& srgb{ Srgb() };
+		const bool linear{ filter == MipFilter::GammaCorrect };
+		float toFloat[256];
+		for (int i = 0; i < 256; i++)
+			toFloat[i] = linear ? srgb.toLinear[i] : i / 255.0f;
+
+		// Filter across each source row, then down the columns of the result
+		std::vector<glm::vec4> across((size_t)height * halfWidth);
+
+		ParallelFor(threadPool, (size_t)height, [&](size_t y)
+		{
+			const unsigned char* row{ source + y * width * 4 };
+			glm::vec4* out{ across.data() + y * halfWidth };
+
+			for (int x = 0; x < halfWidth; x++)
+			{
+				glm::vec4 sum{ 0 };
+				for (size_t t = columns.begin[x]; t < columns.begin[x + 1]; t++)
+				{
+					const unsigned char* texel{ row + columns.sources[t] * 4 };
+					sum += columns.weights[t] * glm::vec4(toFloat[texel[0]], toFloat[texel[1]], toFloat[texel[2]], texel[3] / 255.0f);
+				}
+				out[x] = sum;
+			}
+		});
+
+		ParallelFor(threadPool, (size_t)halfHeight, [&](size_t y)
+		{
+			unsigned char* out{ destination + y * halfWidth * 4 };
+
+			for (int x = 0; x < halfWidth; x++)
+			{
+				glm::vec4 sum{ 0 };
+				for (size_t t = rows.begin[y]; t < rows.begin[y + 1]; t++)
+					sum += rows.weights[t] * across[(size_t)rows.sources[t] * halfWidth + x];
+
+				// Kaiser lobes can overshoot either side
+				sum = glm::clamp(sum, 0.0f, 1.0f);
+				for (int c = 0; c < 3; c++)
+				{
+					out[x * 4 + c] = linear
+						? (unsigned char)(std::upper_bound(srgb.thresholds, srgb.thresholds + 255, sum[c]) - srgb.thresholds)
+						: (unsigned char)(sum[c] * 255.0f + 0.5f);
+				}
+				out[x * 4 + 3] = (unsigned char)(sum[3] * 255.0f + 0.5f);
+			}
+		});
+	}
+
+	// Fill every level after the first from the one above
+	void GenerateMipChain(unsigned char* data, const std::vector<ImageLevel>& levels, MipFilter filter, ThreadPool* threadPool)
+	{
+		for (size_t i = 1; i < levels.size(); i++)
+		{
+			const ImageLevel& above{ levels[i - 1] };
+			DownsampleImage(data + above.offset, above.width, above.height, data + levels[i].offset, filter, threadPool);
+		}
+	}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+// Mip chains of RGBA images built on the CPU, so they can be filtered better than glGenerateMipmap and cached with the texture
+
+#include "ExternalLibraryHeaders.h"
+#include "TextureContainer.h"
+
+namespace Helpers
+{
+	class ThreadPool;
+
+	// Filter each mip level is made from the one above with
+	enum class MipFilter
+	{
+		Box,			// Average of the texels each covers, what glGenerateMipmap usually does
+		Kaiser,			// Kaiser windowed sinc, sharper distant textures without aliasing
+		GammaCorrect	// Kaiser applied to linear rather than sRGB colour, so dark and bright detail average to the right brightness
+	};
+
+	// Lower case name of the filter, as used in cache keys
+	const char* MipFilterName(MipFilter filter);
+
+	// RGBA levels of a width x height image down to 1x1, packed one after another from offset 0
+	std::vector<ImageLevel> MipChainLayout(int width, int height);
+
+	// Halve a width x height RGBA image with filter, destination holds max(1, width / 2) x max(1, height / 2) texels.
+	// Edges wrap, as textures are sampled with GL_REPEAT. Rows are spread across threadPool.
+	void DownsampleImage(const unsigned char* source, int width, int height, unsigned char* destination, MipFilter filter, ThreadPool* threadPool);
+
+	// Fill every level after the first from the one above, data holds level 0 and room for the rest as laid out by MipChainLayout
+	void GenerateMipChain(unsigned char* data, const std::vector<ImageLevel>& levels, MipFilter filter, ThreadPool* threadPool);
+
+}
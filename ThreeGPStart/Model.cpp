@@ -3,6 +3,9 @@
 #include "Mesh.h"
 #include "ImageLoader.h"
 
+#include <algorithm>
+#include <limits>
+
 Model::Model(const std::string& name, const float& posX, const float& posY, const float& posZ, const float& scale) : modelName(name), m_posX(posX), m_posY(posY), m_posZ(posZ), m_scale(scale)
 {
 
@@ -13,150 +16,273 @@ Model::Model(const std::string& name, const float& posX, const float& posY, cons
 Model::~Model()
 {
 
+	if (m_instanceBuffer)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+	}
+
 }
 
-bool Model::Initialise()
+bool Model::LoadTextures(Helpers::ThreadPool* threadPool, const std::vector<std::string>& filenames, size_t numPixelTextures)
 {
 
-	Helpers::ModelLoader loader;
-	Helpers::ImageLoader imageLoader;
+	TextureManager& textureManager = TextureManager::Shared();
+
+	m_textures.clear();
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		m_textures.push_back(textureManager.Acquire(filenames[i], i < numPixelTextures)); //Shared with every other Model using the same file
+	}
 
-	int counter = 0; //Counter starts at 0
+	std::vector<char> loaded(filenames.size(), 0);
 
-	if (!loader.LoadFromFile(modelName)) //Load Model
+	Helpers::ParallelFor(threadPool, filenames.size(), [&](size_t i)
+	{
+		if (threadPool && textureManager.BeginLoad(m_textures[i], *threadPool)) //Streamed in once decoded, so the Model does not wait for it
+		{
+			loaded[i] = 1;
+			return;
+		}
+
+		loaded[i] = textureManager.Load(*m_textures[i], threadPool); //Only decoded by the first Model to get here
+	});
+
+	return std::find(loaded.begin(), loaded.end(), 0) == loaded.end(); //False if any image failed
+
+}
+
+bool Model::Load(Helpers::ThreadPool* threadPool)
+{
+
+	m_meshResource = MeshResourceCache::Shared().Acquire(modelName, m_importProfile, m_vertexEncoding); //Shared with other Models of the same file
+
+	if (!m_meshResource->Load(threadPool)) //Load Model, only imported by the first Model to get here
 	{
 		return false;
 	}
 
-	for (const Helpers::Mesh& mesh : loader.GetMeshVector()) //For every mesh in the Model
+	m_localBoundingBox = m_meshResource->GetLoader().GetBoundingBox(); //Calculated once at import
+	m_localBoundingSphere = m_meshResource->GetLoader().GetBoundingSphere();
+
+	const size_t numMeshes = m_meshResource->GetLoader().GetMeshVector().size();
+
+	if (m_textureList.size() < numMeshes) //One texture per mesh
 	{
+		std::cout << "Not enough textures given for " << modelName << std::endl;
+		return false;
+	}
 
-		MyMesh newMesh;
+	std::vector<std::string> textureFiles(m_textureList.begin(), m_textureList.begin() + numMeshes);
 
-		//Create VBOs
-		GLuint positionsVBO; //Positions VBO
-		glGenBuffers(1, &positionsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, positionsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.vertices.size(), mesh.vertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return LoadTextures(threadPool, textureFiles); //Load Textures for Model
 
-		GLuint normalsVBO; //Normals VBO
-		glGenBuffers(1, &normalsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, normalsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.normals.size(), mesh.normals.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-		GLuint texcoordsVBO; //UV Coords VBO
-		glGenBuffers(1, &texcoordsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, texcoordsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * mesh.uvCoords.size(), mesh.uvCoords.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+bool Model::Upload()
+{
 
-		GLuint elementsEBO; //Elements EBO
-		glGenBuffers(1, &elementsEBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementsEBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh.elements.size(), mesh.elements.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	if (!m_meshResource->Upload()) //Only creates the buffers the first time
+	{
+		return false;
+	}
+
+	return AttachMeshes();
+
+}
+
+bool Model::AttachMeshes()
+{
+
+	m_meshGeneration = m_meshResource->GetGeneration();
+	m_localBoundingBox = m_meshResource->GetLoader().GetBoundingBox(); //A reload may have changed them
+	m_localBoundingSphere = m_meshResource->GetLoader().GetBoundingSphere();
+
+	myMeshVector.clear();
+	m_meshLods.clear();
+
+	size_t counter = 0; //Counter starts at 0
+
+	for (const MyMesh& sharedMesh : m_meshResource->GetMeshes()) //For every mesh in the Model
+	{
 
-		newMesh.numElements = mesh.elements.size();
+		MyMesh newMesh = sharedMesh; //Shared VAO, own texture
 
-		if (!imageLoader.Load(m_textureList[counter])) //Load Textures for Model
+		//Add Model textures to Model, only uploaded the first time the file is used. A reload may add meshes with no texture given.
+		if (counter < m_textures.size() && TextureManager::Shared().Upload(*m_textures[counter]))
 		{
-			return false;
+			newMesh.textureID = m_textures[counter]->GetID();
 		}
 
 		counter++; //Add 1 to counter
 
-		//Add Model textures to Model
-		glGenTextures(1, &newMesh.textureID);
-		glBindTexture(GL_TEXTURE_2D, newMesh.textureID);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, imageLoader.Width(), imageLoader.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, imageLoader.GetData());
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		//Create VAOs
-		glGenVertexArrays(1, &newMesh.VAO);
-		glBindVertexArray(newMesh.VAO);
-
-		// Bind the vertex buffer to the context (records this action in the VAO)
-		glBindBuffer(GL_ARRAY_BUFFER, positionsVBO);
-
-		// Enable the first attribute in the program (the vertices) to stream to the vertex shader
-		glEnableVertexAttribArray(0);
-
-		// Describe the make up of the vertex stream
-		glVertexAttribPointer(
-			0,                  // attribute 0
-			3,                  // size in bytes of each item in the stream
-			GL_FLOAT,           // type of the item
-			GL_FALSE,           // normalized or not (advanced)
-			0,                  // stride (advanced)
-			(void*)0            // array buffer offset (advanced)
-		);
-
-		glBindBuffer(GL_ARRAY_BUFFER, normalsVBO);
-		// Enable the normal
-		glEnableVertexAttribArray(1);
-
-		// Describe the make up of the vertex stream
-		glVertexAttribPointer(
-			1,                  // attribute 1
-			3,                  // size in bytes of each item in the stream
-			GL_FLOAT,           // type of the item
-			GL_FALSE,           // normalized or not (advanced)
-			0,                  // stride (advanced)
-			(void*)0            // array buffer offset (advanced)
-		);
-
-		glBindBuffer(GL_ARRAY_BUFFER, texcoordsVBO);
-		// Enable the normal
-		glEnableVertexAttribArray(2);
-
-		// Describe the make up of the vertex stream
-		glVertexAttribPointer(
-			2,                  // attribute 1
-			2,                  // size in bytes of each item in the stream
-			GL_FLOAT,           // type of the item
-			GL_FALSE,           // normalized or not (advanced)
-			0,                  // stride (advanced)
-			(void*)0            // array buffer offset (advanced)
-		);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementsEBO);
-
-		// Clear VAO binding
-		glBindVertexArray(0);
-
 		myMeshVector.push_back(newMesh);
 
 	}
 
+	//Skinned meshes need their own pose and palettes, the CPU path also its own vertex buffers
+	const std::vector<Helpers::Mesh>& meshes = m_meshResource->GetLoader().GetMeshVector();
+
+	m_pose = m_meshResource->GetLoader().GetNodeHierarchy();
+	m_meshNodes.assign(meshes.size(), std::vector<unsigned int>());
+	for (size_t n = 0; n < m_pose.NumNodes(); n++)
+	{
+		for (unsigned int meshIndex : m_pose.GetMeshIndices(n))
+		{
+			if (meshIndex < m_meshNodes.size())
+			{
+				m_meshNodes[meshIndex].push_back((unsigned int)n);
+			}
+		}
+	}
+
+	bool anyInstanced = false;
+	for (const std::vector<unsigned int>& nodes : m_meshNodes)
+	{
+		anyInstanced |= nodes.size() > 1;
+	}
+
+	if (anyInstanced && !m_instanceBuffer)
+	{
+		glGenBuffers(1, &m_instanceBuffer);
+	}
+
+	m_skinPalettes.assign(meshes.size(), std::vector<glm::mat4>());
+	m_skinnedMeshes.clear();
+	m_skinnedMeshes.resize(meshes.size());
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+
+		if (meshes[i].bones.empty())
+		{
+			continue;
+		}
+
+		m_skinPalettes[i].resize(meshes[i].bones.size());
+
+		if (m_skinningPath == SkinningPath::Cpu || myMeshVector[i].numBones > kMaxPaletteBones)
+		{
+			m_skinnedMeshes[i].reset(new SkinnedMesh(meshes[i], myMeshVector[i]));
+		}
+
+	}
+
+	if (!PlayAnimation(GetAnimationCount() > 0 ? 0 : -1)) //Loop the first clip if there is one
+	{
+		return false;
+	}
+
 	return true;
 
 }
 
-void Model::Render(const Helpers::Camera& camera, GLuint m_program, glm::mat4& projection_xform, glm::mat4& view_xform)
+void Model::OnAssetsReloaded()
 {
 
-	for (const auto& mesh : myMeshVector)
+	if (m_meshResource && m_meshResource->GetGeneration() != m_meshGeneration)
 	{
+		AttachMeshes(); //New meshes, which also brings the texture IDs up to date
+		return;
+	}
 
-		glm::mat4 combined_xform = projection_xform * view_xform;
+	//A reloaded texture keeps its GL texture unless it had been sharing another file's
+	for (size_t i = 0; i < myMeshVector.size() && i < m_textures.size(); i++)
+	{
+		myMeshVector[i].textureID = m_textures[i]->GetID();
+	}
 
-		// Send the combined matrix to the shader in a uniform
-		GLuint combined_xform_id = glGetUniformLocation(m_program, "combined_xform");
-		glUniformMatrix4fv(combined_xform_id, 1, GL_FALSE, glm::value_ptr(combined_xform));
+}
 
-		glm::mat4 transform = glm::translate(glm::mat4(1.0), glm::vec3(m_posX, m_posY, m_posZ));
-		glm::mat4 scale = glm::scale(glm::mat4(1.0), glm::vec3(m_scale, m_scale, m_scale));
-		glm::mat4 model_xform = transform * scale;
+bool Model::PlayAnimation(int index)
+{
 
-		// Send the model matrix to the shader in a uniform
-		GLuint model_xform_id = glGetUniformLocation(m_program, "model_xform");
-		glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
+	if (!m_meshResource || index >= (int)GetAnimationCount())
+	{
+		return false;
+	}
+
+	m_animation = std::max(index, -1);
+	m_animationTime = 0;
+	m_sampler.SetClip(m_animation < 0 ? nullptr : &m_meshResource->GetLoader().GetAnimations()[m_animation]);
+
+	m_pose = m_meshResource->GetLoader().GetNodeHierarchy(); //Back to the bind pose, also resets nodes the new clip does not animate
+	UpdateSkinPalettes(nullptr);
+
+	return true;
+
+}
+
+void Model::Update(float deltaTime, Helpers::ThreadPool* threadPool)
+{
+
+	if (m_animation < 0)
+	{
+		return;
+	}
+
+	m_animationTime += deltaTime;
+
+	m_sampler.Sample(m_animationTime, m_pose); //Writes straight into the pose's node transforms
+	m_pose.UpdateWorldTransforms();
+
+	UpdateSkinPalettes(threadPool);
+
+}
+
+void Model::UpdateSkinPalettes(Helpers::ThreadPool* threadPool)
+{
+
+	const std::vector<Helpers::Mesh>& meshes = m_meshResource->GetLoader().GetMeshVector();
+
+	for (size_t i = 0; i < m_skinPalettes.size(); i++)
+	{
+
+		if (m_skinPalettes[i].empty())
+		{
+			continue;
+		}
+
+		Helpers::ComputeSkinPalette(meshes[i].bones, m_pose, m_skinPalettes[i].data());
+
+		if (m_skinnedMeshes[i])
+		{
+			m_skinnedMeshes[i]->Skin(threadPool, meshes[i], m_skinPalettes[i].data());
+		}
+
+	}
+
+}
+
+void Model::Render(const Helpers::Camera& camera, GLuint m_program, glm::mat4& projection_xform, glm::mat4& view_xform)
+{
+
+	//Meshlets are culled in model space so the frustum and camera are taken there
+	const glm::mat4 modelTransform = GetModelTransform();
+	const Helpers::Frustum frustum = Helpers::Frustum::FromMatrix(projection_xform * view_xform * modelTransform);
+	const glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelTransform) * glm::vec4(camera.GetPosition(), 1.0f));
+
+	//Pixels covered by one unit one unit away, errors and distances are both in model space so the scale cancels out
+	GLint viewportSize[4];
+	glGetIntegerv(GL_VIEWPORT, viewportSize);
+	const float pixelsPerUnit = 0.5f * viewportSize[3] * projection_xform[1][1];
+
+	m_meshLods.resize(myMeshVector.size(), 0);
+
+	glm::mat4 combined_xform = projection_xform * view_xform;
+
+	// Send the combined matrix to the shader in a uniform
+	GLuint combined_xform_id = glGetUniformLocation(m_program, "combined_xform");
+	glUniformMatrix4fv(combined_xform_id, 1, GL_FALSE, glm::value_ptr(combined_xform));
+
+	GLuint model_xform_id = glGetUniformLocation(m_program, "model_xform");
+
+	static const std::vector<unsigned int> noNodes;
+
+	for (size_t i = 0; i < myMeshVector.size(); i++)
+	{
+
+		const MyMesh& mesh = myMeshVector[i];
+		const std::vector<unsigned int>& nodes = i < m_meshNodes.size() ? m_meshNodes[i] : noNodes;
 
 		if (mesh.textureID) //Error Catching
 		{ 
@@ -169,8 +295,110 @@ void Model::Render(const Helpers::Camera& camera, GLuint m_program, glm::mat4& p
 			glBindTexture(GL_TEXTURE_2D, 0);
 		}
 
-		glBindVertexArray(mesh.VAO);
-		glDrawElements(GL_TRIANGLES, mesh.numElements, GL_UNSIGNED_INT, (void*)0);
+		//Skinned meshes are placed by their bones rather than their node, and move away from the meshlet cones and simplified shapes, so always draw them in full
+		const bool skinned = !m_skinPalettes.empty() && !m_skinPalettes[i].empty();
+		if (skinned)
+		{
+
+			RecordTextureSize(i, mesh.boundingSphere, cameraPosition, pixelsPerUnit);
+
+			glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(modelTransform));
+
+			if (m_skinnedMeshes[i])
+			{
+				m_skinnedMeshes[i]->Upload();
+				m_skinnedMeshes[i]->Draw(m_program);
+			}
+			else
+			{
+				mesh.DrawSkinned(m_program, m_skinPalettes[i].data());
+			}
+
+			Helpers::CheckForGLError();
+			continue;
+
+		}
+
+		//A mesh used by several nodes, such as repeated wheels or windows, is drawn once for all its visible instances
+		if (nodes.size() > 1 && m_instanceBuffer)
+		{
+
+			m_instanceTransforms.clear();
+			float nearest = std::numeric_limits<float>::max();
+
+			for (unsigned int node : nodes)
+			{
+
+				const glm::mat4& nodeTransform = m_pose.GetWorldTransform(node);
+				if (!frustum.Intersects(mesh.boundingSphere.Transformed(nodeTransform)))
+				{
+					continue;
+				}
+
+				//The nearest instance picks the level of detail for them all, errors are measured in mesh space
+				const glm::vec3 meshCameraPosition = glm::vec3(glm::inverse(nodeTransform) * glm::vec4(cameraPosition, 1.0f));
+				nearest = std::min(nearest, glm::distance(meshCameraPosition, mesh.boundingSphere.centre) - mesh.boundingSphere.radius);
+
+				m_instanceTransforms.push_back(nodeTransform);
+
+			}
+
+			if (m_instanceTransforms.empty())
+			{
+				continue;
+			}
+
+			m_meshLods[i] = m_lodEnabled ? SelectLod(mesh, m_meshLods[i], pixelsPerUnit / std::max(nearest, 1e-3f)) : 0;
+
+			if (i < m_textures.size())
+			{
+				m_textures[i]->RecordDrawnSize(2.0f * mesh.boundingSphere.radius * pixelsPerUnit / std::max(nearest, 1e-3f));
+			}
+
+			glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_instanceTransforms.size(), m_instanceTransforms.data(), GL_STREAM_DRAW);
+
+			glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(modelTransform));
+			mesh.DrawInstanced(m_program, m_meshLods[i], m_instanceBuffer, (GLsizei)m_instanceTransforms.size());
+
+			Helpers::CheckForGLError();
+			continue;
+
+		}
+
+		//A mesh no node draws is taken to be in model space already
+		glm::mat4 model_xform = modelTransform;
+		Helpers::Frustum meshFrustum = frustum;
+		glm::vec3 meshCameraPosition = cameraPosition;
+
+		if (!nodes.empty())
+		{
+			const glm::mat4& nodeTransform = m_pose.GetWorldTransform(nodes[0]);
+			model_xform = modelTransform * nodeTransform;
+			meshFrustum = Helpers::Frustum::FromMatrix(combined_xform * model_xform);
+			meshCameraPosition = glm::vec3(glm::inverse(nodeTransform) * glm::vec4(cameraPosition, 1.0f));
+		}
+
+		// Send the model matrix to the shader in a uniform
+		glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
+
+		//Nearest point of the mesh bounds sets how large its error appears
+		const float distance = std::max(glm::distance(meshCameraPosition, mesh.boundingSphere.centre) - mesh.boundingSphere.radius, 1e-3f);
+		m_meshLods[i] = m_lodEnabled ? SelectLod(mesh, m_meshLods[i], pixelsPerUnit / distance) : 0;
+
+		if (meshFrustum.Intersects(mesh.boundingSphere))
+		{
+			RecordTextureSize(i, mesh.boundingSphere, meshCameraPosition, pixelsPerUnit);
+		}
+
+		if (m_meshLods[i] == 0)
+		{
+			mesh.DrawVisible(m_program, meshFrustum, meshCameraPosition); //Only the full mesh has meshlets
+		}
+		else
+		{
+			mesh.DrawLod(m_program, m_meshLods[i]);
+		}
 
 		Helpers::CheckForGLError();
 
@@ -178,6 +406,64 @@ void Model::Render(const Helpers::Camera& camera, GLuint m_program, glm::mat4& p
 
 }
 
+void Model::RecordTextureSize(size_t meshIndex, const Helpers::BoundingSphere& bounds, const glm::vec3& cameraPosition, float pixelsPerUnit)
+{
+
+	if (meshIndex >= m_textures.size())
+	{
+		return;
+	}
+
+	//Width of the bounds on screen from their nearest point, an upper bound on how many texels across the texture needs
+	const float distance = std::max(glm::distance(cameraPosition, bounds.centre) - bounds.radius, 1e-3f);
+	m_textures[meshIndex]->RecordDrawnSize(2.0f * bounds.radius * pixelsPerUnit / distance);
+
+}
+
+size_t Model::SelectLod(const MyMesh& mesh, size_t currentLod, float pixelsPerUnit) const
+{
+
+	const float hysteresis = 0.75f; //A coarser level must be this far inside the limit, so a mesh near the switching distance does not flicker between levels
+
+	auto pixelError = [&](size_t lod) { return lod == 0 ? 0.0f : mesh.lods[lod - 1].error * pixelsPerUnit; };
+
+	size_t lod = std::min(currentLod, mesh.lods.size());
+
+	while (lod > 0 && pixelError(lod) > m_lodPixelError) //Too coarse, step finer
+	{
+		lod--;
+	}
+
+	while (lod < mesh.lods.size() && pixelError(lod + 1) < m_lodPixelError * hysteresis) //Next level is comfortably within the limit
+	{
+		lod++;
+	}
+
+	return lod;
+
+}
+
+size_t Model::GetGpuBytes() const
+{
+
+	size_t gpuBytes = 0;
+	for (const MyMesh& mesh : myMeshVector)
+	{
+		gpuBytes += mesh.gpuBytes;
+	}
+	return gpuBytes;
+
+}
+
+glm::mat4 Model::GetModelTransform() const
+{
+
+	glm::mat4 transform = glm::translate(glm::mat4(1.0), glm::vec3(m_posX, m_posY, m_posZ));
+	glm::mat4 scale = glm::scale(glm::mat4(1.0), glm::vec3(m_scale, m_scale, m_scale));
+	return transform * scale;
+
+}
+
 void Model::Texture(const std::string& filename) //Add texture file name to texture vector
 {
 
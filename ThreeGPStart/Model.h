@@ -3,13 +3,21 @@
 #include "Helper.h"
 #include "ExternalLibraryHeaders.h"
 #include "Camera.h"
+#include "Mesh.h"
+#include "ImageLoader.h"
+#include "ThreadPool.h"
+#include "MeshResource.h"
+#include "TextureManager.h"
+#include "SkinnedMesh.h"
+#include "Animation.h"
 
-struct MyMesh //Mesh Structure
+#include <memory>
+
+enum class SkinningPath //Where skinned meshes have their vertices blended
 {
 
-	GLuint VAO;
-	GLuint numElements;
-	GLuint textureID{ 0 };
+	Gpu, //Bone palette sent to the vertex shader, falls back to the CPU for meshes with more than kMaxPaletteBones bones
+	Cpu //Vertices skinned across the thread pool and re-uploaded every frame
 
 };
 
@@ -25,22 +33,82 @@ protected:
 	std::vector<MyMesh> myMeshVector;
 	std::vector<std::string> m_textureList;
 
+	//Geometry shared with every other Model of the same file, this Model only adds its own textures and transform
+	std::shared_ptr<MeshResource> m_meshResource;
+
+	//Textures shared through the TextureManager, filled in by Load and uploaded by Upload
+	std::vector<std::shared_ptr<TextureResource>> m_textures;
+
+	Helpers::ImportProfile m_importProfile{ Helpers::ImportProfile::RuntimeOptimal }; //Post-processing used when importing
+	Helpers::VertexEncoding m_vertexEncoding{ Helpers::VertexEncoding::Full }; //Layout of the GPU vertex data
+
+	bool LoadTextures(Helpers::ThreadPool* threadPool, const std::vector<std::string>& filenames, size_t numPixelTextures = 0); //Acquire textures into m_textures and decode them in parallel, the first numPixelTextures are kept RGBA to read on the CPU
+
 	float m_posX{ 0 }, m_posY{ 0 }, m_posZ{ 0 }, m_scale{ 0 }; //Set initial positions for Model
 
+	//Bounds in model space, set by Load so no vertex data needs scanning afterwards
+	Helpers::BoundingBox m_localBoundingBox;
+	Helpers::BoundingSphere m_localBoundingSphere;
+
+	bool m_lodEnabled{ true }; //Draw simplified meshes when far enough away
+	float m_lodPixelError{ 1.0f }; //Most a level of detail may differ from the full mesh on screen, in pixels
+	std::vector<size_t> m_meshLods; //Level of detail each mesh drew with last frame
+
+	size_t SelectLod(const MyMesh& mesh, size_t currentLod, float pixelsPerUnit) const; //Coarsest level within m_lodPixelError, with hysteresis around currentLod
+	void RecordTextureSize(size_t meshIndex, const Helpers::BoundingSphere& bounds, const glm::vec3& cameraPosition, float pixelsPerUnit); //Tell texture streaming how large the mesh's texture was drawn
+
+	SkinningPath m_skinningPath{ SkinningPath::Gpu };
+	Helpers::NodeHierarchy m_pose; //This Model's copy of the node hierarchy, posed by the playing animation
+	int m_animation{ -1 }; //Playing clip, -1 for none
+	Helpers::AnimationSampler m_sampler; //Samples the playing clip, remembering each channel's last keys
+	std::vector<std::vector<unsigned int>> m_meshNodes; //Nodes drawing each mesh, placed by their world transform. A mesh drawn by several is instanced.
+	float m_animationTime{ 0 }; //Seconds into the playing clip
+	std::vector<std::vector<glm::mat4>> m_skinPalettes; //Per mesh bone matrices for the current pose, empty for unskinned meshes
+	std::vector<std::unique_ptr<SkinnedMesh>> m_skinnedMeshes; //Per mesh CPU skinning buffers, null unless skinned on the CPU
+
+	void UpdateSkinPalettes(Helpers::ThreadPool* threadPool); //Recalculate the palettes from m_pose and skin the CPU path meshes
+
+	GLuint m_instanceBuffer{ 0 }; //Node transforms of the visible instances of one mesh, refilled for each instanced draw
+	std::vector<glm::mat4> m_instanceTransforms; //Kept between frames to save allocating
+
+	unsigned int m_meshGeneration{ 0 }; //Generation of m_meshResource that myMeshVector was built from
+	virtual bool AttachMeshes(); //Build myMeshVector and the per mesh state from the uploaded resource, again after it reloads
+
 public:
 
 	Model(const std::string& name, const float& posX, const float& posY, const float& posZ, const float& scale);
-	~Model();
+	virtual ~Model();
 
-	virtual bool Initialise();
+	//Loading is split so the CPU work can run on a worker thread while GL calls stay on the context thread
+	virtual bool Load(Helpers::ThreadPool* threadPool); //Import model and decode textures, no GL calls so safe to run on any thread
+	virtual bool Upload(); //Create GL buffers and textures from the loaded data, GL thread only
+	bool Initialise() { return Load(nullptr) && Upload(); } //Load and upload in one go on the GL thread
+
+	virtual void Update(float deltaTime, Helpers::ThreadPool* threadPool); //Advance the playing animation and skin, call before Render
+	void OnAssetsReloaded(); //Pick up reloaded meshes and textures, GL thread only
 	virtual void Render(const Helpers::Camera& camera, GLuint m_program, glm::mat4& projection_xform, glm::mat4& view_xform);
 
+	const std::string& GetName() const { return modelName; } //Returns Model file name
 	float GetXPos() { return m_posX; }; //Returns Model X position
 	float GetZPos() { return m_posZ; }; //Returns Model Z position
 	virtual float GetHeight(float posX, float posZ) { return 0; };
 
+	glm::mat4 GetModelTransform() const; //Model to world transform from position and scale
+	Helpers::BoundingBox GetWorldBoundingBox() const { return m_localBoundingBox.Transformed(GetModelTransform()); } //Cheap to call every frame
+	Helpers::BoundingSphere GetWorldBoundingSphere() const { return m_localBoundingSphere.Transformed(GetModelTransform()); }
+
 	void Texture(const std::string& filename);
 
+	void SetImportProfile(Helpers::ImportProfile profile) { m_importProfile = profile; } //Set before loading
+	void SetVertexEncoding(Helpers::VertexEncoding encoding) { m_vertexEncoding = encoding; } //Set before loading
+	size_t GetGpuBytes() const; //Vertex and element memory used by the Model's meshes
+	void SetLodEnabled(bool enabled) { m_lodEnabled = enabled; } //Always draw the full meshes when false
+	void SetLodPixelError(float pixels) { m_lodPixelError = pixels; } //Screen error allowed before a finer level is drawn
+	void SetSkinningPath(SkinningPath path) { m_skinningPath = path; } //Set before uploading
+	size_t GetAnimationCount() const { return m_meshResource ? m_meshResource->GetLoader().GetAnimations().size() : 0; } //Clips imported with the model
+	bool PlayAnimation(int index); //Loop a clip from its start, -1 stops and returns to the bind pose
+	const Helpers::ImportReport* GetImportReport() const { return m_meshResource ? &m_meshResource->GetLoader().GetImportReport() : nullptr; } //Timings of the model import
+
 	void Move(const float& x, const float& y, const float& z);
 
 };
@@ -2,127 +2,61 @@
 #include "Helper.h"
 #include "Mesh.h"
 #include "ImageLoader.h"
+#include "MaterialLibrary.h"
 
 ModelSkyBox::ModelSkyBox(const std::string& filename) : Model(filename, 0, 0, 0, 1)
 {
 
+	m_importProfile = Helpers::ImportProfile::FastLoad; //Six textured quads gain nothing from mesh optimisation
+
 }
 
-bool ModelSkyBox::Initialise()
+bool ModelSkyBox::Load(Helpers::ThreadPool* threadPool)
 {
 
-	Helpers::ModelLoader loader;
-	Helpers::ImageLoader imageLoader;
-
-	int counter = 0; //start counter at 0
+	m_meshResource = MeshResourceCache::Shared().Acquire(modelName, m_importProfile, m_vertexEncoding);
 
-	if (!loader.LoadFromFile(modelName)) //Load Model
+	if (!m_meshResource->Load(threadPool)) //Load Model
 	{
 		return false;
 	}
 
+	const Helpers::ModelLoader& loader = m_meshResource->GetLoader();
+
+	std::vector<std::string> textureFiles;
+
 	for (const Helpers::Mesh& mesh : loader.GetMeshVector()) //Loop through all meshes in model
 	{
+		textureFiles.push_back("Data\\Sky\\Clouds\\" + loader.GetMaterialVector()[mesh.materialIndex].diffuseTextureFilename);
+	}
+
+	return LoadTextures(threadPool, textureFiles); //Load SKybox textures, one per face
+
+}
 
-		MyMesh skyBoxMesh;
+bool ModelSkyBox::AttachMeshes()
+{
 
-		//Create VBOs
-		GLuint positionsVBO; //Positions VBO
-		glGenBuffers(1, &positionsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, positionsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.vertices.size(), mesh.vertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_meshGeneration = m_meshResource->GetGeneration();
 
-		GLuint normalsVBO; //Normals VBO
-		glGenBuffers(1, &normalsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, normalsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.normals.size(), mesh.normals.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	myMeshVector.clear();
 
-		GLuint texcoordsVBO; //UV coords VBO
-		glGenBuffers(1, &texcoordsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, texcoordsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * mesh.uvCoords.size(), mesh.uvCoords.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	size_t counter = 0; //start counter at 0
 
-		GLuint elementsEBO; //Elements EBO
-		glGenBuffers(1, &elementsEBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementsEBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh.elements.size(), mesh.elements.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	for (const MyMesh& sharedMesh : m_meshResource->GetMeshes()) //Loop through all meshes in model
+	{
 
-		skyBoxMesh.numElements = mesh.elements.size();
+		MyMesh skyBoxMesh = sharedMesh;
+		skyBoxMesh.materialIndex = MaterialLibrary::kUnlitMaterial; //The sky shows its texture as it is, whatever the file's material
 
-		if (!imageLoader.Load("Data\\Sky\\Clouds\\" + loader.GetMaterialVector()[mesh.materialIndex].diffuseTextureFilename)) //Load SKybox textures
+		//Add Skybox textures to skybox mesh
+		if (counter < m_textures.size() && TextureManager::Shared().Upload(*m_textures[counter]))
 		{
-			return false;
+			skyBoxMesh.textureID = m_textures[counter]->GetID();
 		}
 
 		counter++; //Add one to counter
 
-		//Add Skybox textures to skybox mesh
-		glGenTextures(1, &skyBoxMesh.textureID);
-		glBindTexture(GL_TEXTURE_2D, skyBoxMesh.textureID);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, imageLoader.Width(), imageLoader.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, imageLoader.GetData());
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		//Create VAOs
-		glGenVertexArrays(1, &skyBoxMesh.VAO);
-		glBindVertexArray(skyBoxMesh.VAO);
-
-		// Bind the vertex buffer to the context (records this action in the VAO)
-		glBindBuffer(GL_ARRAY_BUFFER, positionsVBO);
-
-		// Enable the first attribute in the program (the vertices) to stream to the vertex shader
-		glEnableVertexAttribArray(0);
-
-		// Describe the make up of the vertex stream
-		glVertexAttribPointer(
-			0,                  // attribute 0
-			3,                  // size in bytes of each item in the stream
-			GL_FLOAT,           // type of the item
-			GL_FALSE,           // normalized or not (advanced)
-			0,                  // stride (advanced)
-			(void*)0            // array buffer offset (advanced)
-		);
-
-		glBindBuffer(GL_ARRAY_BUFFER, normalsVBO);
-		// Enable the normal
-		glEnableVertexAttribArray(1);
-
-		// Describe the make up of the vertex stream
-		glVertexAttribPointer(
-			1,                  // attribute 1
-			3,                  // size in bytes of each item in the stream
-			GL_FLOAT,           // type of the item
-			GL_FALSE,           // normalized or not (advanced)
-			0,                  // stride (advanced)
-			(void*)0            // array buffer offset (advanced)
-		);
-
-		glBindBuffer(GL_ARRAY_BUFFER, texcoordsVBO);
-		// Enable the normal
-		glEnableVertexAttribArray(2);
-
-		// Describe the make up of the vertex stream
-		glVertexAttribPointer(
-			2,                  // attribute 1
-			2,                  // size in bytes of each item in the stream
-			GL_FLOAT,           // type of the item
-			GL_FALSE,           // normalized or not (advanced)
-			0,                  // stride (advanced)
-			(void*)0            // array buffer offset (advanced)
-		);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementsEBO);
-
-		// Clear VAO binding
-		glBindVertexArray(0);
-
 		myMeshVector.push_back(skyBoxMesh);
 
 	}
@@ -134,6 +68,14 @@ bool ModelSkyBox::Initialise()
 void ModelSkyBox::Render(const Helpers::Camera& camera, GLuint m_program, glm::mat4& projection_xform, glm::mat4& view_xform)
 {
 
+	//Each face can fill the screen, so the sky always wants its textures at the viewport's size
+	GLint viewportSize[4];
+	glGetIntegerv(GL_VIEWPORT, viewportSize);
+	for (const std::shared_ptr<TextureResource>& texture : m_textures)
+	{
+		texture->RecordDrawnSize((float)std::max(viewportSize[2], viewportSize[3]));
+	}
+
 	for (const auto& mesh : myMeshVector) //For every Mesh
 	{
 
@@ -167,8 +109,7 @@ void ModelSkyBox::Render(const Helpers::Camera& camera, GLuint m_program, glm::m
 			glBindTexture(GL_TEXTURE_2D, 0);
 		}
 
-		glBindVertexArray(mesh.VAO);
-		glDrawElements(GL_TRIANGLES, mesh.numElements, GL_UNSIGNED_INT, (void*)0);
+		mesh.Draw(m_program);
 
 		Helpers::CheckForGLError();
 
@@ -6,13 +6,13 @@ class ModelSkyBox : public Model
 
 private:
 
-
+	bool AttachMeshes() override final; //Sky meshes are unlit and use the textures their materials name
 
 public:
 
 	ModelSkyBox(const std::string& filename);
 
-	bool Initialise() override final;
+	bool Load(Helpers::ThreadPool* threadPool) override final;
 	void Render(const Helpers::Camera& camera, GLuint m_program, glm::mat4& projection_xform, glm::mat4& view_xform) override final;
 
 };
@@ -1,5 +1,6 @@
 #include "ModelTerrain.h"
 #include "ImageLoader.h"
+#include "MeshOptimiser.h"
 
 ModelTerrain::ModelTerrain(float size, int numCellsXZ) : Model("", 0, 0, 0, 1.0f)
 {
@@ -9,10 +10,14 @@ ModelTerrain::ModelTerrain(float size, int numCellsXZ) : Model("", 0, 0, 0, 1.0f
 
 }
 
-bool ModelTerrain::Initialise() 
+bool ModelTerrain::Load(Helpers::ThreadPool* threadPool)
 {
 
-	MyMesh terrainMesh; //Create Terrain mesh
+	//Decode the heightmap and the terrain texture together, the heightmap is kept RGBA to read its heights
+	if (!LoadTextures(threadPool, { "Data/Textures/curvy.bmp", m_textureList[0] }, 1))
+	{
+		return false;
+	}
 
 	float cellSize = m_size / m_numCellsXZ; //Calculate cell size
 
@@ -24,13 +29,15 @@ bool ModelTerrain::Initialise()
 
 	float tiles{ 10.0f }; //How many texture tiles on the terrain
 
-	Helpers::ImageLoader heightImage;
-	if (!heightImage.Load("Data/Textures/curvy.bmp")) //Load terrain heightmap
+	const Helpers::ImageLoader& heightImage = m_textures[0]->GetImage(); //Terrain heightmap, never uploaded
+
+	if (heightImage.IsCompressed()) //Heights are read texel by texel so must be decoded
 	{
+		std::cout << "Terrain heightmap cannot be block compressed" << std::endl;
 		return false;
 	}
 
-	unsigned char* texels = (unsigned char*)heightImage.GetData(); //Get heightmap data
+	const unsigned char* texels = (const unsigned char*)heightImage.GetData(); //Get heightmap data
 
 	for (int z = 0; z < numVertsZ; z++) //Loop through Z vertices
 	{
@@ -61,8 +68,6 @@ bool ModelTerrain::Initialise()
 		}
 	}
 
-	std::vector<glm::uint> elements;
-
 	bool toggleForDiamondPattern = true;
 
 	//Create Diamond pattern for terrain mesh
@@ -103,8 +108,7 @@ bool ModelTerrain::Initialise()
 		toggleForDiamondPattern = !toggleForDiamondPattern;
 	}
 
-	std::vector<glm::vec3> normals(vertices.size()); //Create normals vector
-	std::fill(normals.begin(), normals.end(), glm::vec3(0, 0, 0));
+	normals.assign(vertices.size(), glm::vec3(0, 0, 0)); //Create normals vector
 
 	for (size_t i = 0; i < elements.size(); i += 3) //Normals
 	{
@@ -133,93 +137,70 @@ bool ModelTerrain::Initialise()
 		n = glm::normalize(n);
 	}
 
-	GLuint PositionsVBO; //Positions VBO
-	glGenBuffers(1, &PositionsVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, PositionsVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)* vertices.size(), vertices.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	GLuint NormalsVBO; //Normals VBO
-	glGenBuffers(1, &NormalsVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, NormalsVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)* normals.size(), normals.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	GLuint CoordsVBO; //UV Coords VBO
-	glGenBuffers(1, &CoordsVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, CoordsVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2)* uvCoords.size(), uvCoords.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	GLuint ElementsEBO; //Elements EBO
-	glGenBuffers(1, &ElementsEBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementsEBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint)* elements.size(), elements.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-	Helpers::CheckForGLError();
-	terrainMesh.numElements = elements.size();
-
-	if (!heightImage.Load(m_textureList[0])) //Load terrain texture
+	//Reorder the triangles for the vertex cache and then for overdraw, the vertices keep their row order as GetHeight relies on it
+	const Helpers::VertexCacheStats cacheBefore = Helpers::AnalyseVertexCache(elements.data(), elements.size(), vertices.size());
+
+	Helpers::OptimiseVertexCache(elements.data(), elements.data(), elements.size(), vertices.size());
+	std::vector<glm::uint> reordered(elements.size());
+	Helpers::OptimiseOverdraw(reordered.data(), elements.data(), elements.size(), vertices.data(), vertices.size());
+	elements.swap(reordered);
+
+	const Helpers::VertexCacheStats cacheAfter = Helpers::AnalyseVertexCache(elements.data(), elements.size(), vertices.size());
+
+	std::cout << "Terrain vertex cache ACMR " << cacheBefore.Acmr() << " -> " << cacheAfter.Acmr() <<
+		", ATVR " << cacheBefore.Atvr() << " -> " << cacheAfter.Atvr() << std::endl;
+
+	m_localBoundingBox = Helpers::ComputeBoundingBox(vertices.data(), vertices.size()); //Terrain bounds for culling
+	m_localBoundingSphere = Helpers::ComputeBoundingSphere(vertices.data(), vertices.size(), m_localBoundingBox);
+
+	return true;
+
+}
+
+ModelTerrain::~ModelTerrain()
+{
+
+	for (const MyMesh& mesh : myMeshVector)
+	{
+		glDeleteVertexArrays(1, &mesh.VAO);
+	}
+
+	if (!m_buffers.empty())
 	{
-		return false;
+		glDeleteBuffers((GLsizei)m_buffers.size(), m_buffers.data());
 	}
 
+}
+
+bool ModelTerrain::Upload()
+{
+
+	//View the generated geometry as a mesh so it is uploaded the same way as imported models
+	Helpers::Mesh mesh;
+	mesh.vertices = Helpers::Span<glm::vec3>(vertices.data(), vertices.size());
+	mesh.normals = Helpers::Span<glm::vec3>(normals.data(), normals.size());
+	mesh.uvCoords = Helpers::Span<glm::vec2>(uvCoords.data(), uvCoords.size());
+	mesh.elements = Helpers::Span<unsigned int>(elements.data(), elements.size());
+	mesh.boundingBox = m_localBoundingBox;
+	mesh.boundingSphere = m_localBoundingSphere;
+
+	MyMesh terrainMesh = UploadMesh(mesh, m_vertexEncoding, m_buffers); //Create Terrain mesh
+
+	TextureResource& texture = *m_textures[1]; //Terrain texture
+
 	//Add terrain texture to terrain mesh
-	glGenTextures(1, &terrainMesh.textureID);
-	glBindTexture(GL_TEXTURE_2D, terrainMesh.textureID);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, heightImage.Width(), heightImage.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, heightImage.GetData());
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	glGenVertexArrays(1, &terrainMesh.VAO);
-	glBindVertexArray(terrainMesh.VAO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, PositionsVBO);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(
-		0,                  // attribute 0
-		3,                  // size in bytes of each item in the stream
-		GL_FLOAT,           // type of the item
-		GL_FALSE,           // normalized or not (advanced)
-		0,                  // stride (advanced)
-		(void*)0            // array buffer offset (advanced)
-	);
-
-	glBindBuffer(GL_ARRAY_BUFFER, NormalsVBO);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(
-		1,                  // attribute 0
-		3,                  // size in bytes of each item in the stream
-		GL_FLOAT,           // type of the item
-		GL_FALSE,           // normalized or not (advanced)
-		0,                  // stride (advanced)
-		(void*)0            // array buffer offset (advanced)
-	);
-
-	glBindBuffer(GL_ARRAY_BUFFER, CoordsVBO);
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(
-		2,                  // attribute 0
-		2,                  // size in bytes of each item in the stream
-		GL_FLOAT,           // type of the item
-		GL_FALSE,           // normalized or not (advanced)
-		0,                  // stride (advanced)
-		(void*)0            // array buffer offset (advanced)
-	);
-
-	Helpers::CheckForGLError();
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementsEBO);
-	glBindVertexArray(0);
+	if (TextureManager::Shared().Upload(texture))
+	{
+		terrainMesh.textureID = texture.GetID();
+	}
 
 	myMeshVector.push_back(terrainMesh);
 
-	// Clear VAO binding
-	glBindVertexArray(0);
+	m_textures.erase(m_textures.begin()); //Heightmap is no longer needed once the geometry is built
+
+	std::cout << "Terrain vertex memory: " << terrainMesh.gpuBytes / 1024 << " KB" <<
+		(m_vertexEncoding == Helpers::VertexEncoding::Compact ? " compact, " : " full, ") <<
+		Helpers::FullEncodingBytes(mesh) / 1024 << " KB with full floats" << std::endl;
 
 	return true;
 
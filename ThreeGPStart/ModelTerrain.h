@@ -11,11 +11,18 @@ private:
 
 	std::vector<glm::vec3> vertices; //Vertex vector
 	std::vector<glm::vec2> uvCoords; //UV coords vector
+	std::vector<glm::vec3> normals; //Normals vector
+	std::vector<glm::uint> elements; //Elements vector
+
+	std::vector<GLuint> m_buffers; //GL buffers, deleted with the terrain
 
 public:
 
 	ModelTerrain(float size, int numCellsXZ);
-	bool Initialise() override final;
+	~ModelTerrain();
+
+	bool Load(Helpers::ThreadPool* threadPool) override final;
+	bool Upload() override final;
 
 	float GetHeight(float posX, float posZ) override final;
 
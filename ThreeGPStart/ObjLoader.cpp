@@ -0,0 +1,816 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "Helper.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Marks a corner with no uv or normal
+		const int kNoIndex{ INT_MIN };
+
+		// Chunks are about this size so even a small file keeps every thread busy with room to balance
+		const size_t kChunkBytes{ 1024 * 1024 };
+		const size_t kMaxChunks{ 1024 };
+
+		// Welding splits the corners by hash into this many independent tables, fixed so the result never depends on the thread count
+		const unsigned int kWeldPartitions{ 64 };
+		const size_t kWeldBlockCorners{ 64 * 1024 };
+
+		// Indices of a face corner. While parsing a negative (relative) index is stored relative to the chunk,
+		// with its bit set in relative, as the chunk does not yet know how many values come before it.
+		struct ObjCorner
+		{
+			int position{ kNoIndex };
+			int uv{ kNoIndex };
+			int normal{ kNoIndex };
+			unsigned int relative{ 0 };
+		};
+
+		struct ObjFace
+		{
+			unsigned int firstCorner{ 0 };
+			unsigned int numCorners{ 0 };
+
+			// Triangles in the chunk before this face
+			unsigned int firstTriangle{ 0 };
+		};
+
+		// A usemtl, o or g line, taking effect from the face that follows it
+		struct ObjStateChange
+		{
+			unsigned int face{ 0 };
+			bool material{ false };
+			std::string name;
+		};
+
+		// What one line aligned chunk of the file holds
+		struct ObjChunk
+		{
+			const char* begin{ nullptr };
+			const char* end{ nullptr };
+
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec2> uvs;
+			std::vector<glm::vec3> normals;
+			std::vector<ObjCorner> corners;
+			std::vector<ObjFace> faces;
+			std::vector<ObjStateChange> changes;
+			std::vector<std::string> materialLibraries;
+			unsigned int numTriangles{ 0 };
+
+			// Values in the chunks before this one
+			size_t positionBase{ 0 };
+			size_t uvBase{ 0 };
+			size_t normalBase{ 0 };
+		};
+
+		// Consecutive faces of one chunk that all go to the same mesh
+		struct ObjRun
+		{
+			size_t chunk{ 0 };
+			unsigned int firstFace{ 0 };
+			unsigned int numFaces{ 0 };
+			size_t mesh{ 0 };
+
+			// Where the run's triangles start in the mesh
+			size_t firstTriangle{ 0 };
+		};
+
+		bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+		const char* SkipBlanks(const char* cursor, const char* end)
+		{
+			while (cursor < end && IsBlank(*cursor))
+				cursor++;
+			return cursor;
+		}
+
+		// True if the line starts with keyword followed by a blank, cursor is moved past both
+		bool Keyword(const char*& cursor, const char* end, const char* keyword)
+		{
+			const size_t length{ std::strlen(keyword) };
+			if ((size_t)(end - cursor) <= length || std::memcmp(cursor, keyword, length) != 0 || !IsBlank(cursor[length]))
+				return false;
+			cursor = SkipBlanks(cursor + length, end);
+			return true;
+		}
+
+		// Rest of the line without trailing blanks
+		std::string RestOfLine(const char* cursor, const char* end)
+		{
+			while (end > cursor && IsBlank(end[-1]))
+				end--;
+			return std::string(cursor, end);
+		}
+
+		bool ParseInt(const char*& cursor, const char* end, int& value)
+		{
+			const char* p{ cursor };
+			bool negative{ false };
+			if (p < end && (*p == '-' || *p == '+'))
+				negative = *p++ == '-';
+
+			if (p == end || *p < '0' || *p > '9')
+				return false;
+
+			// Digits past INT_MAX are still consumed but the value is rejected rather than wrapped
+			long long result{ 0 };
+			while (p < end && *p >= '0' && *p <= '9')
+				result = std::min(result * 10 + (*p++ - '0'), (long long)INT_MAX + 1);
+
+			if (result > INT_MAX)
+				return false;
+
+			value = (int)(negative ? -result : result);
+			cursor = p;
+			return true;
+		}
+
+		// Up to three floats, missing ones are left alone
+		void ParseVector(const char* cursor, const char* end, float* values, int count)
+		{
+			for (int i = 0; i < count && ParseFloat(cursor, end, values[i]); i++)
+				;
+		}
+
+		// One OBJ index as stored in an ObjCorner, 1 based from the start or negative from the end so far
+		bool ParseIndex(const char*& cursor, const char* end, size_t localCount, int& index, unsigned int& relative, unsigned int bit)
+		{
+			int value{ 0 };
+			if (!ParseInt(cursor, end, value) || value == 0)
+				return false;
+
+			if (value > 0)
+			{
+				index = value - 1;
+			}
+			else
+			{
+				index = (int)localCount + value;
+				relative |= bit;
+			}
+			return true;
+		}
+
+		// v, v/vt, v//vn or v/vt/vn
+		bool ParseCorner(const char*& cursor, const char* end, const ObjChunk& chunk, ObjCorner& corner)
+		{
+			if (!ParseIndex(cursor, end, chunk.positions.size(), corner.position, corner.relative, 1))
+				return false;
+
+			if (cursor < end && *cursor == '/')
+			{
+				cursor++;
+				if (cursor < end && *cursor != '/')
+					ParseIndex(cursor, end, chunk.uvs.size(), corner.uv, corner.relative, 2);
+
+				if (cursor < end && *cursor == '/')
+				{
+					cursor++;
+					ParseIndex(cursor, end, chunk.normals.size(), corner.normal, corner.relative, 4);
+				}
+			}
+
+			// Skip anything unexpected up to the next corner
+			while (cursor < end && !IsBlank(*cursor))
+				cursor++;
+			return true;
+		}
+
+		void ParseLine(const char* cursor, const char* end, ObjChunk& chunk)
+		{
+			cursor = SkipBlanks(cursor, end);
+			if (cursor == end)
+				return;
+
+			switch (*cursor)
+			{
+			case 'v':
+				if (Keyword(cursor, end, "v"))
+				{
+					glm::vec3 position{ 0 };
+					ParseVector(cursor, end, &position.x, 3);
+					chunk.positions.push_back(position);
+				}
+				else if (Keyword(cursor, end, "vt"))
+				{
+					glm::vec2 uv{ 0 };
+					ParseVector(cursor, end, &uv.x, 2);
+					chunk.uvs.push_back(uv);
+				}
+				else if (Keyword(cursor, end, "vn"))
+				{
+					glm::vec3 normal{ 0 };
+					ParseVector(cursor, end, &normal.x, 3);
+					chunk.normals.push_back(normal);
+				}
+				break;
+			case 'f':
+				if (Keyword(cursor, end, "f"))
+				{
+					ObjFace face;
+					face.firstCorner = (unsigned int)chunk.corners.size();
+					face.firstTriangle = chunk.numTriangles;
+
+					ObjCorner corner;
+					while ((cursor = SkipBlanks(cursor, end)) < end && ParseCorner(cursor, end, chunk, corner))
+					{
+						chunk.corners.push_back(corner);
+						corner = ObjCorner();
+					}
+
+					// Lines and points are dropped as the renderer only draws triangles
+					face.numCorners = (unsigned int)chunk.corners.size() - face.firstCorner;
+					if (face.numCorners < 3)
+					{
+						chunk.corners.resize(face.firstCorner);
+						break;
+					}
+
+					chunk.numTriangles += face.numCorners - 2;
+					chunk.faces.push_back(face);
+				}
+				break;
+			case 'u':
+				if (Keyword(cursor, end, "usemtl"))
+					chunk.changes.push_back(ObjStateChange{ (unsigned int)chunk.faces.size(), true, RestOfLine(cursor, end) });
+				break;
+			case 'o':
+			case 'g':
+				if (Keyword(cursor, end, "o") || Keyword(cursor, end, "g"))
+					chunk.changes.push_back(ObjStateChange{ (unsigned int)chunk.faces.size(), false, RestOfLine(cursor, end) });
+				break;
+			case 'm':
+				if (Keyword(cursor, end, "mtllib"))
+				{
+					while (cursor < end)
+					{
+						const char* nameEnd{ cursor };
+						while (nameEnd < end && !IsBlank(*nameEnd))
+							nameEnd++;
+						chunk.materialLibraries.push_back(std::string(cursor, nameEnd));
+						cursor = SkipBlanks(nameEnd, end);
+					}
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		void ParseChunk(ObjChunk& chunk)
+		{
+			const char* cursor{ chunk.begin };
+			while (cursor < chunk.end)
+			{
+				const char* lineEnd{ (const char*)std::memchr(cursor, '\n', chunk.end - cursor) };
+				if (!lineEnd)
+					lineEnd = chunk.end;
+
+				const char* contentEnd{ lineEnd };
+				if (contentEnd > cursor && contentEnd[-1] == '\r')
+					contentEnd--;
+
+				ParseLine(cursor, contentEnd, chunk);
+				cursor = lineEnd + 1;
+			}
+		}
+
+		// Turn the chunk's relative indices into indices into the whole file's values, false if any are out of range
+		bool ResolveCorners(ObjChunk& chunk, size_t numPositions, size_t numUVs, size_t numNormals)
+		{
+			auto resolve = [](int& index, bool relative, size_t base, size_t count)
+			{
+				if (index == kNoIndex)
+					return true;
+				const long long global{ relative ? (long long)base + index : (long long)index };
+				if (global < 0 || global >= (long long)count)
+					return false;
+				index = (int)global;
+				return true;
+			};
+
+			for (ObjCorner& corner : chunk.corners)
+			{
+				if (!resolve(corner.position, (corner.relative & 1) != 0, chunk.positionBase, numPositions) ||
+					!resolve(corner.uv, (corner.relative & 2) != 0, chunk.uvBase, numUVs) ||
+					!resolve(corner.normal, (corner.relative & 4) != 0, chunk.normalBase, numNormals))
+					return false;
+				corner.relative = 0;
+			}
+			return true;
+		}
+
+		// Read the materials of an MTL file into materials by name
+		void ReadMaterialLibrary(const std::string& filename, std::map<std::string, Material>& materials)
+		{
+			std::ifstream in(filename);
+			if (!in)
+			{
+				std::cout << "Could not open material library " << filename << std::endl;
+				return;
+			}
+
+			Material* material{ nullptr };
+			std::string line;
+			while (std::getline(in, line))
+			{
+				const char* cursor{ line.data() };
+				const char* end{ line.data() + line.size() };
+				if (end > cursor && end[-1] == '\r')
+					end--;
+				cursor = SkipBlanks(cursor, end);
+
+				auto colour = [&](glm::vec4& value)
+				{
+					glm::vec3 rgb{ value };
+					ParseVector(cursor, end, &rgb.x, 3);
+					value = glm::vec4(rgb, 1.0f);
+				};
+
+				if (Keyword(cursor, end, "newmtl"))
+					material = &materials[RestOfLine(cursor, end)];
+				else if (!material)
+					continue;
+				else if (Keyword(cursor, end, "Ka"))
+					colour(material->ambientColour);
+				else if (Keyword(cursor, end, "Kd"))
+					colour(material->diffuseColour);
+				else if (Keyword(cursor, end, "Ks"))
+					colour(material->specularColour);
+				else if (Keyword(cursor, end, "Ke"))
+					colour(material->emissiveColour);
+				else if (Keyword(cursor, end, "Ns"))
+					ParseFloat(cursor, end, material->specularFactor);
+				else if (Keyword(cursor, end, "map_Kd"))
+					material->diffuseTextureFilename = RestOfLine(cursor, end);
+				else if (Keyword(cursor, end, "map_Ks"))
+					material->specularTextureFilename = RestOfLine(cursor, end);
+			}
+		}
+
+		// The file's values the corner indices refer to, corners are welded by value as aiProcess_JoinIdenticalVertices does
+		struct ObjValues
+		{
+			const glm::vec3* positions{ nullptr };
+			const glm::vec2* uvs{ nullptr };
+			const glm::vec3* normals{ nullptr };
+
+			glm::vec3 Position(const ObjCorner& corner) const { return positions[corner.position]; }
+			glm::vec2 UV(const ObjCorner& corner) const { return corner.uv == kNoIndex ? glm::vec2(0) : uvs[corner.uv]; }
+			glm::vec3 Normal(const ObjCorner& corner) const { return corner.normal == kNoIndex ? glm::vec3(0) : normals[corner.normal]; }
+		};
+
+		unsigned long long HashCorner(const ObjValues& values, const ObjCorner& corner)
+		{
+			float components[8];
+			const glm::vec3 position{ values.Position(corner) };
+			const glm::vec2 uv{ values.UV(corner) };
+			const glm::vec3 normal{ values.Normal(corner) };
+			std::memcpy(components, &position, sizeof(position));
+			std::memcpy(components + 3, &uv, sizeof(uv));
+			std::memcpy(components + 5, &normal, sizeof(normal));
+
+			unsigned long long hash{ 14695981039346656037ull };
+			for (float component : components)
+			{
+				unsigned int bits;
+				component += 0.0f; // -0 and +0 hash the same as they compare equal
+				std::memcpy(&bits, &component, sizeof(bits));
+				hash = (hash ^ bits) * 0x100000001B3ull;
+			}
+			hash ^= hash >> 29;
+			hash *= 0xBF58476D1CE4E5B9ull;
+			return hash ^ (hash >> 32);
+		}
+
+		bool SameCorner(const ObjValues& values, const ObjCorner& a, const ObjCorner& b)
+		{
+			if (a.position == b.position && a.uv == b.uv && a.normal == b.normal)
+				return true;
+			return values.Position(a) == values.Position(b) && values.UV(a) == values.UV(b) && values.Normal(a) == values.Normal(b);
+		}
+
+		// Give every distinct corner a vertex, numbered in the order the corners first use them
+		// Corners are split by hash into partitions that are welded in parallel, each with its own table
+		void WeldCorners(ThreadPool* threadPool, const ObjValues& values, const std::vector<ObjCorner>& corners, std::vector<ObjCorner>& uniqueCorners, std::vector<unsigned int>& elements)
+		{
+			const size_t numCorners{ corners.size() };
+			const size_t numBlocks{ std::max<size_t>(1, (numCorners + kWeldBlockCorners - 1) / kWeldBlockCorners) };
+
+			// Each block of corners lists its corners by partition, so every partition can then walk its own in order
+			std::vector<std::vector<unsigned int>> blockPartitions(numBlocks * kWeldPartitions);
+			std::vector<unsigned char> cornerPartition(numCorners);
+			std::vector<unsigned int> cornerHash(numCorners);
+			ParallelFor(threadPool, numBlocks, [&](size_t block)
+			{
+				const size_t last{ std::min(numCorners, (block + 1) * kWeldBlockCorners) };
+				for (size_t c = block * kWeldBlockCorners; c < last; c++)
+				{
+					const unsigned long long hash{ HashCorner(values, corners[c]) };
+					const unsigned int partition{ (unsigned int)(hash >> 58) % kWeldPartitions };
+					cornerHash[c] = (unsigned int)hash;
+					cornerPartition[c] = (unsigned char)partition;
+					blockPartitions[block * kWeldPartitions + partition].push_back((unsigned int)c);
+				}
+			});
+
+			// Open addressing table per partition, the first corner to reach a slot becomes its vertex
+			std::vector<std::vector<ObjCorner>> partitionCorners(kWeldPartitions);
+			std::vector<unsigned int> cornerVertex(numCorners);
+			ParallelFor(threadPool, kWeldPartitions, [&](size_t partition)
+			{
+				size_t count{ 0 };
+				for (size_t block = 0; block < numBlocks; block++)
+					count += blockPartitions[block * kWeldPartitions + partition].size();
+
+				size_t tableSize{ 16 };
+				while (tableSize < count * 2)
+					tableSize *= 2;
+
+				// Slots keep the hash beside the vertex so most mismatches are rejected without reading the corner
+				struct Slot
+				{
+					unsigned int vertex;
+					unsigned int hash;
+				};
+				std::vector<Slot> table(tableSize, Slot{ UINT_MAX, 0 });
+
+				std::vector<ObjCorner>& unique{ partitionCorners[partition] };
+				for (size_t block = 0; block < numBlocks; block++)
+				{
+					for (unsigned int c : blockPartitions[block * kWeldPartitions + partition])
+					{
+						const unsigned int hash{ cornerHash[c] };
+						size_t slot{ hash & (tableSize - 1) };
+						while (table[slot].vertex != UINT_MAX && (table[slot].hash != hash || !SameCorner(values, unique[table[slot].vertex], corners[c])))
+							slot = (slot + 1) & (tableSize - 1);
+
+						if (table[slot].vertex == UINT_MAX)
+						{
+							table[slot] = Slot{ (unsigned int)unique.size(), hash };
+							unique.push_back(corners[c]);
+						}
+						cornerVertex[c] = table[slot].vertex;
+					}
+				}
+			});
+
+			std::vector<size_t> partitionBase(kWeldPartitions + 1, 0);
+			for (unsigned int partition = 0; partition < kWeldPartitions; partition++)
+				partitionBase[partition + 1] = partitionBase[partition] + partitionCorners[partition].size();
+			const size_t numVertices{ partitionBase[kWeldPartitions] };
+
+			// Renumber by first use in one pass, this is the only serial step and is a simple walk
+			std::vector<unsigned int> firstUse(numVertices, UINT_MAX);
+			elements.resize(numCorners);
+			unsigned int nextVertex{ 0 };
+			for (size_t c = 0; c < numCorners; c++)
+			{
+				unsigned int& vertex{ firstUse[partitionBase[cornerPartition[c]] + cornerVertex[c]] };
+				if (vertex == UINT_MAX)
+					vertex = nextVertex++;
+				elements[c] = vertex;
+			}
+
+			uniqueCorners.resize(numVertices);
+			ParallelFor(threadPool, kWeldPartitions, [&](size_t partition)
+			{
+				const std::vector<ObjCorner>& unique{ partitionCorners[partition] };
+				for (size_t i = 0; i < unique.size(); i++)
+					uniqueCorners[firstUse[partitionBase[partition] + i]] = unique[i];
+			});
+		}
+
+		// Area weighted normals averaged over every vertex sharing a position, as aiProcess_GenSmoothNormals does
+		void GenerateSmoothNormals(const std::vector<ObjCorner>& uniqueCorners, ObjMesh& mesh)
+		{
+			int maxPosition{ 0 };
+			for (const ObjCorner& corner : uniqueCorners)
+				maxPosition = std::max(maxPosition, corner.position);
+			std::vector<glm::vec3> positionNormals(maxPosition + 1, glm::vec3(0));
+			for (size_t e = 0; e + 2 < mesh.elements.size(); e += 3)
+			{
+				const unsigned int* triangle{ &mesh.elements[e] };
+				const glm::vec3 normal{ glm::cross(mesh.vertices[triangle[1]] - mesh.vertices[triangle[0]], mesh.vertices[triangle[2]] - mesh.vertices[triangle[0]]) };
+				for (int corner = 0; corner < 3; corner++)
+					positionNormals[uniqueCorners[triangle[corner]].position] += normal;
+			}
+
+			mesh.normals.resize(mesh.vertices.size());
+			for (size_t v = 0; v < mesh.vertices.size(); v++)
+			{
+				const glm::vec3& sum{ positionNormals[uniqueCorners[v].position] };
+				const float length{ glm::length(sum) };
+				mesh.normals[v] = length > 0 ? sum / length : glm::vec3(0, 1, 0);
+			}
+		}
+
+		// Directory part of a path including the trailing separator, empty if there is none
+		std::string Directory(const std::string& filename)
+		{
+			const size_t separator{ filename.find_last_of("\\/") };
+			return separator == std::string::npos ? std::string() : filename.substr(0, separator + 1);
+		}
+	}
+
+	// Decimal text to float without locale or allocation
+	bool ParseFloat(const char*& cursor, const char* end, float& value)
+	{
+		// Exact powers of ten a double can hold
+		static const double kPowersOfTen[]{ 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		const char* p{ SkipBlanks(cursor, end) };
+
+		bool negative{ false };
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+
+		// Up to 19 significant digits fit in the mantissa, later ones only move the exponent
+		unsigned long long mantissa{ 0 };
+		int significantDigits{ 0 };
+		int exponent{ 0 };
+		bool anyDigits{ false };
+
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				significantDigits += mantissa != 0;
+			}
+			else
+			{
+				exponent++;
+			}
+			p++;
+			anyDigits = true;
+		}
+
+		if (p < end && *p == '.')
+		{
+			p++;
+			while (p < end && *p >= '0' && *p <= '9')
+			{
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					significantDigits += mantissa != 0;
+					exponent--;
+				}
+				p++;
+				anyDigits = true;
+			}
+		}
+
+		if (!anyDigits)
+			return false;
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* exponentStart{ p + 1 };
+			int exponentValue{ 0 };
+			if (ParseInt(exponentStart, end, exponentValue))
+			{
+				exponent += exponentValue;
+				p = exponentStart;
+			}
+		}
+
+		double result{ (double)mantissa };
+		if (exponent < 0)
+			result = -exponent <= 22 ? result / kPowersOfTen[-exponent] : result * std::pow(10.0, exponent);
+		else if (exponent > 0)
+			result = exponent <= 22 ? result * kPowersOfTen[exponent] : result * std::pow(10.0, exponent);
+
+		value = (float)(negative ? -result : result);
+		cursor = p;
+		return true;
+	}
+
+	// Read an OBJ file and the material libraries it names
+	bool ReadObj(const std::string& filename, ThreadPool* threadPool, ObjModel& model)
+	{
+		model = ObjModel();
+		Timer stepTimer;
+		auto endStep = [&](const std::string& step)
+		{
+			model.steps.push_back(ImportStepTiming{ step, stepTimer.ElapsedMs() });
+			stepTimer.Reset();
+		};
+
+		MappedFile file;
+		if (!file.Open(filename))
+		{
+			std::cout << "Could not open " << filename << std::endl;
+			return false;
+		}
+
+		// Chunks end just after a newline so no line is split between two
+		const char* text{ (const char*)file.Data() };
+		const char* textEnd{ text + file.Size() };
+		const size_t numChunks{ std::min(kMaxChunks, std::max<size_t>(1, file.Size() / kChunkBytes)) };
+
+		std::vector<ObjChunk> chunks(numChunks);
+		const char* chunkBegin{ text };
+		for (size_t c = 0; c < numChunks; c++)
+		{
+			const char* chunkEnd{ textEnd };
+			if (c + 1 < numChunks)
+			{
+				chunkEnd = std::max(chunkBegin, text + file.Size() * (c + 1) / numChunks);
+				const char* newline{ (const char*)std::memchr(chunkEnd, '\n', textEnd - chunkEnd) };
+				chunkEnd = newline ? newline + 1 : textEnd;
+			}
+			chunks[c].begin = chunkBegin;
+			chunks[c].end = chunkEnd;
+			chunkBegin = chunkEnd;
+		}
+
+		ParallelFor(threadPool, numChunks, [&](size_t c) { ParseChunk(chunks[c]); });
+		endStep("OBJ parse");
+
+		// Gather the values of every chunk, each chunk's indices are then made file wide
+		size_t numPositions{ 0 };
+		size_t numUVs{ 0 };
+		size_t numNormals{ 0 };
+		for (ObjChunk& chunk : chunks)
+		{
+			chunk.positionBase = numPositions;
+			chunk.uvBase = numUVs;
+			chunk.normalBase = numNormals;
+			numPositions += chunk.positions.size();
+			numUVs += chunk.uvs.size();
+			numNormals += chunk.normals.size();
+		}
+
+		std::vector<glm::vec3> positions(numPositions);
+		std::vector<glm::vec2> uvs(numUVs);
+		std::vector<glm::vec3> normals(numNormals);
+		std::atomic<bool> indicesValid{ true };
+		ParallelFor(threadPool, numChunks, [&](size_t c)
+		{
+			ObjChunk& chunk{ chunks[c] };
+			std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase);
+			std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + chunk.uvBase);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase);
+			if (!ResolveCorners(chunk, numPositions, numUVs, numNormals))
+				indicesValid = false;
+		});
+
+		if (!indicesValid)
+		{
+			std::cout << filename << " has a face index out of range" << std::endl;
+			return false;
+		}
+
+		// Material libraries are small so read on this thread, materials are then found by name
+		std::map<std::string, Material> libraryMaterials;
+		for (const ObjChunk& chunk : chunks)
+		{
+			for (const std::string& library : chunk.materialLibraries)
+				ReadMaterialLibrary(Directory(filename) + library, libraryMaterials);
+		}
+
+		// One mesh per material in order of first use, split into runs of consecutive faces that go to the same mesh
+		std::map<std::string, size_t> meshByMaterial;
+		std::vector<size_t> meshTriangles;
+		std::vector<ObjRun> runs;
+		std::string materialName;
+		std::string groupName;
+
+		auto addRun = [&](size_t c, unsigned int firstFace, unsigned int lastFace)
+		{
+			if (lastFace <= firstFace)
+				return;
+
+			auto found = meshByMaterial.find(materialName);
+			if (found == meshByMaterial.end())
+			{
+				found = meshByMaterial.insert({ materialName, model.meshes.size() }).first;
+
+				ObjMesh mesh;
+				mesh.name = groupName;
+				mesh.materialIndex = model.materials.size();
+				model.meshes.push_back(mesh);
+				meshTriangles.push_back(0);
+
+				auto material = libraryMaterials.find(materialName);
+				model.materials.push_back(material != libraryMaterials.end() ? material->second : Material());
+			}
+
+			const ObjChunk& chunk{ chunks[c] };
+			const ObjFace& last{ chunk.faces[lastFace - 1] };
+			const size_t numTriangles{ last.firstTriangle + last.numCorners - 2 - chunk.faces[firstFace].firstTriangle };
+
+			runs.push_back(ObjRun{ c, firstFace, lastFace - firstFace, found->second, meshTriangles[found->second] });
+			meshTriangles[found->second] += numTriangles;
+		};
+
+		for (size_t c = 0; c < numChunks; c++)
+		{
+			unsigned int runStart{ 0 };
+			for (const ObjStateChange& change : chunks[c].changes)
+			{
+				addRun(c, runStart, change.face);
+				runStart = std::max(runStart, change.face);
+				(change.material ? materialName : groupName) = change.name;
+			}
+			addRun(c, runStart, (unsigned int)chunks[c].faces.size());
+		}
+
+		if (model.meshes.empty())
+		{
+			std::cout << filename << " has no faces" << std::endl;
+			return false;
+		}
+
+		// Fan triangulate every run into its place in its mesh's corners
+		std::vector<std::vector<ObjCorner>> meshCorners(model.meshes.size());
+		for (size_t m = 0; m < model.meshes.size(); m++)
+			meshCorners[m].resize(meshTriangles[m] * 3);
+
+		ParallelFor(threadPool, runs.size(), [&](size_t r)
+		{
+			const ObjRun& run{ runs[r] };
+			const ObjChunk& chunk{ chunks[run.chunk] };
+			ObjCorner* out{ meshCorners[run.mesh].data() + run.firstTriangle * 3 };
+
+			for (unsigned int f = run.firstFace; f < run.firstFace + run.numFaces; f++)
+			{
+				const ObjCorner* corners{ chunk.corners.data() + chunk.faces[f].firstCorner };
+				for (unsigned int corner = 2; corner < chunk.faces[f].numCorners; corner++)
+				{
+					*out++ = corners[0];
+					*out++ = corners[corner - 1];
+					*out++ = corners[corner];
+				}
+			}
+		});
+
+		chunks.clear();
+		endStep("OBJ triangulate");
+
+		// Weld each mesh then fill in its vertex streams from the distinct corners
+		const ObjValues values{ positions.data(), uvs.data(), normals.data() };
+		std::vector<ObjCorner> uniqueCorners;
+		for (size_t m = 0; m < model.meshes.size(); m++)
+		{
+			ObjMesh& mesh{ model.meshes[m] };
+			const std::vector<ObjCorner>& corners{ meshCorners[m] };
+
+			// A stream only some corners give is dropped rather than half filled, normals are then generated
+			const bool hasUVs{ std::all_of(corners.begin(), corners.end(), [](const ObjCorner& corner) { return corner.uv != kNoIndex; }) };
+			const bool hasNormals{ std::all_of(corners.begin(), corners.end(), [](const ObjCorner& corner) { return corner.normal != kNoIndex; }) };
+			if (!hasUVs || !hasNormals)
+			{
+				for (ObjCorner& corner : meshCorners[m])
+				{
+					if (!hasUVs)
+						corner.uv = kNoIndex;
+					if (!hasNormals)
+						corner.normal = kNoIndex;
+				}
+			}
+
+			WeldCorners(threadPool, values, corners, uniqueCorners, mesh.elements);
+
+			const size_t numVertices{ uniqueCorners.size() };
+			mesh.vertices.resize(numVertices);
+			if (hasNormals)
+				mesh.normals.resize(numVertices);
+			if (hasUVs)
+				mesh.uvCoords.resize(numVertices);
+
+			ParallelFor(threadPool, (numVertices + kWeldBlockCorners - 1) / kWeldBlockCorners, [&](size_t block)
+			{
+				const size_t last{ std::min(numVertices, (block + 1) * kWeldBlockCorners) };
+				for (size_t v = block * kWeldBlockCorners; v < last; v++)
+				{
+					mesh.vertices[v] = positions[uniqueCorners[v].position];
+					if (hasNormals)
+						mesh.normals[v] = normals[uniqueCorners[v].normal];
+					if (hasUVs)
+						mesh.uvCoords[v] = uvs[uniqueCorners[v].uv];
+				}
+			});
+
+			if (!hasNormals)
+				GenerateSmoothNormals(uniqueCorners, mesh);
+
+			meshCorners[m] = std::vector<ObjCorner>();
+		}
+		endStep("OBJ weld");
+
+		return true;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+// Native reader for Wavefront OBJ files and their MTL material libraries, parsed across the thread pool
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+
+namespace Helpers
+{
+
+	// The faces of an OBJ file that use one material, triangulated and welded into indexed vertices
+	struct ObjMesh
+	{
+		// Object or group the material was first used in
+		std::string name;
+
+		// Index into the ObjModel materials
+		size_t materialIndex{ 0 };
+
+		// Normals are always present, generated smooth if the file has none. uvCoords is empty if the file has none.
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> uvCoords;
+		std::vector<unsigned int> elements;
+	};
+
+	// Everything read from an OBJ file
+	struct ObjModel
+	{
+		std::vector<ObjMesh> meshes;
+
+		// Only the materials the faces use, in order of first use
+		std::vector<Material> materials;
+
+		// Time taken by each stage of the read
+		std::vector<ImportStepTiming> steps;
+	};
+
+	// Read an OBJ file and the material libraries it names, returns false if it cannot be read or has no faces.
+	// The file is memory mapped and split into line aligned chunks that are parsed in parallel.
+	// Polygons are fan triangulated and corners with the same position, uv and normal share a vertex,
+	// numbered in the order the elements first use them.
+	bool ReadObj(const std::string& filename, ThreadPool* threadPool, ObjModel& model);
+
+	// Decimal text to float without locale or allocation, skipping leading blanks.
+	// Advances cursor past the number, returns false and leaves cursor alone if there is none.
+	bool ParseFloat(const char*& cursor, const char* end, float& value);
+
+}
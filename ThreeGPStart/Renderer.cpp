@@ -5,47 +5,137 @@
 #include "Model.h"
 #include "ModelTerrain.h"
 #include "ModelSkyBox.h"
+#include "MaterialLibrary.h"
+
+namespace
+{
+	// Shaders every model is drawn with, recompiled when either changes on disk
+	const std::string kVertexShaderFile{ "Data/Shaders/vertex_shader.glsl" };
+	const std::string kFragmentShaderFile{ "Data/Shaders/fragment_shader.glsl" };
+
+	// Longest the first frame waits for texture decodes, the rest appear grey and stream in while drawing
+	const double kFirstFrameTextureWaitMs{ 100.0 };
+
+	// Texture mip levels uploaded each frame, at least one level goes up whatever its size
+	const size_t kTextureStreamBytesPerFrame{ 4 * 1024 * 1024 };
+}
 
 // On exit must clean up any OpenGL resources e.g. the program, the buffers
 Renderer::~Renderer()
 {
+	TextureManager::Shared().WaitForReloads();
+	MaterialLibrary::Shared().Clear();
 	glDeleteProgram(m_program);	
 	glDeleteBuffers(1, &m_VAO);
 }
 
 // Load, compile and link the shaders and create a program object to host them
+// The program only replaces m_program once it links, so a broken shader edit leaves the previous one drawing
 bool Renderer::CreateProgram()
 {
 	// Create a new program (returns a unqiue id)
-	m_program = glCreateProgram();
+	GLuint program{ glCreateProgram() };
 
 	// Load and create vertex and fragment shaders
-	GLuint vertex_shader{ Helpers::LoadAndCompileShader(GL_VERTEX_SHADER, "Data/Shaders/vertex_shader.glsl") };
-	GLuint fragment_shader{ Helpers::LoadAndCompileShader(GL_FRAGMENT_SHADER, "Data/Shaders/fragment_shader.glsl") };
+	GLuint vertex_shader{ Helpers::LoadAndCompileShader(GL_VERTEX_SHADER, kVertexShaderFile) };
+	GLuint fragment_shader{ Helpers::LoadAndCompileShader(GL_FRAGMENT_SHADER, kFragmentShaderFile) };
 	if (vertex_shader == 0 || fragment_shader == 0)
+	{
+		glDeleteShader(vertex_shader);
+		glDeleteShader(fragment_shader);
+		glDeleteProgram(program);
 		return false;
+	}
 
 	// Attach the vertex shader to this program (copies it)
-	glAttachShader(m_program, vertex_shader);
+	glAttachShader(program, vertex_shader);
 
 	// The attibute 0 maps to the input stream "vertex_position" in the vertex shader
 	// Not needed if you use (location=0) in the vertex shader itself
-	//glBindAttribLocation(m_program, 0, "vertex_position");
+	//glBindAttribLocation(program, 0, "vertex_position");
 
 	// Attach the fragment shader (copies it)
-	glAttachShader(m_program, fragment_shader);
+	glAttachShader(program, fragment_shader);
 
 	// Done with the originals of these as we have made copies
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
 
 	// Link the shaders, checking for errors
-	if (!Helpers::LinkProgramShaders(m_program))
+	if (!Helpers::LinkProgramShaders(program))
+	{
+		glDeleteProgram(program);
 		return false;
+	}
+
+	glDeleteProgram(m_program);
+	m_program = program;
+
+	// Material colours come from the MaterialLibrary's uniform buffer
+	MaterialLibrary::BindProgram(m_program);
 
 	return !Helpers::CheckForGLError();
 }
 
+// Watch the shaders and every file the models were loaded from
+void Renderer::WatchAssets()
+{
+	std::vector<std::string> filenames{ kVertexShaderFile, kFragmentShaderFile };
+
+	const std::vector<std::string> textureFiles{ TextureManager::Shared().GetFilenames() };
+	filenames.insert(filenames.end(), textureFiles.begin(), textureFiles.end());
+
+	const std::vector<std::string> modelFiles{ MeshResourceCache::Shared().GetFilenames() };
+	filenames.insert(filenames.end(), modelFiles.begin(), modelFiles.end());
+
+	size_t numWatched{ 0 };
+	for (const std::string& filename : filenames)
+	{
+		if (m_watcher.Watch(filename))
+			numWatched++;
+	}
+
+	std::cout << "Watching " << numWatched << " asset files for changes" << std::endl;
+}
+
+// Rebuild only what depends on the files changed since the last frame
+// Imports and decodes run on the worker threads and are picked up by a later frame, so the frame only
+// pays for shader compiles and GL uploads
+void Renderer::ReloadChangedAssets()
+{
+	bool reloadProgram{ false };
+	for (const std::string& path : m_watcher.Poll())
+	{
+		if (path == Helpers::CanonicalPath(kVertexShaderFile) || path == Helpers::CanonicalPath(kFragmentShaderFile))
+		{
+			reloadProgram = true;
+			continue;
+		}
+
+		// A file may be both a texture and a model of some odd format, so ask both
+		TextureManager::Shared().BeginReload(path, m_threadPool);
+		MeshResourceCache::Shared().BeginReload(path, m_threadPool);
+	}
+
+	if (reloadProgram)
+	{
+		Helpers::Timer compileTimer;
+		if (CreateProgram())
+			std::cout << "Reloaded shaders in " << compileTimer.ElapsedMs() << " ms" << std::endl;
+		else
+			std::cout << "Shader reload failed, keeping the previous program" << std::endl;
+	}
+
+	const bool texturesChanged{ TextureManager::Shared().FinishReloads(m_threadPool) };
+	const bool meshesChanged{ MeshResourceCache::Shared().FinishReloads(m_threadPool) };
+
+	if (texturesChanged || meshesChanged)
+	{
+		for (Model* model : myModels)
+			model->OnAssetsReloaded();
+	}
+}
+
 // Load / create geometry into OpenGL buffers	
 bool Renderer::InitialiseGeometry()
 {
@@ -53,48 +143,95 @@ bool Renderer::InitialiseGeometry()
 	if (!CreateProgram())
 		return false;
 
+	//Models are all created up front so their CPU side loading can run in parallel
 	ModelSkyBox* skyBox = new ModelSkyBox("Data\\Sky\\Clouds\\skybox.x"); //Create Skybox
-	if (!skyBox->Initialise()) 
-	{
-		//ERROR
-		std::cout << "Unable to load texture" << std::endl;
-		return false;
-	}
 	myModels.push_back(skyBox); //Add to model vector
 
 	ModelTerrain* terrain = new ModelTerrain(10000, 64); //Create Terrain
 	terrain->Texture("Data\\Textures\\grass.jpg");
-	if (!terrain->Initialise())
-	{
-		//ERROR
-		std::cout << "Unable to load texture" << std::endl;
-		return false;
-	}
+	terrain->SetVertexEncoding(Helpers::VertexEncoding::Compact); //Half the vertex memory
 	myModels.push_back(terrain); //Add to model vector
 
+	//Jeeps are raised to the terrain height once the terrain has been generated
 	float jeepX = 0.0f;
 	float jeepZ = 0.0f;
-	Model* jeep = new Model("Data\\Models\\Jeep\\jeep.obj", jeepX, (GetHeight(*terrain, jeepX, jeepZ)) + 50, jeepZ, 1.0f); //Create first Jeep
+	Model* jeep = new Model("Data\\Models\\Jeep\\jeep.obj", jeepX, 50, jeepZ, 1.0f); //Create first Jeep
 	jeep->Texture("Data\\Models\\Jeep\\jeep_army.jpg");
-	if (!jeep->Initialise())
-	{
-		//ERROR
-		std::cout << "Unable to load texture" << std::endl;
-		return false;
-	}
+	jeep->SetVertexEncoding(Helpers::VertexEncoding::Compact);
 	myModels.push_back(jeep); //Add to model vector
 
 	float jeepTwoX = 1000.0f;
 	float jeepTwoZ = 1000.0f;
-	Model* jeepTwo = new Model("Data\\Models\\Jeep\\jeep.obj", jeepTwoX, (GetHeight(*terrain, jeepTwoX, jeepTwoZ)) + 50, jeepTwoZ, 1.0f); //Create second Jeep
+	Model* jeepTwo = new Model("Data\\Models\\Jeep\\jeep.obj", jeepTwoX, 50, jeepTwoZ, 1.0f); //Create second Jeep
 	jeepTwo->Texture("Data\\Models\\Jeep\\jeep_rood.jpg");
-	if (!jeepTwo->Initialise())
+	jeepTwo->SetVertexEncoding(Helpers::VertexEncoding::Compact);
+	myModels.push_back(jeepTwo); //Add to model vector
+
+	Helpers::Timer totalTimer;
+
+	//CPU side loading (model import, image decode, terrain generation) on the worker threads
+	std::vector<std::future<bool>> loads;
+	for (Model* model : myModels)
+	{
+		loads.push_back(m_threadPool.Submit([this, model]()
+		{
+			Helpers::Timer loadTimer;
+			bool loaded = model->Load(&m_threadPool);
+			std::cout << "Loaded " << (model->GetName().empty() ? "terrain" : model->GetName()) << " in " << loadTimer.ElapsedMs() << " ms" << std::endl;
+			if (model->GetImportReport())
+			{
+				std::cout << model->GetImportReport()->ToString() << std::endl;
+			}
+			return loaded;
+		}));
+	}
+
+	//Every load must finish before returning as the tasks use the models
+	bool allLoaded = true;
+	for (std::future<bool>& load : loads)
+	{
+		allLoaded = load.get() && allLoaded;
+	}
+
+	std::cout << "CPU loading on " << m_threadPool.NumThreads() << " threads took " << totalTimer.ElapsedMs() << " ms" << std::endl;
+
+	if (!allLoaded)
 	{
 		//ERROR
-		std::cout << "Unable to load texture" << std::endl;
+		std::cout << "Unable to load model" << std::endl;
+		return false;
+	}
+
+	//Textures decode in the background, so only give them a fixed time before drawing starts
+	TextureManager::Shared().WaitForLoads(kFirstFrameTextureWaitMs);
+
+	//GL uploads stay on this thread as it owns the context
+	for (Model* model : myModels)
+	{
+		Helpers::Timer uploadTimer;
+		if (!model->Upload())
+		{
+			//ERROR
+			std::cout << "Unable to upload model" << std::endl;
+			return false;
+		}
+		std::cout << "Uploaded " << (model->GetName().empty() ? "terrain" : model->GetName()) << " in " << uploadTimer.ElapsedMs() << " ms" << std::endl;
+	}
+
+	//Models without imported materials still need the built in ones
+	if (!MaterialLibrary::Shared().Upload())
+	{
 		return false;
 	}
-	myModels.push_back(jeepTwo); //Add to model vector
+
+	jeep->Move(0, GetHeight(*terrain, jeepX, jeepZ), 0);
+	jeepTwo->Move(0, GetHeight(*terrain, jeepTwoX, jeepTwoZ), 0);
+
+	std::cout << TextureManager::Shared().StatsString() << std::endl;
+	std::cout << MaterialLibrary::Shared().NumMaterials() << " materials in the material buffer" << std::endl;
+	std::cout << "Total geometry initialisation took " << totalTimer.ElapsedMs() << " ms" << std::endl;
+
+	WatchAssets();
 
 	return true;
 }
@@ -109,6 +246,16 @@ float Renderer::GetHeight(Model& model, float posX, float posZ) //Get terrain He
 // Render the scene. Passed the delta time since last called.
 void Renderer::Render(const Helpers::Camera& camera, float deltaTime)
 {		
+	// Pick up any assets edited since the last frame
+	ReloadChangedAssets();
+
+	// Textures whose decodes have landed and the finer mips of those drawn largest last frame
+	if (TextureManager::Shared().Stream(kTextureStreamBytesPerFrame))
+	{
+		for (Model* model : myModels)
+			model->OnAssetsReloaded();
+	}
+
 	// Configure pipeline settings
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
@@ -133,9 +280,19 @@ void Renderer::Render(const Helpers::Camera& camera, float deltaTime)
 	// Use our program. Doing this enables the shaders we attached previously.
 	glUseProgram(m_program);
 
+	// Lighting is the same for every draw so is only sent once a frame
+	glUniform3fv(glGetUniformLocation(m_program, "light_position"), 1, glm::value_ptr(m_lightPosition));
+	glUniform3fv(glGetUniformLocation(m_program, "light_colour"), 1, glm::value_ptr(m_lightColour));
+	glUniform3fv(glGetUniformLocation(m_program, "ambient_light"), 1, glm::value_ptr(m_ambientLight));
+	const glm::vec3 cameraPosition = camera.GetPosition();
+	glUniform3fv(glGetUniformLocation(m_program, "camera_position"), 1, glm::value_ptr(cameraPosition));
+
+	DrawStats::Current().Reset();
+
 	for (auto& model : myModels) //Loop through all models in model vector
 	{
 
+		model->Update(deltaTime, &m_threadPool); //Advance animations
 		model->Render(camera, m_program, projection_xform, view_xform); //Render all model
 
 	}
@@ -5,6 +5,8 @@
 #include "Helper.h"
 #include "Mesh.h"
 #include "Camera.h"
+#include "ThreadPool.h"
+#include "FileWatcher.h"
 
 class Model;
 class Renderer
@@ -16,8 +18,19 @@ protected:
 	GLuint m_VAO{ 0 };
 	// Number of elments to use when rendering
 	GLuint m_numElements{ 0 };
+	// Worker threads for CPU side asset loading
+	Helpers::ThreadPool m_threadPool;
+	// Single point light and the ambient light every material's ambient colour is scaled by
+	glm::vec3 m_lightPosition{ 0, 5000, 0 };
+	glm::vec3 m_lightColour{ 0.8f };
+	glm::vec3 m_ambientLight{ 0.7f };
+
+	// Asset files changed on disk are reloaded while running
+	Helpers::FileWatcher m_watcher;
 
 	bool CreateProgram();
+	void WatchAssets();
+	void ReloadChangedAssets();
 public:
 
 	std::vector<Model*> myModels; //Vector for all models
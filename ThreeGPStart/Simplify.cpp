@@ -0,0 +1,349 @@
+#include "Simplify.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <tuple>
+#include <unordered_map>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Sum of squared distances to a set of planes, weighted by area (Garland and Heckbert)
+		struct Quadric
+		{
+			double a00{ 0 }, a01{ 0 }, a02{ 0 }, a03{ 0 };
+			double a11{ 0 }, a12{ 0 }, a13{ 0 };
+			double a22{ 0 }, a23{ 0 };
+			double a33{ 0 };
+			double weight{ 0 };
+
+			void AddPlane(const glm::dvec3& normal, double distance, double planeWeight)
+			{
+				a00 += planeWeight * normal.x * normal.x;
+				a01 += planeWeight * normal.x * normal.y;
+				a02 += planeWeight * normal.x * normal.z;
+				a03 += planeWeight * normal.x * distance;
+				a11 += planeWeight * normal.y * normal.y;
+				a12 += planeWeight * normal.y * normal.z;
+				a13 += planeWeight * normal.y * distance;
+				a22 += planeWeight * normal.z * normal.z;
+				a23 += planeWeight * normal.z * distance;
+				a33 += planeWeight * distance * distance;
+				weight += planeWeight;
+			}
+
+			void Add(const Quadric& other)
+			{
+				a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+				a11 += other.a11; a12 += other.a12; a13 += other.a13;
+				a22 += other.a22; a23 += other.a23;
+				a33 += other.a33;
+				weight += other.weight;
+			}
+
+			// Mean squared distance of point from the planes
+			double Error(const glm::vec3& point) const
+			{
+				const double x{ point.x }, y{ point.y }, z{ point.z };
+				const double sum{ a00 * x * x + a11 * y * y + a22 * z * z + a33 +
+					2.0 * (a01 * x * y + a02 * x * z + a12 * y * z + a03 * x + a13 * y + a23 * z) };
+				return weight > 0 ? std::abs(sum) / weight : 0;
+			}
+		};
+
+		enum class VertexKind : unsigned char
+		{
+			Manifold,	// Free to collapse onto any neighbour
+			Border,		// On an open edge, may only slide along it
+			Locked		// Shares its position with another vertex (an attribute seam) or is otherwise pinned
+		};
+
+		struct Collapse
+		{
+			unsigned int from;
+			unsigned int to;
+			double cost;
+		};
+
+		unsigned long long EdgeKey(unsigned int a, unsigned int b) { return ((unsigned long long)a << 32) | b; }
+	}
+
+	size_t SimplifyMesh(unsigned int* destination, const unsigned int* elements, size_t numElements,
+		const glm::vec3* vertices, size_t numVertices, size_t targetNumElements, float maxError, float& error)
+	{
+		error = 0;
+
+		// Vertices are joined by position, so splits in other attributes show up as several vertices at one position
+		std::vector<unsigned int> positionId(numVertices);
+		std::vector<unsigned int> verticesAtPosition(numVertices, 0);
+		{
+			std::map<std::tuple<float, float, float>, unsigned int> firstAtPosition;
+			for (size_t v = 0; v < numVertices; v++)
+			{
+				auto inserted = firstAtPosition.emplace(std::make_tuple(vertices[v].x, vertices[v].y, vertices[v].z), (unsigned int)v);
+				positionId[v] = inserted.first->second;
+				verticesAtPosition[positionId[v]]++;
+			}
+		}
+
+		// An edge between positions used by only one triangle is an open border
+		std::unordered_map<unsigned long long, unsigned int> edgeUse;
+		edgeUse.reserve(numElements);
+		for (size_t i = 0; i < numElements; i += 3)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				unsigned int a{ positionId[elements[i + corner]] };
+				unsigned int b{ positionId[elements[i + (corner + 1) % 3]] };
+				edgeUse[EdgeKey(std::min(a, b), std::max(a, b))]++;
+			}
+		}
+		auto isBorderEdge = [&](unsigned int a, unsigned int b)
+		{
+			const unsigned int pa{ positionId[a] };
+			const unsigned int pb{ positionId[b] };
+			auto found = edgeUse.find(EdgeKey(std::min(pa, pb), std::max(pa, pb)));
+			return found != edgeUse.end() && found->second == 1;
+		};
+
+		std::vector<VertexKind> kind(numVertices, VertexKind::Manifold);
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			if (verticesAtPosition[positionId[v]] > 1)
+				kind[v] = VertexKind::Locked;
+		}
+		for (size_t i = 0; i < numElements; i += 3)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const unsigned int a{ elements[i + corner] };
+				const unsigned int b{ elements[i + (corner + 1) % 3] };
+				if (isBorderEdge(a, b))
+				{
+					if (kind[a] == VertexKind::Manifold)
+						kind[a] = VertexKind::Border;
+					if (kind[b] == VertexKind::Manifold)
+						kind[b] = VertexKind::Border;
+				}
+			}
+		}
+
+		// Each vertex starts with the planes of the triangles around it, border edges add a steep plane to hold the outline
+		std::vector<Quadric> quadrics(numVertices);
+		for (size_t i = 0; i < numElements; i += 3)
+		{
+			const glm::dvec3 p0{ vertices[elements[i]] };
+			const glm::dvec3 p1{ vertices[elements[i + 1]] };
+			const glm::dvec3 p2{ vertices[elements[i + 2]] };
+			glm::dvec3 normal{ glm::cross(p1 - p0, p2 - p0) };
+			const double doubleArea{ glm::length(normal) };
+			if (doubleArea == 0)
+				continue;
+			normal /= doubleArea;
+
+			for (int corner = 0; corner < 3; corner++)
+				quadrics[elements[i + corner]].AddPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5);
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const unsigned int a{ elements[i + corner] };
+				const unsigned int b{ elements[i + (corner + 1) % 3] };
+				if (!isBorderEdge(a, b))
+					continue;
+
+				const glm::dvec3 pa{ vertices[a] };
+				const glm::dvec3 edge{ glm::dvec3(vertices[b]) - pa };
+				const double edgeLengthSq{ glm::dot(edge, edge) };
+				if (edgeLengthSq == 0)
+					continue;
+
+				const glm::dvec3 edgeNormal{ glm::normalize(glm::cross(edge, normal)) };
+				const double borderWeight{ 10.0 * edgeLengthSq };
+				quadrics[a].AddPlane(edgeNormal, -glm::dot(edgeNormal, pa), borderWeight);
+				quadrics[b].AddPlane(edgeNormal, -glm::dot(edgeNormal, pa), borderWeight);
+			}
+		}
+
+		std::vector<unsigned int> result(elements, elements + numElements);
+		const double maxCost{ (double)maxError * (double)maxError };
+		double worstCost{ 0 };
+
+		std::vector<Collapse> collapses;
+		std::vector<unsigned int> collapseTo(numVertices);
+		std::vector<unsigned char> touched(numVertices);
+		std::vector<unsigned int> triangleOffsets(numVertices + 1);
+		std::vector<unsigned int> vertexTriangles;
+
+		while (result.size() > targetNumElements)
+		{
+			const size_t numTriangles{ result.size() / 3 };
+
+			// Triangles around each vertex, for the fold over test
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (unsigned int v : result)
+				triangleOffsets[v + 1]++;
+			for (size_t v = 0; v < numVertices; v++)
+				triangleOffsets[v + 1] += triangleOffsets[v];
+			vertexTriangles.resize(result.size());
+			{
+				std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+				for (size_t i = 0; i < result.size(); i++)
+					vertexTriangles[fill[result[i]]++] = (unsigned int)(i / 3);
+			}
+
+			// Every allowed half edge collapse with its cost
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int corner = 0; corner < 3; corner++)
+				{
+					const unsigned int a{ result[i + corner] };
+					const unsigned int b{ result[i + (corner + 1) % 3] };
+					const unsigned int ends[2][2]{ { a, b }, { b, a } };
+					for (const auto& end : ends)
+					{
+						const unsigned int from{ end[0] };
+						const unsigned int to{ end[1] };
+						const bool allowed{ kind[from] == VertexKind::Manifold ||
+							(kind[from] == VertexKind::Border && kind[to] != VertexKind::Manifold && isBorderEdge(from, to)) };
+						if (!allowed)
+							continue;
+
+						Quadric combined{ quadrics[from] };
+						combined.Add(quadrics[to]);
+						collapses.push_back(Collapse{ from, to, combined.Error(vertices[to]) });
+					}
+				}
+			}
+
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			// Take the cheapest collapses that do not overlap, enough to reach the target this pass
+			for (size_t v = 0; v < numVertices; v++)
+				collapseTo[v] = (unsigned int)v;
+			std::fill(touched.begin(), touched.end(), 0);
+
+			const size_t trianglesToRemove{ (result.size() - targetNumElements) / 3 };
+
+			// Blocked neighbours mean a pass cannot take every cheap collapse, so hold the rest back for a later pass
+			// rather than reach further up the cost order
+			const double passCost{ std::min(maxCost, collapses[std::min(trianglesToRemove, collapses.size() - 1)].cost * 1.5) };
+			size_t trianglesRemoved{ 0 };
+			size_t numCollapses{ 0 };
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (trianglesRemoved >= trianglesToRemove || collapse.cost > passCost)
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				// Reject if any triangle that survives would flip over or become a sliver
+				bool flips{ false };
+				unsigned int removes{ 0 };
+				for (unsigned int t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; t++)
+				{
+					const unsigned int* triangle{ &result[vertexTriangles[t] * 3] };
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					{
+						removes++;
+						continue;
+					}
+
+					glm::vec3 corners[3];
+					glm::vec3 moved[3];
+					for (int corner = 0; corner < 3; corner++)
+					{
+						corners[corner] = vertices[triangle[corner]];
+						moved[corner] = triangle[corner] == collapse.from ? vertices[collapse.to] : corners[corner];
+					}
+					const glm::vec3 before{ glm::cross(corners[1] - corners[0], corners[2] - corners[0]) };
+					const glm::vec3 after{ glm::cross(moved[1] - moved[0], moved[2] - moved[0]) };
+					const float afterLength{ glm::length(after) };
+					flips = afterLength == 0 || glm::dot(before, after) < 0.25f * glm::length(before) * afterLength;
+				}
+				if (flips)
+					continue;
+
+				collapseTo[collapse.from] = collapse.to;
+				quadrics[collapse.to].Add(quadrics[collapse.from]);
+				worstCost = std::max(worstCost, collapse.cost);
+				trianglesRemoved += removes;
+				numCollapses++;
+
+				// Everything around the collapse is now stale for this pass
+				for (unsigned int t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++)
+				{
+					const unsigned int* triangle{ &result[vertexTriangles[t] * 3] };
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+				}
+				touched[collapse.to] = 1;
+			}
+
+			if (numCollapses == 0)
+				break;
+
+			// Apply the collapses and drop the triangles that became degenerate
+			size_t write{ 0 };
+			for (size_t t = 0; t < numTriangles; t++)
+			{
+				const unsigned int a{ collapseTo[result[t * 3]] };
+				const unsigned int b{ collapseTo[result[t * 3 + 1]] };
+				const unsigned int c{ collapseTo[result[t * 3 + 2]] };
+				if (a == b || b == c || a == c)
+					continue;
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+		}
+
+		error = (float)std::sqrt(worstCost);
+		std::copy(result.begin(), result.end(), destination);
+		return result.size();
+	}
+
+	std::vector<MeshLod> BuildLods(const glm::vec3* vertices, size_t numVertices, const unsigned int* elements, size_t numElements,
+		std::vector<unsigned int>& lodElements, unsigned int maxLods)
+	{
+		std::vector<MeshLod> lods;
+		lodElements.clear();
+
+		// Each level is simplified from the one before, which is much quicker than starting from the full mesh every time,
+		// so its error is the sum of the steps taken to get there
+		std::vector<unsigned int> previous(elements, elements + numElements);
+		std::vector<unsigned int> simplified(numElements);
+		float totalError{ 0 };
+
+		while (lods.size() < maxLods)
+		{
+			const size_t target{ previous.size() / 6 * 3 };
+			float error{ 0 };
+			const size_t numSimplified{ SimplifyMesh(simplified.data(), previous.data(), previous.size(), vertices, numVertices,
+				target, FLT_MAX, error) };
+
+			// Not worth the memory of another level if seams and borders held most of the triangles in place
+			if (numSimplified == 0 || numSimplified > previous.size() * 4 / 5)
+				break;
+
+			totalError += error;
+
+			MeshLod lod;
+			lod.firstElement = (unsigned int)lodElements.size();
+			lod.numElements = (unsigned int)numSimplified;
+			lod.error = totalError;
+			lods.push_back(lod);
+
+			lodElements.insert(lodElements.end(), simplified.begin(), simplified.begin() + numSimplified);
+			previous.assign(simplified.begin(), simplified.begin() + numSimplified);
+		}
+
+		return lods;
+	}
+}
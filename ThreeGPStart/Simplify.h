@@ -0,0 +1,26 @@
+#pragma once
+// Quadric error mesh simplification used to build levels of detail
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+
+namespace Helpers
+{
+
+	// Reduce the triangle list in elements towards targetNumElements by collapsing edges onto existing vertices, so the
+	// result indexes the same vertex data. Vertices where attributes split, such as UV seams, and open borders are kept in
+	// place so the appearance holds together. Simplification stops early rather than exceed maxError, a distance in the
+	// same units as the vertices. destination needs room for numElements values.
+	// Returns the number of elements written, error is set to the largest distance the surface was moved.
+	size_t SimplifyMesh(unsigned int* destination, const unsigned int* elements, size_t numElements,
+		const glm::vec3* vertices, size_t numVertices, size_t targetNumElements, float maxError, float& error);
+
+	// Most levels of detail built per mesh, each aims for half the triangles of the one before
+	const unsigned int kMaxLods{ 3 };
+
+	// Build a chain of simplified levels of detail for a mesh. Their triangles are written to lodElements, which the
+	// returned ranges index. Stops early once a level would not remove enough triangles to be worth drawing.
+	std::vector<MeshLod> BuildLods(const glm::vec3* vertices, size_t numVertices, const unsigned int* elements, size_t numElements,
+		std::vector<unsigned int>& lodElements, unsigned int maxLods = kMaxLods);
+
+}
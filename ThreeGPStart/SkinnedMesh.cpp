@@ -0,0 +1,87 @@
+#include "SkinnedMesh.h"
+#include "Helper.h"
+
+#include <cstddef>
+
+SkinnedMesh::SkinnedMesh(const Helpers::Mesh& mesh, const MyMesh& uploaded) : m_numElements(uploaded.numElements), m_elementType(uploaded.elementType), m_materialIndex(uploaded.materialIndex), m_vertices(mesh.vertices.size())
+{
+
+	glGenVertexArrays(1, &m_VAO);
+	glBindVertexArray(m_VAO);
+
+	//Storage only, filled by the first Upload
+	glGenBuffers(1, &m_vertexVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(Helpers::SkinnedVertex) * m_vertices.size(), nullptr, GL_STREAM_DRAW);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Helpers::SkinnedVertex), (void*)offsetof(Helpers::SkinnedVertex, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Helpers::SkinnedVertex), (void*)offsetof(Helpers::SkinnedVertex, normal));
+
+	glGenBuffers(1, &m_texcoordsVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_texcoordsVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * mesh.uvCoords.size(), mesh.uvCoords.data(), GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, uploaded.elementBuffer);
+
+	// Clear VAO binding
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	Helpers::CheckForGLError();
+
+}
+
+SkinnedMesh::~SkinnedMesh()
+{
+
+	glDeleteVertexArrays(1, &m_VAO);
+
+	const GLuint buffers[] = { m_vertexVBO, m_texcoordsVBO };
+	glDeleteBuffers(2, buffers);
+
+}
+
+void SkinnedMesh::Skin(Helpers::ThreadPool* threadPool, const Helpers::Mesh& mesh, const glm::mat4* palette)
+{
+
+	Helpers::SkinMesh(threadPool, mesh, palette, m_vertices.data());
+
+}
+
+void SkinnedMesh::Upload()
+{
+
+	const GLsizeiptr numBytes = sizeof(Helpers::SkinnedVertex) * m_vertices.size();
+
+	//Orphan the old storage so the driver need not wait for last frame's draw to finish with it
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexVBO);
+	glBufferData(GL_ARRAY_BUFFER, numBytes, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, numBytes, m_vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+}
+
+void SkinnedMesh::Draw(GLuint program) const
+{
+
+	//Already skinned full float vertices, so no decode in the shader
+	glUniform3f(glGetUniformLocation(program, "position_offset"), 0, 0, 0);
+	glUniform3f(glGetUniformLocation(program, "position_scale"), 1, 1, 1);
+	glUniform1i(glGetUniformLocation(program, "oct_normals"), 0);
+	glUniform1i(glGetUniformLocation(program, "skinned"), 0);
+	glUniform1i(glGetUniformLocation(program, "instanced"), 0);
+	glUniform1i(glGetUniformLocation(program, "material_index"), (GLint)m_materialIndex);
+
+	glBindVertexArray(m_VAO);
+	glDrawElements(GL_TRIANGLES, m_numElements, m_elementType, (void*)0);
+
+	DrawStats::Current().drawCalls++;
+	DrawStats::Current().triangles += m_numElements / 3;
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+#include "MeshResource.h"
+#include "Skinning.h"
+#include "ThreadPool.h"
+
+//One instance of a mesh skinned on the CPU, for meshes with more bones than the vertex shader palette holds
+//or when comparing against GPU skinning. Positions and normals are re-uploaded every frame, UVs and elements never change.
+class SkinnedMesh
+{
+
+private:
+
+	GLuint m_VAO{ 0 };
+	GLuint m_vertexVBO{ 0 }; //Skinned positions and normals, rewritten every frame
+	GLuint m_texcoordsVBO{ 0 };
+
+	GLuint m_numElements{ 0 };
+	GLenum m_elementType{ GL_UNSIGNED_INT };
+	GLuint m_materialIndex{ 0 };
+
+	std::vector<Helpers::SkinnedVertex> m_vertices; //Kept between frames so skinning never allocates
+
+public:
+
+	SkinnedMesh(const Helpers::Mesh& mesh, const MyMesh& uploaded); //Shares the element buffer of the uploaded mesh
+	~SkinnedMesh();
+
+	SkinnedMesh(const SkinnedMesh&) = delete;
+	SkinnedMesh& operator=(const SkinnedMesh&) = delete;
+
+	void Skin(Helpers::ThreadPool* threadPool, const Helpers::Mesh& mesh, const glm::mat4* palette); //CPU work only, safe while other meshes draw
+	void Upload(); //Send the skinned vertices to the GPU, GL thread only
+	void Draw(GLuint program) const; //Draw the last uploaded pose
+
+};
@@ -0,0 +1,91 @@
+#include "Skinning.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SKINNING_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace Helpers
+{
+	// Plain per component version of SkinVertices, kept for platforms without SSE and for comparison
+	void SkinVerticesScalar(const Mesh& mesh, const glm::mat4* palette, size_t first, size_t count, SkinnedVertex* out)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const size_t v{ first + i };
+			const glm::u8vec4& indices{ mesh.boneIndices[v] };
+			const glm::vec4& weights{ mesh.boneWeights[v] };
+
+			const glm::mat4 skin{
+				palette[indices.x] * weights.x +
+				palette[indices.y] * weights.y +
+				palette[indices.z] * weights.z +
+				palette[indices.w] * weights.w };
+
+			out[i].position = glm::vec3(skin * glm::vec4(mesh.vertices[v], 1.0f));
+			out[i].normal = glm::mat3(skin) * mesh.normals[v];
+		}
+	}
+
+	// Skin vertices [first, first + count) of mesh, uses SSE where available
+	void SkinVertices(const Mesh& mesh, const glm::mat4* palette, size_t first, size_t count, SkinnedVertex* out)
+	{
+#ifdef SKINNING_USE_SSE
+		// Each palette column is one register, so blending the four bone matrices is sixteen multiply adds
+		// and transforming by the result is a broadcast of each input component against a column
+		for (size_t i = 0; i < count; i++)
+		{
+			const size_t v{ first + i };
+			const glm::u8vec4& indices{ mesh.boneIndices[v] };
+			const glm::vec4& weights{ mesh.boneWeights[v] };
+
+			__m128 col0{ _mm_setzero_ps() }, col1{ _mm_setzero_ps() }, col2{ _mm_setzero_ps() }, col3{ _mm_setzero_ps() };
+			for (int influence = 0; influence < 4; influence++)
+			{
+				const float* bone{ &palette[indices[influence]][0][0] };
+				const __m128 weight{ _mm_set1_ps(weights[influence]) };
+				col0 = _mm_add_ps(col0, _mm_mul_ps(_mm_loadu_ps(bone), weight));
+				col1 = _mm_add_ps(col1, _mm_mul_ps(_mm_loadu_ps(bone + 4), weight));
+				col2 = _mm_add_ps(col2, _mm_mul_ps(_mm_loadu_ps(bone + 8), weight));
+				col3 = _mm_add_ps(col3, _mm_mul_ps(_mm_loadu_ps(bone + 12), weight));
+			}
+
+			// Positions and normals are broadcast a component at a time so nothing reads past the last vertex
+			const glm::vec3& position{ mesh.vertices[v] };
+			const __m128 skinnedPosition{ _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(position.x)), _mm_mul_ps(col1, _mm_set1_ps(position.y))),
+				_mm_add_ps(_mm_mul_ps(col2, _mm_set1_ps(position.z)), col3)) };
+
+			const glm::vec3& normal{ mesh.normals[v] };
+			const __m128 skinnedNormal{ _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(col0, _mm_set1_ps(normal.x)), _mm_mul_ps(col1, _mm_set1_ps(normal.y))),
+				_mm_mul_ps(col2, _mm_set1_ps(normal.z))) };
+
+			// The four wide position store spills into normal.x, which the normal store then overwrites
+			float* destination{ &out[i].position.x };
+			_mm_storeu_ps(destination, skinnedPosition);
+			_mm_storel_pi((__m64*)(destination + 3), skinnedNormal);
+			_mm_store_ss(destination + 5, _mm_movehl_ps(skinnedNormal, skinnedNormal));
+		}
+#else
+		SkinVerticesScalar(mesh, palette, first, count, out);
+#endif
+	}
+
+	// Skin the whole mesh in batches across the pool
+	void SkinMesh(ThreadPool* threadPool, const Mesh& mesh, const glm::mat4* palette, SkinnedVertex* out)
+	{
+		const size_t numVertices{ mesh.vertices.size() };
+		const size_t numBatches{ (numVertices + kSkinningBatchSize - 1) / kSkinningBatchSize };
+
+		ParallelFor(threadPool, numBatches, [&](size_t batch)
+		{
+			const size_t first{ batch * kSkinningBatchSize };
+			const size_t count{ std::min(kSkinningBatchSize, numVertices - first) };
+			SkinVertices(mesh, palette, first, count, out + first);
+		});
+	}
+}
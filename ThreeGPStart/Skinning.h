@@ -0,0 +1,32 @@
+#pragma once
+// Linear blend skinning on the CPU
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+
+namespace Helpers
+{
+	class ThreadPool;
+
+	// One skinned vertex as uploaded for drawing, normals are left unnormalised as the fragment shader normalises them
+	struct SkinnedVertex
+	{
+		glm::vec3 position{ 0 };
+		glm::vec3 normal{ 0 };
+	};
+
+	// Vertices handed to each task by SkinMesh, big enough to amortise the task overhead
+	const size_t kSkinningBatchSize{ 1024 };
+
+	// Skin vertices [first, first + count) of mesh with the palette from ComputeSkinPalette, writing to out[0, count).
+	// Uses SSE where available. The mesh must have bones and full float positions and normals.
+	void SkinVertices(const Mesh& mesh, const glm::mat4* palette, size_t first, size_t count, SkinnedVertex* out);
+
+	// Plain per component version of SkinVertices, kept for platforms without SSE and for comparison
+	void SkinVerticesScalar(const Mesh& mesh, const glm::mat4* palette, size_t first, size_t count, SkinnedVertex* out);
+
+	// Skin the whole mesh into out, which needs room for every vertex, in batches spread across the pool.
+	// With a null threadPool everything runs on the calling thread.
+	void SkinMesh(ThreadPool* threadPool, const Mesh& mesh, const glm::mat4* palette, SkinnedVertex* out);
+
+}
@@ -0,0 +1,41 @@
+#include "TextureCache.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace Helpers
+{
+
+	// Hash of the source file's bytes, the mip filter and the compressor version, so an edited image, another filter
+	// or a newer encoder rebuilds the cache
+	std::string TextureCache::MakeKey(const unsigned char* sourceBytes, size_t numBytes, MipFilter mipFilter)
+	{
+		// FNV-1a over 8 byte words, the source is read for every load so this needs to keep up with the disk
+		unsigned long long hash{ 14695981039346656037ull };
+		auto mix = [&hash](unsigned long long value) { hash = (hash ^ value) * 1099511628211ull; };
+
+		mix(numBytes);
+
+		size_t i{ 0 };
+		for (; i + 8 <= numBytes; i += 8)
+		{
+			unsigned long long word;
+			std::memcpy(&word, sourceBytes + i, sizeof(word));
+			mix(word);
+		}
+		for (; i < numBytes; i++)
+			mix(sourceBytes[i]);
+
+		char key[64];
+		std::snprintf(key, sizeof(key), "%016llx-%s-v%u", hash, MipFilterName(mipFilter), kVersion);
+		return key;
+	}
+
+	// Write a KTX file to the cache. Returns false on error.
+	bool TextureCache::Write(const std::string& cacheFilename, const std::vector<unsigned char>& ktx)
+	{
+		return WriteFileAtomically(cacheFilename, ktx);
+	}
+
+}
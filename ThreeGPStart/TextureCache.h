@@ -0,0 +1,35 @@
+#pragma once
+// Cache of textures block compressed on the CPU, written beside the source image as KTX so later runs skip decoding and compressing
+
+#include "ExternalLibraryHeaders.h"
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+
+namespace Helpers
+{
+
+	// Names and writes the cache files, ImageLoader reads them back as ordinary KTX files
+	class TextureCache
+	{
+	public:
+		// Bump whenever the compressor's output changes, older caches are then rebuilt
+		static const unsigned int kVersion{ 1 };
+
+		// KTX metadata key holding the key the cache was built for
+		static constexpr const char* kKeyName{ "ThreeGPStart.sourceKey" };
+
+		// Cache filename used for a given source image and requested format
+		static std::string CacheFilename(const std::string& sourceFilename, BlockFormat format)
+		{
+			return sourceFilename + "." + BlockFormatName(format) + ".ktx";
+		}
+
+		// Hash of the source file's bytes, the mip filter and the compressor version, so an edited image, another filter
+		// or a newer encoder rebuilds the cache
+		static std::string MakeKey(const unsigned char* sourceBytes, size_t numBytes, MipFilter mipFilter);
+
+		// Write a KTX file to the cache. Returns false on error.
+		static bool Write(const std::string& cacheFilename, const std::vector<unsigned char>& ktx);
+	};
+
+}
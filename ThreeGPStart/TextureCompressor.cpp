@@ -0,0 +1,495 @@
+#include "TextureCompressor.h"
+#include "TextureContainer.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Helpers
+{
+
+	namespace
+	{
+		// Texels of one 4x4 block, row by row
+		struct Block
+		{
+			glm::vec4 texels[16];
+		};
+
+		// Direction of greatest spread of the points about their mean, by power iteration on their covariance.
+		// Only the first numChannels components are used.
+		glm::vec4 PrincipalAxis(const glm::vec4* points, int numPoints, int numChannels, glm::vec4& mean)
+		{
+			mean = glm::vec4(0);
+			for (int i = 0; i < numPoints; i++)
+				mean += points[i];
+			mean /= (float)std::max(numPoints, 1);
+
+			float covariance[4][4]{};
+			for (int i = 0; i < numPoints; i++)
+			{
+				const glm::vec4 d{ points[i] - mean };
+				for (int r = 0; r < numChannels; r++)
+					for (int c = 0; c < numChannels; c++)
+						covariance[r][c] += d[r] * d[c];
+			}
+
+			// Start along the diagonal of the bounds, which is already close for most blocks
+			glm::vec4 minPoint{ points[0] };
+			glm::vec4 maxPoint{ points[0] };
+			for (int i = 1; i < numPoints; i++)
+			{
+				minPoint = glm::min(minPoint, points[i]);
+				maxPoint = glm::max(maxPoint, points[i]);
+			}
+			glm::vec4 axis{ maxPoint - minPoint };
+			for (int c = numChannels; c < 4; c++)
+				axis[c] = 0;
+
+			for (int iteration = 0; iteration < 8; iteration++)
+			{
+				glm::vec4 next{ 0 };
+				for (int r = 0; r < numChannels; r++)
+					for (int c = 0; c < numChannels; c++)
+						next[r] += covariance[r][c] * axis[c];
+
+				const float length{ glm::length(next) };
+				if (length < 1e-6f)
+					break;
+				axis = next / length;
+			}
+
+			const float length{ glm::length(axis) };
+			return length < 1e-6f ? glm::vec4(0) : axis / length;
+		}
+
+		// Ends of the points' spread along axis through mean
+		void ExtremesAlongAxis(const glm::vec4* points, int numPoints, const glm::vec4& mean, const glm::vec4& axis, glm::vec4& low, glm::vec4& high)
+		{
+			float minT{ 0 };
+			float maxT{ 0 };
+			for (int i = 0; i < numPoints; i++)
+			{
+				const float t{ glm::dot(points[i] - mean, axis) };
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+			low = glm::clamp(mean + axis * minT, glm::vec4(0), glm::vec4(255));
+			high = glm::clamp(mean + axis * maxT, glm::vec4(0), glm::vec4(255));
+		}
+
+		float DistanceSq(const glm::vec3& a, const glm::vec3& b)
+		{
+			const glm::vec3 d{ a - b };
+			return glm::dot(d, d);
+		}
+
+		// 5:6:5 colour and its expansion back to 8 bits per channel
+		unsigned int Pack565(const glm::vec3& colour)
+		{
+			const unsigned int r{ (unsigned int)std::lround(glm::clamp(colour.r, 0.0f, 255.0f) * 31.0f / 255.0f) };
+			const unsigned int g{ (unsigned int)std::lround(glm::clamp(colour.g, 0.0f, 255.0f) * 63.0f / 255.0f) };
+			const unsigned int b{ (unsigned int)std::lround(glm::clamp(colour.b, 0.0f, 255.0f) * 31.0f / 255.0f) };
+			return (r << 11) | (g << 5) | b;
+		}
+
+		glm::vec3 Unpack565(unsigned int packed)
+		{
+			const unsigned int r{ (packed >> 11) & 31 };
+			const unsigned int g{ (packed >> 5) & 63 };
+			const unsigned int b{ packed & 31 };
+			return glm::vec3((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)));
+		}
+
+		// Palette of a BC1 colour block, index 3 is transparent black when c0 <= c1
+		void Bc1Palette(unsigned int c0, unsigned int c1, glm::vec3 palette[4])
+		{
+			palette[0] = Unpack565(c0);
+			palette[1] = Unpack565(c1);
+			if (c0 > c1)
+			{
+				palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+				palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+			}
+			else
+			{
+				palette[2] = (palette[0] + palette[1]) / 2.0f;
+				palette[3] = glm::vec3(0);
+			}
+		}
+
+		// Nearest palette entry for each texel, transparent texels take index 3 in three colour mode. Returns the total error.
+		float ChooseBc1Indices(const Block& block, const bool transparent[16], unsigned int c0, unsigned int c1, unsigned int indices[16])
+		{
+			glm::vec3 palette[4];
+			Bc1Palette(c0, c1, palette);
+			const int numColours{ c0 > c1 ? 4 : 3 };
+
+			float error{ 0 };
+			for (int i = 0; i < 16; i++)
+			{
+				if (transparent[i])
+				{
+					indices[i] = 3;
+					continue;
+				}
+
+				const glm::vec3 texel{ block.texels[i] };
+				float best{ DistanceSq(texel, palette[0]) };
+				indices[i] = 0;
+				for (int p = 1; p < numColours; p++)
+				{
+					const float distance{ DistanceSq(texel, palette[p]) };
+					if (distance < best)
+					{
+						best = distance;
+						indices[i] = p;
+					}
+				}
+				error += best;
+			}
+			return error;
+		}
+
+		// Endpoints that best fit the texels for fixed indices, by least squares on the weight each index gives c0
+		bool FitBc1Endpoints(const Block& block, const bool transparent[16], const unsigned int indices[16], bool fourColour, glm::vec3& e0, glm::vec3& e1)
+		{
+			const float fourWeights[4]{ 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+			const float threeWeights[4]{ 1.0f, 0.0f, 0.5f, 0.0f };
+			const float* weights{ fourColour ? fourWeights : threeWeights };
+
+			float aa{ 0 }, ab{ 0 }, bb{ 0 };
+			glm::vec3 ax{ 0 }, bx{ 0 };
+			for (int i = 0; i < 16; i++)
+			{
+				if (transparent[i])
+					continue;
+
+				const float a{ weights[indices[i]] };
+				const float b{ 1.0f - a };
+				const glm::vec3 texel{ block.texels[i] };
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				ax += a * texel;
+				bx += b * texel;
+			}
+
+			const float determinant{ aa * bb - ab * ab };
+			if (std::abs(determinant) < 1e-6f)
+				return false;
+
+			e0 = (ax * bb - bx * ab) / determinant;
+			e1 = (bx * aa - ax * ab) / determinant;
+			return true;
+		}
+
+		// BC1 colour block into 8 bytes. With allowTransparent, texels with alpha below half use the transparent index.
+		void EncodeBc1Colour(const Block& block, bool allowTransparent, unsigned char* out)
+		{
+			bool transparent[16]{};
+			glm::vec4 opaque[16];
+			int numOpaque{ 0 };
+			for (int i = 0; i < 16; i++)
+			{
+				transparent[i] = allowTransparent && block.texels[i].a < 128.0f;
+				if (!transparent[i])
+					opaque[numOpaque++] = block.texels[i];
+			}
+
+			const bool fourColour{ numOpaque == 16 };
+			unsigned int c0{ 0 };
+			unsigned int c1{ 0 };
+			unsigned int indices[16]{};
+
+			if (numOpaque > 0)
+			{
+				glm::vec4 mean;
+				const glm::vec4 axis{ PrincipalAxis(opaque, numOpaque, 3, mean) };
+				glm::vec4 low, high;
+				ExtremesAlongAxis(opaque, numOpaque, mean, axis, low, high);
+
+				// Four colour mode needs c0 > c1, three colour mode c0 <= c1
+				auto order = [fourColour](unsigned int& a, unsigned int& b)
+				{
+					if (fourColour ? a < b : a > b)
+						std::swap(a, b);
+				};
+
+				c0 = Pack565(glm::vec3(high));
+				c1 = Pack565(glm::vec3(low));
+				order(c0, c1);
+				float error{ ChooseBc1Indices(block, transparent, c0, c1, indices) };
+
+				// One refinement of the endpoints for the chosen indices, kept only if it helps
+				glm::vec3 e0, e1;
+				if (c0 != c1 && FitBc1Endpoints(block, transparent, indices, c0 > c1, e0, e1))
+				{
+					unsigned int refined0{ Pack565(e0) };
+					unsigned int refined1{ Pack565(e1) };
+					order(refined0, refined1);
+
+					unsigned int refinedIndices[16];
+					const float refinedError{ ChooseBc1Indices(block, transparent, refined0, refined1, refinedIndices) };
+					if (refinedError < error && (refined0 != refined1 || !fourColour))
+					{
+						error = refinedError;
+						c0 = refined0;
+						c1 = refined1;
+						std::copy(refinedIndices, refinedIndices + 16, indices);
+					}
+				}
+
+				// Equal endpoints read as three colour mode, where index 3 would be transparent
+				if (fourColour && c0 == c1)
+					std::fill(indices, indices + 16, 0u);
+			}
+			else
+			{
+				std::fill(indices, indices + 16, 3u);
+			}
+
+			out[0] = (unsigned char)c0;
+			out[1] = (unsigned char)(c0 >> 8);
+			out[2] = (unsigned char)c1;
+			out[3] = (unsigned char)(c1 >> 8);
+			for (int row = 0; row < 4; row++)
+			{
+				out[4 + row] = (unsigned char)(indices[row * 4] | (indices[row * 4 + 1] << 2) | (indices[row * 4 + 2] << 4) | (indices[row * 4 + 3] << 6));
+			}
+		}
+
+		// BC4 block of the alpha channel into 8 bytes, using the eight value mode between the block's extremes
+		void EncodeBc4Alpha(const Block& block, unsigned char* out)
+		{
+			float minAlpha{ 255 };
+			float maxAlpha{ 0 };
+			for (const glm::vec4& texel : block.texels)
+			{
+				minAlpha = std::min(minAlpha, texel.a);
+				maxAlpha = std::max(maxAlpha, texel.a);
+			}
+
+			const unsigned int a0{ (unsigned int)std::lround(maxAlpha) };
+			const unsigned int a1{ (unsigned int)std::lround(minAlpha) };
+
+			// Codes 0 and 1 are the endpoints, 2 to 7 step from a0 towards a1
+			float palette[8]{ (float)a0, (float)a1 };
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7.0f;
+
+			unsigned long long bits{ 0 };
+			for (int i = 0; i < 16; i++)
+			{
+				unsigned int best{ 0 };
+				if (a0 != a1)
+				{
+					float bestDistance{ std::abs(block.texels[i].a - palette[0]) };
+					for (unsigned int p = 1; p < 8; p++)
+					{
+						const float distance{ std::abs(block.texels[i].a - palette[p]) };
+						if (distance < bestDistance)
+						{
+							bestDistance = distance;
+							best = p;
+						}
+					}
+				}
+				bits |= (unsigned long long)best << (3 * i);
+			}
+
+			out[0] = (unsigned char)a0;
+			out[1] = (unsigned char)a1;
+			for (int b = 0; b < 6; b++)
+				out[2 + b] = (unsigned char)(bits >> (8 * b));
+		}
+
+		// Writes fields least significant bit first into a 128 bit block
+		class BitWriter
+		{
+		private:
+			unsigned char* m_out;
+			unsigned int m_position{ 0 };
+		public:
+			BitWriter(unsigned char* out) : m_out(out) { std::memset(out, 0, 16); }
+
+			void Write(unsigned int value, unsigned int numBits)
+			{
+				for (unsigned int b = 0; b < numBits; b++, m_position++)
+				{
+					if (value & (1u << b))
+						m_out[m_position / 8] |= (unsigned char)(1u << (m_position % 8));
+				}
+			}
+		};
+
+		// BC7 mode 6, one subset with 7 bit RGBA endpoints plus a p bit each and 4 bit indices, into 16 bytes
+		void EncodeBc7Mode6(const Block& block, unsigned char* out)
+		{
+			static const int kWeights[16]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+			glm::vec4 mean;
+			const glm::vec4 axis{ PrincipalAxis(block.texels, 16, 4, mean) };
+			glm::vec4 ends[2];
+			ExtremesAlongAxis(block.texels, 16, mean, axis, ends[0], ends[1]);
+
+			// Each endpoint shares its p bit as the low bit of all four channels, take whichever rounds closer
+			glm::ivec4 quantised[2];
+			unsigned int pBits[2];
+			glm::vec4 decoded[2];
+			for (int e = 0; e < 2; e++)
+			{
+				float bestError{ 1e30f };
+				for (unsigned int p = 0; p < 2; p++)
+				{
+					const glm::ivec4 q{ glm::clamp(glm::ivec4(glm::round((ends[e] - (float)p) / 2.0f)), 0, 127) };
+					const glm::vec4 value{ glm::vec4(q * 2 + (int)p) };
+					const glm::vec4 d{ value - ends[e] };
+					const float error{ glm::dot(d, d) };
+					if (error < bestError)
+					{
+						bestError = error;
+						quantised[e] = q;
+						pBits[e] = p;
+						decoded[e] = value;
+					}
+				}
+			}
+
+			// Every weight is tried for every texel, the palette is only 16 entries
+			glm::vec4 palette[16];
+			for (int w = 0; w < 16; w++)
+				palette[w] = glm::floor(((64.0f - kWeights[w]) * decoded[0] + (float)kWeights[w] * decoded[1] + 32.0f) / 64.0f);
+
+			unsigned int indices[16];
+			for (int i = 0; i < 16; i++)
+			{
+				float best{ 1e30f };
+				for (unsigned int w = 0; w < 16; w++)
+				{
+					const glm::vec4 d{ block.texels[i] - palette[w] };
+					const float error{ glm::dot(d, d) };
+					if (error < best)
+					{
+						best = error;
+						indices[i] = w;
+					}
+				}
+			}
+
+			// The first texel's index is stored without its top bit, so it must be below 8
+			if (indices[0] & 8)
+			{
+				std::swap(quantised[0], quantised[1]);
+				std::swap(pBits[0], pBits[1]);
+				for (unsigned int& index : indices)
+					index = 15 - index;
+			}
+
+			BitWriter writer(out);
+			writer.Write(1u << 6, 7); // Mode 6
+			for (int channel = 0; channel < 4; channel++)
+			{
+				writer.Write((unsigned int)quantised[0][channel], 7);
+				writer.Write((unsigned int)quantised[1][channel], 7);
+			}
+			writer.Write(pBits[0], 1);
+			writer.Write(pBits[1], 1);
+			writer.Write(indices[0], 3);
+			for (int i = 1; i < 16; i++)
+				writer.Write(indices[i], 4);
+		}
+
+		// Texels of the block at (blockX, blockY), repeating the last row and column past the edges
+		void GatherBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, Block& block)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				const int sourceY{ std::min(blockY * 4 + y, height - 1) };
+				for (int x = 0; x < 4; x++)
+				{
+					const int sourceX{ std::min(blockX * 4 + x, width - 1) };
+					const unsigned char* texel{ rgba + ((size_t)sourceY * width + sourceX) * 4 };
+					block.texels[y * 4 + x] = glm::vec4(texel[0], texel[1], texel[2], texel[3]);
+				}
+			}
+		}
+	}
+
+	// Lower case name of the format, as used in cache filenames
+	const char* BlockFormatName(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::None: return "none";
+		case BlockFormat::Auto: return "auto";
+		case BlockFormat::BC1: return "bc1";
+		case BlockFormat::BC3: return "bc3";
+		case BlockFormat::BC7: return "bc7";
+		}
+		return "none";
+	}
+
+	// GL internal format a format uploads as, 0 for None and Auto
+	GLenum BlockFormatGl(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		default: return 0;
+		}
+	}
+
+	// Auto becomes BC1 or BC3 depending on whether the image has any alpha, other formats are returned as they are
+	BlockFormat ResolveBlockFormat(BlockFormat format, const unsigned char* rgba, size_t numPixels)
+	{
+		if (format != BlockFormat::Auto)
+			return format;
+
+		for (size_t i = 0; i < numPixels; i++)
+		{
+			if (rgba[i * 4 + 3] != 255)
+				return BlockFormat::BC3;
+		}
+		return BlockFormat::BC1;
+	}
+
+	// Compress a width x height RGBA image into blocks of format, which must be BC1, BC3 or BC7.
+	void CompressImage(const unsigned char* rgba, int width, int height, BlockFormat format, ThreadPool* threadPool, unsigned char* blocks)
+	{
+		const int blocksX{ std::max(1, (width + 3) / 4) };
+		const int blocksY{ std::max(1, (height + 3) / 4) };
+		const size_t blockBytes{ CompressedBlockBytes(BlockFormatGl(format)) };
+
+		ParallelFor(threadPool, (size_t)blocksY, [&](size_t blockY)
+		{
+			Block block;
+			unsigned char* out{ blocks + blockY * blocksX * blockBytes };
+
+			for (int blockX = 0; blockX < blocksX; blockX++, out += blockBytes)
+			{
+				GatherBlock(rgba, width, height, blockX, (int)blockY, block);
+
+				switch (format)
+				{
+				case BlockFormat::BC1:
+					EncodeBc1Colour(block, true, out);
+					break;
+				case BlockFormat::BC3:
+					EncodeBc4Alpha(block, out);
+					EncodeBc1Colour(block, false, out + 8);
+					break;
+				case BlockFormat::BC7:
+					EncodeBc7Mode6(block, out);
+					break;
+				default:
+					break;
+				}
+			}
+		});
+	}
+
+}
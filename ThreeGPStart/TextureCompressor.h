@@ -0,0 +1,33 @@
+#pragma once
+// Block compression of decoded RGBA images on the CPU, so source art in JPG or TGA can sit in GPU memory compressed
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	class ThreadPool;
+
+	// Block format to compress decoded images to
+	enum class BlockFormat
+	{
+		None,	// Keep images as RGBA
+		Auto,	// BC1 for opaque images, BC3 when any texel has alpha
+		BC1,	// 4 bits per texel, 1 bit alpha
+		BC3,	// 8 bits per texel, BC1 colour with smooth alpha
+		BC7		// 8 bits per texel, higher quality colour and alpha, encoded as mode 6 only
+	};
+
+	// Lower case name of the format, as used in cache filenames
+	const char* BlockFormatName(BlockFormat format);
+
+	// GL internal format a format uploads as, 0 for None and Auto
+	GLenum BlockFormatGl(BlockFormat format);
+
+	// Auto becomes BC1 or BC3 depending on whether the image has any alpha, other formats are returned as they are
+	BlockFormat ResolveBlockFormat(BlockFormat format, const unsigned char* rgba, size_t numPixels);
+
+	// Compress a width x height RGBA image into blocks of format, which must be BC1, BC3 or BC7.
+	// blocks holds one block per 4x4 texels, edge blocks repeat the last texels. Each row of blocks is a task on threadPool.
+	void CompressImage(const unsigned char* rgba, int width, int height, BlockFormat format, ThreadPool* threadPool, unsigned char* blocks);
+
+}
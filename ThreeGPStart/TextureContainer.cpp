@@ -0,0 +1,498 @@
+#include "TextureContainer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Helpers
+{
+
+	namespace
+	{
+		// DDS header flags and the DX10 extension header's values we need
+		const uint32_t kDdsMagic{ 0x20534444 }; // "DDS "
+		const uint32_t kDdsHeaderSize{ 124 };
+		const uint32_t kDdsFlagMipMapCount{ 0x20000 };
+		const uint32_t kDdsPixelFormatFourCC{ 0x4 };
+		const uint32_t kDdsCaps2CubeMap{ 0x200 };
+		const uint32_t kDdsCaps2Volume{ 0x200000 };
+		const uint32_t kDx10Texture2D{ 3 };
+		const uint32_t kDx10MiscCubeMap{ 0x4 };
+
+		const unsigned char kKtxIdentifier[12]{ 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+		const uint32_t kKtxEndianness{ 0x04030201 };
+
+		uint32_t ReadU32(const unsigned char* data)
+		{
+			uint32_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint32_t FourCC(const char* code)
+		{
+			return (uint32_t)(unsigned char)code[0] | ((uint32_t)(unsigned char)code[1] << 8) |
+				((uint32_t)(unsigned char)code[2] << 16) | ((uint32_t)(unsigned char)code[3] << 24);
+		}
+
+		// Legacy DDS pixel formats named by their four character code
+		GLenum FormatFromFourCC(uint32_t fourCC)
+		{
+			if (fourCC == FourCC("DXT1"))
+				return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			if (fourCC == FourCC("DXT2") || fourCC == FourCC("DXT3"))
+				return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+			if (fourCC == FourCC("DXT4") || fourCC == FourCC("DXT5"))
+				return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			if (fourCC == FourCC("ATI1") || fourCC == FourCC("BC4U"))
+				return GL_COMPRESSED_RED_RGTC1;
+			if (fourCC == FourCC("BC4S"))
+				return GL_COMPRESSED_SIGNED_RED_RGTC1;
+			if (fourCC == FourCC("ATI2") || fourCC == FourCC("BC5U"))
+				return GL_COMPRESSED_RG_RGTC2;
+			if (fourCC == FourCC("BC5S"))
+				return GL_COMPRESSED_SIGNED_RG_RGTC2;
+			return 0;
+		}
+
+		// DXGI_FORMAT values of the block compressed formats in a DX10 header
+		GLenum FormatFromDxgi(uint32_t dxgiFormat)
+		{
+			switch (dxgiFormat)
+			{
+			case 71: case 72: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; // BC1 UNORM, SRGB
+			case 74: case 75: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; // BC2
+			case 77: case 78: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; // BC3
+			case 80: return GL_COMPRESSED_RED_RGTC1;                  // BC4 UNORM
+			case 81: return GL_COMPRESSED_SIGNED_RED_RGTC1;           // BC4 SNORM
+			case 83: return GL_COMPRESSED_RG_RGTC2;                   // BC5 UNORM
+			case 84: return GL_COMPRESSED_SIGNED_RG_RGTC2;            // BC5 SNORM
+			case 98: case 99: return GL_COMPRESSED_RGBA_BPTC_UNORM;   // BC7 UNORM, SRGB
+			default: return 0;
+			}
+		}
+
+		// KTX names GL formats directly, sRGB ones are read as linear like every other texture
+		GLenum FormatFromGl(uint32_t internalFormat)
+		{
+			switch (internalFormat)
+			{
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+			case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+			case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+				return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+			case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+				return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+				return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			case GL_COMPRESSED_RED_RGTC1:
+			case GL_COMPRESSED_SIGNED_RED_RGTC1:
+			case GL_COMPRESSED_RG_RGTC2:
+			case GL_COMPRESSED_SIGNED_RG_RGTC2:
+				return internalFormat;
+			case GL_COMPRESSED_RGBA_BPTC_UNORM:
+			case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+				return GL_COMPRESSED_RGBA_BPTC_UNORM;
+			default:
+				return 0;
+			}
+		}
+
+		// Bytes of a width x height level, partial blocks at the edges count as whole ones
+		size_t LevelBytes(GLenum format, int width, int height)
+		{
+			const size_t blocksX{ (size_t)std::max(1, (width + 3) / 4) };
+			const size_t blocksY{ (size_t)std::max(1, (height + 3) / 4) };
+			return blocksX * blocksY * CompressedBlockBytes(format);
+		}
+
+		// Level 0 must be a sensible size, a full chain of a 16K image has 15 levels
+		bool ValidSize(int width, int height, uint32_t numLevels)
+		{
+			return width > 0 && height > 0 && width <= 16384 && height <= 16384 && numLevels <= 15;
+		}
+
+		// Reverse the first numRows rows of one block, each rowBytes wide, starting at block
+		void ReverseRows(unsigned char* block, size_t rowBytes, int numRows)
+		{
+			for (int top = 0, bottom = numRows - 1; top < bottom; top++, bottom--)
+			{
+				for (size_t b = 0; b < rowBytes; b++)
+					std::swap(block[top * rowBytes + b], block[bottom * rowBytes + b]);
+			}
+		}
+
+		// BC1 colour block, the 2 bit indices of each row are one byte after the two endpoints
+		void FlipColourBlock(unsigned char* block, int numRows)
+		{
+			ReverseRows(block + 4, 1, numRows);
+		}
+
+		// BC2 explicit alpha block, 4 bits per texel so 2 bytes per row
+		void FlipExplicitAlphaBlock(unsigned char* block, int numRows)
+		{
+			ReverseRows(block, 2, numRows);
+		}
+
+		// BC4 block, also BC3 alpha and each half of BC5. 3 bit indices packed 12 bits to a row after the two endpoints.
+		void FlipInterpolatedBlock(unsigned char* block, int numRows)
+		{
+			uint64_t bits{ 0 };
+			for (int b = 0; b < 6; b++)
+				bits |= (uint64_t)block[2 + b] << (8 * b);
+
+			uint64_t rows[4];
+			for (int r = 0; r < 4; r++)
+				rows[r] = (bits >> (12 * r)) & 0xFFF;
+			std::reverse(rows, rows + numRows);
+
+			bits = 0;
+			for (int r = 0; r < 4; r++)
+				bits |= rows[r] << (12 * r);
+			for (int b = 0; b < 6; b++)
+				block[2 + b] = (unsigned char)(bits >> (8 * b));
+		}
+
+		void FlipBlock(unsigned char* block, GLenum format, int numRows)
+		{
+			switch (format)
+			{
+			case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+				FlipColourBlock(block, numRows);
+				break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+				FlipExplicitAlphaBlock(block, numRows);
+				FlipColourBlock(block + 8, numRows);
+				break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				FlipInterpolatedBlock(block, numRows);
+				FlipColourBlock(block + 8, numRows);
+				break;
+			case GL_COMPRESSED_RED_RGTC1:
+			case GL_COMPRESSED_SIGNED_RED_RGTC1:
+				FlipInterpolatedBlock(block, numRows);
+				break;
+			case GL_COMPRESSED_RG_RGTC2:
+			case GL_COMPRESSED_SIGNED_RG_RGTC2:
+				FlipInterpolatedBlock(block, numRows);
+				FlipInterpolatedBlock(block + 8, numRows);
+				break;
+			}
+		}
+	}
+
+	// Bytes in one 4x4 block of a compressed format, 0 if the format is not one we read
+	size_t CompressedBlockBytes(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RED_RGTC1:
+		case GL_COMPRESSED_SIGNED_RED_RGTC1:
+			return 8;
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_RG_RGTC2:
+		case GL_COMPRESSED_SIGNED_RG_RGTC2:
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	// Parse a DDS file held in data. Returns false if it is not a single 2D image in a block compressed format GL can take.
+	bool ParseDds(const unsigned char* data, size_t size, CompressedImageInfo& info)
+	{
+		if (size < 4 + kDdsHeaderSize || ReadU32(data) != kDdsMagic || ReadU32(data + 4) != kDdsHeaderSize)
+		{
+			std::cout << "Not a DDS file" << std::endl;
+			return false;
+		}
+
+		const unsigned char* header{ data + 4 };
+		const uint32_t flags{ ReadU32(header + 4) };
+		const int height{ (int)ReadU32(header + 8) };
+		const int width{ (int)ReadU32(header + 12) };
+		const uint32_t mipMapCount{ ReadU32(header + 24) };
+		const uint32_t pixelFlags{ ReadU32(header + 76) };
+		const uint32_t fourCC{ ReadU32(header + 80) };
+		const uint32_t caps2{ ReadU32(header + 108) };
+
+		size_t dataStart{ 4 + kDdsHeaderSize };
+
+		if (caps2 & (kDdsCaps2CubeMap | kDdsCaps2Volume))
+		{
+			std::cout << "DDS cube maps and volumes are not supported" << std::endl;
+			return false;
+		}
+
+		if (!(pixelFlags & kDdsPixelFormatFourCC))
+		{
+			std::cout << "DDS is not block compressed" << std::endl;
+			return false;
+		}
+
+		info.format = 0;
+		if (fourCC == FourCC("DX10"))
+		{
+			if (size < dataStart + 20)
+			{
+				std::cout << "DDS DX10 header is truncated" << std::endl;
+				return false;
+			}
+
+			const unsigned char* dx10{ data + dataStart };
+			if (ReadU32(dx10 + 4) != kDx10Texture2D || (ReadU32(dx10 + 8) & kDx10MiscCubeMap) || ReadU32(dx10 + 12) > 1)
+			{
+				std::cout << "Only single 2D DDS textures are supported" << std::endl;
+				return false;
+			}
+
+			info.format = FormatFromDxgi(ReadU32(dx10));
+			dataStart += 20;
+		}
+		else
+		{
+			info.format = FormatFromFourCC(fourCC);
+		}
+
+		if (!info.format)
+		{
+			std::cout << "DDS block format is not supported" << std::endl;
+			return false;
+		}
+
+		const uint32_t numLevels{ (flags & kDdsFlagMipMapCount) && mipMapCount > 0 ? mipMapCount : 1 };
+		if (!ValidSize(width, height, numLevels))
+		{
+			std::cout << "DDS size is not supported" << std::endl;
+			return false;
+		}
+
+		info.levels.clear();
+		size_t offset{ dataStart };
+		for (uint32_t level = 0; level < numLevels; level++)
+		{
+			ImageLevel newLevel;
+			newLevel.width = std::max(1, width >> level);
+			newLevel.height = std::max(1, height >> level);
+			newLevel.offset = offset;
+			newLevel.size = LevelBytes(info.format, newLevel.width, newLevel.height);
+
+			if (newLevel.size > size - offset)
+			{
+				std::cout << "DDS is truncated" << std::endl;
+				return false;
+			}
+
+			offset += newLevel.size;
+			info.levels.push_back(newLevel);
+		}
+
+		info.metadata.clear();
+		info.topDown = true;
+		return true;
+	}
+
+	// Parse a KTX 1 file held in data. Returns false if it is not a single 2D image in a block compressed format GL can take.
+	bool ParseKtx(const unsigned char* data, size_t size, CompressedImageInfo& info)
+	{
+		const size_t headerSize{ 64 };
+		if (size < headerSize || std::memcmp(data, kKtxIdentifier, sizeof(kKtxIdentifier)) != 0)
+		{
+			std::cout << "Not a KTX file" << std::endl;
+			return false;
+		}
+
+		if (ReadU32(data + 12) != kKtxEndianness)
+		{
+			std::cout << "KTX files of the other endianness are not supported" << std::endl;
+			return false;
+		}
+
+		const uint32_t glType{ ReadU32(data + 16) };
+		const uint32_t glInternalFormat{ ReadU32(data + 28) };
+		const int width{ (int)ReadU32(data + 36) };
+		const int height{ (int)ReadU32(data + 40) };
+		const uint32_t depth{ ReadU32(data + 44) };
+		const uint32_t arrayElements{ ReadU32(data + 48) };
+		const uint32_t faces{ ReadU32(data + 52) };
+		const uint32_t mipMapLevels{ ReadU32(data + 56) };
+		const uint32_t keyValueBytes{ ReadU32(data + 60) };
+
+		info.format = glType == 0 ? FormatFromGl(glInternalFormat) : 0;
+		if (!info.format)
+		{
+			std::cout << "KTX format is not a supported block compressed one" << std::endl;
+			return false;
+		}
+
+		if (depth > 0 || arrayElements > 0 || faces != 1)
+		{
+			std::cout << "Only single 2D KTX textures are supported" << std::endl;
+			return false;
+		}
+
+		// 0 asks for the levels to be generated, which GL cannot do for compressed formats, so only the first is used
+		const uint32_t numLevels{ std::max(mipMapLevels, 1u) };
+		if (!ValidSize(width, height, numLevels) || keyValueBytes > size - headerSize)
+		{
+			std::cout << "KTX size is not supported" << std::endl;
+			return false;
+		}
+
+		info.metadata.clear();
+		const unsigned char* keyValues{ data + headerSize };
+		for (size_t at = 0; at + 4 <= keyValueBytes; )
+		{
+			const uint32_t pairBytes{ ReadU32(keyValues + at) };
+			if (pairBytes > keyValueBytes - at - 4)
+				break;
+
+			const std::string pair((const char*)keyValues + at + 4, pairBytes);
+			const size_t keyEnd{ pair.find('\0') };
+			if (keyEnd != std::string::npos)
+			{
+				const size_t valueEnd{ pair.find('\0', keyEnd + 1) };
+				info.metadata[pair.substr(0, keyEnd)] = pair.substr(keyEnd + 1, valueEnd == std::string::npos ? std::string::npos : valueEnd - keyEnd - 1);
+			}
+
+			at += 4 + ((pairBytes + 3) & ~3u);
+		}
+
+		// Rows run bottom to top unless the writer recorded otherwise
+		auto orientation = info.metadata.find("KTXorientation");
+		info.topDown = orientation != info.metadata.end() && orientation->second.find("T=d") != std::string::npos;
+
+		info.levels.clear();
+		size_t offset{ headerSize + keyValueBytes };
+		for (uint32_t level = 0; level < numLevels; level++)
+		{
+			if (size - offset < 4)
+			{
+				std::cout << "KTX is truncated" << std::endl;
+				return false;
+			}
+
+			ImageLevel newLevel;
+			newLevel.width = std::max(1, width >> level);
+			newLevel.height = std::max(1, height >> level);
+			newLevel.offset = offset + 4;
+			newLevel.size = LevelBytes(info.format, newLevel.width, newLevel.height);
+
+			if (ReadU32(data + offset) != newLevel.size || newLevel.size > size - newLevel.offset)
+			{
+				std::cout << "KTX level size does not match its format" << std::endl;
+				return false;
+			}
+
+			info.levels.push_back(newLevel);
+
+			// Level sizes are whole blocks of 8 or 16 bytes so the 4 byte mip padding is never needed
+			offset = newLevel.offset + newLevel.size;
+		}
+
+		return true;
+	}
+
+	// Assemble a KTX 1 file of the levels described by info, whose offsets are into data, with metadata as its key and value pairs
+	std::vector<unsigned char> BuildKtx(const CompressedImageInfo& info, const unsigned char* data)
+	{
+		std::vector<unsigned char> file(kKtxIdentifier, kKtxIdentifier + sizeof(kKtxIdentifier));
+		auto writeU32 = [&file](uint32_t value)
+		{
+			const unsigned char* bytes{ (const unsigned char*)&value };
+			file.insert(file.end(), bytes, bytes + sizeof(value));
+		};
+
+		std::vector<unsigned char> keyValues;
+		for (const auto& pair : info.metadata)
+		{
+			const uint32_t pairBytes{ (uint32_t)(pair.first.size() + 1 + pair.second.size() + 1) };
+			const unsigned char* sizeBytes{ (const unsigned char*)&pairBytes };
+			keyValues.insert(keyValues.end(), sizeBytes, sizeBytes + sizeof(pairBytes));
+			keyValues.insert(keyValues.end(), pair.first.begin(), pair.first.end());
+			keyValues.push_back(0);
+			keyValues.insert(keyValues.end(), pair.second.begin(), pair.second.end());
+			keyValues.push_back(0);
+			keyValues.resize((keyValues.size() + 3) & ~(size_t)3, 0);
+		}
+
+		writeU32(kKtxEndianness);
+		writeU32(0); // glType, compressed
+		writeU32(1); // glTypeSize
+		writeU32(0); // glFormat, compressed
+		writeU32(info.format);
+		writeU32(info.format == GL_COMPRESSED_RED_RGTC1 || info.format == GL_COMPRESSED_SIGNED_RED_RGTC1 ? GL_RED :
+			info.format == GL_COMPRESSED_RG_RGTC2 || info.format == GL_COMPRESSED_SIGNED_RG_RGTC2 ? GL_RG : GL_RGBA);
+		writeU32((uint32_t)info.levels[0].width);
+		writeU32((uint32_t)info.levels[0].height);
+		writeU32(0); // Depth
+		writeU32(0); // Array elements
+		writeU32(1); // Faces
+		writeU32((uint32_t)info.levels.size());
+		writeU32((uint32_t)keyValues.size());
+		file.insert(file.end(), keyValues.begin(), keyValues.end());
+
+		for (const ImageLevel& level : info.levels)
+		{
+			writeU32((uint32_t)level.size);
+			file.insert(file.end(), data + level.offset, data + level.offset + level.size);
+		}
+
+		return file;
+	}
+
+	// Reorder the blocks of a level in place so its rows run bottom to top, the order FreeImage decodes into.
+	bool FlipCompressedLevel(unsigned char* data, GLenum format, const ImageLevel& level)
+	{
+		// BC7 blocks have many layouts and partitions, flipping them means decoding them
+		if (format == GL_COMPRESSED_RGBA_BPTC_UNORM)
+			return false;
+
+		// Partial blocks are only at the bottom, so flipping would move them to the top
+		if (level.height > 4 && level.height % 4 != 0)
+			return false;
+
+		const size_t blockBytes{ CompressedBlockBytes(format) };
+		const size_t blocksX{ (size_t)std::max(1, (level.width + 3) / 4) };
+		const size_t blocksY{ (size_t)std::max(1, (level.height + 3) / 4) };
+		const size_t rowBytes{ blocksX * blockBytes };
+		const int rowsPerBlock{ std::min(level.height, 4) };
+
+		unsigned char* levelData{ data + level.offset };
+
+		for (size_t top = 0, bottom = blocksY - 1; top < bottom; top++, bottom--)
+			std::swap_ranges(levelData + top * rowBytes, levelData + (top + 1) * rowBytes, levelData + bottom * rowBytes);
+
+		for (size_t block = 0; block < blocksX * blocksY; block++)
+			FlipBlock(levelData + block * blockBytes, format, rowsPerBlock);
+
+		return true;
+	}
+
+	// Whether the current GL context can sample the format, GL thread only
+	bool IsCompressedFormatSupported(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			return GLEW_EXT_texture_compression_s3tc != 0;
+		case GL_COMPRESSED_RED_RGTC1:
+		case GL_COMPRESSED_SIGNED_RED_RGTC1:
+		case GL_COMPRESSED_RG_RGTC2:
+		case GL_COMPRESSED_SIGNED_RG_RGTC2:
+			return GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+			return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+		default:
+			return false;
+		}
+	}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+// Readers for DDS and KTX texture containers holding block compressed images, so they can go to GL without decoding
+
+#include "ExternalLibraryHeaders.h"
+
+#include <map>
+
+namespace Helpers
+{
+
+	// One mip level of an image, located in the bytes the container was read into
+	struct ImageLevel
+	{
+		int width{ 0 };
+		int height{ 0 };
+		size_t offset{ 0 };
+		size_t size{ 0 };
+	};
+
+	// A block compressed image found in a container
+	struct CompressedImageInfo
+	{
+		// GL internal format, sRGB formats are given as their linear equivalent as textures are not read as sRGB
+		GLenum format{ 0 };
+
+		// Level 0 first, each half the size of the one before
+		std::vector<ImageLevel> levels;
+
+		// The first row of blocks is the top of the image, as DDS stores it
+		bool topDown{ false };
+
+		// KTX key and value pairs, values without their terminating null
+		std::map<std::string, std::string> metadata;
+	};
+
+	// Parse a DDS file held in data. Returns false if it is not a single 2D image in a block compressed format GL can take.
+	bool ParseDds(const unsigned char* data, size_t size, CompressedImageInfo& info);
+
+	// Parse a KTX 1 file held in data. Returns false if it is not a single 2D image in a block compressed format GL can take.
+	bool ParseKtx(const unsigned char* data, size_t size, CompressedImageInfo& info);
+
+	// Assemble a KTX 1 file of the levels described by info, whose offsets are into data, with metadata as its key and value pairs
+	std::vector<unsigned char> BuildKtx(const CompressedImageInfo& info, const unsigned char* data);
+
+	// Bytes in one 4x4 block of a compressed format, 0 if the format is not one we read
+	size_t CompressedBlockBytes(GLenum format);
+
+	// Reorder the blocks of a level in place so its rows run bottom to top, the order FreeImage decodes into.
+	// Returns false, leaving the level alone, for BC7 or heights over 4 that are not a whole number of blocks.
+	bool FlipCompressedLevel(unsigned char* data, GLenum format, const ImageLevel& level);
+
+	// Whether the current GL context can sample the format, GL thread only
+	bool IsCompressedFormatSupported(GLenum format);
+
+}
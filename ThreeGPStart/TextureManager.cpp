@@ -0,0 +1,734 @@
+#include "TextureManager.h"
+#include "Helper.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+	//FNV-1a over 64 bit words, quick enough to run over every decoded texture
+	unsigned long long HashPixels(const Helpers::ImageLoader& image)
+	{
+
+		unsigned long long hash = 14695981039346656037ull;
+		auto mix = [&hash](unsigned long long value) { hash = (hash ^ value) * 1099511628211ull; };
+
+		mix((unsigned long long)image.Width());
+		mix((unsigned long long)image.Height());
+
+		const unsigned char* bytes = (const unsigned char*)image.GetData();
+		const size_t numBytes = image.DataSize(); //Compressed images hash their whole file
+
+		size_t i = 0;
+		for (; i + 8 <= numBytes; i += 8)
+		{
+			unsigned long long word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+			mix(word);
+		}
+		for (; i < numBytes; i++)
+		{
+			mix(bytes[i]);
+		}
+
+		return hash == 0 ? 1 : hash; //0 means not hashed
+
+	}
+
+	//Streamed textures are first uploaded down to the level no larger than this, finer levels follow as they are drawn larger
+	const int kResidentTailSize = 64;
+
+	//Levels the image uploads as one by one, empty when GL has to build the mipmaps
+	const std::vector<Helpers::ImageLevel>& UploadLevels(const Helpers::ImageLoader& image)
+	{
+
+		return image.IsCompressed() ? image.CompressedLevels() : image.MipLevels();
+
+	}
+
+	//Coarsest level a streamed texture starts from
+	size_t TailLevel(const std::vector<Helpers::ImageLevel>& levels)
+	{
+
+		for (size_t level = 0; level < levels.size(); level++)
+		{
+			if (std::max(levels[level].width, levels[level].height) <= kResidentTailSize)
+			{
+				return level;
+			}
+		}
+
+		return levels.empty() ? 0 : levels.size() - 1;
+
+	}
+
+	//Upload one level of the image into the bound texture, returns its bytes
+	size_t UploadLevel(const Helpers::ImageLoader& image, size_t level)
+	{
+
+		const Helpers::ImageLevel& imageLevel = UploadLevels(image)[level];
+
+		if (image.IsCompressed())
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, image.CompressedFormat(), imageLevel.width, imageLevel.height, 0,
+				(GLsizei)imageLevel.size, image.GetData() + imageLevel.offset);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA, imageLevel.width, imageLevel.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+				image.GetData() + imageLevel.offset);
+		}
+
+		return imageLevel.size;
+
+	}
+
+	//Create the GL texture the first time, later calls replace the pixels of the same texture. Returns the GPU bytes used.
+	//Images with their own levels, compressed or built while loading, go up from firstLevel down, otherwise GL builds the mipmaps.
+	//firstLevel is lowered to the finest level that could be uploaded.
+	size_t UploadPixels(GLuint& textureID, const Helpers::ImageLoader& image, const std::string& filename, size_t& firstLevel)
+	{
+
+		if (image.IsCompressed() && !Helpers::IsCompressedFormatSupported(image.CompressedFormat()))
+		{
+			std::cout << "GL cannot sample the compressed format of " << filename << ", decoding it instead" << std::endl;
+
+			Helpers::ImageLoader decoded;
+			if (!decoded.LoadDecoded(filename))
+			{
+				return 0;
+			}
+			return UploadPixels(textureID, decoded, filename, firstLevel);
+		}
+
+		if (!textureID)
+		{
+			glGenTextures(1, &textureID);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+		const std::vector<Helpers::ImageLevel>& levels = UploadLevels(image);
+
+		if (levels.empty()) //GL builds the chain, so it is all resident
+		{
+
+			firstLevel = 0;
+
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0); //The GL defaults, an earlier upload may have changed them
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.Width(), image.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.GetData());
+			glGenerateMipmap(GL_TEXTURE_2D);
+
+			return (size_t)image.Width() * image.Height() * 4 * 4 / 3; //A full mip chain adds a third
+
+		}
+
+		firstLevel = std::min(firstLevel, levels.size() - 1);
+		size_t gpuBytes = 0;
+
+		//Finer levels a placeholder or an earlier upload left are freed, they are outside the base level so never sampled
+		for (size_t level = 0; level < firstLevel; level++)
+		{
+			glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+
+		for (size_t level = firstLevel; level < levels.size(); level++)
+		{
+			gpuBytes += UploadLevel(image, level);
+		}
+
+		//Levels a previous upload of the texture had beyond these are never sampled
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)firstLevel);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+
+		return gpuBytes;
+
+	}
+
+	//Whether a streamed texture's background decode has finished, collecting its result the first time
+	bool LoadLanded(std::future<bool>& load)
+	{
+
+		if (!load.valid())
+		{
+			return true;
+		}
+
+		if (load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			return false;
+		}
+
+		load.get();
+		return true;
+
+	}
+
+}
+
+void TextureResource::RecordDrawnSize(float screenPixels)
+{
+
+	if (m_duplicateOf) //Its mips are the ones drawn
+	{
+		m_duplicateOf->RecordDrawnSize(screenPixels);
+		return;
+	}
+
+	m_drawnPixels = std::max(m_drawnPixels, screenPixels);
+
+}
+
+TextureResource::~TextureResource()
+{
+
+	if (m_textureID)
+	{
+		glDeleteTextures(1, &m_textureID);
+	}
+
+}
+
+TextureManager& TextureManager::Shared()
+{
+
+	static TextureManager manager;
+	return manager;
+
+}
+
+std::shared_ptr<TextureResource> TextureManager::Acquire(const std::string& filename, bool needPixels)
+{
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::weak_ptr<TextureResource>& entry = m_byPath[Helpers::CanonicalPath(filename)];
+
+	std::shared_ptr<TextureResource> texture = entry.lock(); //Still in use elsewhere?
+	if (texture)
+	{
+		m_pathHits++;
+	}
+	else
+	{
+		m_pathMisses++;
+		texture = std::make_shared<TextureResource>(filename);
+		entry = texture;
+	}
+
+	if (needPixels)
+	{
+		texture->m_needPixels = true; //Only takes effect if it has not been loaded yet
+	}
+
+	return texture;
+
+}
+
+Helpers::ImageLoadSettings TextureManager::LoadSettings(const TextureResource& texture) const
+{
+
+	Helpers::ImageLoadSettings settings;
+
+	if (!texture.m_needPixels) //Pixels read on the CPU stay as the file has them
+	{
+		settings.compression = m_blockCompression;
+		settings.generateMips = true;
+		settings.mipFilter = m_mipFilter;
+	}
+
+	return settings;
+
+}
+
+bool TextureManager::Load(TextureResource& texture, Helpers::ThreadPool* threadPool)
+{
+
+	//Later callers wait here for the first decode to finish then share its result
+	std::lock_guard<std::mutex> lock(texture.m_loadMutex);
+
+	if (!texture.m_loadAttempted)
+	{
+		texture.m_loadAttempted = true;
+		texture.m_loaded = texture.m_image.Load(texture.m_filename, LoadSettings(texture), threadPool); //Mips built and compressed on the pool's threads the first time, read from the cache after
+
+		if (texture.m_loaded && m_hashContents)
+		{
+			texture.m_pixelHash = HashPixels(texture.m_image);
+		}
+	}
+
+	return texture.m_loaded;
+
+}
+
+bool TextureManager::BeginLoad(const std::shared_ptr<TextureResource>& texture, Helpers::ThreadPool& threadPool)
+{
+
+	if (!m_streaming || texture->m_needPixels)
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (texture->m_loadStarted) //Another Model using the file got here first
+		{
+			return true;
+		}
+
+		texture->m_loadStarted = true;
+		texture->m_streamed = true;
+		m_streamedTextures.push_back(texture);
+	}
+
+	Helpers::ThreadPool* pool = &threadPool;
+	std::future<bool> load = threadPool.Submit([this, texture, pool]() { return Load(*texture, pool); });
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	texture->m_load = std::move(load);
+
+	return true;
+
+}
+
+bool TextureManager::Upload(TextureResource& texture)
+{
+
+	if (texture.GetID())
+	{
+		return true;
+	}
+
+	if (texture.m_streamed)
+	{
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!LoadLanded(texture.m_load)) //Draw with a flat grey until Stream sees the decode land
+		{
+			const GLubyte grey[4] = { 128, 128, 128, 255 };
+
+			glGenTextures(1, &texture.m_textureID);
+			glBindTexture(GL_TEXTURE_2D, texture.m_textureID);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+
+			texture.m_placeholder = true;
+			texture.m_gpuBytes = sizeof(grey);
+			return true;
+		}
+
+	}
+
+	if (!texture.m_loaded)
+	{
+		return false;
+	}
+
+	UploadLoaded(texture);
+
+	return true;
+
+}
+
+bool TextureManager::UploadLoaded(TextureResource& texture)
+{
+
+	bool shared = false;
+
+	if (texture.m_pixelHash)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::weak_ptr<TextureResource>& entry = m_byContent[texture.m_pixelHash];
+
+		std::shared_ptr<TextureResource> original = entry.lock();
+		if (original && original.get() != &texture && original->GetID() && !original->m_placeholder)
+		{
+			m_contentHits++;
+			texture.m_duplicateOf = original; //Same pixels already on the GPU under another name
+			shared = true;
+		}
+		else
+		{
+			//Register so later duplicates can find this one, a shared_ptr must exist as Acquire made it
+			for (auto& pathEntry : m_byPath)
+			{
+				std::shared_ptr<TextureResource> candidate = pathEntry.second.lock();
+				if (candidate.get() == &texture)
+				{
+					entry = candidate;
+					break;
+				}
+			}
+		}
+	}
+
+	if (shared)
+	{
+		if (texture.m_textureID) //A placeholder is no longer needed
+		{
+			glDeleteTextures(1, &texture.m_textureID);
+			texture.m_textureID = 0;
+		}
+		texture.m_gpuBytes = 0;
+		texture.m_placeholder = false;
+		return true;
+	}
+
+	//Streamed textures start from their smallest mips
+	texture.m_residentLevel = texture.m_streamed ? TailLevel(UploadLevels(texture.m_image)) : 0;
+	texture.m_gpuBytes = UploadPixels(texture.m_textureID, texture.m_image, texture.m_filename, texture.m_residentLevel);
+	texture.m_placeholder = false;
+
+	return false;
+
+}
+
+bool TextureManager::Stream(size_t byteBudget)
+{
+
+	std::vector<std::shared_ptr<TextureResource>> textures;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_streamedTextures.erase(std::remove_if(m_streamedTextures.begin(), m_streamedTextures.end(),
+			[](const std::weak_ptr<TextureResource>& texture) { return texture.expired(); }), m_streamedTextures.end());
+
+		for (const std::weak_ptr<TextureResource>& texture : m_streamedTextures)
+		{
+			textures.push_back(texture.lock());
+		}
+	}
+
+	bool anyChanged = false;
+	size_t bytesUploaded = 0;
+
+	//Decodes that have landed replace their placeholders with their smallest mips, which are small enough to always take
+	for (const std::shared_ptr<TextureResource>& texture : textures)
+	{
+
+		if (!texture->m_placeholder)
+		{
+			continue;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!LoadLanded(texture->m_load))
+			{
+				continue;
+			}
+		}
+
+		if (!texture->m_loaded)
+		{
+			std::cout << "Could not load " << texture->m_filename << ", it stays grey" << std::endl;
+			texture->m_placeholder = false;
+			continue;
+		}
+
+		const size_t placeholderBytes = texture->m_gpuBytes;
+		anyChanged = UploadLoaded(*texture) || anyChanged;
+		bytesUploaded += texture->m_gpuBytes - std::min(texture->m_gpuBytes, placeholderBytes);
+
+	}
+
+	//Finest level each texture needs to have about a texel per pixel where it was last drawn, never drawn textures need none
+	struct Wanted
+	{
+		TextureResource* texture;
+		float shortfall; //On-screen size over the resident finest level's size
+	};
+	std::vector<Wanted> wanted;
+
+	for (const std::shared_ptr<TextureResource>& texture : textures)
+	{
+
+		if (texture->m_drawnPixels > 0)
+		{
+			texture->m_lastDrawnPixels = texture->m_drawnPixels;
+		}
+		texture->m_drawnPixels = 0;
+
+		if (texture->m_placeholder || texture->m_duplicateOf || !texture->m_textureID || texture->m_residentLevel == 0)
+		{
+			continue;
+		}
+
+		const Helpers::ImageLevel& resident = UploadLevels(texture->m_image)[texture->m_residentLevel];
+		const float shortfall = texture->m_lastDrawnPixels / (float)std::max(resident.width, resident.height);
+		if (shortfall > 1.0f)
+		{
+			wanted.push_back({ texture.get(), shortfall });
+		}
+
+	}
+
+	//Largest shortfall first, a level at a time so one large texture does not hold back the rest
+	std::sort(wanted.begin(), wanted.end(), [](const Wanted& a, const Wanted& b) { return a.shortfall > b.shortfall; });
+
+	bool uploadedAny = true;
+	while (uploadedAny && (bytesUploaded < byteBudget || bytesUploaded == 0))
+	{
+
+		uploadedAny = false;
+
+		for (Wanted& entry : wanted)
+		{
+
+			TextureResource& texture = *entry.texture;
+			if (texture.m_residentLevel == 0 || entry.shortfall <= 1.0f)
+			{
+				continue;
+			}
+
+			const size_t level = texture.m_residentLevel - 1;
+
+			glBindTexture(GL_TEXTURE_2D, texture.m_textureID);
+			const size_t levelBytes = UploadLevel(texture.m_image, level);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)level);
+
+			texture.m_residentLevel = level;
+			texture.m_gpuBytes += levelBytes;
+			bytesUploaded += levelBytes;
+			entry.shortfall *= 0.5f; //Each level doubles the size
+			uploadedAny = true;
+
+			if (bytesUploaded >= byteBudget)
+			{
+				break;
+			}
+
+		}
+
+	}
+
+	return anyChanged;
+
+}
+
+void TextureManager::WaitForLoads(double maxMs)
+{
+
+	std::vector<std::shared_ptr<TextureResource>> loading;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (const std::weak_ptr<TextureResource>& entry : m_streamedTextures)
+		{
+			std::shared_ptr<TextureResource> texture = entry.lock();
+			if (texture && texture->m_load.valid())
+			{
+				loading.push_back(texture);
+			}
+		}
+	}
+
+	//Only BeginLoad replaces the futures and it has finished with these, so they are waited on without the lock
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(maxMs);
+	for (const std::shared_ptr<TextureResource>& texture : loading)
+	{
+		if (texture->m_load.wait_until(deadline) != std::future_status::ready)
+		{
+			break;
+		}
+	}
+
+}
+
+std::vector<std::string> TextureManager::GetFilenames()
+{
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<std::string> filenames;
+	for (auto& entry : m_byPath)
+	{
+		std::shared_ptr<TextureResource> texture = entry.second.lock();
+		if (texture)
+		{
+			filenames.push_back(texture->m_filename);
+		}
+	}
+
+	return filenames;
+
+}
+
+bool TextureManager::BeginReload(const std::string& filename, Helpers::ThreadPool& threadPool)
+{
+
+	std::shared_ptr<TextureResource> texture;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto entry = m_byPath.find(Helpers::CanonicalPath(filename));
+		if (entry == m_byPath.end())
+		{
+			return false;
+		}
+
+		texture = entry->second.lock();
+		if (!texture || !texture->GetID() || texture->m_placeholder) //Not uploaded yet, the first upload will read the new file anyway
+		{
+			return false;
+		}
+
+		if (texture->m_reload.valid()) //Start again once the decode in flight is done
+		{
+			texture->m_reloadAgain = true;
+			return true;
+		}
+
+		m_reloading.push_back(texture);
+	}
+
+	//The texture keeps drawing with its old pixels until the new ones are decoded
+	texture->m_reloadedImage.reset(new Helpers::ImageLoader);
+	Helpers::ImageLoader* image = texture->m_reloadedImage.get();
+	const std::string textureFile = texture->m_filename;
+	const Helpers::ImageLoadSettings settings = LoadSettings(*texture);
+	Helpers::ThreadPool* pool = &threadPool;
+	texture->m_reload = threadPool.Submit([image, textureFile, settings, pool]() { return image->Load(textureFile, settings, pool); });
+
+	return true;
+
+}
+
+bool TextureManager::FinishReloads(Helpers::ThreadPool& threadPool)
+{
+
+	std::vector<std::shared_ptr<TextureResource>> finished;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto ready = [](const std::shared_ptr<TextureResource>& texture)
+		{
+			return texture->m_reload.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		};
+
+		auto firstFinished = std::stable_partition(m_reloading.begin(), m_reloading.end(), [&ready](const std::shared_ptr<TextureResource>& texture) { return !ready(texture); });
+		finished.assign(firstFinished, m_reloading.end());
+		m_reloading.erase(firstFinished, m_reloading.end());
+	}
+
+	bool anyChanged = false;
+
+	for (const std::shared_ptr<TextureResource>& texture : finished)
+	{
+
+		const bool decoded = texture->m_reload.get();
+		std::unique_ptr<Helpers::ImageLoader> image = std::move(texture->m_reloadedImage);
+
+		if (!decoded)
+		{
+			std::cout << "Could not reload " << texture->m_filename << ", keeping the previous pixels" << std::endl;
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			//Files that shared this texture because their pixels matched keep the old pixels in a texture of their own
+			for (auto& pathEntry : m_byPath)
+			{
+				std::shared_ptr<TextureResource> other = pathEntry.second.lock();
+				if (other && other->m_duplicateOf == texture)
+				{
+					other->m_duplicateOf.reset();
+					other->m_residentLevel = 0;
+					other->m_gpuBytes = UploadPixels(other->m_textureID, other->m_image, other->m_filename, other->m_residentLevel);
+				}
+			}
+
+			//The old pixels are no longer this texture's, so it cannot be shared by their hash
+			auto contentEntry = m_byContent.find(texture->m_pixelHash);
+			if (contentEntry != m_byContent.end() && contentEntry->second.lock() == texture)
+			{
+				m_byContent.erase(contentEntry);
+			}
+			texture->m_pixelHash = 0;
+
+			//A texture that was sharing another's now needs its own, otherwise the existing GL texture is refilled
+			texture->m_duplicateOf.reset();
+			std::swap(texture->m_image, *image);
+			texture->m_residentLevel = 0; //Edited files come back in full
+			texture->m_gpuBytes = UploadPixels(texture->m_textureID, texture->m_image, texture->m_filename, texture->m_residentLevel);
+
+			std::cout << "Reloaded " << texture->m_filename << std::endl;
+			anyChanged = true;
+		}
+
+		if (texture->m_reloadAgain)
+		{
+			texture->m_reloadAgain = false;
+			BeginReload(texture->m_filename, threadPool);
+		}
+
+	}
+
+	return anyChanged;
+
+}
+
+void TextureManager::WaitForReloads()
+{
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (const std::shared_ptr<TextureResource>& texture : m_reloading)
+	{
+		texture->m_reload.wait();
+	}
+	m_reloading.clear();
+
+	for (const std::weak_ptr<TextureResource>& entry : m_streamedTextures)
+	{
+		std::shared_ptr<TextureResource> texture = entry.lock();
+		if (texture && texture->m_load.valid())
+		{
+			texture->m_load.wait();
+		}
+	}
+
+}
+
+std::string TextureManager::StatsString()
+{
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	unsigned int numLive = 0;
+	unsigned int numPartial = 0;
+	size_t gpuBytes = 0;
+	for (auto& entry : m_byPath)
+	{
+		std::shared_ptr<TextureResource> texture = entry.second.lock();
+		if (texture)
+		{
+			numLive++;
+			gpuBytes += texture->m_gpuBytes;
+			if (texture->m_placeholder || texture->m_residentLevel > 0)
+			{
+				numPartial++;
+			}
+		}
+	}
+
+	return "Textures: " + std::to_string(numLive) + " live, " +
+		std::to_string(gpuBytes / 1024) + " KB on the GPU, " +
+		std::to_string(numPartial) + " below full resolution, " +
+		std::to_string(m_pathHits) + " path hits, " +
+		std::to_string(m_pathMisses) + " path misses, " +
+		std::to_string(m_contentHits) + " duplicate contents shared";
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "ImageLoader.h"
+#include "ThreadPool.h"
+
+#include <future>
+#include <memory>
+#include <mutex>
+
+class TextureManager;
+
+//One image file decoded and uploaded once, shared by everything that references it
+class TextureResource
+{
+
+	friend class TextureManager;
+
+private:
+
+	std::string m_filename;
+
+	Helpers::ImageLoader m_image; //Decoded pixels
+	unsigned long long m_pixelHash{ 0 }; //Hash of the decoded pixels, 0 if not hashed
+
+	std::mutex m_loadMutex;
+	bool m_loadAttempted{ false };
+	bool m_loaded{ false };
+	bool m_needPixels{ false }; //Read on the CPU so kept as RGBA, never block compressed
+
+	GLuint m_textureID{ 0 };
+	size_t m_gpuBytes{ 0 }; //Texture memory including mip levels, 0 when sharing a duplicate's
+	std::shared_ptr<TextureResource> m_duplicateOf; //Set when another file had identical pixels, its texture is used instead
+
+	std::future<bool> m_load; //Background decode of a streamed texture, valid until it lands
+	bool m_loadStarted{ false }; //A background decode has been asked for, guarded by the manager's mutex
+	bool m_streamed{ false }; //Becomes resident with its smallest mips first, finer ones are uploaded as it is drawn larger
+	bool m_placeholder{ false }; //Only the 1x1 stand in is on the GPU as the decode has not landed
+	size_t m_residentLevel{ 0 }; //Finest mip level on the GPU
+	float m_drawnPixels{ 0 }; //Largest on-screen size drawn at since the last Stream
+	float m_lastDrawnPixels{ 0 }; //On-screen size the last frame it was drawn, sets its streaming priority
+
+	std::future<bool> m_reload; //Decode of the file after it changed on disk, valid while in flight
+	std::unique_ptr<Helpers::ImageLoader> m_reloadedImage; //Pixels the reload decodes into
+	bool m_reloadAgain{ false }; //The file changed again while it was being decoded
+
+public:
+
+	TextureResource(const std::string& filename) : m_filename(filename) {}
+	~TextureResource();
+
+	TextureResource(const TextureResource&) = delete;
+	TextureResource& operator=(const TextureResource&) = delete;
+
+	const std::string& GetFilename() const { return m_filename; } //File the texture was loaded from
+	GLuint GetID() const { return m_duplicateOf ? m_duplicateOf->GetID() : m_textureID; } //GL texture, 0 until uploaded
+	const Helpers::ImageLoader& GetImage() const { return m_image; } //Decoded pixels, valid after Load
+	void RecordDrawnSize(float screenPixels); //Note the texture was drawn this many pixels across, so streaming knows which mips it needs. GL thread only.
+
+};
+
+//Hands out shared GL textures keyed by canonical path, and optionally by decoded pixel contents
+//so the same image under two names is only uploaded once. Textures are reference counted through
+//shared_ptr and deleted when no longer used.
+class TextureManager
+{
+
+private:
+
+	std::map<std::string, std::weak_ptr<TextureResource>> m_byPath;
+	std::map<unsigned long long, std::weak_ptr<TextureResource>> m_byContent;
+	std::vector<std::shared_ptr<TextureResource>> m_reloading; //Textures whose changed file is being decoded
+	std::vector<std::weak_ptr<TextureResource>> m_streamedTextures; //Textures given finer mips as they are drawn larger
+	std::mutex m_mutex;
+
+	bool m_hashContents{ true };
+	Helpers::BlockFormat m_blockCompression{ Helpers::BlockFormat::Auto };
+	Helpers::MipFilter m_mipFilter{ Helpers::MipFilter::GammaCorrect };
+	bool m_streaming{ true };
+
+	Helpers::ImageLoadSettings LoadSettings(const TextureResource& texture) const; //How the texture's image is prepared
+	bool UploadLoaded(TextureResource& texture); //First upload of decoded pixels, sharing a duplicate's texture if there is one. True if it did.
+
+	//Statistics
+	unsigned int m_pathHits{ 0 };
+	unsigned int m_pathMisses{ 0 };
+	unsigned int m_contentHits{ 0 };
+
+public:
+
+	static TextureManager& Shared(); //Manager used by all Models
+
+	void SetHashContents(bool hashContents) { m_hashContents = hashContents; } //Detect duplicate files under different names
+	void SetBlockCompression(Helpers::BlockFormat format) { m_blockCompression = format; } //Compress decoded images to, None keeps them RGBA
+	void SetMipFilter(Helpers::MipFilter filter) { m_mipFilter = filter; } //Filter mip chains are built with on the loading threads
+	void SetStreaming(bool streaming) { m_streaming = streaming; } //Decode textures in the background and stream in their mips, off loads them in full up front
+
+	std::shared_ptr<TextureResource> Acquire(const std::string& filename, bool needPixels = false); //Existing texture or a new unloaded one, needPixels keeps it RGBA
+	bool Load(TextureResource& texture, Helpers::ThreadPool* threadPool = nullptr); //Decode the image the first time it is called, safe from any thread
+	bool BeginLoad(const std::shared_ptr<TextureResource>& texture, Helpers::ThreadPool& threadPool); //Decode on the pool and stream the texture in, false if streaming is off so Load should be used
+	bool Upload(TextureResource& texture); //Create the GL texture the first time it is called, GL thread only. A streamed texture still decoding gets a placeholder.
+	bool Stream(size_t byteBudget); //Once a frame on the GL thread, upload landed decodes then finer mips of the textures largest on screen first. True if any texture's ID changed.
+	void WaitForLoads(double maxMs); //Give background decodes up to maxMs to land, e.g. so the first frame shows more textures
+
+	std::vector<std::string> GetFilenames(); //Files of the textures in use, for watching
+	bool BeginReload(const std::string& filename, Helpers::ThreadPool& threadPool); //Decode a changed file again on the pool, false if no uploaded texture uses it
+	bool FinishReloads(Helpers::ThreadPool& threadPool); //Upload finished decodes into the textures' existing GL textures, GL thread only. True if any texture changed.
+	void WaitForReloads(); //Let decodes and background loads in flight finish and drop them, before the GL context goes
+
+	std::string StatsString(); //Hit / miss statistics
+
+};
@@ -0,0 +1,125 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <exception>
+
+namespace Helpers
+{
+
+	// Creates numThreads workers, 0 means one per hardware thread
+	ThreadPool::ThreadPool(unsigned int numThreads)
+	{
+		if (numThreads == 0)
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+		for (unsigned int i = 0; i < numThreads; i++)
+			m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+
+	// Finishes any queued tasks then joins the workers
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_taskAvailable.notify_all();
+
+		for (std::thread& worker : m_workers)
+			worker.join();
+	}
+
+	// Each worker takes tasks from the front of the queue until the pool is destroyed
+	void ThreadPool::WorkerLoop()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+				if (m_tasks.empty())
+					return;
+
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+
+	// Runs task(i) for every i in [0, count) spread across the pool's workers and the calling thread
+	void ParallelFor(ThreadPool* threadPool, size_t count, const std::function<void(size_t)>& task)
+	{
+		if (!threadPool || count < 2)
+		{
+			for (size_t i = 0; i < count; i++)
+				task(i);
+			return;
+		}
+
+		// Shared so helpers that only get to run after the loop has finished can still safely see it is done
+		struct LoopState
+		{
+			std::function<void(size_t)> task;
+			size_t count{ 0 };
+			std::atomic<size_t> nextIndex{ 0 };
+			std::atomic<size_t> numCompleted{ 0 };
+			std::mutex mutex;
+			std::condition_variable allCompleted;
+
+			// First exception thrown by an item, rethrown on the caller. Once set the remaining items are skipped.
+			std::exception_ptr firstException;
+			std::atomic<bool> failed{ false };
+		};
+
+		auto state = std::make_shared<LoopState>();
+		state->task = task;
+		state->count = count;
+
+		auto runItems = [](LoopState& loop)
+		{
+			size_t i;
+			while ((i = loop.nextIndex++) < loop.count)
+			{
+				// Every item must count as completed, even one that throws, or the caller would wait forever
+				if (!loop.failed)
+				{
+					try
+					{
+						loop.task(i);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(loop.mutex);
+						if (!loop.firstException)
+							loop.firstException = std::current_exception();
+						loop.failed = true;
+					}
+				}
+
+				if (++loop.numCompleted == loop.count)
+				{
+					std::lock_guard<std::mutex> lock(loop.mutex);
+					loop.allCompleted.notify_all();
+				}
+			}
+		};
+
+		const size_t numHelpers{ std::min(count - 1, (size_t)threadPool->NumThreads()) };
+		for (size_t h = 0; h < numHelpers; h++)
+			threadPool->Submit([state, runItems]() { runItems(*state); });
+
+		runItems(*state);
+
+		// Only items already claimed by running helpers can be outstanding here
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->allCompleted.wait(lock, [&state]() { return state->numCompleted == state->count; });
+
+		if (state->firstException)
+			std::rethrow_exception(state->firstException);
+	}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Helpers
+{
+
+	// Fixed set of worker threads that run submitted tasks in order of submission
+	// Used for CPU side work such as model import and image decode. Never submit OpenGL calls,
+	// the GL context only belongs to the main thread.
+	class ThreadPool
+	{
+	private:
+		std::vector<std::thread> m_workers;
+		std::deque<std::function<void()>> m_tasks;
+		std::mutex m_mutex;
+		std::condition_variable m_taskAvailable;
+		bool m_stopping{ false };
+
+		void WorkerLoop();
+	public:
+		// Creates numThreads workers, 0 means one per hardware thread
+		explicit ThreadPool(unsigned int numThreads = 0);
+
+		// Finishes any queued tasks then joins the workers
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// Number of worker threads
+		unsigned int NumThreads() const { return (unsigned int)m_workers.size(); }
+
+		// Queue a task, the returned future provides its result once complete
+		template<typename Task>
+		auto Submit(Task&& task) -> std::future<decltype(task())>
+		{
+			using Result = decltype(task());
+
+			// std::function needs a copyable target so the packaged task is shared
+			auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+			std::future<Result> result{ packaged->get_future() };
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_tasks.emplace_back([packaged]() { (*packaged)(); });
+			}
+			m_taskAvailable.notify_one();
+
+			return result;
+		}
+	};
+
+	// Runs task(i) for every i in [0, count) spread across the pool's workers and the calling thread.
+	// The caller helps rather than blocking so this is safe to use from inside a pool task.
+	// With a null threadPool everything runs in order on the calling thread.
+	// If a task throws, the rest are skipped and the first exception is rethrown on the caller once all running items finish.
+	void ParallelFor(ThreadPool* threadPool, size_t count, const std::function<void(size_t)>& task);
+
+}
@@ -0,0 +1,223 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace Helpers
+{
+	static_assert(sizeof(FullVertex) == 32, "FullVertex must be tightly packed");
+	static_assert(sizeof(CompactVertex) == 16, "CompactVertex must be tightly packed");
+
+	// Convert to IEEE half precision, rounding to nearest
+	unsigned short FloatToHalf(float value)
+	{
+		unsigned int bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		const unsigned int sign{ (bits >> 16) & 0x8000u };
+		const int exponent{ (int)((bits >> 23) & 0xff) - 127 + 15 };
+		unsigned int mantissa{ bits & 0x7fffffu };
+
+		// NaN stays NaN, infinity and anything too big become infinity
+		if (((bits >> 23) & 0xff) == 0xff)
+			return (unsigned short)(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+		if (exponent >= 31)
+			return (unsigned short)(sign | 0x7c00u);
+
+		// Too small for a normal half, shift into a denormal or flush to zero
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+				return (unsigned short)sign;
+
+			mantissa |= 0x800000u;
+			const int shift{ 14 - exponent };
+			unsigned int half{ mantissa >> shift };
+			const unsigned int remainder{ mantissa & ((1u << shift) - 1) };
+			const unsigned int halfway{ 1u << (shift - 1) };
+			if (remainder > halfway || (remainder == halfway && (half & 1)))
+				half++;
+			return (unsigned short)(sign | half);
+		}
+
+		// Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+		unsigned int half{ ((unsigned int)exponent << 10) | (mantissa >> 13) };
+		const unsigned int remainder{ mantissa & 0x1fffu };
+		if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1)))
+			half++;
+		return (unsigned short)(sign | half);
+	}
+
+	// Convert from IEEE half precision
+	float HalfToFloat(unsigned short value)
+	{
+		const unsigned int sign{ (unsigned int)(value & 0x8000u) << 16 };
+		const unsigned int exponent{ (value >> 10) & 0x1fu };
+		const unsigned int mantissa{ value & 0x3ffu };
+
+		float result;
+		if (exponent == 0)
+			result = std::ldexp((float)mantissa, -24);
+		else if (exponent == 31)
+			result = mantissa ? std::numeric_limits<float>::quiet_NaN() : std::numeric_limits<float>::infinity();
+		else
+			result = std::ldexp((float)(mantissa | 0x400u), (int)exponent - 25);
+
+		return sign ? -result : result;
+	}
+
+	// Octahedral normal encoding, unit vector to a point in -1..1 square
+	glm::vec2 OctEncode(const glm::vec3& normal)
+	{
+		const float sum{ std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z) };
+		if (sum == 0)
+			return glm::vec2(0);
+
+		glm::vec2 encoded{ normal.x / sum, normal.y / sum };
+
+		// The lower half of the octahedron folds out over the corners
+		if (normal.z < 0)
+		{
+			encoded = glm::vec2((1.0f - std::abs(encoded.y)) * (encoded.x >= 0 ? 1.0f : -1.0f),
+				(1.0f - std::abs(encoded.x)) * (encoded.y >= 0 ? 1.0f : -1.0f));
+		}
+
+		return encoded;
+	}
+
+	// Octahedral normal decoding, matches oct_decode in the vertex shader
+	glm::vec3 OctDecode(const glm::vec2& encoded)
+	{
+		glm::vec3 normal{ encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y) };
+		if (normal.z < 0)
+		{
+			normal.x = (1.0f - std::abs(encoded.y)) * (encoded.x >= 0 ? 1.0f : -1.0f);
+			normal.y = (1.0f - std::abs(encoded.x)) * (encoded.y >= 0 ? 1.0f : -1.0f);
+		}
+		return glm::normalize(normal);
+	}
+
+	// Encode a mesh's data compactly, octNormalBits is 8 or 16
+	void EncodeCompact(const Mesh& mesh, CompactVertexData& out, int octNormalBits)
+	{
+		const size_t numVertices{ mesh.vertices.size() };
+
+		// Positions are spread over the full 16 bit range of the mesh bounds
+		BoundingBox bounds{ mesh.boundingBox.IsValid() ? mesh.boundingBox : ComputeBoundingBox(mesh.vertices.data(), numVertices) };
+		if (!bounds.IsValid())
+			bounds.minExtents = bounds.maxExtents = glm::vec3(0);
+
+		// A flat axis, such as the height of a planar mesh, keeps a scale of 1 and quantises to 0 so it decodes to the offset exactly
+		out.positionOffset = bounds.minExtents;
+		out.positionScale = glm::vec3(1.0f);
+		glm::vec3 toUnit{ 0 };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float extent{ bounds.maxExtents[axis] - bounds.minExtents[axis] };
+			const float magnitude{ glm::max(1.0f, glm::max(std::abs(bounds.minExtents[axis]), std::abs(bounds.maxExtents[axis]))) };
+			if (extent > std::numeric_limits<float>::epsilon() * magnitude)
+			{
+				out.positionScale[axis] = extent;
+				toUnit[axis] = 65535.0f / extent;
+			}
+		}
+
+		out.positions.resize(numVertices * 4);
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			const glm::vec3 quantised{ glm::clamp((mesh.vertices[i] - out.positionOffset) * toUnit + 0.5f, glm::vec3(0), glm::vec3(65535.0f)) };
+			out.positions[i * 4 + 0] = (unsigned short)quantised.x;
+			out.positions[i * 4 + 1] = (unsigned short)quantised.y;
+			out.positions[i * 4 + 2] = (unsigned short)quantised.z;
+			out.positions[i * 4 + 3] = 0;
+		}
+
+		// Normals, stored native endian so the GPU reads the 16 bit values directly
+		out.octNormalBits = octNormalBits == 8 ? 8 : 16;
+		const float normalMax{ out.octNormalBits == 8 ? 255.0f : 65535.0f };
+		const size_t normalBytes{ (size_t)out.octNormalBits / 8 };
+		out.normals.resize(mesh.normals.size() * 2 * normalBytes);
+		for (size_t i = 0; i < mesh.normals.size(); i++)
+		{
+			const glm::vec2 encoded{ glm::clamp(OctEncode(mesh.normals[i]) * 0.5f + 0.5f, glm::vec2(0), glm::vec2(1)) * normalMax + 0.5f };
+			for (int axis = 0; axis < 2; axis++)
+			{
+				const unsigned short value{ (unsigned short)encoded[axis] };
+				if (normalBytes == 1)
+					out.normals[i * 2 + axis] = (unsigned char)value;
+				else
+					std::memcpy(&out.normals[(i * 2 + axis) * 2], &value, sizeof(value));
+			}
+		}
+
+		out.uvCoords.resize(mesh.uvCoords.size() * 2);
+		for (size_t i = 0; i < mesh.uvCoords.size(); i++)
+		{
+			out.uvCoords[i * 2 + 0] = FloatToHalf(mesh.uvCoords[i].x);
+			out.uvCoords[i * 2 + 1] = FloatToHalf(mesh.uvCoords[i].y);
+		}
+
+		out.elements16.clear();
+		if (numVertices <= 65536)
+		{
+			out.elements16.assign(mesh.elements.begin(), mesh.elements.end());
+			out.elements16.insert(out.elements16.end(), mesh.lodElements.begin(), mesh.lodElements.end());
+		}
+	}
+
+	// Build interleaved vertices, missing normals or UVs are zeroed
+	void InterleaveFull(const Mesh& mesh, std::vector<FullVertex>& out)
+	{
+		const size_t numVertices{ mesh.vertices.size() };
+		out.assign(numVertices, FullVertex{ glm::vec3(0), glm::vec3(0), glm::vec2(0) });
+
+		for (size_t i = 0; i < numVertices; i++)
+			out[i].position = mesh.vertices[i];
+		for (size_t i = 0; i < std::min(numVertices, mesh.normals.size()); i++)
+			out[i].normal = mesh.normals[i];
+		for (size_t i = 0; i < std::min(numVertices, mesh.uvCoords.size()); i++)
+			out[i].uvCoord = mesh.uvCoords[i];
+	}
+
+	void InterleaveCompact(const CompactVertexData& compact, size_t numVertices, std::vector<CompactVertex>& out)
+	{
+		out.assign(numVertices, CompactVertex{});
+
+		const bool wideNormals{ compact.octNormalBits == 16 };
+		const size_t numNormals{ std::min(numVertices, compact.normals.size() / (wideNormals ? 4 : 2)) };
+		const size_t numUVs{ std::min(numVertices, compact.uvCoords.size() / 2) };
+
+		for (size_t i = 0; i < numVertices; i++)
+			std::memcpy(out[i].position, &compact.positions[i * 4], sizeof(out[i].position));
+
+		for (size_t i = 0; i < numNormals; i++)
+		{
+			if (wideNormals)
+			{
+				std::memcpy(out[i].normal, &compact.normals[i * 4], sizeof(out[i].normal));
+			}
+			else
+			{
+				// Widen 8 bit to 16 bit, 255 * 257 = 65535 so values map exactly
+				out[i].normal[0] = (unsigned short)(compact.normals[i * 2 + 0] * 257);
+				out[i].normal[1] = (unsigned short)(compact.normals[i * 2 + 1] * 257);
+			}
+		}
+
+		for (size_t i = 0; i < numUVs; i++)
+		{
+			out[i].uvCoord[0] = compact.uvCoords[i * 2 + 0];
+			out[i].uvCoord[1] = compact.uvCoords[i * 2 + 1];
+		}
+	}
+
+	// Bytes the mesh needs on the GPU with VertexEncoding::Full
+	size_t FullEncodingBytes(const Mesh& mesh)
+	{
+		return mesh.vertices.size() * sizeof(glm::vec3) + mesh.normals.size() * sizeof(glm::vec3) +
+			mesh.uvCoords.size() * sizeof(glm::vec2) + (mesh.elements.size() + mesh.lodElements.size()) * sizeof(unsigned int);
+	}
+
+}
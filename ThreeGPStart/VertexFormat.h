@@ -0,0 +1,79 @@
+#pragma once
+// Encodings of mesh vertex data for upload to the GPU
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+
+namespace Helpers
+{
+
+	// How a mesh's vertex and element data is stored in GPU buffers
+	enum class VertexEncoding
+	{
+		Full,		// 32 bit float positions, normals and UVs with 32 bit elements
+		Compact		// 16 bit positions relative to the bounds, octahedral normals, half float UVs and 16 bit elements where they fit
+	};
+
+	// How vertex attributes are arranged in GPU buffers
+	enum class VertexLayout
+	{
+		Interleaved,	// One buffer per mesh holding whole vertices, each vertex fetch touches one cache line
+		Separate		// One buffer per attribute, kept to compare against
+	};
+
+	// Interleaved vertex with VertexEncoding::Full, 32 bytes
+	struct FullVertex
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uvCoord;
+	};
+
+	// Interleaved vertex with VertexEncoding::Compact, 16 bytes
+	// Normals are always 16 bit here as 8 bit ones would only be padded back out to keep the UVs aligned
+	struct CompactVertex
+	{
+		unsigned short position[4];
+		unsigned short normal[2];
+		unsigned short uvCoord[2];
+	};
+
+	// Compact encoding of one mesh, every value is unsigned normalised or half float so needs no GL version specific handling
+	struct CompactVertexData
+	{
+		// Four 16 bit values per vertex, xyz then padding, decoded as positionOffset + value * positionScale
+		std::vector<unsigned short> positions;
+		glm::vec3 positionOffset{ 0 };
+		glm::vec3 positionScale{ 1 };
+
+		// Two values per vertex of octNormalBits each, an octahedral encoding mapped from -1..1 to 0..1
+		std::vector<unsigned char> normals;
+		int octNormalBits{ 16 };
+
+		// Two half floats per vertex
+		std::vector<unsigned short> uvCoords;
+
+		// Elements followed by the level of detail elements narrowed to 16 bits, empty when there are too many vertices and
+		// the 32 bit originals must be used
+		std::vector<unsigned short> elements16;
+	};
+
+	// Convert to and from IEEE half precision, rounding to nearest
+	unsigned short FloatToHalf(float value);
+	float HalfToFloat(unsigned short value);
+
+	// Octahedral normal encoding, unit vector to a point in -1..1 square and back
+	glm::vec2 OctEncode(const glm::vec3& normal);
+	glm::vec3 OctDecode(const glm::vec2& encoded);
+
+	// Encode a mesh's data compactly, octNormalBits is 8 or 16
+	void EncodeCompact(const Mesh& mesh, CompactVertexData& out, int octNormalBits = 16);
+
+	// Build interleaved vertices, missing normals or UVs are zeroed
+	void InterleaveFull(const Mesh& mesh, std::vector<FullVertex>& out);
+	void InterleaveCompact(const CompactVertexData& compact, size_t numVertices, std::vector<CompactVertex>& out);
+
+	// Bytes the mesh needs on the GPU with VertexEncoding::Full
+	size_t FullEncodingBytes(const Mesh& mesh);
+
+}
@@ -21,9 +21,14 @@
 #include "ExternalLibraryHeaders.h"
 #include "Helper.h"
 #include "Simulation.h"
+#include "Benchmark.h"
 
-int main()
+int main(int argc, char* argv[])
 {
+	// Run a benchmark instead of the simulation if asked, e.g. ThreeGPStart --benchmark import
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+		return Benchmarks::Run(argc > 2 ? argv[2] : "");
+
 	// Use the helper function to set up GLFW, GLEW and OpenGL
 	GLFWwindow* window{ Helpers::CreateGLFWWindow(1024, 768, "Simple example") };
 	if (!window)